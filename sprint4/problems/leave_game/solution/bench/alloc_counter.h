@@ -0,0 +1,32 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+namespace alloc_counter {
+
+// Число вызовов operator new с начала работы процесса
+uint64_t GetAllocations();
+
+// Записывает в счётчик allocs среднее число выделений памяти на итерацию
+class Scope {
+public:
+    explicit Scope(benchmark::State& state)
+        : state_(state)
+        , start_(GetAllocations()) {
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    ~Scope() {
+        state_.counters["allocs"] = benchmark::Counter(static_cast<double>(GetAllocations() - start_),
+                                                       benchmark::Counter::kAvgIterations);
+    }
+private:
+    benchmark::State& state_;
+    uint64_t start_;
+};
+
+} // namespace alloc_counter
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/model.h"
+
+namespace bench_data {
+
+// В картах из data/config.json от 4 до 22 дорог, поэтому замеры идут
+// на тех же размерах и на увеличенных в 4 и 16 раз
+const std::vector<int64_t> ROAD_COUNTS = {4, 22, 88, 352};
+
+const int ROAD_STEP = 10;
+
+// Сетка из road_count / 2 горизонтальных и стольких же вертикальных дорог
+inline model::Map MakeGridMap(int64_t road_count) {
+    int lines = std::max<int>(static_cast<int>(road_count / 2), 2);
+    int size = (lines - 1) * ROAD_STEP;
+
+    model::Map map{model::Map::Id{"bench"}, "bench map", {1.}};
+
+    for (int i = 0; i < lines; ++i) {
+        map.AddRoad({model::Road::HORIZONTAL, {0, i * ROAD_STEP}, size});
+        map.AddRoad({model::Road::VERTICAL, {i * ROAD_STEP, 0}, size});
+    }
+
+    for (int i = 0; i + 1 < lines; ++i) {
+        map.AddBuilding(model::Building{{{i * ROAD_STEP + 2, i * ROAD_STEP + 2}, {ROAD_STEP - 4, ROAD_STEP - 4}}});
+    }
+
+    map.AddOffice({model::Office::Id{"o0"}, {0, 0}, {5, 0}});
+
+    for (int i = 0; i < 2; ++i) {
+        model::LootType type;
+        type.name = "type" + std::to_string(i);
+        type.file = "assets/" + type.name + ".obj";
+        type.type = model::LootSort::obj;
+        type.scale = 0.5;
+        type.value = 10;
+        map.AddLootType(std::move(type));
+    }
+
+    return map;
+}
+
+inline std::mt19937_64& GetGenerator() {
+    static std::mt19937_64 generator{42};
+    return generator;
+}
+
+inline double GetRandom(double from, double to) {
+    return std::uniform_real_distribution<double>{from, to}(GetGenerator());
+}
+
+} // namespace bench_data
@@ -0,0 +1,56 @@
+#include "alloc_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Результаты в JSON для сравнения между коммитами:
+//   game_server_bench --benchmark_out=bench.json --benchmark_out_format=json
+
+namespace alloc_counter {
+
+namespace detail {
+
+std::atomic<uint64_t> allocations = 0;
+
+void* Allocate(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+} // namespace detail
+
+uint64_t GetAllocations() {
+    return detail::allocations.load(std::memory_order_relaxed);
+}
+
+} // namespace alloc_counter
+
+void* operator new(std::size_t size) {
+    return alloc_counter::detail::Allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return alloc_counter::detail::Allocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,101 @@
+#include <benchmark/benchmark.h>
+
+#include "alloc_counter.h"
+#include "bench_data.h"
+
+#include "../src/collision_detector.h"
+#include "../src/game_manager.h"
+#include "../src/loot_generator.h"
+#include "../src/move_manager.h"
+
+namespace {
+
+using namespace std::literals;
+
+void BM_FindGatherEvents(benchmark::State& state) {
+    const int64_t gatherers = state.range(0);
+    const int64_t items = state.range(1);
+    const double size = 100.;
+
+    game_manager::GameProvider provider;
+    for (int64_t i = 0; i < items; ++i) {
+        provider.AddItem({{bench_data::GetRandom(0, size), bench_data::GetRandom(0, size)},
+                          model::ITEM_WIDTH, false});
+    }
+    for (int64_t i = 0; i < gatherers; ++i) {
+        geom::Point2D start{bench_data::GetRandom(0, size), bench_data::GetRandom(0, size)};
+        geom::Point2D end{start.x + bench_data::GetRandom(-1, 1), start.y};
+        provider.AddGatherer({start, end, model::DOG_WIDTH});
+    }
+
+    alloc_counter::Scope allocs{state};
+    for (auto _ : state) {
+        auto events = collision_detector::FindGatherEvents(provider);
+        benchmark::DoNotOptimize(events);
+    }
+    state.SetComplexityN(gatherers * items);
+}
+BENCHMARK(BM_FindGatherEvents)->ArgsProduct({{10, 100, 1000}, {10, 100, 1000}})->Complexity();
+
+move_manager::Speed GetSpeed(move_manager::Direction dir, double speed) {
+    using move_manager::Direction;
+    switch (dir) {
+    case Direction::NORTH:
+        return {0, -speed};
+    case Direction::SOUTH:
+        return {0, speed};
+    case Direction::WEST:
+        return {-speed, 0};
+    case Direction::EAST:
+        return {speed, 0};
+    default:
+        return {0, 0};
+    }
+}
+
+void BM_StateMove(benchmark::State& state) {
+    const int64_t roads = state.range(0);
+    const int64_t players = state.range(1);
+    const uint64_t tick_ms = 50;
+
+    model::Map map = bench_data::MakeGridMap(roads);
+    move_manager::Map move_map{map};
+
+    std::vector<move_manager::State> dogs(players);
+    for (move_manager::State& dog : dogs) {
+        dog.position = move_map.GetRandomPlace(bench_data::GetGenerator());
+    }
+
+    std::uniform_int_distribution<int> dir_dist{0, 3};
+
+    alloc_counter::Scope allocs{state};
+    for (auto _ : state) {
+        for (move_manager::State& dog : dogs) {
+            if (dog.speed.IsNull()) {
+                dog.dir = static_cast<move_manager::Direction>(dir_dist(bench_data::GetGenerator()));
+                dog.speed = GetSpeed(dog.dir, 3.);
+            }
+            dog.Move(tick_ms);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * players);
+}
+BENCHMARK(BM_StateMove)->ArgsProduct({bench_data::ROAD_COUNTS, {10, 100, 1000}});
+
+void BM_LootGenerate(benchmark::State& state) {
+    const auto looters = static_cast<unsigned>(state.range(0));
+    loot_gen::LootGenerator generator{5s, 0.5, [] {
+        return bench_data::GetRandom(0, 1);
+    }};
+
+    unsigned loot = 0;
+    alloc_counter::Scope allocs{state};
+    for (auto _ : state) {
+        loot += generator.Generate(50ms, loot % looters, looters);
+        benchmark::DoNotOptimize(loot);
+    }
+}
+BENCHMARK(BM_LootGenerate)->Arg(10)->Arg(1000);
+
+} // namespace
@@ -0,0 +1,121 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+
+#include "alloc_counter.h"
+#include "bench_data.h"
+
+#include "../src/api_handler.h"
+#include "../src/body_types.h"
+#include "../src/http_server.h"
+#include "../src/model_serialization.h"
+#include "../src/state_codec.h"
+
+namespace {
+
+using namespace std::literals;
+
+void BM_DecodeURL(benchmark::State& state) {
+    const std::array targets = {
+        "/api/v1/game/state"sv,
+        "/api/v1/maps/map1"sv,
+        "/images/some%20image%20name.png"sv,
+        "/hall_of_fame.html?start=0&maxItems=100"sv,
+        "/%D0%BA%D0%B0%D1%80%D1%82%D0%B0+%D0%B3%D0%BE%D1%80%D0%BE%D0%B4%D0%B0.json"sv
+    };
+
+    alloc_counter::Scope allocs{state};
+    for (auto _ : state) {
+        for (std::string_view target : targets) {
+            benchmark::DoNotOptimize(url_decode::DecodeURL(target));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * targets.size());
+}
+BENCHMARK(BM_DecodeURL);
+
+void BM_GetTypeByExtention(benchmark::State& state) {
+    const std::array files = {
+        ".html"sv, ".js"sv, ".css"sv, ".png"sv, ".obj"sv, ".JPEG"sv, ".unknown"sv, ""sv
+    };
+
+    alloc_counter::Scope allocs{state};
+    for (auto _ : state) {
+        for (std::string_view file : files) {
+            benchmark::DoNotOptimize(body_type::GetTypeByExtention(file));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * files.size());
+}
+BENCHMARK(BM_GetTypeByExtention);
+
+struct SessionState {
+    std::deque<game_manager::Player> players;
+    game_manager::LootObjectsContainer objects;
+};
+
+SessionState MakeSessionState(int64_t players_count) {
+    SessionState result;
+    auto& [players, objects] = result;
+    for (int64_t i = 0; i < players_count; ++i) {
+        game_manager::Player& player = players.emplace_back();
+        player.id = i;
+        player.name = "Player " + std::to_string(i);
+        player.state.position.coor = {bench_data::GetRandom(0, 100), bench_data::GetRandom(0, 100)};
+        player.state.speed = {1., 0.};
+        player.items_in_bag = {{static_cast<size_t>(i), 0}};
+
+        objects.push_back({static_cast<size_t>(i % 2),
+                           {bench_data::GetRandom(0, 100), bench_data::GetRandom(0, 100)},
+                           static_cast<size_t>(i)});
+    }
+    return result;
+}
+
+// Тело ответа /api/v1/game/state. Счётчик bytes - размер тела
+void BM_StateJson(benchmark::State& state) {
+    const auto [players, objects] = MakeSessionState(state.range(0));
+
+    size_t bytes = 0;
+    alloc_counter::Scope allocs{state};
+    for (auto _ : state) {
+        boost::json::object stat;
+        stat[json_keys::players_key] = api_handler::ApiHandler::MakePlayersJson(players);
+        stat[json_keys::lost_objects_key] = api_handler::ApiHandler::MakeLootObjectsJson(objects);
+        std::string body = boost::json::serialize(stat);
+        bytes = body.size();
+        benchmark::DoNotOptimize(body);
+    }
+    state.SetItemsProcessed(state.iterations() * players.size());
+    state.counters["bytes"] = static_cast<double>(bytes);
+}
+BENCHMARK(BM_StateJson)->RangeMultiplier(10)->Range(1, 1000);
+
+// То же в формате application/x-game-state
+void BM_StateBinary(benchmark::State& state) {
+    const auto [players, objects] = MakeSessionState(state.range(0));
+
+    size_t bytes = 0;
+    alloc_counter::Scope allocs{state};
+    for (auto _ : state) {
+        std::string body = state_codec::EncodeState({players, objects});
+        bytes = body.size();
+        benchmark::DoNotOptimize(body);
+    }
+    state.SetItemsProcessed(state.iterations() * players.size());
+    state.counters["bytes"] = static_cast<double>(bytes);
+}
+BENCHMARK(BM_StateBinary)->RangeMultiplier(10)->Range(1, 1000);
+
+// Тело ответа /api/v1/maps/{id}
+void BM_MapJson(benchmark::State& state) {
+    model::Map map = bench_data::MakeGridMap(state.range(0));
+
+    alloc_counter::Scope allocs{state};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(boost::json::serialize(boost::json::value_from(map)));
+    }
+}
+BENCHMARK(BM_MapJson)->ArgsProduct({bench_data::ROAD_COUNTS});
+
+} // namespace
@@ -0,0 +1,75 @@
+#include <benchmark/benchmark.h>
+
+#include <sstream>
+
+#include "alloc_counter.h"
+#include "bench_data.h"
+
+#include "../src/game_serialization.h"
+
+namespace {
+
+game_manager::GameRepr MakeRepr(int64_t players, int64_t loot) {
+    game_manager::GameRepr repr;
+    repr.players_number = players;
+
+    game_manager::GameSessionRepr& session = repr.sessions.emplace_back();
+    session.map_name = "town";
+
+    for (int64_t i = 0; i < players; ++i) {
+        game_manager::Player player;
+        player.id = i;
+        player.name = "Player " + std::to_string(i);
+        player.state.position.coor = {bench_data::GetRandom(0, 100), bench_data::GetRandom(0, 100)};
+        player.state.position.area = nullptr;
+        player.items_in_bag = {{static_cast<size_t>(i), 0}, {static_cast<size_t>(i + 1), 1}};
+        player.score = i * 10;
+        session.players.push_back(std::move(player));
+
+        repr.players.push_back({std::string(32, 'a' + i % 26), static_cast<size_t>(i)});
+    }
+
+    for (int64_t i = 0; i < loot; ++i) {
+        session.loot_objects.push_back({static_cast<size_t>(i % 2),
+                                        {bench_data::GetRandom(0, 100), bench_data::GetRandom(0, 100)},
+                                        static_cast<size_t>(i)});
+    }
+
+    return repr;
+}
+
+void BM_TextArchiveSave(benchmark::State& state) {
+    game_manager::GameRepr repr = MakeRepr(state.range(0), state.range(0));
+
+    alloc_counter::Scope allocs{state};
+    for (auto _ : state) {
+        std::ostringstream out;
+        boost::archive::text_oarchive archive(out);
+        archive << repr;
+        state.SetBytesProcessed(state.bytes_processed() + out.tellp());
+    }
+}
+BENCHMARK(BM_TextArchiveSave)->RangeMultiplier(10)->Range(10, 10000);
+
+void BM_TextArchiveLoad(benchmark::State& state) {
+    std::ostringstream out;
+    {
+        game_manager::GameRepr repr = MakeRepr(state.range(0), state.range(0));
+        boost::archive::text_oarchive archive(out);
+        archive << repr;
+    }
+    const std::string data = out.str();
+
+    alloc_counter::Scope allocs{state};
+    for (auto _ : state) {
+        std::istringstream in(data);
+        boost::archive::text_iarchive archive(in);
+        game_manager::GameRepr repr;
+        archive >> repr;
+        benchmark::DoNotOptimize(repr);
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_TextArchiveLoad)->RangeMultiplier(10)->Range(10, 10000);
+
+} // namespace
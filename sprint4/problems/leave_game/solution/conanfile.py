@@ -0,0 +1,18 @@
+from conans import ConanFile
+
+
+class GameServerConan(ConanFile):
+    settings = "os", "compiler", "build_type", "arch"
+    generators = "cmake_multi"
+    # Должна совпадать с опцией GAME_IO_URING в CMakeLists.txt
+    options = {"io_uring": [True, False]}
+    default_options = {"io_uring": False}
+
+    def requirements(self):
+        self.requires("boost/1.78.0")
+        self.requires("catch2/3.1.0")
+        self.requires("libpqxx/7.7.4")
+        self.requires("benchmark/1.7.1")
+        self.requires("libnghttp2/1.59.0")
+        if self.options.io_uring:
+            self.requires("liburing/2.2")
@@ -0,0 +1,208 @@
+#include "admission.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <stdexcept>
+
+#include "json_keys.h"
+
+namespace admission {
+
+using namespace std::literals;
+
+namespace detail {
+
+struct RejectionInfo {
+    std::string_view status;
+    std::string_view code;
+    std::string_view message;
+    bool close;
+};
+
+RejectionInfo GetRejectionInfo(Reason reason) {
+    switch (reason) {
+    case Reason::connections:
+        return {"503 Service Unavailable"sv, "serverOverloaded"sv, "Too many connections"sv, true};
+    case Reason::ip_rate:
+        return {"429 Too Many Requests"sv, "tooManyRequests"sv, "Too many requests from this address"sv, false};
+    case Reason::token_rate:
+        return {"429 Too Many Requests"sv, "tooManyRequests"sv, "Too many requests for this player"sv, false};
+    case Reason::session_queue:
+        return {"503 Service Unavailable"sv, "serverOverloaded"sv, "Game session is overloaded"sv, false};
+    default:
+        throw std::invalid_argument("Unknown admission reason");
+    }
+}
+
+std::string MakeRejection(Reason reason, std::chrono::seconds retry_after) {
+    RejectionInfo info = GetRejectionInfo(reason);
+
+    std::string body = "{\"code\":\""s + std::string{info.code} + "\",\"message\":\""s
+                       + std::string{info.message} + "\"}"s;
+
+    std::string result = "HTTP/1.1 "s + std::string{info.status} + "\r\n"s;
+    result += "Content-Type: application/json\r\n"s;
+    result += "Cache-Control: no-cache\r\n"s;
+    result += "Retry-After: "s + std::to_string(retry_after.count()) + "\r\n"s;
+    if (info.close) {
+        result += "Connection: close\r\n"s;
+    }
+    result += "Content-Length: "s + std::to_string(body.size()) + "\r\n\r\n"s;
+    result += body;
+    return result;
+}
+
+// Токен игрока из заголовка Authorization: 32 шестнадцатеричные цифры
+std::optional<std::string_view> GetPlayerToken(std::string_view authorization) {
+    constexpr size_t TOKEN_SIZE = 32;
+
+    if (!authorization.starts_with(json_keys::token_prefix)) {
+        return std::nullopt;
+    }
+    std::string_view token = authorization.substr(json_keys::token_prefix.size());
+    if (token.size() != TOKEN_SIZE || !std::all_of(token.begin(), token.end(), [](unsigned char c) {
+            return std::isxdigit(c);
+        })) {
+        return std::nullopt;
+    }
+    return token;
+}
+
+} // namespace detail
+
+std::string_view GetReasonName(Reason reason) {
+    switch (reason) {
+    case Reason::connections:
+        return "connections"sv;
+    case Reason::ip_rate:
+        return "ip_rate"sv;
+    case Reason::token_rate:
+        return "token_rate"sv;
+    case Reason::session_queue:
+        return "session_queue"sv;
+    default:
+        return "unknown"sv;
+    }
+}
+
+RateLimiter::RateLimiter(double rate, double burst)
+    : rate_(rate)
+    , burst_(std::max(burst, 1.)) {
+}
+
+bool RateLimiter::TryAcquire(std::string_view key, Clock::time_point now) {
+    Shard& shard = shards_[std::hash<std::string_view>{}(key) % SHARDS];
+    std::lock_guard lock{shard.mutex};
+
+    auto it = shard.buckets.find(key);
+    if (it == shard.buckets.end()) {
+        if (shard.buckets.size() >= MAX_SHARD_KEYS) {
+            shard.buckets.erase(shard.buckets.find(shard.lru.back()));
+            shard.lru.pop_back();
+        }
+        it = shard.buckets.emplace(std::string{key}, Bucket{burst_, now, {}}).first;
+        shard.lru.push_front(it->first);
+        it->second.lru = shard.lru.begin();
+    } else {
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lru);
+    }
+
+    Bucket& bucket = it->second;
+    std::chrono::duration<double> elapsed = now - bucket.updated;
+    bucket.tokens = std::min(burst_, bucket.tokens + elapsed.count() * rate_);
+    bucket.updated = now;
+
+    if (bucket.tokens < 1.) {
+        return false;
+    }
+    bucket.tokens -= 1.;
+    return true;
+}
+
+std::chrono::seconds RateLimiter::GetRetryAfter() const {
+    return std::chrono::seconds{std::max<int64_t>(1, static_cast<int64_t>(std::ceil(1. / rate_)))};
+}
+
+Admission& Admission::GetInstance() {
+    static Admission admission;
+    return admission;
+}
+
+Admission::Admission() {
+    retry_after_.fill(1s);
+    for (size_t i = 0; i < REASONS; ++i) {
+        rejections_[i] = detail::MakeRejection(static_cast<Reason>(i), retry_after_[i]);
+    }
+
+    metrics::Registry::GetInstance().AddCollector([this](std::ostream& out) {
+        WriteMetrics(out);
+    });
+}
+
+void Admission::Configure(const Limits& limits) {
+    limits_ = limits;
+
+    ip_limiter_.reset();
+    token_limiter_.reset();
+
+    if (limits.ip_rate > 0) {
+        ip_limiter_ = std::make_unique<RateLimiter>(limits.ip_rate, limits.ip_burst);
+        retry_after_[static_cast<size_t>(Reason::ip_rate)] = ip_limiter_->GetRetryAfter();
+    }
+    if (limits.token_rate > 0) {
+        token_limiter_ = std::make_unique<RateLimiter>(limits.token_rate, limits.token_burst);
+        retry_after_[static_cast<size_t>(Reason::token_rate)] = token_limiter_->GetRetryAfter();
+    }
+
+    for (size_t i = 0; i < REASONS; ++i) {
+        rejections_[i] = detail::MakeRejection(static_cast<Reason>(i), retry_after_[i]);
+    }
+}
+
+bool Admission::TryOpenConnection() {
+    size_t connections = connections_.fetch_add(1, std::memory_order_relaxed);
+    if (limits_.max_connections != 0 && connections >= limits_.max_connections) {
+        connections_.fetch_sub(1, std::memory_order_relaxed);
+        CountRejection(Reason::connections);
+        return false;
+    }
+    return true;
+}
+
+void Admission::CloseConnection() {
+    connections_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+std::optional<Reason> Admission::CheckRequest(std::string_view ip, std::string_view authorization) {
+    Clock::time_point now = Clock::now();
+
+    if (ip_limiter_ && !ip_limiter_->TryAcquire(ip, now)) {
+        CountRejection(Reason::ip_rate);
+        return Reason::ip_rate;
+    }
+    if (!token_limiter_) {
+        return std::nullopt;
+    }
+    // Случайные строки в заголовке не должны заводить вёдра
+    auto token = detail::GetPlayerToken(authorization);
+    if (token && !token_limiter_->TryAcquire(*token, now)) {
+        CountRejection(Reason::token_rate);
+        return Reason::token_rate;
+    }
+    return std::nullopt;
+}
+
+void Admission::WriteMetrics(std::ostream& out) const {
+    metrics::WriteHeader(out, "game_http_connections"sv, "gauge"sv, "Open HTTP connections"sv);
+    out << "game_http_connections "sv << connections_.load(std::memory_order_relaxed) << '\n';
+
+    metrics::WriteHeader(out, "game_admission_rejections_total"sv, "counter"sv,
+                         "Requests and connections rejected by overload protection"sv);
+    for (size_t i = 0; i < REASONS; ++i) {
+        out << "game_admission_rejections_total{reason=\""sv << GetReasonName(static_cast<Reason>(i))
+            << "\"} "sv << rejected_[i].Get() << '\n';
+    }
+}
+
+} // namespace admission
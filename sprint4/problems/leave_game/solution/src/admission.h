@@ -0,0 +1,143 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "metrics.h"
+
+// Защита от перегрузки: ограничения на число соединений и частоту запросов.
+// Отказ отдаётся заранее сформированным ответом до разбора запроса и входа в strand'ы игры
+namespace admission {
+
+using Clock = std::chrono::steady_clock;
+
+struct Limits {
+    // 0 - без ограничения
+    size_t max_connections = 0;
+    // Запросов в секунду и наибольший всплеск. Нулевая частота - без ограничения
+    double token_rate = 0;
+    double token_burst = 0;
+    double ip_rate = 0;
+    double ip_burst = 0;
+    // Сколько обработчиков может ждать в strand'е одной игровой сессии
+    size_t session_queue = 0;
+    std::chrono::seconds read_timeout{30};
+};
+
+enum class Reason {
+    connections,
+    ip_rate,
+    token_rate,
+    session_queue,
+    count
+};
+
+std::string_view GetReasonName(Reason reason);
+
+// Ведро токенов на каждый ключ. Ключи разбиты по шардам, чтобы потоки реже ждали друг друга
+class RateLimiter {
+public:
+    // Больше ключей шард не хранит: новый ключ вытесняет давнее всех использованное ведро
+    static constexpr size_t MAX_SHARD_KEYS = 4096;
+
+    RateLimiter(double rate, double burst);
+
+    bool TryAcquire(std::string_view key, Clock::time_point now);
+
+    // Время, за которое в ведре появляется место для запроса
+    std::chrono::seconds GetRetryAfter() const;
+private:
+    static constexpr size_t SHARDS = 16;
+
+    struct Bucket {
+        double tokens;
+        Clock::time_point updated;
+        // Место ключа в Shard::lru
+        std::list<std::string_view>::iterator lru;
+    };
+
+    struct KeyHash {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view key) const {
+            return std::hash<std::string_view>{}(key);
+        }
+    };
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::unordered_map<std::string, Bucket, KeyHash, std::equal_to<>> buckets;
+        // Ключи buckets, в начале - использованные последними
+        std::list<std::string_view> lru;
+    };
+
+    double rate_;
+    double burst_;
+    std::array<Shard, SHARDS> shards_;
+};
+
+class Admission {
+public:
+    static Admission& GetInstance();
+
+    // Вызывать до запуска сервера
+    void Configure(const Limits& limits);
+
+    const Limits& GetLimits() const {
+        return limits_;
+    }
+
+    // false, если достигнут предел соединений. Отказ уже учтён
+    bool TryOpenConnection();
+
+    void CloseConnection();
+
+    // nullopt, если запрос можно обрабатывать. authorization - значение заголовка Authorization,
+    // пусто, если его нет. По токену ограничиваются только токены правильного вида,
+    // остальные запросы ограничивает только ведро адреса
+    std::optional<Reason> CheckRequest(std::string_view ip, std::string_view authorization);
+
+    // Готовый HTTP-ответ на отказ, включая Retry-After
+    const std::string& GetRejection(Reason reason) const {
+        return rejections_[static_cast<size_t>(reason)];
+    }
+
+    void CountRejection(Reason reason) {
+        rejected_[static_cast<size_t>(reason)].Add();
+    }
+
+    uint64_t GetRejectedCount(Reason reason) const {
+        return rejected_[static_cast<size_t>(reason)].Get();
+    }
+
+    std::chrono::seconds GetRetryAfter(Reason reason) const {
+        return retry_after_[static_cast<size_t>(reason)];
+    }
+private:
+    static constexpr size_t REASONS = static_cast<size_t>(Reason::count);
+
+    Admission();
+
+    void WriteMetrics(std::ostream& out) const;
+
+    Limits limits_;
+    std::unique_ptr<RateLimiter> ip_limiter_;
+    std::unique_ptr<RateLimiter> token_limiter_;
+
+    std::atomic<size_t> connections_ = 0;
+    std::array<metrics::Counter, REASONS> rejected_;
+    std::array<std::chrono::seconds, REASONS> retry_after_;
+    std::array<std::string, REASONS> rejections_;
+};
+
+} // namespace admission
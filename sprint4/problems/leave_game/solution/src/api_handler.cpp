@@ -1,5 +1,8 @@
 #include "api_handler.h"
 
+#include "admission.h"
+#include "logger.h"
+
 namespace game_manager {
 namespace json = boost::json;
 using namespace json_keys;
@@ -37,18 +40,53 @@ namespace json = boost::json;
 
 ApiHandler::ApiHandler(game_manager::GameManager& game) : game_(game) {}
 
-void ApiHandler::HandleGameResponse() {
+net::awaitable<ApiHandler::ResponseInfo> ApiHandler::HandleGame() {
+    co_await HandleGameResponse();
+    co_return std::move(response_);
+}
+
+ApiHandler::ResponseInfo ApiHandler::HandleApi() {
+    HandleApiResponse();
+    return std::move(response_);
+}
+
+ApiHandler::ResponseInfo ApiHandler::HandleServerError(std::exception_ptr error) {
+    LogException(error);
+
+    ResponseInfo result = MakeResponse(http::status::internal_server_error, true);
+    json::value body = {
+        {json_keys::code_key, json_keys::server_error_key},
+        {json_keys::message_key, json_keys::server_error_mess}
+    };
+    result.body = json::serialize(body);
+    return result;
+}
+
+void ApiHandler::LogException(std::exception_ptr error) {
+    json_logger::JsonLogger& logger = json_logger::JsonLogger::GetInstance();
+    try {
+        std::rethrow_exception(error);
+    } catch (const std::exception& e) {
+        logger.LogException("game request"sv, e.what());
+    } catch (...) {
+        logger.LogException("game request"sv, "unknown exception"sv);
+    }
+}
+
+net::awaitable<void> ApiHandler::HandleGameResponse() {
     std::string path_part = FindAndCutTarget(req_info_);
     if (path_part == http_strs::join) {
-        HandleJoinRequest();
+        co_await HandleJoinRequest();
     } else if (path_part == http_strs::players) {
-        HandlePlayersListRequest();
+        co_await HandlePlayersListRequest();
     } else if (path_part == http_strs::state) {
-        HandlePlayersStateRequest();
+        co_await HandlePlayersStateRequest();
     } else if (path_part == http_strs::player) {
-        HandleMoveRequest();
+        co_await HandleMoveRequest();
     } else if (path_part == http_strs::tick) {
-        HandleTickRequest();
+        co_await HandleTickRequest();
+    } else if (path_part == http_strs::batch) {
+        co_await HandleBatchRequest();
     } else if (path_part == http_strs::records) {
         HandleRecordsRequest();
     } else {
@@ -103,18 +141,26 @@ bool ApiHandler::CheckRequest(Method method, bool auth) {
     return true;
 }
 
-void ApiHandler::HandleJoinRequest() {
+net::awaitable<void> ApiHandler::HandleJoinRequest() {
     using namespace resp_maker;
 
     if(!CheckRequest(Method::post, false)) {
-        return;
+        co_return;
     }
 
-    json::value player = json::parse(std::string{req_info_.body});
+    json::value player;
+
+    try {
+        player = json::parse(req_info_.body);
+    } catch (...) {
+        SendBadRequestResponse("Join game request parse error", "invalidArgument");
+        co_return;
+    }
 
-    if (!player.as_object().contains(json_keys::user_name_key) || !player.as_object().contains(json_keys::map_id_key)) {
+    if (!player.is_object() || !player.as_object().contains(json_keys::user_name_key) || !player.as_object().contains(json_keys::map_id_key)
+        || !player.at(json_keys::user_name_key).is_string() || !player.at(json_keys::map_id_key).is_string()) {
         SendBadRequestResponse("Invalid join request format", "invalidArgument");
-        return;
+        co_return;
     }
 
     std::string user_name;
@@ -125,79 +171,82 @@ void ApiHandler::HandleJoinRequest() {
 
     if (user_name.find_first_not_of(' ') == user_name.npos) {
         SendBadRequestResponse("Invalid name", "invalidArgument");
-        return;
+        co_return;
     }
 
     if (game_.FindMap(model::Map::Id{map_id}) == nullptr) {
         SendNotFoundResponse("Map not found");
-        return;
+        co_return;
     }
 
-    game_.Join(std::move(user_name), model::Map::Id{map_id},
-               [self = this->shared_from_this()]
-               (game_manager::PlayerInfo info) {
-        json::value player = json::value_from(info);
-        std::string bd = json::serialize(player);
-        self->SendOkResponse(bd);
-    }
-    );
+    game_manager::PlayerInfo info = co_await Traced([&] {
+        return game_.Join(std::move(user_name), model::Map::Id{map_id}, net::use_awaitable);
+    });
+    json::value player_json = json::value_from(info);
+    SendOkResponse(json::serialize(player_json));
 }
 
-void ApiHandler::HandlePlayersStateRequest() {
+net::awaitable<void> ApiHandler::HandlePlayersStateRequest() {
     using namespace resp_maker::json_resp;
 
     if(!CheckRequest(Method::get_head, true)) {
-        return;
+        co_return;
     }
 
     using namespace game_manager;
-    game_.GetPlayers(*req_info_.auth,
-                     [self = this->shared_from_this()]
-                     (const std::optional<PlayersAndObjects>& players_and_objects, Result res) {
-        if (res == Result::ok) {
-            json::object stat;
-            stat[json_keys::players_key] = self->MakePlayersJson(players_and_objects->players);
-            stat[json_keys::lost_objects_key] = self->MakeLootObjectsJson(players_and_objects->objects);
-            self->SendOkResponse(json::serialize(stat));
-        } else if (res == Result::no_token) {
-            self->SendNoAuthResponse(json_keys::unknown_token_mess, json_keys::unknown_token_key);
-        } else {
-            self->SendNotFoundResponse("Player`s session not found", "sessionNotFound");
-        }
+    // Корутина продолжается в strand'е сессии: состояние сериализуется до следующего co_await
+    auto [players_and_objects, res] = co_await Traced([&] {
+        return game_.GetState(*req_info_.auth, net::use_awaitable);
     });
+    if (res == Result::ok && req_info_.binary_state) {
+        SendBinaryStateResponse(state_codec::EncodeState(*players_and_objects));
+    } else if (res == Result::ok) {
+        json::object stat;
+        stat[json_keys::players_key] = MakePlayersJson(players_and_objects->players,
+                                                       players_and_objects->visible_players);
+        stat[json_keys::lost_objects_key] = MakeLootObjectsJson(players_and_objects->objects,
+                                                                players_and_objects->visible_objects);
+        SendOkResponse(json::serialize(stat));
+    } else if (res == Result::no_token) {
+        SendNoAuthResponse(json_keys::unknown_token_mess, json_keys::unknown_token_key);
+    } else if (res == Result::overloaded) {
+        SendOverloadedResponse();
+    } else {
+        SendNotFoundResponse("Player`s session not found", "sessionNotFound");
+    }
 }
 
-void ApiHandler::HandlePlayersListRequest() {
+net::awaitable<void> ApiHandler::HandlePlayersListRequest() {
     using namespace resp_maker::json_resp;
 
     game_manager::Token token{""};
 
     if(!CheckRequest(Method::get_head, true)) {
-        return;
+        co_return;
     }
 
     using namespace game_manager;
-    game_.GetPlayers(*req_info_.auth,
-                     [self = this->shared_from_this()]
-                     (std::optional<PlayersAndObjects> players_and_objects, Result res)
-    {
-        using namespace resp_maker::json_resp;
-        using namespace json_keys;
-        if (res == Result::ok) {
-            json::object obj;
-
-            for (const Player& player : players_and_objects->players) {
-                json::object val;
-                val.emplace(json_keys::name_key, player.name);
-                obj.emplace(std::to_string(player.id), val);
-            }
-            self->SendOkResponse(json::serialize(obj));
-        } else if (res == Result::no_token) {
-            self->SendNoAuthResponse(json_keys::unknown_token_mess, json_keys::unknown_token_key);
-        } else {
-            self->SendNotFoundResponse("Player`s session not found", "sessionNotFound");
-        }
+    auto [players_and_objects, res] = co_await Traced([&] {
+        return game_.GetPlayers(*req_info_.auth, net::use_awaitable);
     });
+    if (res == Result::ok && req_info_.binary_state) {
+        SendBinaryStateResponse(state_codec::EncodePlayersList(players_and_objects->players));
+    } else if (res == Result::ok) {
+        json::object obj;
+
+        for (const Player& player : players_and_objects->players) {
+            json::object val;
+            val.emplace(json_keys::name_key, player.name);
+            obj.emplace(std::to_string(player.id), val);
+        }
+        SendOkResponse(json::serialize(obj));
+    } else if (res == Result::no_token) {
+        SendNoAuthResponse(json_keys::unknown_token_mess, json_keys::unknown_token_key);
+    } else if (res == Result::overloaded) {
+        SendOverloadedResponse();
+    } else {
+        SendNotFoundResponse("Player`s session not found", "sessionNotFound");
+    }
 }
 
 std::optional<uint32_t> ApiHandler::TryGetNumberFromJson(json::value& jv, const std::string& key) {
@@ -230,7 +279,12 @@ std::optional<uint32_t> ApiHandler::TryGetNumberFromJson(json::value& jv, const
             SendBadRequestResponse("Failed to parse action", "invalidArgument");
             return std::nullopt;
         }
-        result = std::stoi(res_str);
+        try {
+            result = std::stoul(res_str);
+        } catch (const std::out_of_range&) {
+            SendBadRequestResponse("Failed to parse action", "invalidArgument");
+            return std::nullopt;
+        }
     } else if (res.is_int64()) {
         try {
             result = res.as_int64();
@@ -253,16 +307,16 @@ std::optional<uint32_t> ApiHandler::TryGetNumberFromJson(json::value& jv, const
     return result;
 }
 
-void ApiHandler::HandleTickRequest() {
+net::awaitable<void> ApiHandler::HandleTickRequest() {
     using namespace resp_maker;
 
     if (!game_.IsTestMode()) {
         SendBadRequestResponse("Invalid endpoint");
-        return;
+        co_return;
     }
 
     if(!CheckRequest(Method::post, false)) {
-        return;
+        co_return;
     }
 
     json::value jv;
@@ -271,68 +325,202 @@ void ApiHandler::HandleTickRequest() {
         jv = json::parse(req_info_.body);
     } catch (...) {
         SendBadRequestResponse("Failed to parse action", "invalidArgument");
-        return;
+        co_return;
     }
 
     auto duration = TryGetNumberFromJson(jv, json_keys::time_delta_key);
 
     if (!duration.has_value()) {
-        return;
+        co_return;
     }
 
     if (*duration == 0) {
         SendBadRequestResponse("Failed to parse action", "invalidArgument");
-        return;
+        co_return;
     }
 
-    game_.CallTick(*duration,
-                   [self = this->shared_from_this()](game_manager::Result res){
-        self->SendOkResponse("{}");
-    }
-    );
+    co_await Traced([&] {
+        return game_.CallTick(*duration, net::use_awaitable);
+    });
+    SendOkResponse("{}");
 }
 
-void ApiHandler::HandleMoveRequest() {
+net::awaitable<void> ApiHandler::HandleMoveRequest() {
     using namespace resp_maker;
 
     std::string path_part = FindAndCutTarget(req_info_);
     if (path_part != http_strs::action) {
         SendBadRequestResponseDefault();
-        return;
+        co_return;
     }
 
     if(!CheckRequest(Method::post, true)) {
-        return;
+        co_return;
     }
 
-    json::value jv = json::parse(req_info_.body);
+    json::value jv;
 
+    try {
+        jv = json::parse(req_info_.body);
+    } catch (...) {
+        SendBadRequestResponse("Failed to parse action", "invalidArgument");
+        co_return;
+    }
 
-    if (!jv.is_object() || !jv.as_object().contains(json_keys::move_key)) {
+    if (!jv.is_object() || !jv.as_object().contains(json_keys::move_key) || !jv.at(json_keys::move_key).is_string()) {
         SendBadRequestResponse("Failed to parse action", "invalidArgument");
-        return;
+        co_return;
     }
 
     std::optional<move_manager::Direction> dir = move_manager::GetDirectionFromString(jv.at(json_keys::move_key).as_string());
 
-    if (dir.has_value()) {
-        game_.MovePlayer(*req_info_.auth, *dir,
-                         [self = this->shared_from_this()]
-                         (game_manager::Result res){
-            using namespace game_manager;
-            using namespace resp_maker::json_resp;
-            if (res == Result::ok) {
-                self->SendOkResponse("{}"s);
-            } else if (res == Result::no_token) {
-                self->SendNoAuthResponse(unknown_token_mess, unknown_token_key);
-            } else if (res == Result::no_session) {
-                self->SendNotFoundResponse("Player`s session not found", "sessionNotFound");
+    if (!dir.has_value()) {
+        SendBadRequestResponse("Failed to parse action", "invalidArgument");
+        co_return;
+    }
+
+    using namespace game_manager;
+    Result res = co_await Traced([&] {
+        return game_.MovePlayer(*req_info_.auth, *dir, net::use_awaitable);
+    });
+    if (res == Result::ok) {
+        SendOkResponse("{}"s);
+    } else if (res == Result::no_token) {
+        SendNoAuthResponse(unknown_token_mess, unknown_token_key);
+    } else if (res == Result::no_session) {
+        SendNotFoundResponse("Player`s session not found", "sessionNotFound");
+    } else if (res == Result::overloaded) {
+        SendOverloadedResponse();
+    }
+}
+
+net::awaitable<void> ApiHandler::HandleBatchRequest() {
+    if(!CheckRequest(Method::post, false)) {
+        co_return;
+    }
+
+    json::value jv;
+
+    try {
+        jv = json::parse(req_info_.body);
+    } catch (...) {
+        SendBadRequestResponse("Failed to parse batch", "invalidArgument");
+        co_return;
+    }
+
+    if (!jv.is_array() || jv.as_array().size() > MAX_BATCH_COMMANDS) {
+        SendBadRequestResponse("Batch must be an array of at most "s + std::to_string(MAX_BATCH_COMMANDS)
+                               + " commands"s, "invalidArgument");
+        co_return;
+    }
+
+    // Неверные команды не отправляются в игру, а получают свой результат 400
+    std::vector<game_manager::BatchCommand> commands;
+    std::vector<size_t> positions;
+    std::vector<json::value> results(jv.as_array().size());
+
+    for (size_t i = 0; i < jv.as_array().size(); ++i) {
+        if (auto command = ParseBatchCommand(jv.as_array()[i])) {
+            commands.push_back(std::move(*command));
+            positions.push_back(i);
+        } else {
+            results[i] = {
+                {json_keys::batch_status_key, static_cast<unsigned>(http::status::bad_request)},
+                {json_keys::code_key, "invalidArgument"},
+                {json_keys::message_key, "Failed to parse command"}
+            };
+        }
+    }
+
+    std::vector<game_manager::BatchResult> batch_results = co_await Traced([&] {
+        return game_.Batch(std::move(commands), net::use_awaitable);
+    });
+    json::array response;
+    response.reserve(results.size());
+
+    // Состояние сессии сериализуется один раз на все её запросы в пакете
+    std::unordered_map<const game_manager::SessionState*, json::object> states;
+
+    for (size_t k = 0; k < batch_results.size(); ++k) {
+        json::value result = MakeBatchResultJson(batch_results[k]);
+
+        if (const auto& state = batch_results[k].state) {
+            auto [it, inserted] = states.try_emplace(state.get());
+            if (inserted) {
+                it->second[json_keys::players_key] = MakePlayersJson(state->players);
+                it->second[json_keys::lost_objects_key] = MakeLootObjectsJson(state->objects);
+            }
+            for (const auto& [key, value] : it->second) {
+                result.as_object()[key] = value;
             }
         }
-        );
-    } else {
-        SendBadRequestResponse("Failed to parse action", "invalidArgument");
-        return;
+        results[positions[k]] = std::move(result);
+    }
+    for (json::value& result : results) {
+        response.push_back(std::move(result));
+    }
+
+    SendOkResponse(json::serialize(response));
+}
+
+std::optional<game_manager::BatchCommand> ApiHandler::ParseBatchCommand(const json::value& jv) const {
+    const json::object* command = jv.if_object();
+    if (!command) {
+        return std::nullopt;
+    }
+
+    const json::value* token = command->if_contains(json_keys::auth_token_key);
+    if (!token || !token->is_string() || token->as_string().size() != static_cast<size_t>(game_.TOKEN_SIZE)) {
+        return std::nullopt;
+    }
+
+    game_manager::BatchCommand result{game_manager::Token{std::string{token->as_string()}}, std::nullopt};
+
+    const json::value* move = command->if_contains(json_keys::move_key);
+    const json::value* state = command->if_contains(json_keys::batch_state_key);
+
+    if (move && !state && move->is_string()) {
+        result.move = move_manager::GetDirectionFromString(move->as_string());
+        if (!result.move) {
+            return std::nullopt;
+        }
+        return result;
+    }
+
+    if (state && !move && state->is_bool() && state->as_bool()) {
+        return result;
+    }
+
+    return std::nullopt;
+}
+
+json::value ApiHandler::MakeBatchResultJson(const game_manager::BatchResult& result) {
+    using game_manager::Result;
+
+    switch (result.result) {
+    case Result::ok:
+        return {
+            {json_keys::batch_status_key, static_cast<unsigned>(http::status::ok)}
+        };
+    case Result::no_token:
+        return {
+            {json_keys::batch_status_key, static_cast<unsigned>(http::status::unauthorized)},
+            {json_keys::code_key, json_keys::unknown_token_key},
+            {json_keys::message_key, json_keys::unknown_token_mess}
+        };
+    case Result::overloaded:
+        admission::Admission::GetInstance().CountRejection(admission::Reason::session_queue);
+        return {
+            {json_keys::batch_status_key, static_cast<unsigned>(http::status::service_unavailable)},
+            {json_keys::code_key, json_keys::server_overloaded_key},
+            {json_keys::message_key, json_keys::server_overloaded_mess}
+        };
+    default:
+        return {
+            {json_keys::batch_status_key, static_cast<unsigned>(http::status::not_found)},
+            {json_keys::code_key, "sessionNotFound"},
+            {json_keys::message_key, "Player`s session not found"}
+        };
     }
 }
 
@@ -353,14 +541,18 @@ void ApiHandler::HandleRecordsRequest() {
     SendOkResponse(json::serialize(result));
 }
 
-json::value ApiHandler::MakePlayersJson(const std::deque<game_manager::Player>& players) {
+json::value ApiHandler::MakePlayersJson(const std::deque<game_manager::Player>& players,
+                                        const std::vector<uint32_t>* visible) {
     using namespace game_manager;
+    using fixed_point::ToDouble;
     json::object obj;
-    for (const Player& player : players) {
+    size_t count = visible ? visible->size() : players.size();
+    for (size_t i = 0; i < count; ++i) {
+        const Player& player = players[visible ? (*visible)[i] : i];
         const move_manager::State& state = player.state;
         json::value jv = {
-            {json_keys::pos_key, json::array{state.position.coor.x, state.position.coor.y}},
-            {json_keys::speed_key, json::array{state.speed.x_axis, state.speed.y_axis}},
+            {json_keys::pos_key, json::array{ToDouble(state.position.coor.x), ToDouble(state.position.coor.y)}},
+            {json_keys::speed_key, json::array{ToDouble(state.speed.x_axis), ToDouble(state.speed.y_axis)}},
             {json_keys::dir_key, move_manager::GetStringDirection(state.dir)},
             {json_keys::bag_key, player.items_in_bag},
             {json_keys::score_key, player.score}
@@ -370,14 +562,18 @@ json::value ApiHandler::MakePlayersJson(const std::deque<game_manager::Player>&
     return obj;
 }
 
-json::value ApiHandler::MakeLootObjectsJson(const game_manager::LootObjectsContainer& objects) {
+json::value ApiHandler::MakeLootObjectsJson(const game_manager::LootObjectsContainer& objects,
+                                            const std::vector<uint32_t>* visible) {
     using namespace game_manager;
+    using fixed_point::ToDouble;
     json::object obj;
-    for (const LootObject& object : objects) {
+    size_t count = visible ? visible->size() : objects.size();
+    for (size_t i = 0; i < count; ++i) {
+        const LootObject& object = objects[visible ? (*visible)[i] : i];
         move_manager::Coords coords = object.position;
         json::value jv = {
             {json_keys::type_key, object.type},
-            {json_keys::pos_key, json::array{coords.x, coords.y}}
+            {json_keys::pos_key, json::array{ToDouble(coords.x), ToDouble(coords.y)}}
         };
         obj.emplace(std::to_string(object.id), jv);
     }
@@ -473,7 +669,18 @@ void ApiHandler::SendOkResponse(const std::string& body, bool no_cache) {
 
     result.body = body;
 
-    send_(result);
+    response_ = std::move(result);
+}
+
+void ApiHandler::SendBinaryStateResponse(std::string body) {
+    ResponseInfo result = MakeResponse(http::status::ok, true);
+
+    result.content_type = body_type::game_state;
+    result.body = std::move(body);
+    // Тот же адрес отвечает и JSON, поэтому кэши должны учитывать Accept
+    result.additional_fields.emplace_back(http::field::vary, "Accept"s);
+
+    response_ = std::move(result);
 }
 
 void ApiHandler::SendBadRequestResponse(std::string message, std::string code, bool no_cache) {
@@ -486,7 +693,7 @@ void ApiHandler::SendBadRequestResponse(std::string message, std::string code, b
 
     result.body = json::serialize(body);
 
-    send_(result);
+    response_ = std::move(result);
 }
 
 void ApiHandler::SendNotFoundResponse(const std::string& message, const std::string& key, bool no_cache) {
@@ -499,7 +706,7 @@ void ApiHandler::SendNotFoundResponse(const std::string& message, const std::str
 
     result.body = json::serialize(body);
 
-    send_(result);
+    response_ = std::move(result);
 }
 
 void ApiHandler::SendNoAuthResponse(const std::string& message, const std::string& key, bool no_cache) {
@@ -512,7 +719,25 @@ void ApiHandler::SendNoAuthResponse(const std::string& message, const std::strin
 
     result.body = json::serialize(body);
 
-    send_(result);
+    response_ = std::move(result);
+}
+
+void ApiHandler::SendOverloadedResponse() {
+    admission::Admission& admission = admission::Admission::GetInstance();
+    admission.CountRejection(admission::Reason::session_queue);
+
+    ResponseInfo result = MakeResponse(http::status::service_unavailable, true);
+    result.additional_fields.emplace_back(http::field::retry_after,
+        std::to_string(admission.GetRetryAfter(admission::Reason::session_queue).count()));
+
+    json::value body = {
+        {json_keys::code_key, json_keys::server_overloaded_key},
+        {json_keys::message_key, json_keys::server_overloaded_mess}
+    };
+
+    result.body = json::serialize(body);
+
+    response_ = std::move(result);
 }
 
 void ApiHandler::SendWrongMethodResponseAllowedGetHead(const std::string& message, bool no_cache) {
@@ -527,7 +752,7 @@ void ApiHandler::SendWrongMethodResponseAllowedGetHead(const std::string& messag
 
     result.additional_fields.emplace_back(http::field::allow, "GET, HEAD"s);
 
-    send_(result);
+    response_ = std::move(result);
 }
 
 void ApiHandler::SendWrongMethodResponseAllowedPost(const std::string& message, bool no_cache) {
@@ -542,7 +767,7 @@ void ApiHandler::SendWrongMethodResponseAllowedPost(const std::string& message,
 
     result.additional_fields.emplace_back(http::field::allow, "POST"s);
 
-    send_(result);
+    response_ = std::move(result);
 }
 
 void ApiHandler::SendWrongMethodResponse(Method method) {
@@ -4,20 +4,25 @@
 
 #include <boost/json.hpp>
 #include <boost/beast.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/use_awaitable.hpp>
 
 #include "game_manager.h"
 #include "resp_maker.h"
 #include "model_serialization.h"
 #include "move_manager.h"
 #include "http_strs.h"
+#include "state_codec.h"
+#include "request_tracer.h"
 
+#include <exception>
 #include <optional>
-#include <functional>
-#include <memory>
 
 #define BOOST_BEAST_USE_STD_STRING_VIEW
 
 const size_t MAX_ITEMS = 100;
+const size_t MAX_BATCH_COMMANDS = 10000;
 
 namespace game_manager {
 namespace json = boost::json;
@@ -30,6 +35,7 @@ void tag_invoke (json::value_from_tag, json::value& jv, const ItemInfo& info);
 
 namespace api_handler {
 
+namespace net = boost::asio;
 namespace beast = boost::beast;
 namespace http = beast::http;
 using namespace std::literals;
@@ -43,6 +49,8 @@ struct RequestInfo {
     int version;
     bool keep_alive;
     std::optional<game_manager::Token> auth;
+    // Клиент принимает бинарное состояние, см. state_codec.h
+    bool binary_state = false;
     int start = 0;
     int max_number = 100;
 };
@@ -53,18 +61,38 @@ enum class Method {
     any
 };
 
-class ApiHandler : public std::enable_shared_from_this<ApiHandler> {
+// Обработчик одного запроса. Запросы к игре ждут GameManager в корутине HandleGame,
+// остальные отвечаются сразу из HandleApi
+class ApiHandler {
 public:
     ApiHandler(game_manager::GameManager& game);
 
     using ResponseInfo = resp_maker::detail::ResponseInfo;
 
-    template <typename Body, typename Allocator, typename Send>
-    void Handle(const http::request<Body, http::basic_fields<Allocator>>& req, Send&& send);
-private:
-    std::function<void(ResponseInfo)> send_;
+    template <typename Body, typename Allocator>
+    void SetRequest(const http::request<Body, http::basic_fields<Allocator>>& req);
+
+    bool IsGameRequest() const {
+        return is_game_request_;
+    }
+
+    net::awaitable<ResponseInfo> HandleGame();
+
+    ResponseInfo HandleApi();
+
+    // Ответ 500 на исключение, вылетевшее из HandleGame. Исключение записывается в лог
+    ResponseInfo HandleServerError(std::exception_ptr error);
 
-    void HandleGameResponse();
+    static void LogException(std::exception_ptr error);
+
+    // visible - индексы попадающих в ответ элементов, nullptr - все
+    static json::value MakePlayersJson(const std::deque<game_manager::Player>& players,
+                                       const std::vector<uint32_t>* visible = nullptr);
+
+    static json::value MakeLootObjectsJson(const game_manager::LootObjectsContainer& objects,
+                                           const std::vector<uint32_t>* visible = nullptr);
+private:
+    net::awaitable<void> HandleGameResponse();
 
     bool CheckEndPath();
 
@@ -74,21 +102,25 @@ private:
 
     bool CheckRequest(Method method, bool auth = false);
 
-    void HandleJoinRequest();
+    net::awaitable<void> HandleJoinRequest();
 
-    void HandlePlayersStateRequest();
+    net::awaitable<void> HandlePlayersStateRequest();
 
-    void HandlePlayersListRequest();
+    net::awaitable<void> HandlePlayersListRequest();
 
-    void HandleTickRequest();
+    net::awaitable<void> HandleTickRequest();
 
-    void HandleMoveRequest();
+    net::awaitable<void> HandleMoveRequest();
 
-    void HandleRecordsRequest();
+    // Пакет команд от ботов и нагрузочных клиентов:
+    // [{"authToken": "...", "move": "L"}, {"authToken": "...", "state": true}, ...]
+    net::awaitable<void> HandleBatchRequest();
+
+    std::optional<game_manager::BatchCommand> ParseBatchCommand(const json::value& jv) const;
 
-    json::value MakePlayersJson(const std::deque<game_manager::Player>& players);
+    static json::value MakeBatchResultJson(const game_manager::BatchResult& result);
 
-    json::value MakeLootObjectsJson(const game_manager::LootObjectsContainer& objects);
+    void HandleRecordsRequest();
 
     void HandleApiResponse();
 
@@ -101,12 +133,20 @@ private:
     template <typename Body, typename Allocator>
     RequestInfo ParseRequest(const http::request<Body, http::basic_fields<Allocator>>& req);
 
+    // Вызывает operation() - операцию GameManager - в трассе запроса:
+    // корутина начинается уже вне обработчика, где трасса была текущей
+    template <typename Operation>
+    auto Traced(Operation&& operation);
+
     std::string FindAndCutTarget(RequestInfo& req);
 
     ResponseInfo MakeResponse(http::status status, bool no_cache);
 
     void SendOkResponse(const std::string& body, bool no_cache = true);
 
+    // Ответ в формате state_codec
+    void SendBinaryStateResponse(std::string body);
+
     void SendBadRequestResponse(std::string message, std::string code = json_keys::bad_request_key, bool no_cache = true);
 
     void SendBadRequestResponseDefault(bool no_cache = true) {
@@ -119,6 +159,9 @@ private:
     void SendNoAuthResponse(const std::string& message = json_keys::bad_token_mess,
                             const std::string& key = json_keys::bad_token_key, bool no_cache = true);
 
+    // 503 с Retry-After, когда очередь сессии игрока переполнена
+    void SendOverloadedResponse();
+
     void SendWrongMethodResponseAllowedGetHead (const std::string& message = json_keys::invalid_method_message_get_head,
                                       bool no_cache = true);
 
@@ -135,6 +178,10 @@ private:
 
     game_manager::GameManager& game_;
     RequestInfo req_info_;
+    bool is_game_request_ = false;
+    request_tracer::TracePtr trace_;
+    // Send*Response только запоминают ответ, отправляет его HandleApiRequest
+    ResponseInfo response_;
 };
 
 template <typename Body, typename Allocator, typename Send>
@@ -163,6 +210,10 @@ RequestInfo ApiHandler::ParseRequest(const http::request<Body, http::basic_field
         result.content_type = req.at(http::field::content_type);
     }
 
+    if (auto accept = req.find(http::field::accept); accept != req.end()) {
+        result.binary_state = state_codec::IsAccepted({accept->value().data(), accept->value().size()});
+    }
+
     auto it = req.find(http::field::authorization);
     if (it != req.end()) {
         std::string token_str{req.at(http::field::authorization)};
@@ -178,29 +229,55 @@ RequestInfo ApiHandler::ParseRequest(const http::request<Body, http::basic_field
     return result;
 }
 
-template <typename Body, typename Allocator, typename Send>
-void ApiHandler::Handle(const http::request<Body, http::basic_fields<Allocator>>& req, Send&& send) {
-    send_ = std::forward<Send>(send);
+template <typename Body, typename Allocator>
+void ApiHandler::SetRequest(const http::request<Body, http::basic_fields<Allocator>>& req) {
     req_info_ = ParseRequest(req);
-    if (req_info_.target.starts_with(http_strs::game_path)) {
+    trace_ = request_tracer::GetCurrent();
+    is_game_request_ = req_info_.target.starts_with(http_strs::game_path);
+    if (is_game_request_) {
         req_info_.target = req_info_.target.substr(http_strs::game_path.size());
-        HandleGameResponse();
     } else {
         req_info_.target = req_info_.target.substr(http_strs::api.size());
-        HandleApiResponse();
     }
 }
 
+template <typename Operation>
+auto ApiHandler::Traced(Operation&& operation) {
+    request_tracer::CurrentScope scope{trace_};
+    return operation();
+}
+
 template <typename Body, typename Allocator, typename Send>
 void HandleApiRequest(game_manager::GameManager& game,
                       http::request<Body, http::basic_fields<Allocator>>&& req,
                       Send&& send)
 {
-    auto handler = std::make_shared<ApiHandler>(game);
+    ApiHandler handler{game};
+    handler.SetRequest(req);
 
-    handler->Handle(req, [send = std::forward<Send>(send)](const resp_maker::detail::ResponseInfo& info){
-        send(resp_maker::detail::MakeTextResponse<Body, Allocator>(info));
-    });
+    if (!handler.IsGameRequest()) {
+        return send(resp_maker::detail::MakeTextResponse<Body, Allocator>(handler.HandleApi()));
+    }
+
+    // Кадр корутины вместе с обработчиком и send берётся из потокового кэша кадров asio
+    net::co_spawn(game.GetExecutor(),
+        [handler = std::move(handler), send = std::forward<Send>(send)]()mutable -> net::awaitable<void> {
+            ApiHandler::ResponseInfo info;
+            try {
+                info = co_await handler.HandleGame();
+            } catch (...) {
+                // Ошибки запроса HandleGame обрабатывает сам, это ошибка сервера
+                info = handler.HandleServerError(std::current_exception());
+            }
+            send(resp_maker::detail::MakeTextResponse<Body, Allocator>(info));
+        },
+        [](std::exception_ptr error) {
+            // Исключение из send: ответить уже нельзя, но рабочий поток должен продолжить работу
+            if (error) {
+                ApiHandler::LogException(error);
+            }
+        }
+    );
 }
 
 } // namespace api_handler
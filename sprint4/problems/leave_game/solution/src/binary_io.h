@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Запись и чтение простых бинарных форматов. Числа хранятся в порядке байт машины,
+// varint - по 7 бит в байте, младшие вперёд, независимо от машины
+namespace binary_io {
+
+template <typename T>
+void Put(std::string& out, T value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    char buf[sizeof(T)];
+    std::memcpy(buf, &value, sizeof(T));
+    out.append(buf, sizeof(T));
+}
+
+template <typename Size>
+void PutString(std::string& out, std::string_view str) {
+    Put(out, static_cast<Size>(str.size()));
+    out.append(str);
+}
+
+// Старший бит байта - есть ли продолжение
+inline void PutVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+// Знаковое число: 0, -1, 1, -2, ... кодируются как 0, 1, 2, 3, ..., так что малые по модулю - короткие
+inline void PutZigzag(std::string& out, int64_t value) {
+    PutVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+// Читает данные, записанные Put и PutString. При выходе за границы бросает std::runtime_error
+class Reader {
+public:
+    explicit Reader(std::string_view data) : data_(data) {}
+
+    template <typename T>
+    T Get() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        Check(sizeof(T));
+        T value;
+        std::memcpy(&value, data_.data() + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return value;
+    }
+
+    uint64_t GetVarint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = Get<uint8_t>();
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Varint is too long");
+    }
+
+    int64_t GetZigzag() {
+        uint64_t value = GetVarint();
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    template <typename Size>
+    std::string GetString() {
+        return std::string{GetBytes(Get<Size>())};
+    }
+
+    std::string_view GetBytes(size_t size) {
+        Check(size);
+        std::string_view result = data_.substr(pos_, size);
+        pos_ += size;
+        return result;
+    }
+
+    bool IsEnd() const {
+        return pos_ == data_.size();
+    }
+private:
+    void Check(size_t size) const {
+        if (size > data_.size() - pos_) {
+            throw std::runtime_error("Binary data is truncated");
+        }
+    }
+
+    std::string_view data_;
+    size_t pos_ = 0;
+};
+
+} // namespace binary_io
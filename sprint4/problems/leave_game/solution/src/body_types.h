@@ -20,6 +20,8 @@ const std::string tif = "image/tiff"s; //.tiff, .tif: image/tiff
 const std::string svg = "image/svg+xml"s; //.svg, .svgz: image/svg+xml
 const std::string mp3 = "audio/mpeg"s; //.mp3: audio/mpeg
 const std::string unknown = "application/octet-stream"s; //other
+// Бинарное состояние игры, см. state_codec.h
+const std::string game_state = "application/x-game-state"s;
 
 std::string to_lower_case(std::string_view str);
 std::string_view GetTypeByExtention(std::string_view file);
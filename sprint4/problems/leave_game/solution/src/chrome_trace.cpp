@@ -0,0 +1,62 @@
+#include "chrome_trace.h"
+
+#include <atomic>
+
+namespace chrome_trace {
+
+using namespace std::literals;
+
+namespace detail {
+
+const Clock::time_point process_start = Clock::now();
+
+} // namespace detail
+
+int64_t GetTimestamp(Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time - detail::process_start).count();
+}
+
+uint32_t GetThreadId() {
+    static std::atomic<uint32_t> next_id = 1;
+    thread_local uint32_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+void WriteEvent(std::ostream& out, const TraceEvent& event) {
+    out << "{\"name\":\""sv << event.name
+        << "\",\"cat\":\""sv << event.category
+        << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"sv << event.tid
+        << ",\"ts\":"sv << event.ts
+        << ",\"dur\":"sv << event.dur
+        << ",\"args\":{"sv;
+
+    bool first_arg = true;
+    for (const auto& [key, value] : event.args) {
+        if (key.empty()) {
+            break;
+        }
+        if (!first_arg) {
+            out << ',';
+        }
+        first_arg = false;
+        out << '"' << key << "\":"sv << value;
+    }
+    out << "}}"sv;
+}
+
+void WriteEvents(std::ostream& out, const std::vector<TraceEvent>& events) {
+    out << "{\"traceEvents\":[\n"sv;
+
+    bool first = true;
+    for (const TraceEvent& event : events) {
+        if (!first) {
+            out << ",\n"sv;
+        }
+        first = false;
+        WriteEvent(out, event);
+    }
+
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n"sv;
+}
+
+} // namespace chrome_trace
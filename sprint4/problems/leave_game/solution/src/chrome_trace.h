@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+namespace chrome_trace {
+
+using Clock = std::chrono::steady_clock;
+
+// Событие формата Chrome trace (ph = "X"), открывается в chrome://tracing и Perfetto.
+// Имена и аргументы - строковые литералы, чтобы запись события не выделяла память
+struct TraceEvent {
+    static constexpr size_t MAX_ARGS = 3;
+
+    std::string_view name;
+    std::string_view category;
+    int64_t ts = 0;
+    int64_t dur = 0;
+    uint32_t tid = 0;
+    std::array<std::pair<std::string_view, int64_t>, MAX_ARGS> args{};
+};
+
+// Микросекунды от запуска процесса
+int64_t GetTimestamp(Clock::time_point time);
+
+// Небольшой номер текущего потока для поля tid
+uint32_t GetThreadId();
+
+void WriteEvent(std::ostream& out, const TraceEvent& event);
+
+void WriteEvents(std::ostream& out, const std::vector<TraceEvent>& events);
+
+} // namespace chrome_trace
@@ -1,52 +1,32 @@
 #include "collision_detector.h"
-#include <cassert>
 
 namespace collision_detector {
 
-CollectionResult TryCollectPoint(geom::Point2D a, geom::Point2D b, geom::Point2D c) {
-    // Проверим, что перемещение ненулевое.
-    // Тут приходится использовать строгое равенство, а не приближённое,
-    // пскольку при сборе заказов придётся учитывать перемещение даже на небольшое
-    // расстояние.
+template <>
+CollectionResult TryCollectPoint<fixed_point::Fixed>(geom::BasicPoint2D<fixed_point::Fixed> a,
+                                                     geom::BasicPoint2D<fixed_point::Fixed> b,
+                                                     geom::BasicPoint2D<fixed_point::Fixed> c) {
+    using Wide = __int128;
     assert(b.x != a.x || b.y != a.y);
-    const double u_x = c.x - a.x;
-    const double u_y = c.y - a.y;
-    const double v_x = b.x - a.x;
-    const double v_y = b.y - a.y;
-    const double u_dot_v = u_x * v_x + u_y * v_y;
-    const double u_len2 = u_x * u_x + u_y * u_y;
-    const double v_len2 = v_x * v_x + v_y * v_y;
-    const double proj_ratio = u_dot_v / v_len2;
-    const double sq_distance = u_len2 - (u_dot_v * u_dot_v) / v_len2;
 
-    return CollectionResult{sq_distance, proj_ratio};
-}
+    // Разности и произведения точны. Квадрат расстояния считается через векторное
+    // произведение: |u|^2 - (u, v)^2 / |v|^2 = [u, v]^2 / |v|^2, переполнения нет
+    const int64_t u_x = int64_t{c.x.GetRaw()} - a.x.GetRaw();
+    const int64_t u_y = int64_t{c.y.GetRaw()} - a.y.GetRaw();
+    const int64_t v_x = int64_t{b.x.GetRaw()} - a.x.GetRaw();
+    const int64_t v_y = int64_t{b.y.GetRaw()} - a.y.GetRaw();
+    const Wide u_dot_v = Wide{u_x} * v_x + Wide{u_y} * v_y;
+    const Wide u_cross_v = Wide{u_x} * v_y - Wide{u_y} * v_x;
+    const Wide v_len2 = Wide{v_x} * v_x + Wide{v_y} * v_y;
 
-std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider) {
-    std::vector<GatheringEvent> result;
-    for (int g = 0; g < provider.GatherersCount(); ++g) {
-        const auto& gatherer = provider.GetGatherer(g);
-        if (gatherer.start_pos != gatherer.end_pos) {
-            for (int i = 0; i < provider.ItemsCount(); ++i) {
-                const auto& item = provider.GetItem(i);
-                auto res = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, item.position);
-                if (res.IsCollected(gatherer.width + item.width)) {
-                    GatheringEvent event;
-                    event.gatherer_id = g;
-                    event.item_id     = i;
-                    event.sq_distance = res.sq_distance;
-                    event.time        = res.proj_ratio;
-                    event.is_office   = item.is_office;
-                    result.push_back(event);
-                }
-            }
-        }
-    }
+    // Дальше по одной операции с правильным округлением, сжатие в FMA невозможно
+    const double cross = static_cast<double>(u_cross_v);
+    const double len2 = static_cast<double>(v_len2);
+    const double proj_ratio = static_cast<double>(u_dot_v) / len2;
+    const double raw_sq_distance = cross * cross / len2;
+    const double sq_distance = raw_sq_distance / (double{fixed_point::Fixed::ONE} * fixed_point::Fixed::ONE);
 
-    std::sort(result.begin(), result.end(), [](const GatheringEvent& a, const GatheringEvent& b){
-        return a.time < b.time;
-    });
-    return result;
+    return CollectionResult{sq_distance, proj_ratio};
 }
 
 }  // namespace collision_detector
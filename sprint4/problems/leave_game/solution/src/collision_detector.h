@@ -3,6 +3,10 @@
 #include "geom.h"
 
 #include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <functional>
 #include <vector>
 
 namespace collision_detector {
@@ -16,31 +20,47 @@ struct CollectionResult {
     double proj_ratio;
 };
 
-CollectionResult TryCollectPoint(geom::Point2D a, geom::Point2D b, geom::Point2D c);
+// Ядра поиска столкновений параметризованы типом координат S: double или fixed_point::Fixed.
+// Игра использует geom::Scalar
+template <typename S>
+CollectionResult TryCollectPoint(geom::BasicPoint2D<S> a, geom::BasicPoint2D<S> b, geom::BasicPoint2D<S> c);
 
-struct Item {
-    geom::Point2D position;
-    double width;
+// Считается в целых числах, результат одинаков при любых флагах компилятора
+template <>
+CollectionResult TryCollectPoint<fixed_point::Fixed>(geom::BasicPoint2D<fixed_point::Fixed> a,
+                                                     geom::BasicPoint2D<fixed_point::Fixed> b,
+                                                     geom::BasicPoint2D<fixed_point::Fixed> c);
+
+template <typename S>
+struct BasicItem {
+    geom::BasicPoint2D<S> position;
+    S width;
     bool is_office;
 };
 
-struct Gatherer {
-    geom::Point2D start_pos;
-    geom::Point2D end_pos;
-    double width;
+template <typename S>
+struct BasicGatherer {
+    geom::BasicPoint2D<S> start_pos;
+    geom::BasicPoint2D<S> end_pos;
+    S width;
 };
 
-class ItemGathererProvider {
+template <typename S>
+class BasicItemGathererProvider {
 protected:
-    ~ItemGathererProvider() = default;
+    ~BasicItemGathererProvider() = default;
 
 public:
     virtual size_t ItemsCount() const = 0;
-    virtual Item GetItem(size_t idx) const = 0;
+    virtual BasicItem<S> GetItem(size_t idx) const = 0;
     virtual size_t GatherersCount() const = 0;
-    virtual Gatherer GetGatherer(size_t idx) const = 0;
+    virtual BasicGatherer<S> GetGatherer(size_t idx) const = 0;
 };
 
+using Item = BasicItem<geom::Scalar>;
+using Gatherer = BasicGatherer<geom::Scalar>;
+using ItemGathererProvider = BasicItemGathererProvider<geom::Scalar>;
+
 struct GatheringEvent {
     size_t item_id;
     size_t gatherer_id;
@@ -49,6 +69,216 @@ struct GatheringEvent {
     bool is_office;
 };
 
-std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider);
+// События упорядочены по времени, при равном времени - по сборщику и предмету.
+// Предметы сначала отсеиваются по прямоугольнику вокруг пути сборщика: этот цикл
+// только сравнивает координаты и векторизуется, точная проверка идёт для оставшихся
+template <typename S>
+std::vector<GatheringEvent> FindGatherEvents(const BasicItemGathererProvider<S>& provider);
+
+// Вызывает task(i) для всех i из [0, count), возможно параллельно, и дожидается их окончания
+using ParallelFor = std::function<void(size_t count, const std::function<void(size_t)>& task)>;
+
+// То же, что FindGatherEvents, но карта делится на regions полос по оси x, и полосы
+// обрабатываются параллельно. Сборщик, чей путь с учётом ширин не выходит из полосы,
+// проверяется только с предметами своей полосы. Пересекающие границу сборщики
+// проверяются после, в одном потоке. Результат совпадает с FindGatherEvents
+template <typename S>
+std::vector<GatheringEvent> FindGatherEventsPartitioned(const BasicItemGathererProvider<S>& provider, size_t regions,
+                                                        const ParallelFor& parallel_for);
+
+//===================================Templates implementation============================================
+
+namespace detail {
+
+inline bool EventLess(const GatheringEvent& a, const GatheringEvent& b) {
+    if (a.time != b.time) {
+        return a.time < b.time;
+    }
+    if (a.gatherer_id != b.gatherer_id) {
+        return a.gatherer_id < b.gatherer_id;
+    }
+    return a.item_id < b.item_id;
+}
+
+template <typename S>
+void TryGather(const BasicGatherer<S>& gatherer, size_t gatherer_id, const BasicItem<S>& item, size_t item_id,
+               std::vector<GatheringEvent>& result) {
+    auto res = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, item.position);
+    if (res.IsCollected(fixed_point::ToDouble(gatherer.width + item.width))) {
+        result.push_back({item_id, gatherer_id, res.sq_distance, res.proj_ratio, item.is_office});
+    }
+}
+
+// Предметы в виде отдельных массивов координат для отсева
+template <typename S>
+struct ItemColumns {
+    explicit ItemColumns(const std::vector<BasicItem<S>>& items) {
+        xs.reserve(items.size());
+        ys.reserve(items.size());
+        for (const BasicItem<S>& item : items) {
+            xs.push_back(item.position.x);
+            ys.push_back(item.position.y);
+            max_width = std::max(max_width, item.width);
+        }
+        candidates.resize(items.size());
+    }
+
+    // Отмечает в candidates предметы, которые gatherer может задеть
+    void Select(const BasicGatherer<S>& gatherer) {
+        // Запас на ошибки округления TryCollectPoint для double
+        S reach = gatherer.width + max_width;
+        reach = reach + reach / 1000;
+        const S min_x = std::min(gatherer.start_pos.x, gatherer.end_pos.x) - reach;
+        const S max_x = std::max(gatherer.start_pos.x, gatherer.end_pos.x) + reach;
+        const S min_y = std::min(gatherer.start_pos.y, gatherer.end_pos.y) - reach;
+        const S max_y = std::max(gatherer.start_pos.y, gatherer.end_pos.y) + reach;
+
+        const size_t size = xs.size();
+        for (size_t i = 0; i < size; ++i) {
+            candidates[i] = (xs[i] >= min_x) & (xs[i] <= max_x) & (ys[i] >= min_y) & (ys[i] <= max_y);
+        }
+    }
+
+    std::vector<S> xs;
+    std::vector<S> ys;
+    S max_width = 0;
+    std::vector<uint8_t> candidates;
+};
+
+} // namespace detail
+
+template <typename S>
+CollectionResult TryCollectPoint(geom::BasicPoint2D<S> a, geom::BasicPoint2D<S> b, geom::BasicPoint2D<S> c) {
+    // Проверим, что перемещение ненулевое.
+    // Тут приходится использовать строгое равенство, а не приближённое,
+    // пскольку при сборе заказов придётся учитывать перемещение даже на небольшое
+    // расстояние.
+    assert(b.x != a.x || b.y != a.y);
+    const double u_x = c.x - a.x;
+    const double u_y = c.y - a.y;
+    const double v_x = b.x - a.x;
+    const double v_y = b.y - a.y;
+    const double u_dot_v = u_x * v_x + u_y * v_y;
+    const double u_len2 = u_x * u_x + u_y * u_y;
+    const double v_len2 = v_x * v_x + v_y * v_y;
+    const double proj_ratio = u_dot_v / v_len2;
+    const double sq_distance = u_len2 - (u_dot_v * u_dot_v) / v_len2;
+
+    return CollectionResult{sq_distance, proj_ratio};
+}
+
+template <typename S>
+std::vector<GatheringEvent> FindGatherEvents(const BasicItemGathererProvider<S>& provider) {
+    std::vector<BasicItem<S>> items;
+    items.reserve(provider.ItemsCount());
+    for (size_t i = 0; i < provider.ItemsCount(); ++i) {
+        items.push_back(provider.GetItem(i));
+    }
+    detail::ItemColumns<S> columns{items};
+
+    std::vector<GatheringEvent> result;
+    for (size_t g = 0; g < provider.GatherersCount(); ++g) {
+        const BasicGatherer<S> gatherer = provider.GetGatherer(g);
+        if (gatherer.start_pos == gatherer.end_pos) {
+            continue;
+        }
+        columns.Select(gatherer);
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (columns.candidates[i]) {
+                detail::TryGather(gatherer, g, items[i], i, result);
+            }
+        }
+    }
+
+    std::sort(result.begin(), result.end(), detail::EventLess);
+    return result;
+}
+
+template <typename S>
+std::vector<GatheringEvent> FindGatherEventsPartitioned(const BasicItemGathererProvider<S>& provider, size_t regions,
+                                                        const ParallelFor& parallel_for) {
+    using fixed_point::ToDouble;
+
+    std::vector<BasicItem<S>> items;
+    items.reserve(provider.ItemsCount());
+    std::vector<BasicGatherer<S>> gatherers;
+    gatherers.reserve(provider.GatherersCount());
+
+    double min_x = INFINITY;
+    double max_x = -INFINITY;
+    double max_item_width = 0;
+    for (size_t i = 0; i < provider.ItemsCount(); ++i) {
+        const BasicItem<S>& item = items.emplace_back(provider.GetItem(i));
+        min_x = std::min(min_x, ToDouble(item.position.x));
+        max_x = std::max(max_x, ToDouble(item.position.x));
+        max_item_width = std::max(max_item_width, ToDouble(item.width));
+    }
+    for (size_t g = 0; g < provider.GatherersCount(); ++g) {
+        gatherers.emplace_back(provider.GetGatherer(g));
+    }
+
+    double width = (max_x - min_x) / regions;
+    if (regions < 2 || !(width > 0)) {
+        return FindGatherEvents(provider);
+    }
+
+    auto get_region = [&](double x) -> size_t {
+        double region = std::floor((x - min_x) / width);
+        return static_cast<size_t>(std::clamp(region, 0., static_cast<double>(regions - 1)));
+    };
+
+    std::vector<std::vector<size_t>> region_items(regions);
+    for (size_t i = 0; i < items.size(); ++i) {
+        region_items[get_region(ToDouble(items[i].position.x))].push_back(i);
+    }
+
+    // Собрать можно только предмет, чей x не дальше суммы ширин от пути сборщика
+    struct Span {
+        size_t first;
+        size_t last;
+    };
+    std::vector<std::vector<size_t>> region_gatherers(regions);
+    std::vector<std::pair<size_t, Span>> crossing;
+    for (size_t g = 0; g < gatherers.size(); ++g) {
+        const BasicGatherer<S>& gatherer = gatherers[g];
+        if (gatherer.start_pos == gatherer.end_pos) {
+            continue;
+        }
+        double reach = ToDouble(gatherer.width) + max_item_width;
+        reach += reach / 1000;
+        size_t first = get_region(ToDouble(std::min(gatherer.start_pos.x, gatherer.end_pos.x)) - reach);
+        size_t last = get_region(ToDouble(std::max(gatherer.start_pos.x, gatherer.end_pos.x)) + reach);
+        if (first == last) {
+            region_gatherers[first].push_back(g);
+        } else {
+            crossing.push_back({g, {first, last}});
+        }
+    }
+
+    std::vector<std::vector<GatheringEvent>> region_events(regions);
+    parallel_for(regions, [&](size_t region) {
+        for (size_t g : region_gatherers[region]) {
+            for (size_t i : region_items[region]) {
+                detail::TryGather(gatherers[g], g, items[i], i, region_events[region]);
+            }
+        }
+    });
+
+    std::vector<GatheringEvent> result;
+    for (auto& events : region_events) {
+        result.insert(result.end(), events.begin(), events.end());
+    }
+    for (const auto& [g, span] : crossing) {
+        for (size_t region = span.first; region <= span.last; ++region) {
+            for (size_t i : region_items[region]) {
+                detail::TryGather(gatherers[g], g, items[i], i, result);
+            }
+        }
+    }
+
+    // Порядок событий не зависит от разбиения
+    std::sort(result.begin(), result.end(), detail::EventLess);
+    return result;
+}
 
 }  // namespace collision_detector
@@ -4,6 +4,8 @@
 #include <mutex>
 #include <condition_variable>
 
+#include "metrics.h"
+
 namespace connection_pool {
 
 class ConnectionPool {
@@ -55,11 +57,15 @@ public:
 
     ConnectionWrapper GetConnection() {
         std::unique_lock lock{mutex_};
+
+        metrics::Gauge& db_queue = metrics::Registry::GetInstance().db_queue;
+        db_queue.Add(1);
         // Блокируем текущий поток и ждём, пока cond_var_ не получит уведомление и не освободится
         // хотя бы одно соединение
         cond_var_.wait(lock, [this] {
             return used_connections_ < pool_.size();
         });
+        db_queue.Add(-1);
         // После выхода из цикла ожидания мьютекс остаётся захваченным
 
         return {std::move(pool_[used_connections_++]), *this};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <compare>
+#include <concepts>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+namespace fixed_point {
+
+// Число с фиксированной точкой: int32 в единицах 1/1024.
+// Сложение, сравнение и деление на целое выполняются в целых числах и не зависят
+// от флагов компилятора, поэтому симуляция на них воспроизводится бит в бит.
+// Значения до ±2^21 клеток
+class Fixed {
+public:
+    static constexpr int FRACTION_BITS = 10;
+    static constexpr int32_t ONE = 1 << FRACTION_BITS;
+
+    constexpr Fixed() = default;
+
+    // Неявное, чтобы константы, конфиг и JSON записывались как для double.
+    // Округляет к ближайшему, половину - от нуля
+    constexpr Fixed(double value)
+        : raw_(static_cast<int32_t>(value * ONE + (value < 0 ? -0.5 : 0.5))) {
+    }
+
+    static constexpr Fixed FromRaw(int32_t raw) {
+        Fixed result;
+        result.raw_ = raw;
+        return result;
+    }
+
+    constexpr int32_t GetRaw() const {
+        return raw_;
+    }
+
+    // Точное: любое Fixed представимо в double
+    constexpr double ToDouble() const {
+        return static_cast<double>(raw_) / ONE;
+    }
+
+    constexpr auto operator<=>(const Fixed&) const = default;
+
+    constexpr Fixed operator-() const {
+        return FromRaw(-raw_);
+    }
+
+    constexpr Fixed& operator+=(Fixed rhs) {
+        raw_ += rhs.raw_;
+        return *this;
+    }
+
+    constexpr Fixed& operator-=(Fixed rhs) {
+        raw_ -= rhs.raw_;
+        return *this;
+    }
+
+private:
+    int32_t raw_ = 0;
+};
+
+constexpr Fixed operator+(Fixed lhs, Fixed rhs) {
+    return lhs += rhs;
+}
+
+constexpr Fixed operator-(Fixed lhs, Fixed rhs) {
+    return lhs -= rhs;
+}
+
+// Округляет вниз
+constexpr Fixed operator*(Fixed lhs, Fixed rhs) {
+    return Fixed::FromRaw(static_cast<int32_t>((int64_t{lhs.GetRaw()} * rhs.GetRaw()) >> Fixed::FRACTION_BITS));
+}
+
+// Умножение и деление на целое - без промежуточного округления до 1/1024,
+// (speed * dt) / 1000 считается точно и округляется один раз, к нулю
+class Scaled {
+public:
+    constexpr explicit Scaled(int64_t raw) : raw_(raw) {}
+
+    template <std::integral T>
+    constexpr Fixed operator/(T rhs) const {
+        return Fixed::FromRaw(static_cast<int32_t>(raw_ / static_cast<int64_t>(rhs)));
+    }
+
+    constexpr operator Fixed() const {
+        return Fixed::FromRaw(static_cast<int32_t>(raw_));
+    }
+private:
+    int64_t raw_;
+};
+
+template <std::integral T>
+constexpr Scaled operator*(Fixed lhs, T rhs) {
+    return Scaled{int64_t{lhs.GetRaw()} * static_cast<int64_t>(rhs)};
+}
+
+template <std::integral T>
+constexpr Fixed operator/(Fixed lhs, T rhs) {
+    return Fixed::FromRaw(static_cast<int32_t>(lhs.GetRaw() / static_cast<int64_t>(rhs)));
+}
+
+// Граница с JSON и текстовыми форматами. Для double - тождество
+constexpr double ToDouble(double value) {
+    return value;
+}
+
+constexpr double ToDouble(Fixed value) {
+    return value.ToDouble();
+}
+
+// В журнале и снимках хранится сырое значение, чтобы восстановление было точным
+inline std::ostream& operator<<(std::ostream& out, Fixed value) {
+    return out << value.GetRaw();
+}
+
+inline std::istream& operator>>(std::istream& in, Fixed& value) {
+    int32_t raw;
+    if (in >> raw) {
+        value = Fixed::FromRaw(raw);
+    }
+    return in;
+}
+
+template <typename Archive>
+void serialize(Archive& ar, Fixed& value, [[maybe_unused]] const unsigned version) {
+    int32_t raw = value.GetRaw();
+    ar& raw;
+    value = Fixed::FromRaw(raw);
+}
+
+} // namespace fixed_point
@@ -0,0 +1,290 @@
+#include "game_journal.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace game_journal {
+
+using namespace std::literals;
+using game_manager::JournalEvent;
+using game_manager::JournalEventType;
+
+namespace detail {
+
+char GetTypeChar(JournalEventType type) {
+    switch (type) {
+    case JournalEventType::join:
+        return 'J';
+    case JournalEventType::move:
+        return 'M';
+    case JournalEventType::retire:
+        return 'R';
+    case JournalEventType::loot:
+        return 'L';
+    case JournalEventType::tick:
+        return 'T';
+    }
+    throw std::logic_error("Journal: unknown event type");
+}
+
+std::optional<JournalEventType> GetTypeFromChar(char c) {
+    switch (c) {
+    case 'J':
+        return JournalEventType::join;
+    case 'M':
+        return JournalEventType::move;
+    case 'R':
+        return JournalEventType::retire;
+    case 'L':
+        return JournalEventType::loot;
+    case 'T':
+        return JournalEventType::tick;
+    }
+    return std::nullopt;
+}
+
+// Запись журнала занимает ровно одну строку
+std::string OneLine(std::string str) {
+    std::replace(str.begin(), str.end(), '\n', ' ');
+    return str;
+}
+
+} // namespace detail
+
+Journal::Journal(std::filesystem::path file) : file_(std::move(file)) {
+    Open(O_APPEND);
+}
+
+Journal::~Journal() {
+    Close();
+}
+
+void Journal::Append(JournalEvent&& event) {
+    if (detached_) {
+        return;
+    }
+    std::string line = FormatEvent(event);
+
+    std::lock_guard lock{pending_mutex_};
+    pending_ += line;
+}
+
+void Journal::Notify([[maybe_unused]] uint64_t duration) {
+    Commit();
+}
+
+void Journal::Commit() {
+    std::lock_guard file_lock{file_mutex_};
+    std::string batch;
+    {
+        std::lock_guard lock{pending_mutex_};
+        std::swap(batch, pending_);
+    }
+
+    if (batch.empty() || detached_) {
+        return;
+    }
+
+    const char* data = batch.data();
+    size_t left = batch.size();
+    while (left > 0) {
+        ssize_t written = ::write(fd_, data, left);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // Недописанный хвост отбрасывается при загрузке
+            return;
+        }
+        data += written;
+        left -= written;
+    }
+    // Одна синхронизация на тик, а не на событие
+    ::fdatasync(fd_);
+}
+
+void Journal::Rotate() {
+    Commit();
+
+    std::lock_guard file_lock{file_mutex_};
+    if (detached_) {
+        return;
+    }
+    Close();
+
+    std::filesystem::path rotated = GetRotatedPath();
+    if (std::filesystem::exists(rotated)) {
+        // Предыдущий снимок не был записан, старые события нужно сохранить
+        std::ofstream prev(rotated, std::ios::app | std::ios::binary);
+        std::ifstream cur(file_, std::ios::binary);
+        prev << cur.rdbuf();
+        prev.flush();
+        std::filesystem::remove(file_);
+    } else if (std::filesystem::exists(file_)) {
+        std::filesystem::rename(file_, rotated);
+    }
+
+    Open(O_APPEND);
+}
+
+void Journal::DropRotated() {
+    std::lock_guard file_lock{file_mutex_};
+    if (detached_) {
+        return;
+    }
+    std::filesystem::remove(GetRotatedPath());
+}
+
+void Journal::Reset() {
+    std::lock_guard file_lock{file_mutex_};
+    {
+        std::lock_guard lock{pending_mutex_};
+        pending_.clear();
+    }
+    if (detached_) {
+        return;
+    }
+    Close();
+    std::filesystem::remove(GetRotatedPath());
+    Open(O_TRUNC);
+}
+
+void Journal::Detach() {
+    Commit();
+
+    std::lock_guard file_lock{file_mutex_};
+    detached_ = true;
+    Close();
+}
+
+std::vector<JournalEvent> Journal::Load() const {
+    std::vector<JournalEvent> events;
+    LoadFile(GetRotatedPath(), events);
+    LoadFile(file_, events);
+    return events;
+}
+
+std::string Journal::FormatEvent(const JournalEvent& event) {
+    std::ostringstream out;
+    out << std::setprecision(std::numeric_limits<double>::max_digits10);
+    out << detail::GetTypeChar(event.type) << ' ' << event.session_id << ' ' << event.seq << ' ';
+
+    switch (event.type) {
+    case JournalEventType::join:
+        out << event.player_id << ' ' << std::quoted(event.token) << ' '
+            << event.position.x << ' ' << event.position.y << ' '
+            << std::quoted(event.map_name) << ' ' << std::quoted(detail::OneLine(event.name));
+        break;
+    case JournalEventType::move:
+        out << event.player_id << ' ' << static_cast<int>(event.dir);
+        break;
+    case JournalEventType::retire:
+        out << event.player_id;
+        break;
+    case JournalEventType::loot:
+        out << event.loot_id << ' ' << event.loot_type << ' '
+            << event.position.x << ' ' << event.position.y;
+        break;
+    case JournalEventType::tick:
+        out << event.duration;
+        break;
+    }
+    // Маркер конца записи: строка без него считается оборванной при сбое
+    out << " ;\n";
+    return out.str();
+}
+
+std::optional<JournalEvent> Journal::ParseEvent(const std::string& line) {
+    std::istringstream in(line);
+
+    char type_char;
+    in >> type_char;
+    auto type = detail::GetTypeFromChar(type_char);
+    if (!type) {
+        return std::nullopt;
+    }
+
+    JournalEvent event{*type};
+    in >> event.session_id >> event.seq;
+
+    int dir;
+    switch (event.type) {
+    case JournalEventType::join:
+        in >> event.player_id >> std::quoted(event.token)
+           >> event.position.x >> event.position.y
+           >> std::quoted(event.map_name) >> std::quoted(event.name);
+        break;
+    case JournalEventType::move:
+        in >> event.player_id >> dir;
+        if (dir < 0 || dir > static_cast<int>(move_manager::Direction::NONE)) {
+            return std::nullopt;
+        }
+        event.dir = static_cast<move_manager::Direction>(dir);
+        break;
+    case JournalEventType::retire:
+        in >> event.player_id;
+        break;
+    case JournalEventType::loot:
+        in >> event.loot_id >> event.loot_type >> event.position.x >> event.position.y;
+        break;
+    case JournalEventType::tick:
+        in >> event.duration;
+        break;
+    }
+
+    std::string end;
+    in >> end;
+    if (!in || end != ";"sv) {
+        return std::nullopt;
+    }
+    return event;
+}
+
+std::filesystem::path Journal::GetPathForState(const std::filesystem::path& state_file) {
+    std::filesystem::path result = state_file;
+    result += ".journal";
+    return result;
+}
+
+std::filesystem::path Journal::GetRotatedPath() const {
+    std::filesystem::path result = file_;
+    result += ".prev";
+    return result;
+}
+
+void Journal::LoadFile(const std::filesystem::path& file, std::vector<JournalEvent>& events) const {
+    std::ifstream in(file, std::ios::binary);
+    std::string line;
+
+    while (std::getline(in, line)) {
+        auto event = ParseEvent(line);
+        if (!event) {
+            // Хвост, записанный не полностью, отбрасываем
+            break;
+        }
+        events.push_back(std::move(*event));
+    }
+}
+
+void Journal::Open(int flags) {
+    fd_ = ::open(file_.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | flags, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to open journal file "s + file_.string());
+    }
+}
+
+void Journal::Close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+} // namespace game_journal
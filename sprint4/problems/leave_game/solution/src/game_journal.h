@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "game_manager.h"
+
+namespace game_journal {
+
+// Журнал изменений состояния между снимками.
+// События копятся в памяти и записываются в файл одной порцией раз в тик (group commit).
+// Порция сбрасывается на диск через fdatasync, поэтому переживает и сбой машины.
+// При сохранении снимка текущий файл журнала откладывается в <file>.prev и удаляется
+// после того, как снимок записан
+class Journal : public game_manager::JournalInterface, public game_manager::TickListner {
+public:
+    explicit Journal(std::filesystem::path file);
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    void Append(game_manager::JournalEvent&& event) override;
+
+    void Notify(uint64_t duration) override;
+
+    void Commit();
+
+    void Rotate();
+
+    void DropRotated();
+
+    void Reset();
+
+    // Записывает накопленное и закрывает файл: журнал переходит к другому процессу.
+    // Дальнейшие события отбрасываются
+    void Detach();
+
+    std::vector<game_manager::JournalEvent> Load() const;
+
+    static std::string FormatEvent(const game_manager::JournalEvent& event);
+
+    static std::optional<game_manager::JournalEvent> ParseEvent(const std::string& line);
+
+    static std::filesystem::path GetPathForState(const std::filesystem::path& state_file);
+private:
+    std::filesystem::path GetRotatedPath() const;
+
+    void LoadFile(const std::filesystem::path& file, std::vector<game_manager::JournalEvent>& events) const;
+
+    void Open(int flags);
+
+    void Close();
+
+    std::filesystem::path file_;
+
+    std::mutex pending_mutex_;
+    std::string pending_;
+
+    // Порядок захвата: file_mutex_, затем pending_mutex_
+    std::mutex file_mutex_;
+    int fd_ = -1;
+    std::atomic_bool detached_ = false;
+};
+
+} // namespace game_journal
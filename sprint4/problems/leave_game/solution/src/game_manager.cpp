@@ -1,29 +1,73 @@
 #include "game_manager.h"
 #include "collision_detector.h"
 
+#include <algorithm>
 #include <iostream>
 
 namespace game_manager {
 
 using namespace std::literals;
 
+JournalEvent JournalEvent::Join(PlayerId player_id, std::string token, std::string name,
+                                std::string map_name, move_manager::Coords position) {
+    JournalEvent event{JournalEventType::join};
+    event.player_id = player_id;
+    event.token = std::move(token);
+    event.name = std::move(name);
+    event.map_name = std::move(map_name);
+    event.position = position;
+    return event;
+}
+
+JournalEvent JournalEvent::Move(PlayerId player_id, move_manager::Direction dir) {
+    JournalEvent event{JournalEventType::move};
+    event.player_id = player_id;
+    event.dir = dir;
+    return event;
+}
+
+JournalEvent JournalEvent::Retire(PlayerId player_id) {
+    JournalEvent event{JournalEventType::retire};
+    event.player_id = player_id;
+    return event;
+}
+
+JournalEvent JournalEvent::Loot(size_t loot_id, size_t loot_type, move_manager::Coords position) {
+    JournalEvent event{JournalEventType::loot};
+    event.loot_id = loot_id;
+    event.loot_type = loot_type;
+    event.position = position;
+    return event;
+}
+
+JournalEvent JournalEvent::Tick(uint64_t duration) {
+    JournalEvent event{JournalEventType::tick};
+    event.duration = duration;
+    return event;
+}
+
 GameSession::GameSession (net::io_context& ioc, const model::Map& map,
              const move_manager::Map& move_map, model::LootConfig config,
-             bool random_spawn, double retirement_time_s, uint64_t tick_duration)
-    : strand_(net::make_strand(ioc)),
+             bool random_spawn, double retirement_time_s, uint64_t tick_duration,
+             SessionId id)
+    : id_(id),
+      strand_(net::make_strand(ioc)),
       map_(map),
       move_map_(move_map),
+      max_players_(map.GetMaxPlayersPerSession()),
       random_spawn_(random_spawn),
       loot_interval_(config.period),
       loot_prob_(config.probability),
-      retirement_time_ms_(retirement_time_s * 1000)
+      retirement_time_ms_(retirement_time_s * 1000),
+      loot_in_areas_(move_map.GetAreasCount(), 0),
+      interest_radius_(map.GetInterestRadius())
 {
 }
 
 bool GameSession::BookPlace() {
-    size_t new_size = players_number_.fetch_add(1);
+    size_t players = players_number_.fetch_add(1);
 
-    if (new_size > max_players) {
+    if (max_players_ != 0 && players >= max_players_) {
         players_number_.fetch_sub(1);
         return false;
     }
@@ -31,41 +75,141 @@ bool GameSession::BookPlace() {
 }
 
 void GameSession::MovePlayers(size_t duration) {
-    for (Player& player : players_) {
-        player.Move(duration);
+    if (!IsPartitioned()) {
+        for (Player& player : players_) {
+            if (player.state.speed.IsNull()) {
+                continue;
+            }
+            player.Move(duration);
+            // Упёрся в край дороги
+            if (player.state.speed.IsNull()) {
+                StartIdle(player);
+            }
+        }
+        UpdatePlayersGrid();
+        return;
     }
+
+    // Игроки двигаются независимо друг от друга, поэтому делятся на равные части по порядку.
+    // Остановившиеся собираются по частям и ставятся в колесо в том же порядке, что и без деления
+    size_t parts = partitioning_.regions;
+    std::vector<std::vector<Player*>> stopped(parts);
+    ParallelFor(parts, [this, duration, parts, &stopped](size_t part) {
+        size_t first = players_.size() * part / parts;
+        size_t last = players_.size() * (part + 1) / parts;
+        for (size_t i = first; i < last; ++i) {
+            Player& player = players_[i];
+            if (player.state.speed.IsNull()) {
+                continue;
+            }
+            player.Move(duration);
+            if (player.state.speed.IsNull()) {
+                stopped[part].push_back(&player);
+            }
+        }
+    });
+    for (const auto& part : stopped) {
+        for (Player* player : part) {
+            StartIdle(*player);
+        }
+    }
+    UpdatePlayersGrid();
+}
+
+void GameSession::UpdatePlayersGrid() {
+    if (interest_radius_ == 0) {
+        return;
+    }
+    players_grid_.Build(players_.size(), interest_radius_, [this](size_t i) {
+        const move_manager::Coords& coor = players_[i].state.position.coor;
+        return geom::BasicPoint2D<double>{fixed_point::ToDouble(coor.x), fixed_point::ToDouble(coor.y)};
+    });
+    players_grid_valid_ = true;
+}
+
+void GameSession::SelectVisible(const Player& viewer) {
+    using fixed_point::ToDouble;
+
+    if (!players_grid_valid_) {
+        UpdatePlayersGrid();
+    }
+    if (!loot_grid_valid_) {
+        loot_grid_.Build(loot_objects_.size(), interest_radius_, [this](size_t i) {
+            const move_manager::Coords& coor = loot_objects_[i].position;
+            return geom::BasicPoint2D<double>{ToDouble(coor.x), ToDouble(coor.y)};
+        });
+        loot_grid_valid_ = true;
+    }
+
+    const double x = ToDouble(viewer.state.position.coor.x);
+    const double y = ToDouble(viewer.state.position.coor.y);
+    players_grid_.ForEachNear(x, y, interest_radius_, [this](uint32_t i) {
+        visible_players_.push_back(i);
+    });
+    loot_grid_.ForEachNear(x, y, interest_radius_, [this](uint32_t i) {
+        visible_objects_.push_back(i);
+    });
+    // В порядке полного ответа
+    std::sort(visible_players_.begin(), visible_players_.end());
+    std::sort(visible_objects_.begin(), visible_objects_.end());
 }
 
 std::vector<Retiree> GameSession::GetAndRemoveRetires(size_t duration) {
     std::vector<Retiree> res;
+    clock_ms_ += duration;
 
-    auto it = std::copy_if(players_.begin(), players_.end(), players_.begin(),
-                           [this, &res, duration] (Player& player) {
-        player.game_time += duration;
-
-        if (!player.state.speed.IsNull()) {
-            player.idle_time = 0;
-            return true;
+    retirement_wheel_.Advance(clock_ms_, [this, &res](PlayerId id, uint64_t deadline) {
+        auto it = id_for_player_.find(id);
+        // Срок устарел: игрок двигался после того, как он был поставлен
+        if (it == id_for_player_.end() || !it->second->idle || it->second->retire_at != deadline) {
+            return;
         }
+        res.push_back(*RemovePlayer(id));
+    });
 
-        player.idle_time += duration;
-        if (player.idle_time >= retirement_time_ms_) {
-            res.emplace_back(player);
-            id_for_player_.erase(player.id);
-            players_number_--;
-            return false;
-        }
-        return true;
+    return res;
+}
+
+std::optional<Retiree> GameSession::RemovePlayer(PlayerId id) {
+    auto it = id_for_player_.find(id);
+    if (it == id_for_player_.end()) {
+        return std::nullopt;
     }
-    );
 
-    players_.erase(it, players_.end());
+    Player& player = *it->second;
+    Retiree retiree{player, clock_ms_ - player.join_time};
+    id_for_player_.erase(it);
+    {
+        std::lock_guard lock{members_mutex_};
+        members_.erase(id);
+    }
+    if (player.idle) {
+        idle_players_--;
+    }
+    players_number_--;
+    players_grid_valid_ = false;
 
-    for (Player& player : players_) {
+    // Порядок игроков не важен, поэтому удаляем перестановкой с последним
+    if (&player != &players_.back()) {
+        player = std::move(players_.back());
         id_for_player_[player.id] = &player;
     }
+    players_.pop_back();
 
-    return res;
+    return retiree;
+}
+
+const LootObject& GameSession::AddLoot(size_t type, move_manager::Coords position, size_t id) {
+    const LootObject& object = loot_objects_.emplace_back(type, position, id);
+    CountLoot(position, 1);
+    loot_grid_valid_ = false;
+    return object;
+}
+
+void GameSession::CountLoot(move_manager::Coords position, int delta) {
+    if (const move_manager::Area* area = move_map_.FindArea(position)) {
+        loot_in_areas_[area->GetIndex()] += delta;
+    }
 }
 
 int GameSession::GetRandomLootObject() {
@@ -77,9 +221,9 @@ void GameSession::AddPlayersToProvider(GameProvider& provider, uint64_t duration
     for (const Player& player : players_) {
         const move_manager::State& state = player.state;
         geom::Point2D start{state.position.coor.x, state.position.coor.y};
-        double dx = (state.speed.x_axis * duration) / 1000;
-        double dy = (state.speed.y_axis * duration) / 1000;
-        geom::Point2D finish {start.x + dx, start.y + dy};
+        // Так же, как в State::Move, чтобы путь совпадал с перемещением
+        geom::Point2D finish{start.x + (state.speed.x_axis * duration) / 1000,
+                             start.y + (state.speed.y_axis * duration) / 1000};
         provider.AddGatherer({start, finish, model::DOG_WIDTH / 2});
     }
 }
@@ -116,6 +260,8 @@ void GameSession::HandleGatherEvents(std::vector<collision_detector::GatheringEv
                 if (!item.collected && player.items_in_bag.size() < map_.GetBagCapacity()) {
                     player.items_in_bag.push_back({item.id, item.type});
                     item.collected = true;
+                    CountLoot(item.position, -1);
+                    loot_grid_valid_ = false;
                 }
             }
         }
@@ -140,7 +286,15 @@ void GameSession::HandleCollisions(uint64_t duration) {
     AddItemsToProvider(provider);
     AddOfficiesToProvider(provider);
 
-    auto gather_events = FindGatherEvents(provider);
+    std::vector<GatheringEvent> gather_events;
+    if (IsPartitioned()) {
+        gather_events = FindGatherEventsPartitioned(provider, partitioning_.regions,
+            [this](size_t count, const std::function<void(size_t)>& task) {
+                ParallelFor(count, task);
+            });
+    } else {
+        gather_events = FindGatherEvents(provider);
+    }
 
     HandleGatherEvents(gather_events);
 }
@@ -149,7 +303,12 @@ void GameSession::GenerateLoot(uint64_t dur) {
     using namespace std::literals;
     int loot_to_generate = loot_generator_.Generate(dur * 1ms, loot_objects_.size(), players_.size());
     while (loot_to_generate-- > 0) {
-        loot_objects_.emplace_back(GetRandomLootObject(), move_map_.GetRandomPlace().coor, object_id_++);
+        // Лут по возможности не кладётся в клетку, где уже что-то лежит
+        auto place = move_map_.GetRandomPlace(generator, [this](const move_manager::Area& area) {
+            return loot_in_areas_[area.GetIndex()] == 0;
+        });
+        const LootObject& object = AddLoot(GetRandomLootObject(), place.coor, object_id_++);
+        WriteJournal(JournalEvent::Loot(object.id, object.type, object.position));
     }
 }
 
@@ -158,6 +317,8 @@ GameSessionRepr GameSession::GetRepresentation() {
     result.map_name = *map_.GetId();
     result.players = std::vector<Player>{players_.begin(), players_.end()};
     result.loot_objects = std::vector<LootObject>{loot_objects_.begin(), loot_objects_.end()};
+    result.id = id_;
+    result.journal_seq = journal_seq_;
 
     return result;
 }
@@ -168,6 +329,13 @@ void GameSession::Restore(GameSessionRepr&& repr) {
             std::make_move_iterator(repr.loot_objects.end())
 };
     object_id_ = loot_objects_.size();
+    std::fill(loot_in_areas_.begin(), loot_in_areas_.end(), 0);
+    for (const LootObject& object : loot_objects_) {
+        object_id_ = std::max(object_id_, object.id + 1);
+        CountLoot(object.position, 1);
+    }
+    loot_grid_valid_ = false;
+    journal_seq_ = repr.journal_seq;
 
     players_ = std::deque<Player>{
             std::make_move_iterator(repr.players.begin()),
@@ -179,12 +347,217 @@ void GameSession::Restore(GameSessionRepr&& repr) {
 
     positions.reserve(players_.size());
 
+    std::lock_guard lock{members_mutex_};
+    // Время простоя и время в игре в снимок не попадают и отсчитываются заново
     for (Player& player : players_) {
         id_for_player_[player.id] = &player;
+        members_.insert(player.id);
         positions.push_back(&player.state.position);
+        player.join_time = clock_ms_;
+        player.idle = false;
+        if (player.state.speed.IsNull()) {
+            StartIdle(player);
+        }
     }
 
     move_map_.PlaceCoors(positions);
+    players_grid_valid_ = false;
+}
+
+bool GameSession::ApplyJournalEvent(const JournalEvent& event, std::vector<Retiree>& retirees) {
+    if (event.seq <= journal_seq_) {
+        return false;
+    }
+    journal_seq_ = event.seq;
+
+    switch (event.type) {
+    case JournalEventType::join: {
+        move_manager::State state;
+        state.position.coor = event.position;
+        Player& player = EmplacePlayer(event.player_id, event.name, state);
+
+        std::vector<move_manager::PositionState*> positions{&player.state.position};
+        move_map_.PlaceCoors(positions);
+
+        players_number_ = players_.size();
+        break;
+    }
+    case JournalEventType::move:
+        if (auto it = id_for_player_.find(event.player_id); it != id_for_player_.end()) {
+            ApplyMove(*it->second, event.dir);
+        }
+        break;
+    case JournalEventType::tick:
+        // Случайные величины тика (выпавший лут) записаны отдельными событиями,
+        // остальная часть тика детерминирована. Уход игроков тоже записан: сроки простоя
+        // после Restore отсчитываются заново и разошлись бы с настоящими, поэтому колесо
+        // пенсий здесь не продвигается. Оставшиеся сроки сработают на первом живом тике
+        clock_ms_ += event.duration;
+        HandleCollisions(event.duration);
+        MovePlayers(event.duration);
+        loot_generator_.Generate(event.duration * 1ms, loot_objects_.size(), players_.size());
+        break;
+    case JournalEventType::retire:
+        if (auto retiree = RemovePlayer(event.player_id)) {
+            retirees.push_back(std::move(*retiree));
+        }
+        break;
+    case JournalEventType::loot:
+        AddLoot(event.loot_type, event.position, event.loot_id);
+        object_id_ = std::max(object_id_, event.loot_id + 1);
+        break;
+    }
+    return true;
+}
+
+void GameSession::ApplyMove(Player& player, move_manager::Direction dir) {
+    if (dir != move_manager::Direction::NONE) {
+        player.state.dir = dir;
+        // Поворот сбрасывает простой, даже если игрок остался на месте
+        StopIdle(player);
+    }
+    player.state.speed = GetSpeed(dir);
+    if (player.state.speed.IsNull() && !player.idle) {
+        StartIdle(player);
+    }
+}
+
+Player& GameSession::EmplacePlayer(PlayerId id, std::string name, const move_manager::State& state) {
+    Player& player = players_.emplace_back(id, std::move(name), state);
+    player.join_time = clock_ms_;
+    id_for_player_[id] = &player;
+    {
+        std::lock_guard lock{members_mutex_};
+        members_.insert(id);
+    }
+    players_grid_valid_ = false;
+    if (player.state.speed.IsNull()) {
+        StartIdle(player);
+    }
+    return player;
+}
+
+bool GameSession::IsMember(PlayerId player_id) const {
+    std::shared_lock lock{members_mutex_};
+    return members_.contains(player_id);
+}
+
+void GameSession::StartIdle(Player& player) {
+    if (!player.idle) {
+        idle_players_++;
+    }
+    player.idle = true;
+    player.retire_at = clock_ms_ + retirement_time_ms_;
+    retirement_wheel_.Schedule(player.id, player.retire_at);
+}
+
+void GameSession::StopIdle(Player& player) {
+    if (player.idle) {
+        player.idle = false;
+        idle_players_--;
+    }
+}
+
+void GameSession::ApplyMoveCommand(PlayerId player_id, move_manager::Direction dir) {
+    auto it = id_for_player_.find(player_id);
+    if (it == id_for_player_.end()) {
+        return;
+    }
+    ApplyMove(*it->second, dir);
+
+    WriteJournal(JournalEvent::Move(player_id, dir));
+}
+
+void GameSession::DrainInbox() {
+    InboxMove move;
+    while (inbox_.TryPop(move)) {
+        auto [slot, inserted] = inbox_slots_.try_emplace(move.player_id, inbox_moves_.size());
+        if (inserted) {
+            inbox_moves_.push_back({move.player_id, std::nullopt, move.dir});
+        }
+
+        CoalescedMove& coalesced = inbox_moves_[slot->second];
+        if (move.dir != move_manager::Direction::NONE) {
+            coalesced.turn = move.dir;
+        }
+        coalesced.last = move.dir;
+    }
+    inbox_.PublishHead();
+
+    // Игрок мог уйти на пенсию, пока команда ждала в очереди, - такие команды пропускаются
+    for (const CoalescedMove& coalesced : inbox_moves_) {
+        if (coalesced.turn && *coalesced.turn != coalesced.last) {
+            ApplyMoveCommand(coalesced.player_id, *coalesced.turn);
+        }
+        ApplyMoveCommand(coalesced.player_id, coalesced.last);
+    }
+
+    inbox_moves_.clear();
+    inbox_slots_.clear();
+}
+
+bool GameSession::TrySleep(uint64_t duration) {
+    uint64_t state = hibernation_.load(std::memory_order_acquire);
+    while (state & HIBERNATING) {
+        uint64_t slept = state & ~HIBERNATING;
+        if (slept + duration >= wake_deadline_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        if (hibernation_.compare_exchange_weak(state, state + duration, std::memory_order_acq_rel)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool GameSession::CatchUp() {
+    uint64_t state = hibernation_.exchange(0, std::memory_order_acq_rel);
+    if (state & HIBERNATING) {
+        ApplySleep(state & ~HIBERNATING);
+    }
+    DrainInbox();
+    return state & HIBERNATING;
+}
+
+void GameSession::ApplySleep(uint64_t duration) {
+    if (duration == 0) {
+        return;
+    }
+
+    // При восстановлении из журнала сон доигрывается как обычный тик
+    WriteJournal(JournalEvent::Tick(duration));
+
+    GetAndRemoveRetires(duration);
+    GenerateLoot(duration);
+}
+
+void GameSession::TryHibernate() {
+    if (idle_players_ != players_.size()) {
+        return;
+    }
+    // Колесо может разбудить и раньше срока пенсии, чтобы перенести сроки на нижний уровень
+    uint64_t next_event = retirement_wheel_.GetNextEventTime();
+    uint64_t deadline = ~HIBERNATING;
+    if (next_event != retirement_wheel_.NEVER) {
+        deadline = next_event > clock_ms_ ? std::min(next_event - clock_ms_, deadline) : 0;
+    }
+
+    wake_deadline_.store(deadline, std::memory_order_relaxed);
+    hibernation_.store(HIBERNATING, std::memory_order_release);
+
+    // Пара к барьеру в MovePlayer: команда, положенная в очередь до засыпания, будит сессию сразу
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (inbox_.ApproxSize() != 0) {
+        CatchUp();
+    }
+}
+
+void GameSession::WriteJournal(JournalEvent&& event) {
+    event.session_id = id_;
+    event.seq = ++journal_seq_;
+    if (journal_) {
+        journal_->Append(std::move(event));
+    }
 }
 
 move_manager::Speed GameSession::GetSpeed(move_manager::Direction dir) {
@@ -205,6 +578,11 @@ move_manager::Speed GameSession::GetSpeed(move_manager::Direction dir) {
 }
 
 GameManager::GameManager(model::Game& game, net::io_context& ioc, bool random_spawn, uint64_t tick_duration)
+    : GameManager(game, move_manager::BuildAreaGraphs(game.GetMaps()), ioc, random_spawn, tick_duration) {
+}
+
+GameManager::GameManager(model::Game& game, const std::vector<move_manager::AreaGraph>& graphs,
+                         net::io_context& ioc, bool random_spawn, uint64_t tick_duration)
     : game_(game),
       ioc_(ioc),
       tokens_strand_(net::make_strand(ioc_)),
@@ -213,19 +591,23 @@ GameManager::GameManager(model::Game& game, net::io_context& ioc, bool random_sp
       tick_duration_(tick_duration),
       test_mode_(tick_duration_ == 0)
 {
-    auto maps = game_.GetMaps();
+    const auto& maps = game_.GetMaps();
+    if (graphs.size() != maps.size()) {
+        throw std::invalid_argument("GameManager: area graphs do not match maps");
+    }
+
     maps_.reserve(maps.size());
-    for (const model::Map& map : maps) {
-        maps_.emplace_back(map);
-        maps_index_[map.GetId()] = &maps_.back();
+    for (size_t i = 0; i < maps.size(); ++i) {
+        maps_.emplace_back(graphs[i], maps[i].GetRoads());
+        maps_index_[maps[i].GetId()] = &maps_.back();
     }
     if (!test_mode_) {
-        auto ticker = std::make_shared<ticker::Ticker>(sessions_strand_, std::chrono::milliseconds{tick_duration_},
+        ticker_ = std::make_shared<ticker::Ticker>(sessions_strand_, std::chrono::milliseconds{tick_duration_},
             [this](std::chrono::milliseconds delta) {
                 Tick(std::chrono::duration_cast<std::chrono::milliseconds>(delta).count(), [](Result){});
             }
         );
-        ticker->Start();
+        ticker_->Start();
     }
 }
 
@@ -234,7 +616,10 @@ Token GameManager::GetUniqueToken() {
     stream.fill('0');
     stream << std::hex << std::setw(16) << generator1_();
     stream << std::hex << std::setw(16) << generator2_();
-    return Token{stream.str()};
+
+    std::string token = stream.str();
+    token.replace(0, token_prefix_.size(), token_prefix_);
+    return Token{std::move(token)};
 }
 
 GameRepr GameManager::GetRepresentation() {
@@ -272,11 +657,13 @@ void GameManager::Restore(GameRepr&& repr) {
 
     for (GameSessionRepr& sess : repr.sessions) {
         model::Map::Id map_id{sess.map_name};
-        const model::Map& map = *game_.FindMap(map_id);
-        const move_manager::Map& move_map = *maps_index_.at(map_id);
 
-        sessions_.emplace_back(ioc_, map, move_map, game_.GetLootConfig(),
-                               random_spawn_, game_.GetRetirementTime());
+        // В снимках старого формата идентификаторы сессий не сохранялись
+        SessionId session_id = sess.id;
+        if (FindSessionById(session_id) != nullptr) {
+            session_id = next_session_id_;
+        }
+        CreateSession(map_id, session_id);
 
         std::vector<Player> valid_players;
         valid_players.reserve(sess.players.size());
@@ -292,9 +679,161 @@ void GameManager::Restore(GameRepr&& repr) {
         std::swap(valid_players, sess.players);
 
         sessions_.back().Restore(std::move(sess));
-        sessions_for_maps_[map_id].push_back(&sessions_.back());
+    }
+}
+
+size_t GameManager::Replay(std::vector<JournalEvent>&& events) {
+    size_t applied = 0;
+
+    for (JournalEvent& event : events) {
+        GameSession* session = FindSessionById(event.session_id);
+
+        if (session == nullptr) {
+            model::Map::Id map_id{event.map_name};
+            if (event.type != JournalEventType::join || !maps_index_.contains(map_id)) {
+                continue;
+            }
+            session = &CreateSession(map_id, event.session_id);
+        }
+
+        std::vector<Retiree> retirees;
+        if (!session->ApplyJournalEvent(event, retirees)) {
+            continue;
+        }
+        applied++;
+
+        if (event.type == JournalEventType::join) {
+            Token token{event.token};
+            tokens_[token] = event.player_id;
+            id_to_tokens_.insert_or_assign(event.player_id, std::move(token));
+            players_for_sessions_[event.player_id] = session;
+            if (player_counter_ <= event.player_id) {
+                player_counter_ = event.player_id + 1;
+            }
+        }
+
+        // Рекорды ушедших игроков не сохраняются повторно: к моменту сбоя
+        // они, скорее всего, уже записаны в базу
+        for (const Retiree& retiree : retirees) {
+            if (id_to_tokens_.contains(retiree.id)) {
+                DeleteOnePlayer(retiree.id);
+            }
+            players_for_sessions_.erase(retiree.id);
+        }
+    }
+
+    return applied;
+}
+
+GameSession& GameManager::CreateSession(const model::Map::Id& map) {
+    return CreateSession(map, next_session_id_);
+}
+
+GameSession& GameManager::CreateSession(const model::Map::Id& map, SessionId id) {
+    GameSession& session = sessions_.emplace_back(ioc_, *FindMap(map), *maps_index_.at(map),
+                                                  game_.GetLootConfig(), random_spawn_,
+                                                  game_.GetRetirementTime(), tick_duration_, id);
+    next_session_id_ = std::max(next_session_id_, id + 1);
+    session.SetJournal(journal_);
+    session.SetPartitioning(partitioning_);
+    sessions_for_maps_[map].push_back(&session);
+    return session;
+}
+
+GameSession* GameManager::ChooseSession(const std::vector<GameSession*>& sessions) {
+    GameSession* result = nullptr;
+    for (GameSession* session : sessions) {
+        if (!session->HasPlace()) {
+            continue;
+        }
+        if (result == nullptr
+            || std::pair{session->GetTickCost(), session->GetPlayersCount()}
+               < std::pair{result->GetTickCost(), result->GetPlayersCount()}) {
+            result = session;
+        }
     }
 
+    if (result != nullptr && !result->BookPlace()) {
+        return nullptr;
+    }
+    return result;
+}
+
+GameSession* GameManager::FindSessionById(SessionId id) {
+    for (GameSession& session : sessions_) {
+        if (session.GetId() == id) {
+            return &session;
+        }
+    }
+    return nullptr;
+}
+
+void GameManager::UpdateSessionsMetrics(metrics::Registry& registry) const {
+    int64_t pending = 0;
+    int64_t hibernating = 0;
+    for (const GameSession& session : sessions_) {
+        pending += session.GetPendingCount();
+        hibernating += session.IsHibernating();
+    }
+    registry.sessions.Set(sessions_.size());
+    registry.hibernating_sessions.Set(hibernating);
+    registry.session_strands_queue.Set(pending);
+
+    for (const auto& [map, sessions] : sessions_for_maps_) {
+        int64_t players = 0;
+        for (const GameSession* session : sessions) {
+            players += session->GetPlayersCount();
+        }
+        registry.SetPlayersOnMap(*map, players);
+    }
+}
+
+void GameManager::ReclaimEmptySessions(uint64_t duration) {
+    for (auto it = sessions_.begin(); it != sessions_.end();) {
+        GameSession& session = *it;
+        auto next = std::next(it);
+
+        if (session.AddEmptyTime(duration) < session_grace_period_) {
+            it = next;
+            continue;
+        }
+        // Ушедшие игроки удаляются из players_for_sessions_ асинхронно после тика
+        bool referenced = std::any_of(players_for_sessions_.begin(), players_for_sessions_.end(),
+                                      [&session](const auto& item) {
+                                          return item.second == &session;
+                                      });
+        if (referenced) {
+            it = next;
+            continue;
+        }
+
+        std::erase(sessions_for_maps_[session.GetMapId()], &session);
+        reclaimed_sessions_.splice(reclaimed_sessions_.end(), sessions_, it);
+
+        // Сессию больше не найти, но в её strand ещё могут быть обработчики
+        session.Reclaim([this, &session] {
+            net::dispatch(sessions_strand_, [this, &session] {
+                reclaimed_sessions_.remove_if([&session](const GameSession& reclaimed) {
+                    return &reclaimed == &session;
+                });
+            });
+        });
+        it = next;
+    }
+}
+
+void GameManager::SetTickOptions(ticker::TickOptions options) {
+    test_stepper_ = ticker::Stepper{options};
+    if (ticker_) {
+        ticker_->SetOptions(options);
+    }
+}
+
+void GameManager::SetJournal(std::shared_ptr<JournalInterface> journal) {
+    journal_ = std::move(journal);
+    for (GameSession& session : sessions_) {
+        session.SetJournal(journal_);
+    }
 }
 
 void GameManager::SetRecordSaver(const std::shared_ptr<RecordSaverInterface>& newRecord_saver) {
@@ -1,12 +1,11 @@
 #pragma once
 
-// На данный момент неизвестно количество игроков в сессии
-// поэтому используется максимум для int, который получаем из
-// библиотеки limits. Когда количество игроков станет известно
-// эту библиотеку можно больше не использовать
-#include <limits>
-
+#include <atomic>
 #include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <optional>
@@ -21,7 +20,15 @@
 #include "ticker.h"
 #include "loot_generator.h"
 #include "collision_detector.h"
-
+#include "metrics.h"
+#include "tick_profiler.h"
+#include "request_tracer.h"
+#include "mpsc_ring.h"
+#include "timing_wheel.h"
+#include "parallel.h"
+#include "interest_grid.h"
+
+#include <boost/asio/async_result.hpp>
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/beast.hpp>
@@ -47,13 +54,41 @@ private:
     std::vector<collision_detector::Gatherer> gatherers_;
 };
 
+namespace net = boost::asio;
+
 namespace detail {
 struct TokenTag {};
+
+// Отправляет обработчик в strand, учитывая его в счётчике ожидающих
+template <class Strand, class Handler>
+void DispatchCounted(Strand& strand, metrics::Gauge& pending, Handler&& handler) {
+    pending.Add(1);
+    net::dispatch(strand,
+        [&pending, handler = std::forward<Handler>(handler)]()mutable{
+            pending.Add(-1);
+            handler();
+        }
+    );
+}
+
+// Запускает асинхронную операцию GameManager. С completion token вроде use_awaitable
+// initiation выполняется позже, при co_await, поэтому текущая трасса запоминается сразу
+template <class Signature, class CompletionToken, class Initiation, class... Args>
+auto Initiate(CompletionToken&& token, Initiation&& initiation, Args&&... args) {
+    return net::async_initiate<CompletionToken, Signature>(
+        [trace = request_tracer::GetCurrent(), initiation = std::forward<Initiation>(initiation)]
+        (auto&& handler, auto&&... args)mutable{
+            request_tracer::CurrentScope scope{std::move(trace)};
+            initiation(std::forward<decltype(handler)>(handler), std::forward<decltype(args)>(args)...);
+        },
+        token, std::forward<Args>(args)...
+    );
+}
 }  // namespace detail
 
-namespace net = boost::asio;
 using Token = util::Tagged<std::string, detail::TokenTag>;
 using PlayerId = uint32_t;
+using SessionId = uint32_t;
 namespace beast = boost::beast;
 using TokenStr = std::string;
 using namespace std::literals;
@@ -76,8 +111,11 @@ struct Player {
     move_manager::State state;
     std::vector<ItemInfo> items_in_bag;
     size_t score = 0;
-    size_t idle_time = 0;
-    size_t game_time = 0;
+    // Моменты по часам сессии, мс. Время в игре считается от join_time
+    uint64_t join_time = 0;
+    // Игрок стоит и уйдёт на пенсию в retire_at, если не двинется
+    bool idle = false;
+    uint64_t retire_at = 0;
     void Move(uint64_t dur) {
         state.Move(dur);
     }
@@ -95,18 +133,43 @@ using LootObjectsContainer = std::deque<LootObject>;
 struct PlayersAndObjects {
     const std::deque<Player>& players;
     const LootObjectsContainer& objects;
+    // Индексы видимых игроку собак и лута по возрастанию. nullptr - видно всё
+    const std::vector<uint32_t>* visible_players = nullptr;
+    const std::vector<uint32_t>* visible_objects = nullptr;
 };
 
 enum class Result {
     no_token,
     no_session,
+    // Очередь strand'а сессии переполнена, запрос отклонён без постановки в неё
+    overloaded,
     ok
 };
 
+// Команда пакетного запроса. Без направления - запрос состояния сессии игрока
+struct BatchCommand {
+    Token token;
+    std::optional<move_manager::Direction> move;
+};
+
+// Копия состояния сессии, общая для всех запросов состояния этой сессии в пакете
+struct SessionState {
+    std::deque<Player> players;
+    LootObjectsContainer objects;
+};
+
+struct BatchResult {
+    Result result = Result::no_token;
+    std::shared_ptr<const SessionState> state;
+};
+
 struct GameSessionRepr {
     std::string map_name;
     std::vector<Player> players;
     std::vector<LootObject> loot_objects;
+    SessionId id = 0;
+    // Номер последнего события журнала, вошедшего в снимок
+    uint64_t journal_seq = 0;
 };
 
 struct PlayerRepr {
@@ -116,10 +179,10 @@ struct PlayerRepr {
 
 struct Retiree {
     Retiree() = default;
-    explicit Retiree(const Player& player) : name(player.name),
-                                             score(player.score),
-                                             game_time(player.game_time),
-                                             id(player.id) {}
+    Retiree(const Player& player, size_t game_time) : name(player.name),
+                                                      score(player.score),
+                                                      game_time(game_time),
+                                                      id(player.id) {}
     std::string name;
     size_t score;
     size_t game_time;
@@ -127,6 +190,47 @@ struct Retiree {
 };
 
 
+enum class JournalEventType {
+    join,
+    move,
+    retire,
+    loot,
+    tick
+};
+
+// Событие журнала изменений между снимками состояния.
+// seq нумерует события внутри одной сессии
+struct JournalEvent {
+    explicit JournalEvent(JournalEventType type)
+        : type(type) {
+    }
+
+    static JournalEvent Join(PlayerId player_id, std::string token, std::string name,
+                             std::string map_name, move_manager::Coords position);
+    static JournalEvent Move(PlayerId player_id, move_manager::Direction dir);
+    static JournalEvent Retire(PlayerId player_id);
+    static JournalEvent Loot(size_t loot_id, size_t loot_type, move_manager::Coords position);
+    static JournalEvent Tick(uint64_t duration);
+
+    JournalEventType type;
+    SessionId session_id = 0;
+    uint64_t seq = 0;
+    PlayerId player_id = 0;
+    std::string token;
+    std::string name;
+    std::string map_name;
+    move_manager::Coords position{0., 0.};
+    move_manager::Direction dir = move_manager::Direction::NONE;
+    size_t loot_id = 0;
+    size_t loot_type = 0;
+    uint64_t duration = 0;
+};
+
+class JournalInterface {
+public:
+    virtual void Append(JournalEvent&& event) = 0;
+};
+
 class RecordSaverInterface {
 public:
     virtual void Save(std::vector<Retiree>&&) = 0;
@@ -176,24 +280,109 @@ private:
     Callback callback_;
 };
 
+// Режим больших сессий: перемещения и сбор предметов считаются параллельно по полосам карты
+struct PartitionOptions {
+    // С какого числа игроков сессия делится на полосы. 0 - никогда
+    size_t min_players = 0;
+    size_t regions = 1;
+};
+
 class GameSession{
 public:
-    const int max_players = std::numeric_limits<int>::max();
     GameSession (net::io_context& ioc, const model::Map& map,
                  const move_manager::Map& move_map, model::LootConfig config,
-                 bool random_spawn, double retirement_time, uint64_t tick_duration = 0);
+                 bool random_spawn, double retirement_time, uint64_t tick_duration = 0,
+                 SessionId id = 0);
 
     bool BookPlace();
 
+    bool HasPlace() const {
+        return max_players_ == 0 || players_number_ < max_players_;
+    }
+
+    // Сглаженная длительность тика, мкс. По ней новые игроки направляются в менее нагруженную сессию
+    double GetTickCost() const {
+        return tick_cost_.load(std::memory_order_relaxed) / 8.;
+    }
+
+    SessionId GetId() const {
+        return id_;
+    }
+
+    const model::Map::Id& GetMapId() const {
+        return map_.GetId();
+    }
+
+    size_t GetPlayersCount() const {
+        return players_number_;
+    }
+
+    int64_t GetPendingCount() const {
+        return pending_.Get();
+    }
+
+    // Сессия, в которой никто не двигается, засыпает в конце тика и не тикается.
+    // Пропущенное время копится и применяется одним шагом при следующем обращении к сессии
+    bool IsHibernating() const {
+        return hibernation_.load(std::memory_order_acquire) & HIBERNATING;
+    }
+
+    // Засчитывает тик спящей сессии. false, если сессия не спит или за этот тик
+    // кто-то из игроков должен уйти на пенсию - тогда сессию нужно тикать
+    bool TrySleep(uint64_t duration);
+
+    // Время, которое сессия пуста. Вызывать только из sessions_strand_ GameManager'а
+    uint64_t AddEmptyTime(uint64_t duration) {
+        empty_time_ = players_number_ == 0 && IsHibernating() ? empty_time_ + duration : 0;
+        return empty_time_;
+    }
+
+    // Вызывает on_reclaimed из strand_ после всех поставленных в него обработчиков.
+    // Новых обращений к сессии к этому моменту быть не должно
+    template<class Callback>
+    void Reclaim(Callback&& on_reclaimed);
+
+    void SetJournal(std::shared_ptr<JournalInterface> journal) {
+        journal_ = std::move(journal);
+    }
+
+    // Вызывать только до запуска ioc или из strand_
+    void SetPartitioning(PartitionOptions options) {
+        partitioning_ = options;
+    }
+
+    // Применяет событие журнала при восстановлении. Вызывать только до запуска ioc.
+    // Возвращает false, если событие уже учтено в снимке
+    bool ApplyJournalEvent(const JournalEvent& event, std::vector<Retiree>& retirees);
+
     template <class Handler>
     void AddPlayer(PlayerInfo info, Handler&& handler);
 
     template<class Handler>
-    void GetPlayers(Handler&& handler) const;
+    void GetPlayers(Handler&& handler);
 
+    // То же, что GetPlayers, но если у карты задан радиус интереса, в результате
+    // отмечены только собаки и лут в этом радиусе от игрока viewer_id
+    template<class Handler>
+    void GetState(PlayerId viewer_id, Handler&& handler);
+
+    // Команда кладётся во входящую очередь сессии, ответ отправляется сразу.
+    // Очередь разбирается в strand перед тиком и перед чтением состояния.
+    // Если очередь переполнена, команда выполняется через strand как раньше.
+    // Игроку, уже ушедшему на пенсию, по обоим путям отвечается no_session
     template<class Handler>
     void MovePlayer(PlayerId player_id, move_manager::Direction dir, Handler&& handler);
 
+    struct Command {
+        PlayerId player_id;
+        std::optional<move_manager::Direction> move;
+    };
+
+    // Выполняет команды за один заход в strand. Состояние снимается после всех перемещений,
+    // если среди команд есть его запрос. handler(std::vector<Result>, std::shared_ptr<const SessionState>)
+    template<class Handler>
+    void ApplyBatch(std::vector<Command> commands, Handler&& handler);
+
     template<class Callback>
     void Tick(uint64_t duration, Callback&& remove_retirees);
 
@@ -206,12 +395,26 @@ public:
 private:
     std::vector<Retiree> GetAndRemoveRetires(size_t duration);
 
+    // Убирает игрока из сессии. nullopt, если его нет
+    std::optional<Retiree> RemovePlayer(PlayerId id);
+
     void MovePlayers(size_t duration);
 
     void GenerateLoot(uint64_t dur);
 
     int GetRandomLootObject();
 
+    // Добавляет лут и учитывает его в клетке
+    const LootObject& AddLoot(size_t type, move_manager::Coords position, size_t id);
+
+    void CountLoot(move_manager::Coords position, int delta);
+
+    // Перестраивает сетку игроков. Вызывается после перемещений, если у карты есть радиус интереса
+    void UpdatePlayersGrid();
+
+    // Заполняет visible_players_ и visible_objects_ для viewer, перестраивая устаревшие сетки
+    void SelectVisible(const Player& viewer);
+
     void AddPlayersToProvider(GameProvider& provider, uint64_t duration);
 
     void AddItemsToProvider(GameProvider& provider);
@@ -222,13 +425,93 @@ private:
 
     void HandleCollisions(uint64_t duration);
 
+    // Сессия достаточно велика, чтобы делить тик между потоками
+    bool IsPartitioned() const {
+        return partitioning_.min_players != 0 && partitioning_.regions > 1
+               && players_.size() >= partitioning_.min_players;
+    }
+
+    // Выполняет task(i) для i из [0, count) в потоках ioc, считая сам strand_ одним из них
+    template <class Task>
+    void ParallelFor(size_t count, const Task& task);
+
     move_manager::Speed GetSpeed(move_manager::Direction dir);
 
+    void ApplyMove(Player& player, move_manager::Direction dir);
+
+    // Добавляет игрока, отсчитывая его время от текущего момента сессии
+    Player& EmplacePlayer(PlayerId id, std::string name, const move_manager::State& state);
+
+    // Ставит срок пенсии остановившемуся игроку
+    void StartIdle(Player& player);
+
+    void StopIdle(Player& player);
+
+    // Можно вызывать из любого потока
+    bool IsMember(PlayerId player_id) const;
+
+    // Применяет и записывает в журнал перемещение игрока. Вызывать только из strand_
+    void ApplyMoveCommand(PlayerId player_id, move_manager::Direction dir);
+
+    // Разбирает входящую очередь. Вызывать только из strand_
+    void DrainInbox();
+
+    // Будит сессию, применяя пропущенное время, и разбирает входящую очередь.
+    // Вызывать только из strand_ в начале каждого обработчика. true, если сессия спала
+    bool CatchUp();
+
+    // Применяет время сна: игроки стояли, поэтому не было ни перемещений, ни столкновений,
+    // а на пенсию уходить было рано (см. TrySleep). Остаются время простоя и лут
+    void ApplySleep(uint64_t duration);
+
+    // Усыпляет сессию, если никто не двигается. Вызывать только из strand_
+    void TryHibernate();
+
+    void WriteJournal(JournalEvent&& event);
+
+    SessionId id_;
     const model::Map& map_;
     const move_manager::Map& move_map_;
     net::strand<net::io_context::executor_type> strand_;
+    // Обработчики, ожидающие выполнения в strand_
+    mutable metrics::Gauge pending_;
+
+    struct InboxMove {
+        PlayerId player_id = 0;
+        move_manager::Direction dir = move_manager::Direction::NONE;
+    };
+
+    // Несколько команд игрока за тик сводятся к двум: последний поворот и последняя команда.
+    // Так сохраняются и направление, и сброс времени простоя
+    struct CoalescedMove {
+        PlayerId player_id;
+        std::optional<move_manager::Direction> turn;
+        move_manager::Direction last;
+    };
+
+    // Старший бит - сессия спит, остальные - сколько мс она проспала
+    static constexpr uint64_t HIBERNATING = 1ull << 63;
+    std::atomic<uint64_t> hibernation_ = 0;
+    // Сколько мс сна осталось до пенсии первого игрока. Записывается до установки HIBERNATING
+    std::atomic<uint64_t> wake_deadline_ = 0;
+    uint64_t empty_time_ = 0;
+
+    static constexpr size_t INBOX_CAPACITY = 1024;
+    // Пишут обработчики /action из любых потоков, читает только strand_
+    mpsc_ring::MpscRing<InboxMove> inbox_{INBOX_CAPACITY};
+    // Буферы разбора очереди переиспользуются между тиками
+    std::vector<CoalescedMove> inbox_moves_;
+    std::unordered_map<PlayerId, size_t> inbox_slots_;
     std::unordered_map<PlayerId, Player*> id_for_player_;
+    // Те же игроки для MovePlayer, который проверяет их вне strand_. Меняет только strand_
+    mutable std::shared_mutex members_mutex_;
+    std::unordered_set<PlayerId> members_;
     std::deque<Player> players_;
+    // Из настроек карты, 0 - без ограничения
+    const size_t max_players_;
+    // Сглаженная длительность тика, умноженная на 8, чтобы не терять дробную часть среднего
+    std::atomic<uint64_t> tick_cost_ = 0;
+    PartitionOptions partitioning_;
     //Сразу бронируем место для создателя сессии
     std::atomic<size_t> players_number_ = 1;
 
@@ -238,8 +521,31 @@ private:
 
     size_t retirement_time_ms_;
 
+    // Часы сессии: сумма длительностей тиков, мс
+    uint64_t clock_ms_ = 0;
+    // Сроки пенсии стоящих игроков. Устаревшие сроки отбрасываются при срабатывании
+    timing_wheel::TimingWheel<PlayerId> retirement_wheel_;
+    size_t idle_players_ = 0;
+
     size_t object_id_ = 0;
     LootObjectsContainer loot_objects_;
+    // Сколько несобранного лута в каждой клетке move_map_
+    std::vector<uint32_t> loot_in_areas_;
+
+    // Из настроек карты, 0 - /state отдаёт всю сессию
+    const double interest_radius_;
+    // Сетки строятся только при заданном радиусе. Игроков - в конце перемещений,
+    // лута - при первом /state после его изменения
+    interest_grid::InterestGrid players_grid_;
+    bool players_grid_valid_ = false;
+    interest_grid::InterestGrid loot_grid_;
+    bool loot_grid_valid_ = false;
+    // Ответ обработчику /state, переиспользуются между запросами
+    std::vector<uint32_t> visible_players_;
+    std::vector<uint32_t> visible_objects_;
+    std::shared_ptr<JournalInterface> journal_;
+    uint64_t journal_seq_ = 0;
+
     double loot_interval_;
     double loot_prob_;
     loot_gen::LootGenerator loot_generator_{static_cast<int>(loot_interval_ * 1000) * 1ms, loot_prob_/*,
@@ -261,6 +567,10 @@ public:
 
     GameManager(model::Game& game, net::io_context& ioc, bool random_spawn, uint64_t tick_duration);
 
+    // graphs - предобработанные карты в порядке game.GetMaps(), например из map_cache
+    GameManager(model::Game& game, const std::vector<move_manager::AreaGraph>& graphs,
+                net::io_context& ioc, bool random_spawn, uint64_t tick_duration);
+
     model::Game& GetGame() { return game_; }
     const Maps GetMaps() const noexcept { return game_.GetMaps(); }
 
@@ -272,8 +582,17 @@ public:
         return game_.FindMap(id);
     }
 
-    template<class Handler>
-    void Join(std::string name, model::Map::Id map, Handler&& handler);
+    net::io_context::executor_type GetExecutor() noexcept {
+        return ioc_.get_executor();
+    }
+
+    // Join, GetPlayers, GetState, MovePlayer, Batch и CallTick - асинхронные операции asio:
+    // token - обработчик или completion token, например net::use_awaitable.
+    // Обработчик вызывается в strand'е, где готов результат. Корутина продолжается в нём
+    // до следующего co_await, и только до него можно читать ссылки из PlayersAndObjects
+
+    template<class CompletionToken>
+    auto Join(std::string name, model::Map::Id map, CompletionToken&& token);
 private:
     template<class Handler>
     void AddPlayer(PlayerInfo p_info, model::Map::Id map, Handler&& handler);
@@ -287,14 +606,27 @@ private:
 
     Token GetUniqueToken();
 public:
-    template<class Handler>
-    void GetPlayers(Token token, Handler&& handler);
+    using PlayersSignature = void(std::optional<PlayersAndObjects>, Result);
 
-    template<class Handler>
-    void MovePlayer(Token token, move_manager::Direction dir, Handler&& handler);
+    template<class CompletionToken>
+    auto GetPlayers(Token token, CompletionToken&& token_handler);
 
-    template<class Handler>
-    void CallTick(uint64_t duration, Handler&& handler);
+    // Состояние сессии с точки зрения игрока, см. GameSession::GetState
+    template<class CompletionToken>
+    auto GetState(Token token, CompletionToken&& token_handler);
+
+    template<class CompletionToken>
+    auto MovePlayer(Token token, move_manager::Direction dir, CompletionToken&& token_handler);
+
+    // Токены всего пакета ищутся за один заход в tokens_strand_, сессии - за один заход
+    // в sessions_strand_, команды каждой сессии выполняются за один заход в её strand.
+    // Результаты std::vector<BatchResult> - в порядке команд
+    template<class CompletionToken>
+    auto Batch(std::vector<BatchCommand>&& commands, CompletionToken&& token);
+
+    // Длинный duration делится на шаги по правилам SetTickOptions, как и у тикера
+    template<class CompletionToken>
+    auto CallTick(uint64_t duration, CompletionToken&& token);
 
     bool IsTestMode() const {
         return test_mode_;
@@ -312,9 +644,66 @@ public:
     }
     void SetRecordSaver(const std::shared_ptr<RecordSaverInterface>& newRecord_saver);
 
+    void SetJournal(std::shared_ptr<JournalInterface> journal);
+
+    // Начало всех новых токенов. Маршрутизатор определяет по нему воркер игрока.
+    // Вызывать только до запуска ioc
+    void SetTokenPrefix(std::string prefix) {
+        token_prefix_ = std::move(prefix);
+    }
+
+    // Запросы игроков отклоняются с Result::overloaded, если в strand'е их сессии
+    // ждут max_queue обработчиков. 0 - без ограничения
+    void SetMaxSessionQueue(size_t max_queue) {
+        max_session_queue_ = static_cast<int64_t>(max_queue);
+    }
+
+    // Вызывать только до запуска ioc
+    void SetTickOptions(ticker::TickOptions options);
+
+    // Применяется к сессиям, созданным после вызова. Вызывать только до запуска ioc
+    void SetPartitioning(PartitionOptions options) {
+        partitioning_ = options;
+    }
+
+    // Сессии без игроков удаляются, проспав grace_period_ms. Вызывать только до запуска ioc
+    void SetSessionGracePeriod(uint64_t grace_period_ms) {
+        session_grace_period_ = grace_period_ms;
+    }
+
+    // Доигрывает события журнала поверх восстановленного снимка.
+    // Вызывать только до запуска ioc. Возвращает количество применённых событий
+    size_t Replay(std::vector<JournalEvent>&& events);
+
     std::vector<Retiree> GetRecords(size_t start, size_t max_items) const;
 
 private:
+    template<class Handler>
+    struct BatchContext {
+        BatchContext(std::vector<BatchCommand>&& commands, Handler handler)
+            : commands(std::move(commands))
+            , ids(this->commands.size())
+            , results(this->commands.size())
+            , handler(std::move(handler)) {
+        }
+
+        // Вызывается после обработки каждой группы команд одной сессии
+        void FinishGroup() {
+            if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                handler(std::move(results));
+            }
+        }
+
+        std::vector<BatchCommand> commands;
+        std::vector<PlayerId> ids;
+        std::vector<BatchResult> results;
+        std::atomic<size_t> remaining = 0;
+        Handler handler;
+    };
+
+    template<class Handler>
+    void StartBatch(std::vector<BatchCommand>&& commands, Handler&& handler);
+
     template<class ReprType>
     void AddPlayersForRepr(ReprType repr);
 
@@ -338,6 +727,22 @@ private:
 
     void DeletePlayers(std::vector<Retiree>&& retirees);
 
+    GameSession& CreateSession(const model::Map::Id& map);
+
+    GameSession& CreateSession(const model::Map::Id& map, SessionId id);
+
+    GameSession* FindSessionById(SessionId id);
+
+    // Сессия со свободным местом и наименьшей нагрузкой, место в ней бронируется.
+    // nullptr, если все заполнены. Вызывать только из sessions_strand_
+    GameSession* ChooseSession(const std::vector<GameSession*>& sessions);
+
+    // Вызывать только из sessions_strand_
+    void UpdateSessionsMetrics(metrics::Registry& registry) const;
+
+    // Удаляет сессии, пустые дольше session_grace_period_. Вызывать только из sessions_strand_
+    void ReclaimEmptySessions(uint64_t duration);
+
     model::Game& game_;
     net::io_context& ioc_;
 
@@ -357,7 +762,13 @@ private:
     // players_for_sessions_ только из session_strand_!!!!!!!!!!!!!!!!
     net::strand<net::io_context::executor_type> sessions_strand_;
 
-    std::deque<GameSession> sessions_;
+    // list, а не deque: удаление сессии не должно сдвигать остальные
+    std::list<GameSession> sessions_;
+    // Удалённые сессии, которые ещё ждут завершения обработчиков в своём strand
+    std::list<GameSession> reclaimed_sessions_;
+    uint64_t session_grace_period_ = 60000;
+    PartitionOptions partitioning_;
+    SessionId next_session_id_ = 0;
     std::unordered_map<model::Map::Id, std::vector<GameSession*>, MapHasher> sessions_for_maps_;
     std::unordered_map<PlayerId, GameSession*> players_for_sessions_;
 
@@ -373,12 +784,18 @@ private:
         std::uniform_int_distribution<std::mt19937_64::result_type> dist;
         return dist(random_device_);
     }()};
+    std::string token_prefix_;
+    int64_t max_session_queue_ = 0;
 
     bool random_spawn_;
     uint64_t tick_duration_;
     bool test_mode_;
+    std::shared_ptr<ticker::Ticker> ticker_;
+    // Делит /tick тестового режима на шаги. Только из sessions_strand_
+    ticker::Stepper test_stepper_;
 
     std::vector<std::shared_ptr<TickListner>> listners_;
+    std::shared_ptr<JournalInterface> journal_;
 };
 } // namespace game_manager
 
@@ -388,13 +805,15 @@ namespace game_manager {
 
 template <class Handler>
 void GameSession::AddPlayer(PlayerInfo info, Handler&& handler) {
-    net::dispatch(strand_,
-        [this, info = std::move(info), handler = std::forward<Handler>(handler)]
+    detail::DispatchCounted(strand_, pending_,
+        [this, info = std::move(info), handler = std::forward<Handler>(handler)]()mutable
         {
+            CatchUp();
+
             move_manager::State state;
 
             if (random_spawn_) {
-                state.position = move_map_.GetRandomPlace();
+                state.position = move_map_.GetRandomPlace(generator);
             } else {
                 state.position = move_map_.GetStartPlace();
             }
@@ -407,58 +826,147 @@ void GameSession::AddPlayer(PlayerInfo info, Handler&& handler) {
                 name = std::move(info.name);
             }
 
-            players_.emplace_back(info.Id, std::move(name), state);
-            id_for_player_[info.Id] = &players_.back();
-            handler(info);
+            EmplacePlayer(info.Id, std::move(name), state);
+
+            WriteJournal(JournalEvent::Join(info.Id, info.token, players_.back().name,
+                                            *map_.GetId(), state.position.coor));
+
+            handler(std::move(info));
         }
     );
 }
 
 template<class Handler>
-void GameSession::GetPlayers(Handler&& handler) const {
-    net::dispatch(
-        strand_,
-        [this, handler = std::forward<Handler>(handler)](){
+void GameSession::GetPlayers(Handler&& handler) {
+    detail::DispatchCounted(
+        strand_, pending_,
+        request_tracer::Hop(request_tracer::Stage::session, [this, handler = std::forward<Handler>(handler)]()mutable{
+            bool slept = CatchUp();
             PlayersAndObjects res{players_, loot_objects_};
             handler(res, Result::ok);
-        }
+            if (slept) {
+                TryHibernate();
+            }
+        })
     );
 }
 
 template<class Handler>
-void GameSession::MovePlayer(PlayerId player_id, move_manager::Direction dir, Handler&& handler) {
-    net::dispatch(
-        strand_,
-        [this, player_id, dir, handler = std::forward<Handler>(handler)] {
-            auto it = id_for_player_.find(player_id);
-
-            if (it != id_for_player_.end()) {
-                Player& player = *it->second;
-                if (dir != move_manager::Direction::NONE) {
-                    player.state.dir = dir;
-                    player.idle_time = 0;
+void GameSession::GetState(PlayerId viewer_id, Handler&& handler) {
+    detail::DispatchCounted(
+        strand_, pending_,
+        request_tracer::Hop(request_tracer::Stage::session, [this, viewer_id, handler = std::forward<Handler>(handler)]()mutable{
+            bool slept = CatchUp();
+            PlayersAndObjects res{players_, loot_objects_};
+            if (interest_radius_ > 0) {
+                // Игрок мог уйти на пенсию, пока запрос ждал в strand - тогда ему не видно ничего
+                visible_players_.clear();
+                visible_objects_.clear();
+                if (auto it = id_for_player_.find(viewer_id); it != id_for_player_.end()) {
+                    SelectVisible(*it->second);
                 }
-                player.state.speed = GetSpeed(dir);
+                res.visible_players = &visible_players_;
+                res.visible_objects = &visible_objects_;
+            }
+            handler(res, Result::ok);
+            if (slept) {
+                TryHibernate();
+            }
+        })
+    );
+}
+
+template<class Handler>
+void GameSession::MovePlayer(PlayerId player_id, move_manager::Direction dir, Handler&& handler) {
+    // Токен удаляется позже, чем игрок уходит из сессии. Отвечаем так же, как пакетный запрос
+    if (!IsMember(player_id)) {
+        return handler(Result::no_session);
+    }
+
+    if (inbox_.TryPush({player_id, dir})) {
+        // Пара к барьеру в TryHibernate: либо сессия увидит команду, либо мы увидим, что она спит
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (IsHibernating()) {
+            detail::DispatchCounted(strand_, pending_, [this] {
+                CatchUp();
+            });
+        }
+        handler(Result::ok);
+        return;
+    }
+
+    metrics::Registry::GetInstance().session_inbox_overflows.Add();
+    detail::DispatchCounted(
+        strand_, pending_,
+        request_tracer::Hop(request_tracer::Stage::session, [this, player_id, dir, handler = std::forward<Handler>(handler)]()mutable{
+            // Команды из очереди пришли раньше этой
+            CatchUp();
+
+            if (id_for_player_.contains(player_id)) {
+                ApplyMoveCommand(player_id, dir);
                 handler(Result::ok);
             } else {
-                throw std::runtime_error("GameSession: player not found");
+                handler(Result::no_session);
             }
-        }
+        })
     );
 }
 
 template<class Handler>
-void GameManager::Join(std::string name, model::Map::Id map, Handler&& handler) {
-    PlayerInfo p_info;
-    p_info.name = std::move(name);
-    p_info.Id = GetUniquePlayerId();
-    AddPlayer(std::move(p_info), std::move(map), std::forward<Handler>(handler));
+void GameSession::ApplyBatch(std::vector<Command> commands, Handler&& handler) {
+    detail::DispatchCounted(
+        strand_, pending_,
+        request_tracer::Hop(request_tracer::Stage::session,
+            [this, commands = std::move(commands), handler = std::forward<Handler>(handler)]()mutable{
+                CatchUp();
+
+                std::vector<Result> results;
+                results.reserve(commands.size());
+                bool need_state = false;
+
+                for (const Command& command : commands) {
+                    auto it = id_for_player_.find(command.player_id);
+                    // Игрок мог уйти на пенсию, пока пакет шёл через strand'ы
+                    if (it == id_for_player_.end()) {
+                        results.push_back(Result::no_session);
+                        continue;
+                    }
+
+                    if (command.move) {
+                        ApplyMoveCommand(command.player_id, *command.move);
+                    } else {
+                        need_state = true;
+                    }
+                    results.push_back(Result::ok);
+                }
+
+                std::shared_ptr<const SessionState> state;
+                if (need_state) {
+                    state = std::make_shared<SessionState>(SessionState{players_, loot_objects_});
+                }
+                handler(std::move(results), std::move(state));
+            }
+        )
+    );
+}
+
+template<class CompletionToken>
+auto GameManager::Join(std::string name, model::Map::Id map, CompletionToken&& token) {
+    return detail::Initiate<void(PlayerInfo)>(std::forward<CompletionToken>(token),
+        [this](auto&& handler, std::string name, model::Map::Id map) {
+            PlayerInfo p_info;
+            p_info.name = std::move(name);
+            p_info.Id = GetUniquePlayerId();
+            AddPlayer(std::move(p_info), std::move(map), std::forward<decltype(handler)>(handler));
+        },
+        std::move(name), std::move(map)
+    );
 }
 
 template<class Handler>
 void GameManager::AddPlayer(PlayerInfo p_info, model::Map::Id map, Handler&& handler) {
-    net::dispatch(
-        tokens_strand_,
+    detail::DispatchCounted(
+        tokens_strand_, metrics::Registry::GetInstance().tokens_strand_queue,
         [this, p_info = std::move(p_info), map = std::move(map), handler = std::forward<Handler>(handler)]()mutable{
             Token token = GetUniqueToken();
             while (tokens_.find(token) != tokens_.end()) {
@@ -474,30 +982,17 @@ void GameManager::AddPlayer(PlayerInfo p_info, model::Map::Id map, Handler&& han
 
 template<class Handler>
 void GameManager::FindOrCeateSession(PlayerInfo p_info, model::Map::Id map, Handler&& handler) {
-    net::dispatch(
-        sessions_strand_,
+    detail::DispatchCounted(
+        sessions_strand_, metrics::Registry::GetInstance().sessions_strand_queue,
         [this, p_info = std::move(p_info), map = std::move(map), handler = std::forward<Handler>(handler)]()mutable{
             auto it = sessions_for_maps_.find(map);
             GameSession* session = nullptr;
 
-            if (it == sessions_for_maps_.end()) {
-                sessions_.emplace_back(ioc_, *FindMap(map), *maps_index_.at(map),
-                                       game_.GetLootConfig(), random_spawn_, game_.GetRetirementTime());
-                sessions_for_maps_[map].push_back(&sessions_.back());
-                session = &sessions_.back();
-            } else {
-                for (GameSession* sess : it->second) {
-                    if (sess->BookPlace()) {
-                        session = sess;
-                        break;
-                    }
-                }
-                if (session == nullptr) {
-                    sessions_.emplace_back(ioc_, *FindMap(map), *maps_index_.at(map),
-                                           game_.GetLootConfig(), random_spawn_, game_.GetRetirementTime());
-                    sessions_for_maps_[map].push_back(&sessions_.back());
-                    session = &sessions_.back();
-                }
+            if (it != sessions_for_maps_.end()) {
+                session = ChooseSession(it->second);
+            }
+            if (session == nullptr) {
+                session = &CreateSession(map);
             }
 
             players_for_sessions_[p_info.Id]   = session;
@@ -506,51 +1001,190 @@ void GameManager::FindOrCeateSession(PlayerInfo p_info, model::Map::Id map, Hand
     );
 }
 
-template<class Handler>
-void GameManager::GetPlayers(Token token, Handler&& handler) {
-    FindSession(token,
-        [handler = std::forward<Handler>(handler)]
-        (std::optional<GameSession*> session, PlayerId id, Result res)mutable{
-            if (res == Result::ok) {
-                GameSession& sess = **session;
-                sess.GetPlayers(std::forward<Handler>(handler));
-            } else {
-                handler(std::nullopt, res);
-            }
-        }
+template<class CompletionToken>
+auto GameManager::GetPlayers(Token token, CompletionToken&& token_handler) {
+    return detail::Initiate<PlayersSignature>(std::forward<CompletionToken>(token_handler),
+        [this](auto&& handler, Token token) {
+            using Handler = std::decay_t<decltype(handler)>;
+            FindSession(std::move(token),
+                [handler = std::forward<decltype(handler)>(handler)]
+                (std::optional<GameSession*> session, PlayerId id, Result res)mutable{
+                    if (res == Result::ok) {
+                        GameSession& sess = **session;
+                        sess.GetPlayers(std::forward<Handler>(handler));
+                    } else {
+                        handler(std::nullopt, res);
+                    }
+                }
+            );
+        },
+        std::move(token)
+    );
+}
+
+template<class CompletionToken>
+auto GameManager::GetState(Token token, CompletionToken&& token_handler) {
+    return detail::Initiate<PlayersSignature>(std::forward<CompletionToken>(token_handler),
+        [this](auto&& handler, Token token) {
+            using Handler = std::decay_t<decltype(handler)>;
+            FindSession(std::move(token),
+                [handler = std::forward<decltype(handler)>(handler)]
+                (std::optional<GameSession*> session, PlayerId id, Result res)mutable{
+                    if (res == Result::ok) {
+                        GameSession& sess = **session;
+                        sess.GetState(id, std::forward<Handler>(handler));
+                    } else {
+                        handler(std::nullopt, res);
+                    }
+                }
+            );
+        },
+        std::move(token)
+    );
+}
+
+template<class CompletionToken>
+auto GameManager::MovePlayer(Token token, move_manager::Direction dir, CompletionToken&& token_handler) {
+    return detail::Initiate<void(Result)>(std::forward<CompletionToken>(token_handler),
+        [this](auto&& handler, Token token, move_manager::Direction dir) {
+            using Handler = std::decay_t<decltype(handler)>;
+            FindSession(std::move(token),
+                [dir, handler = std::forward<decltype(handler)>(handler)]
+                (std::optional<GameSession*> session, PlayerId id, Result res)mutable{
+                    if (res == Result::ok) {
+                        GameSession& sess = **session;
+                        sess.MovePlayer(id, dir, std::forward<Handler>(handler));
+                    } else {
+                        handler(res);
+                    }
+                }
+            );
+        },
+        std::move(token), dir
+    );
+}
+
+template<class CompletionToken>
+auto GameManager::Batch(std::vector<BatchCommand>&& commands, CompletionToken&& token) {
+    return detail::Initiate<void(std::vector<BatchResult>)>(std::forward<CompletionToken>(token),
+        [this](auto&& handler, std::vector<BatchCommand>&& commands) {
+            StartBatch(std::move(commands), std::forward<decltype(handler)>(handler));
+        },
+        std::move(commands)
     );
 }
 
 template<class Handler>
-void GameManager::MovePlayer(Token token, move_manager::Direction dir, Handler&& handler) {
-    FindSession(std::move(token),
-        [dir, handler = std::forward<Handler>(handler)]
-        (std::optional<GameSession*> session, PlayerId id, Result res)mutable{
-            if (res == Result::ok) {
-                GameSession& sess = **session;
-                sess.MovePlayer(id, dir, handler);
-            } else {
-                handler(res);
+void GameManager::StartBatch(std::vector<BatchCommand>&& commands, Handler&& handler) {
+    using Context = BatchContext<std::decay_t<Handler>>;
+    auto context = std::make_shared<Context>(std::move(commands), std::forward<Handler>(handler));
+
+    detail::DispatchCounted(
+        tokens_strand_, metrics::Registry::GetInstance().tokens_strand_queue,
+        request_tracer::Hop(request_tracer::Stage::tokens, [this, context] {
+            for (size_t i = 0; i < context->commands.size(); ++i) {
+                auto it = tokens_.find(context->commands[i].token);
+                if (it != tokens_.end()) {
+                    context->ids[i] = it->second;
+                    context->results[i].result = Result::ok;
+                }
             }
-        }
+
+            detail::DispatchCounted(
+                sessions_strand_, metrics::Registry::GetInstance().sessions_strand_queue,
+                request_tracer::Hop(request_tracer::Stage::sessions, [this, context] {
+                    std::unordered_map<GameSession*, std::vector<size_t>> groups;
+
+                    for (size_t i = 0; i < context->commands.size(); ++i) {
+                        BatchResult& result = context->results[i];
+                        if (result.result != Result::ok) {
+                            continue;
+                        }
+
+                        auto it = players_for_sessions_.find(context->ids[i]);
+                        if (it == players_for_sessions_.end()) {
+                            result.result = Result::no_session;
+                        } else if (max_session_queue_ != 0
+                                   && it->second->GetPendingCount() >= max_session_queue_) {
+                            result.result = Result::overloaded;
+                        } else {
+                            groups[it->second].push_back(i);
+                        }
+                    }
+
+                    // Лишняя единица не даёт завершить пакет, пока группы ещё раздаются
+                    context->remaining = groups.size() + 1;
+
+                    for (auto& [session, indices] : groups) {
+                        std::vector<GameSession::Command> session_commands;
+                        session_commands.reserve(indices.size());
+                        for (size_t i : indices) {
+                            session_commands.push_back({context->ids[i], context->commands[i].move});
+                        }
+
+                        session->ApplyBatch(std::move(session_commands),
+                            [context, indices = std::move(indices)]
+                            (std::vector<Result>&& results, std::shared_ptr<const SessionState> state) {
+                                for (size_t k = 0; k < indices.size(); ++k) {
+                                    BatchResult& result = context->results[indices[k]];
+                                    result.result = results[k];
+                                    if (results[k] == Result::ok && !context->commands[indices[k]].move) {
+                                        result.state = state;
+                                    }
+                                }
+                                context->FinishGroup();
+                            }
+                        );
+                    }
+
+                    context->FinishGroup();
+                })
+            );
+        })
     );
 }
 
-template<class Handler>
-void GameManager::CallTick(uint64_t duration, Handler&& handler) {
-    if (test_mode_) {
-        Tick(duration, std::forward<Handler>(handler));
-    } else {
+template<class CompletionToken>
+auto GameManager::CallTick(uint64_t duration, CompletionToken&& token) {
+    // До запуска операции: с use_awaitable исключение получит сам вызов, а не co_await
+    if (!test_mode_) {
         throw std::logic_error("Game not in test mode");
     }
+
+    return detail::Initiate<void(Result)>(std::forward<CompletionToken>(token),
+        [this](auto&& handler, uint64_t duration) {
+            metrics::Registry& registry = metrics::Registry::GetInstance();
+            detail::DispatchCounted(
+                sessions_strand_, registry.sessions_strand_queue,
+                [this, duration, &registry, handler = std::forward<decltype(handler)>(handler)]()mutable{
+                    auto dropped = test_stepper_.GetDropped();
+                    // Мы уже в sessions_strand_, поэтому шаги выполняются сразу и по порядку
+                    test_stepper_.Advance(std::chrono::milliseconds{duration}, [this, &registry](std::chrono::milliseconds step) {
+                        registry.tick_steps.Add();
+                        Tick(step.count(), [](Result){});
+                    });
+                    registry.tick_dropped_ms.Add((test_stepper_.GetDropped() - dropped).count());
+                    handler(Result::ok);
+                }
+            );
+        },
+        duration
+    );
 }
 
 template<class Handler>
 void GameManager::Tick(u_int64_t duration, Handler&& handler) {
-    net::dispatch(
-        sessions_strand_,
-        [this, duration, handler = std::forward<Handler>(handler)] (){
+    metrics::Registry& registry = metrics::Registry::GetInstance();
+    detail::DispatchCounted(
+        sessions_strand_, registry.sessions_strand_queue,
+        [this, duration, &registry, handler = std::forward<Handler>(handler)] (){
+            auto start = std::chrono::steady_clock::now();
+            UpdateSessionsMetrics(registry);
+
             for (GameSession& session : sessions_) {
+                if (session.TrySleep(duration)) {
+                    continue;
+                }
                 session.Tick(duration,
                     [this](std::vector<Retiree>&& retirees){
                         if (!retirees.empty()) {
@@ -559,9 +1193,11 @@ void GameManager::Tick(u_int64_t duration, Handler&& handler) {
                     }
                 );
             }
+            ReclaimEmptySessions(duration);
             for (std::shared_ptr<TickListner>& listner : listners_) {
                 listner->Notify(duration);
             }
+            registry.tick_duration.Record(std::chrono::steady_clock::now() - start);
             handler(Result::ok);
         }
     );
@@ -569,16 +1205,18 @@ void GameManager::Tick(u_int64_t duration, Handler&& handler) {
 
 template<class Handler>
 void GameManager::FindToken(Token token, Handler&& handler) {
-    net::dispatch(
-        tokens_strand_,
-        [this, token = std::move(token), handler = std::forward<Handler>(handler)]()mutable{
-            auto it = tokens_.find(token);
-            if (it != tokens_.end()) {
-                handler(it->second);
-            } else {
-                handler(std::nullopt);
+    detail::DispatchCounted(
+        tokens_strand_, metrics::Registry::GetInstance().tokens_strand_queue,
+        request_tracer::Hop(request_tracer::Stage::tokens,
+            [this, token = std::move(token), handler = std::forward<Handler>(handler)]()mutable{
+                auto it = tokens_.find(token);
+                if (it != tokens_.end()) {
+                    handler(it->second);
+                } else {
+                    handler(std::nullopt);
+                }
             }
-        }
+        )
     );
 }
 
@@ -587,15 +1225,20 @@ void GameManager::FindSession(Token token, Handler&& handler) {
     FindToken(std::move(token),
         [this, handler = std::forward<Handler>(handler)](std::optional<PlayerId> id)mutable{
             if (id.has_value()) {
-                net::dispatch(sessions_strand_,
-                    [this, id, handler = std::forward<Handler>(handler)]()mutable{
-                        auto it = players_for_sessions_.find(*id);
-                        if (it != players_for_sessions_.end()) {
-                            handler(it->second, *id, Result::ok);
-                        } else {
-                            handler(std::nullopt, 0, Result::no_session);
+                detail::DispatchCounted(sessions_strand_, metrics::Registry::GetInstance().sessions_strand_queue,
+                    request_tracer::Hop(request_tracer::Stage::sessions,
+                        [this, id, handler = std::forward<Handler>(handler)]()mutable{
+                            auto it = players_for_sessions_.find(*id);
+                            if (it == players_for_sessions_.end()) {
+                                handler(std::nullopt, 0, Result::no_session);
+                            } else if (max_session_queue_ != 0
+                                       && it->second->GetPendingCount() >= max_session_queue_) {
+                                handler(std::nullopt, *id, Result::overloaded);
+                            } else {
+                                handler(it->second, *id, Result::ok);
+                            }
                         }
-                    }
+                    )
                 );
             } else {
                 handler(std::nullopt, 0, Result::no_token);
@@ -604,26 +1247,78 @@ void GameManager::FindSession(Token token, Handler&& handler) {
     );
 }
 
+template <class Task>
+void GameSession::ParallelFor(size_t count, const Task& task) {
+    parallel::For(strand_.get_inner_executor(), count, partitioning_.regions - 1, task);
+}
+
 template<class Callback>
 void GameSession::Tick(uint64_t duration, Callback&& remove_retirees) {
-    net::dispatch(
-        strand_,
+    detail::DispatchCounted(
+        strand_, pending_,
         [this, duration, remove_retirees = std::forward<Callback>(remove_retirees)](){
-            auto retirees = GetAndRemoveRetires(duration);
+            using tick_profiler::Phase;
+            using tick_profiler::Span;
 
-            HandleCollisions(duration);
-            MovePlayers(duration);
+            auto start = std::chrono::steady_clock::now();
+            Span tick_span{Phase::tick, id_, players_.size()};
 
-            remove_retirees(std::move(retirees));
+            {
+                Span span{Phase::inbox, id_, inbox_.ApproxSize()};
+                CatchUp();
+            }
 
-            GenerateLoot(duration);
+            std::vector<Retiree> retirees;
+            {
+                Span span{Phase::retire, id_, players_.size()};
+                retirees = GetAndRemoveRetires(duration);
+            }
+
+            // Уход записывается до тика: при восстановлении столкновения тика
+            // считаются уже без ушедших игроков
+            for (const Retiree& retiree : retirees) {
+                WriteJournal(JournalEvent::Retire(retiree.id));
+            }
+            WriteJournal(JournalEvent::Tick(duration));
+
+            {
+                Span span{Phase::collisions, id_, players_.size() + loot_objects_.size()};
+                HandleCollisions(duration);
+            }
+            {
+                Span span{Phase::move, id_, players_.size()};
+                MovePlayers(duration);
+            }
+            {
+                Span span{Phase::remove_retirees, id_, retirees.size()};
+                remove_retirees(std::move(retirees));
+            }
+            {
+                Span span{Phase::loot, id_, loot_objects_.size()};
+                GenerateLoot(duration);
+            }
+
+            TryHibernate();
+
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            metrics::Registry::GetInstance().session_tick_duration.Record(elapsed);
+
+            // Экспоненциальное среднее с весом 1/8 у нового значения: 8*avg' = 8*avg - avg + cost
+            uint64_t cost = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+            uint64_t old_cost = tick_cost_.load(std::memory_order_relaxed);
+            tick_cost_.store(old_cost - old_cost / 8 + cost, std::memory_order_relaxed);
         }
     );
 }
 
+template<class Callback>
+void GameSession::Reclaim(Callback&& on_reclaimed) {
+    detail::DispatchCounted(strand_, pending_, std::forward<Callback>(on_reclaimed));
+}
+
 template<class ReprType>
 void GameManager::AddSessionsForRepr(ReprType repr) {
-    net::dispatch(sessions_strand_,
+    detail::DispatchCounted(sessions_strand_, metrics::Registry::GetInstance().sessions_strand_queue,
         [repr, this](){
             int i = 0;
             repr->SetSessionsNumber(sessions_.size());
@@ -643,14 +1338,21 @@ void GameManager::AddSessionsForRepr(ReprType repr) {
 
 template <class Callback>
 void GameSession::GetRepresentationAsync(Callback&& callback) {
-    net::dispatch(strand_,
+    detail::DispatchCounted(strand_, pending_,
         [callback = std::forward<Callback>(callback), this](){
+            bool slept = CatchUp();
+
             GameSessionRepr result;
 
             result.map_name = *map_.GetId();
             result.players = std::vector<Player>{players_.begin(), players_.end()};
             result.loot_objects = std::vector<LootObject>{loot_objects_.begin(), loot_objects_.end()};
+            result.id = id_;
+            result.journal_seq = journal_seq_;
 
+            if (slept) {
+                TryHibernate();
+            }
             callback(std::move(result));
         }
     );
@@ -658,9 +1360,10 @@ void GameSession::GetRepresentationAsync(Callback&& callback) {
 
 template<class ReprType>
 void GameManager::AddPlayersForRepr(ReprType repr) {
-    net::dispatch(tokens_strand_,
+    detail::DispatchCounted(tokens_strand_, metrics::Registry::GetInstance().tokens_strand_queue,
         [repr, this](){
-            std::vector<PlayerRepr> players(tokens_.size());
+            std::vector<PlayerRepr> players;
+            players.reserve(tokens_.size());
 
             for (const auto& [token, id] : tokens_) {
                 players.emplace_back(*token, id);
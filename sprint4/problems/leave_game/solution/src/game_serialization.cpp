@@ -25,18 +25,60 @@ void Serializator::Notify(uint64_t duration) {
 }
 
 void Serializator::SaveAsync() {
+    {
+        std::lock_guard lock{save_mutex_};
+        if (saving_ || stopped_) {
+            return;
+        }
+        saving_ = true;
+    }
+
+    if (journal_) {
+        // События, записанные после ротации, доиграются поверх нового снимка
+        journal_->Rotate();
+    }
     game_.GetRepresentationAsync([this](game_manager::GameRepr&& repr) {
         SaveRepr(std::move(repr));
+        if (journal_) {
+            journal_->DropRotated();
+        }
+
+        std::function<void()> on_stopped;
+        {
+            std::lock_guard lock{save_mutex_};
+            saving_ = false;
+            std::swap(on_stopped, on_stopped_);
+        }
+        if (on_stopped) {
+            on_stopped();
+        }
     });
 }
 
+void Serializator::Stop(std::function<void()> on_stopped) {
+    {
+        std::lock_guard lock{save_mutex_};
+        stopped_ = true;
+        if (saving_) {
+            on_stopped_ = std::move(on_stopped);
+            return;
+        }
+    }
+    on_stopped();
+}
+
 void Serializator::Save() {
     SaveRepr(game_.GetRepresentation());
+    if (journal_) {
+        journal_->Reset();
+    }
 }
 
 void Serializator::SaveRepr(game_manager::GameRepr&& repr) {
     using namespace std::literals;
 
+    auto start = std::chrono::steady_clock::now();
+
     std::filesystem::path file(file_);
     std::filesystem::path tmp = file.parent_path() / "tmp";
 
@@ -45,17 +87,26 @@ void Serializator::SaveRepr(game_manager::GameRepr&& repr) {
     archive << repr;
 
     std::filesystem::rename(tmp, file);
+
+    metrics::Registry::GetInstance().snapshot_duration.Record(std::chrono::steady_clock::now() - start);
 }
 
 void Serializator::Load() {
-    if (!std::filesystem::exists(file_)) {
-        return;
+    if (std::filesystem::exists(file_)) {
+        game_manager::GameRepr repr;
+        std::ifstream in(file_);
+        boost::archive::text_iarchive archive(in);
+        archive >> repr;
+        game_.Restore(std::move(repr));
+    }
+
+    if (journal_) {
+        if (game_.Replay(journal_->Load()) > 0) {
+            Save();
+        } else {
+            journal_->Reset();
+        }
     }
-    game_manager::GameRepr repr;
-    std::ifstream in(file_);
-    boost::archive::text_iarchive archive(in);
-    archive >> repr;
-    game_.Restore(std::move(repr));
 }
 
 bool Serializator::HasPeriod() {
@@ -1,12 +1,18 @@
+#pragma once
+
 #include <fstream>
 #include <filesystem>
+#include <functional>
+#include <mutex>
 
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
 
 #include "../src/move_manager.h"
 #include "../src/game_manager.h"
+#include "../src/game_journal.h"
 
 namespace move_manager {
 
@@ -67,10 +73,14 @@ void serialize(Archive& ar, PlayerRepr& player, [[maybe_unused]] const unsigned
 }
 
 template <typename Archive>
-void serialize(Archive& ar, GameSessionRepr& session, [[maybe_unused]] const unsigned version) {
+void serialize(Archive& ar, GameSessionRepr& session, const unsigned version) {
     ar& session.loot_objects;
     ar& session.map_name;
     ar& session.players;
+    if (version > 0) {
+        ar& session.id;
+        ar& session.journal_seq;
+    }
 }
 
 template <typename Archive>
@@ -82,6 +92,8 @@ void serialize(Archive& ar, GameRepr& game, [[maybe_unused]] const unsigned vers
 
 } // namespace game_manager
 
+BOOST_CLASS_VERSION(game_manager::GameSessionRepr, 1)
+
 namespace game_serialization {
 class Serializator : public game_manager::TickListner {
 public:
@@ -90,19 +102,34 @@ public:
 
     void Notify(uint64_t duration) override;
 
+    // Не начинает новое сохранение, пока не закончено предыдущее
     void SaveAsync();
 
+    // Прекращает периодическое сохранение. on_stopped вызывается сразу или
+    // по окончании начатого SaveAsync, после этого файл состояния не меняется
+    void Stop(std::function<void()> on_stopped);
+
     void Save();
 
     void SaveRepr(game_manager::GameRepr&& repr);
 
     void Load();
+
+    void SetJournal(std::shared_ptr<game_journal::Journal> journal) {
+        journal_ = std::move(journal);
+    }
 private:
     bool HasPeriod();
 
     game_manager::GameManager& game_;
+    std::shared_ptr<game_journal::Journal> journal_;
     std::string file_;
     uint64_t period_ = 0;
     uint64_t last_save_ = 0;
+
+    std::mutex save_mutex_;
+    bool saving_ = false;
+    bool stopped_ = false;
+    std::function<void()> on_stopped_;
 };
 } // namespace game_serialization
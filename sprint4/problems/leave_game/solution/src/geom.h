@@ -2,60 +2,78 @@
 
 #include <compare>
 
+#include "fixed_point.h"
+
 namespace geom {
 
-struct Vec2D {
-    Vec2D() = default;
-    Vec2D(double x, double y)
+// Тип координат симуляции. Собирается с GAME_FIXED_POINT для воспроизводимости бит в бит
+#ifdef GAME_FIXED_POINT
+using Scalar = fixed_point::Fixed;
+#else
+using Scalar = double;
+#endif
+
+template <typename S>
+struct BasicVec2D {
+    BasicVec2D() = default;
+    BasicVec2D(S x, S y)
         : x(x)
         , y(y) {
     }
 
-    Vec2D& operator*=(double scale) {
-        x *= scale;
-        y *= scale;
+    BasicVec2D& operator*=(S scale) {
+        x = x * scale;
+        y = y * scale;
         return *this;
     }
 
-    auto operator<=>(const Vec2D&) const = default;
+    auto operator<=>(const BasicVec2D&) const = default;
 
-    double x = 0;
-    double y = 0;
+    S x = 0;
+    S y = 0;
 };
 
-inline Vec2D operator*(Vec2D lhs, double rhs) {
+template <typename S>
+BasicVec2D<S> operator*(BasicVec2D<S> lhs, S rhs) {
     return lhs *= rhs;
 }
 
-inline Vec2D operator*(double lhs, Vec2D rhs) {
+template <typename S>
+BasicVec2D<S> operator*(S lhs, BasicVec2D<S> rhs) {
     return rhs *= lhs;
 }
 
-struct Point2D {
-    Point2D() = default;
-    Point2D(double x, double y)
+template <typename S>
+struct BasicPoint2D {
+    BasicPoint2D() = default;
+    BasicPoint2D(S x, S y)
         : x(x)
         , y(y) {
     }
 
-    Point2D& operator+=(const Vec2D& rhs) {
+    BasicPoint2D& operator+=(const BasicVec2D<S>& rhs) {
         x += rhs.x;
         y += rhs.y;
         return *this;
     }
 
-    auto operator<=>(const Point2D&) const = default;
+    auto operator<=>(const BasicPoint2D&) const = default;
 
-    double x = 0;
-    double y = 0;
+    S x = 0;
+    S y = 0;
 };
 
-inline Point2D operator+(Point2D lhs, const Vec2D& rhs) {
+template <typename S>
+BasicPoint2D<S> operator+(BasicPoint2D<S> lhs, const BasicVec2D<S>& rhs) {
     return lhs += rhs;
 }
 
-inline Point2D operator+(const Vec2D& lhs, Point2D rhs) {
+template <typename S>
+BasicPoint2D<S> operator+(const BasicVec2D<S>& lhs, BasicPoint2D<S> rhs) {
     return rhs += lhs;
 }
 
+using Vec2D = BasicVec2D<Scalar>;
+using Point2D = BasicPoint2D<Scalar>;
+
 }  // namespace geom
@@ -0,0 +1,445 @@
+#include "http2_session.h"
+#include "http_server.h"
+
+#include <nghttp2/nghttp2.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iterator>
+
+namespace http2 {
+
+using namespace std::literals;
+
+namespace {
+
+Options options;
+
+// Как у парсера HTTP/1.1 beast по умолчанию
+constexpr size_t MAX_BODY_SIZE = 1 << 20;
+// Сколько байт кадров отправляется одной записью
+constexpr size_t MAX_WRITE_SIZE = 64 << 10;
+constexpr size_t READ_SIZE = 16 << 10;
+
+bool ContainsToken(std::string_view list, std::string_view token) {
+    while (!list.empty()) {
+        size_t end = list.find(',');
+        std::string_view item = list.substr(0, end);
+        list = end == list.npos ? std::string_view{} : list.substr(end + 1);
+        while (!item.empty() && item.front() == ' ') {
+            item.remove_prefix(1);
+        }
+        while (!item.empty() && item.back() == ' ') {
+            item.remove_suffix(1);
+        }
+        if (detail::ToLower(item) == token) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// HTTP2-Settings - base64url без дополнения
+std::optional<std::string> DecodeBase64Url(std::string_view str) {
+    std::string result;
+    uint32_t bits = 0;
+    int count = 0;
+    for (char c : str) {
+        int value;
+        if ('A' <= c && c <= 'Z') {
+            value = c - 'A';
+        } else if ('a' <= c && c <= 'z') {
+            value = c - 'a' + 26;
+        } else if ('0' <= c && c <= '9') {
+            value = c - '0' + 52;
+        } else if (c == '-' || c == '+') {
+            value = 62;
+        } else if (c == '_' || c == '/') {
+            value = 63;
+        } else if (c == '=') {
+            break;
+        } else {
+            return std::nullopt;
+        }
+        bits = (bits << 6) | value;
+        count += 6;
+        if (count >= 8) {
+            count -= 8;
+            result.push_back(static_cast<char>((bits >> count) & 0xff));
+        }
+    }
+    return result;
+}
+
+nghttp2_nv MakeNv(std::string_view name, std::string_view value) {
+    return {reinterpret_cast<uint8_t*>(const_cast<char*>(name.data())),
+            reinterpret_cast<uint8_t*>(const_cast<char*>(value.data())),
+            name.size(), value.size(), NGHTTP2_NV_FLAG_NONE};
+}
+
+// Готовый ответ admission на отказ, разобранный для отправки по HTTP/2
+http::response<http::string_body> ParseRejection(admission::Reason reason) {
+    const std::string& raw = admission::Admission::GetInstance().GetRejection(reason);
+    http::response_parser<http::string_body> parser;
+    parser.eager(true);
+    beast::error_code ec;
+    parser.put(net::buffer(raw), ec);
+    return parser.release();
+}
+
+} // namespace
+
+void Configure(const Options& new_options) {
+    options = new_options;
+}
+
+const Options& GetOptions() {
+    return options;
+}
+
+bool IsUpgradeRequest(const http::request<http::string_body>& request) {
+    if (!options.enabled) {
+        return false;
+    }
+    auto upgrade = request.find(http::field::upgrade);
+    return upgrade != request.end() && ContainsToken(upgrade->value(), "h2c"sv)
+           && request.find("HTTP2-Settings"sv) != request.end();
+}
+
+namespace detail {
+
+bool IsConnectionField(http::field field) {
+    switch (field) {
+    case http::field::connection:
+    case http::field::keep_alive:
+    case http::field::proxy_connection:
+    case http::field::transfer_encoding:
+    case http::field::upgrade:
+        return true;
+    default:
+        return false;
+    }
+}
+
+std::string ToLower(std::string_view str) {
+    std::string result{str};
+    std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) {
+        return std::tolower(c);
+    });
+    return result;
+}
+
+} // namespace detail
+
+size_t Body::Read(uint8_t* buf, size_t size, bool& eof, beast::error_code& ec) {
+    if (file_) {
+        size_t read = file_->read(buf, static_cast<size_t>(std::min<uint64_t>(size, remaining_)), ec);
+        remaining_ -= read;
+        eof = remaining_ == 0 || (read == 0 && !ec);
+        return read;
+    }
+    size_t read = std::min(size, data_.size() - offset_);
+    std::memcpy(buf, data_.data() + offset_, read);
+    offset_ += read;
+    eof = offset_ == data_.size();
+    return read;
+}
+
+// Обратные вызовы nghttp2. Вызываются только изнутри nghttp2_session_mem_recv и mem_send
+struct SessionBase::Callbacks {
+    static SessionBase& Self(void* user_data) {
+        return *static_cast<SessionBase*>(user_data);
+    }
+
+    static int OnBeginHeaders(nghttp2_session*, const nghttp2_frame* frame, void* user_data) {
+        if (frame->hd.type == NGHTTP2_HEADERS && frame->headers.cat == NGHTTP2_HCAT_REQUEST) {
+            Self(user_data).streams_[frame->hd.stream_id].request.version(11);
+        }
+        return 0;
+    }
+
+    static int OnHeader(nghttp2_session*, const nghttp2_frame* frame, const uint8_t* name, size_t namelen,
+                        const uint8_t* value, size_t valuelen, uint8_t, void* user_data) {
+        auto it = Self(user_data).streams_.find(frame->hd.stream_id);
+        if (it == Self(user_data).streams_.end()) {
+            return 0;
+        }
+        Stream& stream = it->second;
+        std::string_view name_str{reinterpret_cast<const char*>(name), namelen};
+        std::string_view value_str{reinterpret_cast<const char*>(value), valuelen};
+
+        if (name_str == ":method"sv) {
+            stream.request.method_string(value_str);
+            stream.head = stream.request.method() == http::verb::head;
+        } else if (name_str == ":path"sv) {
+            stream.request.target(value_str);
+        } else if (name_str == ":authority"sv) {
+            stream.request.set(http::field::host, value_str);
+        } else if (!name_str.starts_with(':')) {
+            stream.request.insert(name_str, value_str);
+        }
+        return 0;
+    }
+
+    static int OnDataChunk(nghttp2_session* session, uint8_t, int32_t stream_id, const uint8_t* data,
+                           size_t len, void* user_data) {
+        auto it = Self(user_data).streams_.find(stream_id);
+        if (it == Self(user_data).streams_.end()) {
+            return 0;
+        }
+        std::string& body = it->second.request.body();
+        if (body.size() + len > MAX_BODY_SIZE) {
+            nghttp2_submit_rst_stream(session, NGHTTP2_FLAG_NONE, stream_id, NGHTTP2_CANCEL);
+            return 0;
+        }
+        body.append(reinterpret_cast<const char*>(data), len);
+        return 0;
+    }
+
+    static int OnFrame(nghttp2_session*, const nghttp2_frame* frame, void* user_data) {
+        if ((frame->hd.type != NGHTTP2_HEADERS && frame->hd.type != NGHTTP2_DATA)
+            || !(frame->hd.flags & NGHTTP2_FLAG_END_STREAM)) {
+            return 0;
+        }
+        SessionBase& self = Self(user_data);
+        if (auto it = self.streams_.find(frame->hd.stream_id); it != self.streams_.end()) {
+            self.Dispatch(frame->hd.stream_id, std::move(it->second.request));
+        }
+        return 0;
+    }
+
+    static int OnStreamClose(nghttp2_session*, int32_t stream_id, uint32_t, void* user_data) {
+        SessionBase& self = Self(user_data);
+        if (auto it = self.streams_.find(stream_id); it != self.streams_.end()) {
+            if (it->second.started) {
+                http_server::Drain::GetInstance().FinishRequest();
+            }
+            self.streams_.erase(it);
+        }
+        return 0;
+    }
+
+    static ssize_t ReadBody(nghttp2_session*, int32_t, uint8_t* buf, size_t length, uint32_t* data_flags,
+                            nghttp2_data_source* source, void*) {
+        bool eof = false;
+        beast::error_code ec;
+        size_t read = static_cast<Body*>(source->ptr)->Read(buf, length, eof, ec);
+        if (ec) {
+            http_server::ReportError(ec, "http2 body"sv);
+            return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+        }
+        if (eof) {
+            *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+        }
+        return static_cast<ssize_t>(read);
+    }
+};
+
+SessionBase::SessionBase(beast::tcp_stream&& stream, std::string remote_address)
+    : remote_address_(std::move(remote_address))
+    , stream_(std::move(stream)) {
+    nghttp2_session_callbacks* callbacks;
+    nghttp2_session_callbacks_new(&callbacks);
+    nghttp2_session_callbacks_set_on_begin_headers_callback(callbacks, Callbacks::OnBeginHeaders);
+    nghttp2_session_callbacks_set_on_header_callback(callbacks, Callbacks::OnHeader);
+    nghttp2_session_callbacks_set_on_data_chunk_recv_callback(callbacks, Callbacks::OnDataChunk);
+    nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks, Callbacks::OnFrame);
+    nghttp2_session_callbacks_set_on_stream_close_callback(callbacks, Callbacks::OnStreamClose);
+    nghttp2_session_server_new(&session_, callbacks, this);
+    nghttp2_session_callbacks_del(callbacks);
+
+    const nghttp2_settings_entry settings[] = {
+        {NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, options.max_concurrent_streams},
+        {NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE, options.initial_window_size}
+    };
+    nghttp2_submit_settings(session_, NGHTTP2_FLAG_NONE, settings, std::size(settings));
+}
+
+SessionBase::~SessionBase() {
+    // Потоки, оборванные вместе с соединением
+    for (const auto& [id, stream] : streams_) {
+        if (stream.started) {
+            http_server::Drain::GetInstance().FinishRequest();
+        }
+    }
+    nghttp2_session_del(session_);
+    admission::Admission::GetInstance().CloseConnection();
+}
+
+void SessionBase::Run(beast::flat_buffer&& buffer, std::optional<HttpRequest>&& upgrade) {
+    buffer_ = std::move(buffer);
+
+    if (upgrade) {
+        auto settings = DecodeBase64Url(upgrade->at("HTTP2-Settings"sv));
+        bool head = upgrade->method() == http::verb::head;
+        if (!settings || nghttp2_session_upgrade2(session_, reinterpret_cast<const uint8_t*>(settings->data()),
+                                                  settings->size(), head, nullptr) != 0) {
+            return Close();
+        }
+        // 101 уходит раньше преамбулы сервера, сам запрос становится потоком 1
+        write_buffer_ = "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n"s;
+        Stream& stream = streams_[1];
+        stream.head = head;
+        upgrade->erase(http::field::upgrade);
+        upgrade->erase(http::field::connection);
+        upgrade->erase("HTTP2-Settings"sv);
+        Dispatch(1, std::move(*upgrade));
+    }
+
+    OnRead({}, 0);
+}
+
+void SessionBase::Write(int32_t stream_id, Response&& response) {
+    // Всегда через post: из обратных вызовов nghttp2 нельзя вызывать mem_send
+    net::post(stream_.get_executor(), [self = GetSharedThis(), stream_id, response = std::move(response)]() mutable {
+        self->Submit(stream_id, std::move(response));
+        self->Flush();
+    });
+}
+
+void SessionBase::Dispatch(int32_t stream_id, HttpRequest&& request) {
+    Stream& stream = streams_[stream_id];
+    if (!http_server::Drain::GetInstance().TryStartRequest()) {
+        // Клиент может безопасно повторить запрос на другом соединении
+        nghttp2_submit_rst_stream(session_, NGHTTP2_FLAG_NONE, stream_id, NGHTTP2_REFUSED_STREAM);
+        return;
+    }
+    stream.started = true;
+
+    std::string_view token;
+    if (auto auth = request.find(http::field::authorization); auth != request.end()) {
+        token = auth->value();
+    }
+    if (auto reason = admission::Admission::GetInstance().CheckRequest(remote_address_, token)) {
+        Write(stream_id, MakeResponse(ParseRejection(*reason)));
+        return;
+    }
+
+    try {
+        request.target(url_decode::DecodeURL(request.target()));
+    } catch (const std::exception&) {
+        nghttp2_submit_rst_stream(session_, NGHTTP2_FLAG_NONE, stream_id, NGHTTP2_PROTOCOL_ERROR);
+        return;
+    }
+    request.insert(http::field::sender, remote_address_);
+    HandleRequest(stream_id, std::move(request));
+}
+
+void SessionBase::Submit(int32_t stream_id, Response&& response) {
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end()) {
+        // Клиент сбросил поток, пока запрос обрабатывался
+        return;
+    }
+    Stream& stream = it->second;
+    stream.body = std::move(response.body);
+
+    const std::string status = std::to_string(response.status);
+    std::vector<nghttp2_nv> headers;
+    headers.reserve(response.headers.size() + 1);
+    headers.push_back(MakeNv(":status"sv, status));
+    for (const auto& [name, value] : response.headers) {
+        headers.push_back(MakeNv(name, value));
+    }
+
+    nghttp2_data_provider provider;
+    provider.source.ptr = &stream.body;
+    provider.read_callback = Callbacks::ReadBody;
+    int rv = nghttp2_submit_response(session_, stream_id, headers.data(), headers.size(),
+                                     stream.head ? nullptr : &provider);
+    if (rv != 0) {
+        nghttp2_submit_rst_stream(session_, NGHTTP2_FLAG_NONE, stream_id, NGHTTP2_INTERNAL_ERROR);
+    }
+}
+
+void SessionBase::Read() {
+    reading_ = true;
+    stream_.expires_after(admission::Admission::GetInstance().GetLimits().read_timeout);
+    stream_.async_read_some(buffer_.prepare(READ_SIZE),
+                            beast::bind_front_handler(&SessionBase::OnRead, GetSharedThis()));
+}
+
+void SessionBase::OnRead(beast::error_code ec, std::size_t bytes_read) {
+    reading_ = false;
+    if (ec == net::error::eof) {
+        return Close();
+    }
+    if (ec) {
+        http_server::ReportError(ec, "http2 read"sv);
+        return Close();
+    }
+    buffer_.commit(bytes_read);
+
+    auto data = buffer_.cdata();
+    ssize_t processed = nghttp2_session_mem_recv(session_, static_cast<const uint8_t*>(data.data()), data.size());
+    if (processed < 0) {
+        // Ошибка протокола: nghttp2 уже поставил GOAWAY в очередь
+        http_server::ReportError(beast::error_code{}, nghttp2_strerror(static_cast<int>(processed)));
+    } else {
+        buffer_.consume(static_cast<size_t>(processed));
+    }
+
+    Flush();
+    if (processed >= 0 && nghttp2_session_want_read(session_)) {
+        Read();
+    }
+}
+
+void SessionBase::Flush() {
+    if (writing_) {
+        return;
+    }
+    if (!goaway_sent_ && http_server::Drain::GetInstance().IsDraining()) {
+        // Начатые потоки доотвечаются, новые клиент откроет уже на другом соединении
+        nghttp2_submit_goaway(session_, NGHTTP2_FLAG_NONE, nghttp2_session_get_last_proc_stream_id(session_),
+                              NGHTTP2_NO_ERROR, nullptr, 0);
+        goaway_sent_ = true;
+    }
+
+    while (write_buffer_.size() < MAX_WRITE_SIZE) {
+        const uint8_t* data;
+        ssize_t size = nghttp2_session_mem_send(session_, &data);
+        if (size < 0) {
+            http_server::ReportError(beast::error_code{}, nghttp2_strerror(static_cast<int>(size)));
+            return Close();
+        }
+        if (size == 0) {
+            break;
+        }
+        write_buffer_.append(reinterpret_cast<const char*>(data), static_cast<size_t>(size));
+    }
+
+    if (!write_buffer_.empty()) {
+        writing_ = true;
+        // Таймаут tcp_stream общий для чтения и записи, продлеваем его на время записи
+        stream_.expires_after(admission::Admission::GetInstance().GetLimits().read_timeout);
+        net::async_write(stream_, net::buffer(write_buffer_),
+                         beast::bind_front_handler(&SessionBase::OnWrite, GetSharedThis()));
+        return;
+    }
+
+    if (!nghttp2_session_want_read(session_) && !nghttp2_session_want_write(session_)) {
+        Close();
+    }
+}
+
+void SessionBase::OnWrite(beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+    writing_ = false;
+    write_buffer_.clear();
+    if (ec) {
+        http_server::ReportError(ec, "http2 write"sv);
+        return Close();
+    }
+    Flush();
+    if (!reading_ && nghttp2_session_want_read(session_)) {
+        Read();
+    }
+}
+
+void SessionBase::Close() {
+    beast::error_code ec;
+    stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
+}
+
+} // namespace http2
@@ -0,0 +1,193 @@
+#pragma once
+// boost.beast будет использовать std::string_view вместо boost::string_view
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+// Состояние кодека nghttp2, его заголовки нужны только в http2_session.cpp
+struct nghttp2_session;
+
+// HTTP/2 без TLS (h2c) рядом с HTTP/1.1-сессией http_server::Session: на одном соединении
+// много потоков, каждый - отдельный запрос к тому же обработчику. Соединение переходит
+// на HTTP/2, если клиент начинает с преамбулы HTTP/2 (prior knowledge) или просит
+// Upgrade: h2c. Кадры, HPACK и управление потоком - в nghttp2
+namespace http2 {
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+using tcp = net::ip::tcp;
+
+struct Options {
+    bool enabled = false;
+    // Сколько запросов клиент может держать в обработке на одном соединении
+    uint32_t max_concurrent_streams = 100;
+    // Окно приёма потока, байт
+    uint32_t initial_window_size = 1 << 20;
+};
+
+// Вызывать до запуска сервера
+void Configure(const Options& options);
+
+const Options& GetOptions();
+
+// Начало преамбулы клиента HTTP/2
+constexpr std::string_view CLIENT_PREFACE = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+// Запрос HTTP/1.1 просит перейти на h2c и содержит HTTP2-Settings
+bool IsUpgradeRequest(const http::request<http::string_body>& request);
+
+// Тело ответа потока: строка или файл. Отдаётся кусками по мере открытия окна потока
+class Body {
+public:
+    Body() = default;
+
+    explicit Body(std::string data)
+        : data_(std::move(data)) {
+    }
+
+    Body(beast::file file, uint64_t size)
+        : file_(std::move(file))
+        , remaining_(size) {
+    }
+
+    // Копирует в buf до size байт. eof - тело закончилось
+    size_t Read(uint8_t* buf, size_t size, bool& eof, beast::error_code& ec);
+private:
+    std::string data_;
+    size_t offset_ = 0;
+    std::optional<beast::file> file_;
+    uint64_t remaining_ = 0;
+};
+
+struct Response {
+    unsigned status = 200;
+    // Имена в нижнем регистре, без полей соединения HTTP/1.1
+    std::vector<std::pair<std::string, std::string>> headers;
+    Body body;
+};
+
+template <typename ResponseBody, typename Fields>
+Response MakeResponse(http::response<ResponseBody, Fields>&& response);
+
+class SessionBase {
+public:
+    SessionBase(const SessionBase&) = delete;
+    SessionBase& operator=(const SessionBase&) = delete;
+
+    // buffer - уже прочитанные байты соединения. upgrade - запрос HTTP/1.1 с Upgrade: h2c,
+    // он становится потоком 1 и получает ответ уже по HTTP/2
+    void Run(beast::flat_buffer&& buffer, std::optional<http::request<http::string_body>>&& upgrade);
+protected:
+    using HttpRequest = http::request<http::string_body>;
+
+    SessionBase(beast::tcp_stream&& stream, std::string remote_address);
+
+    // Соединение открывается только через Admission::TryOpenConnection
+    ~SessionBase();
+
+    // Вызывается из любого потока
+    void Write(int32_t stream_id, Response&& response);
+
+    std::string remote_address_;
+private:
+    struct Stream {
+        HttpRequest request;
+        bool head = false;
+        // Запрос учтён в Drain
+        bool started = false;
+        Body body;
+    };
+    struct Callbacks;
+
+    // Запрос потока собран, передаём его обработчику
+    void Dispatch(int32_t stream_id, HttpRequest&& request);
+    virtual void HandleRequest(int32_t stream_id, HttpRequest&& request) = 0;
+    void Submit(int32_t stream_id, Response&& response);
+
+    void Read();
+    void OnRead(beast::error_code ec, std::size_t bytes_read);
+    // Отправляет всё, что накопил nghttp2. Закрывает соединение, когда обмен окончен
+    void Flush();
+    void OnWrite(beast::error_code ec, std::size_t bytes_written);
+    void Close();
+
+    virtual std::shared_ptr<SessionBase> GetSharedThis() = 0;
+
+    beast::tcp_stream stream_;
+    beast::flat_buffer buffer_;
+    nghttp2_session* session_ = nullptr;
+    std::unordered_map<int32_t, Stream> streams_;
+    std::string write_buffer_;
+    bool writing_ = false;
+    bool reading_ = false;
+    bool goaway_sent_ = false;
+};
+
+// Обработчик запросов тот же, что у http_server::Session
+template <typename RequestHandler>
+class Session : public SessionBase, public std::enable_shared_from_this<Session<RequestHandler>> {
+public:
+    template <typename Handler>
+    Session(beast::tcp_stream&& stream, std::string remote_address, Handler&& request_handler)
+        : SessionBase(std::move(stream), std::move(remote_address))
+        , request_handler_(std::forward<Handler>(request_handler)) {
+    }
+private:
+    std::shared_ptr<SessionBase> GetSharedThis() override {
+        return this->shared_from_this();
+    }
+
+    void HandleRequest(int32_t stream_id, HttpRequest&& request) override {
+        request_handler_(std::move(request), [self = this->shared_from_this(), stream_id](auto&& response) {
+            self->Write(stream_id, MakeResponse(std::move(response)));
+        });
+    }
+
+    RequestHandler request_handler_;
+};
+
+} // namespace http2
+
+//===================================Templates implementation============================================
+
+namespace http2 {
+
+namespace detail {
+
+// Поля соединения HTTP/1.1 в HTTP/2 запрещены
+bool IsConnectionField(http::field field);
+
+std::string ToLower(std::string_view str);
+
+} // namespace detail
+
+template <typename ResponseBody, typename Fields>
+Response MakeResponse(http::response<ResponseBody, Fields>&& response) {
+    Response result;
+    result.status = response.result_int();
+    for (const auto& field : response) {
+        if (!detail::IsConnectionField(field.name())) {
+            result.headers.emplace_back(detail::ToLower(field.name_string()), std::string{field.value()});
+        }
+    }
+
+    if constexpr (std::is_same_v<ResponseBody, http::file_body>) {
+        uint64_t size = response.body().size();
+        result.body = Body{std::move(response.body().file()), size};
+    } else {
+        result.body = Body{std::string{std::move(response.body())}};
+    }
+    return result;
+}
+
+} // namespace http2
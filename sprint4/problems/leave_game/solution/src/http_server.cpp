@@ -1,7 +1,9 @@
 #include "http_server.h"
 
 #include <boost/asio/dispatch.hpp>
+#include <boost/asio/write.hpp>
 #include <iostream>
+#include <sys/socket.h>
 #include "logger.h"
 
 namespace http_server {
@@ -9,14 +11,113 @@ void ReportError(beast::error_code ec, std::string_view what) {
     json_logger::JsonLogger::GetInstance().LogError(what, ec);
     std::cerr << what << ": "sv << ec.message() << std::endl;
 }
+
+void RejectConnection(tcp::socket&& socket) {
+    auto safe_socket = std::make_shared<tcp::socket>(std::move(socket));
+    const std::string& response = admission::Admission::GetInstance().GetRejection(admission::Reason::connections);
+
+    net::async_write(*safe_socket, net::buffer(response), [safe_socket](sys::error_code, std::size_t) {
+        sys::error_code ec;
+        safe_socket->shutdown(tcp::socket::shutdown_both, ec);
+        safe_socket->close(ec);
+    });
+}
+
+Drain& Drain::GetInstance() {
+    static Drain drain;
+    return drain;
+}
+
+void Drain::Start(std::function<void()> on_drained) {
+    on_drained_ = std::move(on_drained);
+    uint64_t state = state_.fetch_or(DRAINING, std::memory_order_acq_rel) | DRAINING;
+    if (state == DRAINING) {
+        TryFreeze(state);
+    }
+}
+
+void Drain::Finish() {
+    uint64_t state = state_.fetch_or(FROZEN, std::memory_order_acq_rel);
+    if (!(state & FROZEN) && on_drained_) {
+        on_drained_();
+    }
+}
+
+bool Drain::TryStartRequest() {
+    uint64_t state = state_.fetch_add(1, std::memory_order_acq_rel);
+    if (state & FROZEN) {
+        state_.fetch_sub(1, std::memory_order_acq_rel);
+        return false;
+    }
+    return true;
+}
+
+void Drain::FinishRequest() {
+    uint64_t state = state_.fetch_sub(1, std::memory_order_acq_rel) - 1;
+    if (state == DRAINING) {
+        TryFreeze(state);
+    }
+}
+
+void Drain::TryFreeze(uint64_t expected) {
+    // on_drained_ вызывается ровно один раз: флаг FROZEN ставит только один поток
+    if (state_.compare_exchange_strong(expected, DRAINING | FROZEN, std::memory_order_acq_rel)) {
+        on_drained_();
+    }
+}
+
+tcp GetProtocol(tcp::acceptor::native_handle_type fd) {
+    sockaddr_storage addr{};
+    socklen_t len = sizeof(addr);
+    if (::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) == 0 && addr.ss_family == AF_INET6) {
+        return tcp::v6();
+    }
+    return tcp::v4();
+}
+
 void SessionBase::Run() {
     // Вызываем метод Read, используя executor объекта stream_.
     // Таким образом вся работа со stream_ будет выполняться, используя его executor
-    net::dispatch(stream_.get_executor(),
-                  beast::bind_front_handler(&SessionBase::Read, GetSharedThis()));
+    if (http2::GetOptions().enabled) {
+        net::dispatch(stream_.get_executor(),
+                      beast::bind_front_handler(&SessionBase::ReadPreface, GetSharedThis()));
+    } else {
+        net::dispatch(stream_.get_executor(),
+                      beast::bind_front_handler(&SessionBase::Read, GetSharedThis()));
+    }
+}
+
+void SessionBase::ReadPreface() {
+    stream_.expires_after(admission::Admission::GetInstance().GetLimits().read_timeout);
+    // Читаем не больше преамбулы, остальное прочитает сессия нужного протокола
+    stream_.async_read_some(buffer_.prepare(http2::CLIENT_PREFACE.size() - buffer_.size()),
+                            beast::bind_front_handler(&SessionBase::OnReadPreface, GetSharedThis()));
+}
+
+void SessionBase::OnReadPreface(beast::error_code ec, std::size_t bytes_read) {
+    if (ec == net::error::eof) {
+        return Close();
+    }
+    if (ec) {
+        return ReportError(ec, "read"sv);
+    }
+    buffer_.commit(bytes_read);
+
+    std::string_view data{static_cast<const char*>(buffer_.cdata().data()), buffer_.size()};
+    if (!http2::CLIENT_PREFACE.starts_with(data)) {
+        // HTTP/1.1: прочитанное начало запроса уже в buffer_
+        return Read();
+    }
+    if (data.size() < http2::CLIENT_PREFACE.size()) {
+        return ReadPreface();
+    }
+    handed_over_ = true;
+    StartHttp2(std::move(stream_), std::move(buffer_), std::nullopt);
 }
 
 void SessionBase::OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+    Drain::GetInstance().FinishRequest();
+
     if (ec) {
         return ReportError(ec, "write"sv);
     }
@@ -34,7 +135,7 @@ void SessionBase::Read() {
     using namespace std::literals;
     // Очищаем запрос от прежнего значения (метод Read может быть вызван несколько раз)
     request_ = {};
-    stream_.expires_after(30s);
+    stream_.expires_after(admission::Admission::GetInstance().GetLimits().read_timeout);
     // Считываем request_ из stream_, используя buffer_ для хранения считанных данных
     http::async_read(stream_, buffer_, request_,
                      // По окончании операции будет вызван метод OnRead
@@ -50,9 +151,37 @@ void SessionBase::OnRead(beast::error_code ec, [[maybe_unused]] std::size_t byte
     if (ec) {
         return ReportError(ec, "read"sv);
     }
+    if (http2::IsUpgradeRequest(request_)) {
+        // Запрос будет обработан и учтён уже сессией HTTP/2
+        handed_over_ = true;
+        return StartHttp2(std::move(stream_), std::move(buffer_), std::move(request_));
+    }
+    if (!Drain::GetInstance().TryStartRequest()) {
+        // Состояние уже передано новому процессу, запрос там и будет обработан после переподключения
+        return Close();
+    }
+
+    std::string_view token;
+    if (auto auth = request_.find(http::field::authorization); auth != request_.end()) {
+        token = auth->value();
+    }
+
+    if (auto reason = admission::Admission::GetInstance().CheckRequest(remote_address_, token)) {
+        return WriteRejection(*reason);
+    }
+
     HandleRequest(std::move(request_));
 }
 
+void SessionBase::WriteRejection(admission::Reason reason) {
+    const std::string& response = admission::Admission::GetInstance().GetRejection(reason);
+
+    net::async_write(stream_, net::buffer(response),
+                     [self = GetSharedThis(), close = !request_.keep_alive()](beast::error_code ec, std::size_t bytes_written) {
+                         self->OnWrite(close, ec, bytes_written);
+                     });
+}
+
 void SessionBase::Close() {
     beast::error_code ec;
     stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
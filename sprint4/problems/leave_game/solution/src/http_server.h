@@ -3,11 +3,21 @@
 // boost.beast будет использовать std::string_view вместо boost::string_view
 #define BOOST_BEAST_USE_STD_STRING_VIEW
 
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <optional>
+
+#include <boost/asio/dispatch.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
 
+#include "admission.h"
+#include "http2_session.h"
+
 namespace url_decode {
 
 std::string DecodeURL(std::string_view url);
@@ -26,6 +36,65 @@ using namespace std::literals;
 
 void ReportError(beast::error_code ec, std::string_view what);
 
+// Механизм ввода-вывода, с которым собран asio (опция GAME_IO_URING)
+constexpr std::string_view GetIoBackend() {
+#if defined(BOOST_ASIO_HAS_IO_URING) && defined(BOOST_ASIO_DISABLE_EPOLL)
+    return "io_uring"sv;
+#else
+    return "epoll"sv;
+#endif
+}
+
+// Отвечает готовым 503 сверх предела соединений и закрывает соединение
+void RejectConnection(tcp::socket&& socket);
+
+// Завершение работы без потери запросов: после Start ответы закрывают соединение,
+// а когда все начатые запросы обработаны, новые перестают приниматься и вызывается on_drained
+class Drain {
+public:
+    static Drain& GetInstance();
+
+    void Start(std::function<void()> on_drained);
+
+    // Перестать принимать запросы, не дожидаясь начатых
+    void Finish();
+
+    bool IsDraining() const {
+        return state_.load(std::memory_order_acquire) & DRAINING;
+    }
+
+    // false, если запросы больше не принимаются
+    bool TryStartRequest();
+
+    void FinishRequest();
+private:
+    // Старшие биты - флаги, младшие - число запросов в обработке
+    static constexpr uint64_t DRAINING = 1ull << 62;
+    static constexpr uint64_t FROZEN = 1ull << 63;
+
+    Drain() = default;
+
+    void TryFreeze(uint64_t expected);
+
+    std::atomic<uint64_t> state_ = 0;
+    std::function<void()> on_drained_;
+};
+
+// Управление приёмом соединений, не зависящее от обработчика запросов
+// Протокол (IPv4 или IPv6) открытого сокета
+tcp GetProtocol(tcp::acceptor::native_handle_type fd);
+
+class ListenerBase {
+public:
+    virtual int GetNativeHandle() = 0;
+
+    // Прекращает приём соединений и запускает Drain. Если за timeout начатые запросы
+    // не обработаны, on_drained вызывается без них
+    virtual void Stop(std::function<void()> on_drained, std::chrono::milliseconds timeout) = 0;
+protected:
+    ~ListenerBase() = default;
+};
+
 class SessionBase {
 public:
     SessionBase(const SessionBase&) = delete;
@@ -34,6 +103,7 @@ public:
 protected:
     explicit SessionBase(tcp::socket&& socket)
         : remote_endpoint_(socket.remote_endpoint()),
+          remote_address_(remote_endpoint_.address().to_string()),
           stream_(std::move(socket)) {
     }
 
@@ -44,6 +114,11 @@ protected:
         // Запись выполняется асинхронно, поэтому response перемещаем в область кучи
         auto safe_response = std::make_shared<http::response<Body, Fields>>(std::move(response));
 
+        if (Drain::GetInstance().IsDraining()) {
+            // Клиент переподключится уже к новому процессу
+            safe_response->keep_alive(false);
+        }
+
         auto self = GetSharedThis();
         http::async_write(stream_, *safe_response,
                           [safe_response, self](beast::error_code ec, std::size_t bytes_written) {
@@ -51,14 +126,29 @@ protected:
                           });
     }
 
-    ~SessionBase() = default;
+    // Соединение открывается только через Admission::TryOpenConnection.
+    // Переданное сессии HTTP/2 соединение закрывает она
+    ~SessionBase() {
+        if (!handed_over_) {
+            admission::Admission::GetInstance().CloseConnection();
+        }
+    }
 protected:
     tcp::endpoint remote_endpoint_;
+    std::string remote_address_;
 private:
+    // Отказ из admission: запрос не разбирается и не попадает в обработчик
+    void WriteRejection(admission::Reason reason);
     void OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written);
     void Read();
     void OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read);
+    // Читает начало соединения, пока не ясно, HTTP/2 это или HTTP/1.1
+    void ReadPreface();
+    void OnReadPreface(beast::error_code ec, std::size_t bytes_read);
     virtual void HandleRequest(HttpRequest&& request) = 0;
+    // Передаёт соединение сессии HTTP/2. upgrade - запрос с Upgrade: h2c
+    virtual void StartHttp2(beast::tcp_stream&& stream, beast::flat_buffer&& buffer,
+                            std::optional<HttpRequest>&& upgrade) = 0;
     void Close();
 
     virtual std::shared_ptr<SessionBase> GetSharedThis() = 0;
@@ -66,6 +156,7 @@ private:
     beast::tcp_stream stream_;
     beast::flat_buffer buffer_;
     HttpRequest request_;
+    bool handed_over_ = false;
 };
 
 template <typename RequestHandler>
@@ -86,17 +177,23 @@ private:
         // чтобы продлить время жизни сессии до вызова лямбды.
         // Используется generic-лямбда функция, способная принять response произвольного типа
         request.target(url_decode::DecodeURL(request.target()));
-        request.insert(http::field::sender, remote_endpoint_.address().to_string());
+        request.insert(http::field::sender, remote_address_);
         request_handler_(std::move(request), [self = this->shared_from_this()](auto&& response) {
             self->Write(std::move(response));
         });
     }
 
+    void StartHttp2(beast::tcp_stream&& stream, beast::flat_buffer&& buffer,
+                    std::optional<HttpRequest>&& upgrade) override {
+        std::make_shared<http2::Session<RequestHandler>>(std::move(stream), remote_address_, request_handler_)
+            ->Run(std::move(buffer), std::move(upgrade));
+    }
+
     RequestHandler request_handler_;
 };
 
 template <typename RequestHandler>
-class Listener : public std::enable_shared_from_this<Listener<RequestHandler>> {
+class Listener : public ListenerBase, public std::enable_shared_from_this<Listener<RequestHandler>> {
 public:
     template <typename Handler>
     Listener(net::io_context& ioc, const tcp::endpoint& endpoint, Handler&& request_handler)
@@ -119,10 +216,47 @@ public:
         acceptor_.listen(net::socket_base::max_listen_connections);
     }
 
+    // Принимает соединения на уже слушающем сокете, например полученном от другого процесса
+    template <typename Handler>
+    Listener(net::io_context& ioc, const tcp& protocol, tcp::acceptor::native_handle_type listen_fd,
+             Handler&& request_handler)
+        : ioc_(ioc)
+        , acceptor_(net::make_strand(ioc), protocol, listen_fd)
+        , request_handler_(std::forward<Handler>(request_handler)) {
+    }
+
     void Run() {
         DoAccept();
     }
 
+    int GetNativeHandle() override {
+        return acceptor_.native_handle();
+    }
+
+    void Stop(std::function<void()> on_drained, std::chrono::milliseconds timeout) override {
+        net::dispatch(acceptor_.get_executor(), [self = this->shared_from_this(), on_drained = std::move(on_drained), timeout] {
+            sys::error_code ec;
+            self->acceptor_.close(ec);
+
+            auto timer = std::make_shared<net::steady_timer>(self->acceptor_.get_executor(), timeout);
+            timer->async_wait([timer](sys::error_code ec) {
+                if (!ec) {
+                    Drain::GetInstance().Finish();
+                }
+            });
+
+            // Drain хранит обработчик до конца работы процесса, поэтому таймер в нём не удерживаем
+            Drain::GetInstance().Start([weak_timer = std::weak_ptr{timer}, on_drained] {
+                if (auto timer = weak_timer.lock()) {
+                    net::dispatch(timer->get_executor(), [timer] {
+                        timer->cancel();
+                    });
+                }
+                on_drained();
+            });
+        });
+    }
+
 private:
     void AsyncRunSession(tcp::socket&& socket) {
         std::make_shared<Session<RequestHandler>>(std::move(socket), request_handler_)->Run();
@@ -131,12 +265,21 @@ private:
     void OnAccept(sys::error_code ec, tcp::socket socket) {
         using namespace std::literals;
 
+        if (ec == net::error::operation_aborted) {
+            // Приём остановлен через Stop
+            return;
+        }
+
         if (ec) {
             return ReportError(ec, "accept"sv);
         }
 
-        // Асинхронно обрабатываем сессию
-        AsyncRunSession(std::move(socket));
+        if (admission::Admission::GetInstance().TryOpenConnection()) {
+            // Асинхронно обрабатываем сессию
+            AsyncRunSession(std::move(socket));
+        } else {
+            RejectConnection(std::move(socket));
+        }
 
         // Принимаем новое соединение
         DoAccept();
@@ -163,12 +306,26 @@ private:
 };
 
 template <typename RequestHandler>
-void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler) {
+std::shared_ptr<ListenerBase> ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler) {
     // При помощи decay_t исключим ссылки из типа RequestHandler,
     // чтобы Listener хранил RequestHandler по значению
     using MyListener = Listener<std::decay_t<RequestHandler>>;
 
-    std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler))->Run();
+    auto listener = std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler));
+    listener->Run();
+    return listener;
+}
+
+// Обслуживает уже слушающий сокет listen_fd
+template <typename RequestHandler>
+std::shared_ptr<ListenerBase> ServeHttp(net::io_context& ioc, tcp::acceptor::native_handle_type listen_fd,
+                                        RequestHandler&& handler) {
+    using MyListener = Listener<std::decay_t<RequestHandler>>;
+
+    auto listener = std::make_shared<MyListener>(ioc, GetProtocol(listen_fd), listen_fd,
+                                                 std::forward<RequestHandler>(handler));
+    listener->Run();
+    return listener;
 }
 
 }  // namespace http_server
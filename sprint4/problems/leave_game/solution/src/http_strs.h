@@ -15,6 +15,7 @@ const std::string state      = "/state"s;
 const std::string player     = "/player"s;
 const std::string action     = "/action"s;
 const std::string tick       = "/tick"s;
+const std::string batch      = "/batch"s;
 const std::string maps       = "/maps"s;
 const std::string v1         = "/v1"s;
 const std::string records    = "/records"s;
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace interest_grid {
+
+// Точки сессии, разложенные по квадратным клеткам со стороной не меньше радиуса интереса.
+// Хранится плотно: клетки ограничивающего прямоугольника и индексы точек подряд по клеткам,
+// поэтому перестройка - два прохода без выделений памяти, а соседи точки лежат в 3x3 клетках вокруг
+class InterestGrid {
+public:
+    // Клеток не больше, чем MAX_CELLS_PER_POINT на точку: при маленьком радиусе клетки укрупняются
+    static constexpr size_t MAX_CELLS_PER_POINT = 4;
+
+    // get_position(i) возвращает точку i из [0, count) с полями x и y
+    template <class GetPosition>
+    void Build(size_t count, double cell_size, GetPosition&& get_position);
+
+    // Вызывает fn(i) для точек не дальше radius от (x, y).
+    // Внутри клетки индексы идут по возрастанию, порядок клеток не определён
+    template <class Fn>
+    void ForEachNear(double x, double y, double radius, Fn&& fn) const;
+
+    size_t GetSize() const {
+        return xs_.size();
+    }
+
+private:
+    size_t GetCell(double x, double y) const {
+        auto cx = static_cast<size_t>(std::clamp((x - origin_x_) / cell_size_, 0., width_ - 1.));
+        auto cy = static_cast<size_t>(std::clamp((y - origin_y_) / cell_size_, 0., height_ - 1.));
+        return cy * width_ + cx;
+    }
+
+    double origin_x_ = 0;
+    double origin_y_ = 0;
+    double cell_size_ = 1;
+    size_t width_ = 0;
+    size_t height_ = 0;
+    // Точки клетки c - entries_[cell_start_[c]..cell_start_[c + 1])
+    std::vector<uint32_t> cell_start_;
+    std::vector<uint32_t> entries_;
+    std::vector<double> xs_;
+    std::vector<double> ys_;
+};
+
+//===================================Templates implementation============================================
+
+template <class GetPosition>
+void InterestGrid::Build(size_t count, double cell_size, GetPosition&& get_position) {
+    xs_.resize(count);
+    ys_.resize(count);
+    double max_x = 0;
+    double max_y = 0;
+    origin_x_ = 0;
+    origin_y_ = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const auto& pos = get_position(i);
+        xs_[i] = pos.x;
+        ys_[i] = pos.y;
+        if (i == 0) {
+            origin_x_ = max_x = pos.x;
+            origin_y_ = max_y = pos.y;
+        }
+        origin_x_ = std::min(origin_x_, xs_[i]);
+        origin_y_ = std::min(origin_y_, ys_[i]);
+        max_x = std::max(max_x, xs_[i]);
+        max_y = std::max(max_y, ys_[i]);
+    }
+
+    const double max_cells = static_cast<double>(std::max<size_t>(count, 1) * MAX_CELLS_PER_POINT);
+    cell_size_ = std::max(cell_size, std::sqrt((max_x - origin_x_) * (max_y - origin_y_) / max_cells));
+    // Вырожденный прямоугольник - линия дороги
+    cell_size_ = std::max(cell_size_, std::max(max_x - origin_x_, max_y - origin_y_) / max_cells);
+    if (!(cell_size_ > 0)) {
+        cell_size_ = 1;
+    }
+    width_ = static_cast<size_t>((max_x - origin_x_) / cell_size_) + 1;
+    height_ = static_cast<size_t>((max_y - origin_y_) / cell_size_) + 1;
+
+    cell_start_.assign(width_ * height_ + 1, 0);
+    for (size_t i = 0; i < count; ++i) {
+        cell_start_[GetCell(xs_[i], ys_[i]) + 1]++;
+    }
+    for (size_t c = 1; c < cell_start_.size(); ++c) {
+        cell_start_[c] += cell_start_[c - 1];
+    }
+    entries_.resize(count);
+    // Сдвигаем начала клеток при раскладке и восстанавливаем их обратным сдвигом
+    for (size_t i = 0; i < count; ++i) {
+        entries_[cell_start_[GetCell(xs_[i], ys_[i])]++] = static_cast<uint32_t>(i);
+    }
+    for (size_t c = cell_start_.size() - 1; c > 0; --c) {
+        cell_start_[c] = cell_start_[c - 1];
+    }
+    cell_start_[0] = 0;
+}
+
+template <class Fn>
+void InterestGrid::ForEachNear(double x, double y, double radius, Fn&& fn) const {
+    if (xs_.empty()) {
+        return;
+    }
+    const size_t first = GetCell(x - radius, y - radius);
+    const size_t last = GetCell(x + radius, y + radius);
+    const double sq_radius = radius * radius;
+    for (size_t cy = first / width_; cy <= last / width_; ++cy) {
+        for (size_t cx = first % width_; cx <= last % width_; ++cx) {
+            const size_t cell = cy * width_ + cx;
+            for (uint32_t e = cell_start_[cell]; e < cell_start_[cell + 1]; ++e) {
+                const uint32_t i = entries_[e];
+                const double dx = xs_[i] - x;
+                const double dy = ys_[i] - y;
+                if (dx * dx + dy * dy <= sq_radius) {
+                    fn(i);
+                }
+            }
+        }
+    }
+}
+
+} // namespace interest_grid
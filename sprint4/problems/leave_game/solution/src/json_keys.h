@@ -14,6 +14,8 @@ const std::string map_dog_speed_key    = "dogSpeed"s;
 const std::string game_def_speed_key   = "defaultDogSpeed"s;
 const std::string default_bag_capacity_key = "defaultBagCapacity"s;
 const std::string map_bag_capacity_key = "bagCapacity"s;
+const std::string map_max_players_per_session_key = "maxPlayersPerSession"s;
+const std::string map_interest_radius_key = "interestRadius"s;
 
 const std::string id_key   = "id"s;
 const std::string name_key = "name"s;
@@ -24,6 +26,7 @@ const std::string x0_key = "x0"s;
 const std::string y0_key = "y0"s;
 const std::string x1_key = "x1"s;
 const std::string y1_key = "y1"s;
+const std::string spawn_weight_key = "spawnWeight"s;
 
 const std::string width_key  = "w"s;
 const std::string height_key = "h"s;
@@ -57,6 +60,18 @@ const std::string unknown_token_mess = "Player token has not been found"s;
 
 const std::string token_prefix = "Bearer "s;
 
+const std::string server_overloaded_key  = "serverOverloaded"s;
+const std::string server_overloaded_mess = "Game session is overloaded"s;
+
+const std::string batch_state_key  = "state"s;
+const std::string batch_status_key = "status"s;
+
+const std::string worker_unavailable_key  = "workerUnavailable"s;
+const std::string worker_unavailable_mess = "Game server for this map is unavailable"s;
+
+const std::string server_error_key  = "internalError"s;
+const std::string server_error_mess = "Internal server error"s;
+
 const std::string pos_key     = "pos"s;
 const std::string speed_key   = "speed"s;
 const std::string dir_key     = "dir"s;
@@ -1,39 +1,121 @@
 #include "logger.h"
 
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
 namespace json_logger {
 
-namespace logging = boost::log;
 namespace json = boost::json;
-namespace keywords = boost::log::keywords;
-namespace expr = boost::log::expressions;
 namespace sys = boost::system;
 namespace net = boost::asio;
 namespace http = boost::beast::http;
 
 using tcp = net::ip::tcp;
+using namespace std::literals;
 
-void MyFormatter(logging::record_view const& rec, logging::formatting_ostream& strm) {
-    json::value data = *rec[additional_data];
-    auto ts = *rec[timestamp];
-    auto message = *rec[expr::smessage];
+namespace detail {
 
-    json::value result = {
-        {"timestamp", to_iso_extended_string(ts)},
-        {"data", data},
-        {"message", message}
-    };
+const size_t MAX_BATCH = 1024;
+const auto IDLE_WAIT = 10ms;
+
+void AppendJsonString(std::string& out, std::string_view str) {
+    out += json::serialize(json::string(str));
+}
+
+std::string_view GetString(const LogRecord& record, size_t index) {
+    size_t offset = 0;
+    for (size_t i = 0; i < index; ++i) {
+        offset += record.lengths[i];
+    }
+    return {record.text.data() + offset, record.lengths[index]};
+}
 
-    strm << result;
+void CopyStrings(LogRecord& record, std::initializer_list<std::string_view> strings) {
+    size_t offset = 0;
+    size_t index = 0;
+    for (std::string_view str : strings) {
+        size_t size = std::min(str.size(), LogRecord::TEXT_SIZE - offset);
+        std::copy_n(str.data(), size, record.text.data() + offset);
+        record.lengths[index++] = static_cast<uint16_t>(size);
+        offset += size;
+    }
 }
 
+} // namespace detail
 
 JsonLogger& JsonLogger::GetInstance() {
-    static JsonLogger logger;
+    static JsonLogger logger{GetConfig()};
     return logger;
 }
 
+void JsonLogger::Configure(LoggerConfig config) {
+    GetConfig() = config;
+}
+
+LoggerConfig& JsonLogger::GetConfig() {
+    static LoggerConfig config;
+    return config;
+}
+
+JsonLogger::JsonLogger(LoggerConfig config)
+    : config_(config)
+    , ring_(config.ring_capacity)
+    , worker_([this] { Run(); }) {
+}
+
+JsonLogger::~JsonLogger() {
+    stop_ = true;
+    wake_cv_.notify_one();
+    worker_.join();
+}
+
+void JsonLogger::Push(LogEvent event, std::array<int64_t, 2> numbers,
+                      std::initializer_list<std::string_view> strings) {
+    assert(strings.size() <= LogRecord::MAX_STRINGS);
+
+    // Отметка времени берётся в момент события, а не записи в поток
+    auto timestamp = boost::posix_time::microsec_clock::local_time();
+
+    bool pushed = ring_.TryPushWith([&](LogRecord& record) {
+        record.event = event;
+        record.timestamp = timestamp;
+        record.numbers = numbers;
+        record.lengths.fill(0);
+        detail::CopyStrings(record, strings);
+    });
+
+    if (!pushed) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    pushed_.fetch_add(1, std::memory_order_release);
+    if (consumer_sleeping_.load(std::memory_order_relaxed)) {
+        wake_cv_.notify_one();
+    }
+}
+
 void JsonLogger::LogJson(std::string_view message, const json::value& data) {
-    BOOST_LOG_TRIVIAL(trace) << logging::add_value(additional_data, data) << message;
+    std::string data_str = json::serialize(data);
+
+    if (message.size() + data_str.size() <= LogRecord::TEXT_SIZE) {
+        Push(LogEvent::json, {0, 0}, {message, data_str});
+        return;
+    }
+
+    // Большие записи встречаются редко и пишутся напрямую
+    Flush();
+    auto timestamp = boost::posix_time::microsec_clock::local_time();
+    std::string line;
+    line += "{\"timestamp\":"sv;
+    detail::AppendJsonString(line, to_iso_extended_string(timestamp));
+    line += ",\"data\":"sv;
+    line += data_str;
+    line += ",\"message\":"sv;
+    detail::AppendJsonString(line, message);
+    line += "}\n"sv;
+    WriteBatch(line);
 }
 
 void JsonLogger::LogError(std::string_view where, const sys::error_code& ec) {
@@ -45,10 +127,19 @@ void JsonLogger::LogError(std::string_view where, const sys::error_code& ec) {
     LogJson("error", data);
 }
 
-void JsonLogger::LogServerStarted(const tcp::endpoint& ep) {
+void JsonLogger::LogException(std::string_view where, std::string_view what) {
+    json::value data = {
+        {"exception", what},
+        {"where", where}
+    };
+    LogJson("error", data);
+}
+
+void JsonLogger::LogServerStarted(const tcp::endpoint& ep, std::string_view io_backend) {
     json::value data = {
         {"port", ep.port()},
-        {"address", ep.address().to_string()}
+        {"address", ep.address().to_string()},
+        {"io_backend", io_backend}
     };
     LogJson("server started", data);
 }
@@ -58,6 +149,7 @@ void JsonLogger::LogServerNormalFinish() {
         {"code", 0}
     };
     LogJson("server exited", data);
+    Flush();
 }
 
 void JsonLogger::LogServerErrorFinish(const std::exception& ec) {
@@ -66,36 +158,119 @@ void JsonLogger::LogServerErrorFinish(const std::exception& ec) {
         {"exception", ec.what()}
     };
     LogJson("server exited", data);
+    Flush();
 }
 
 void JsonLogger::LogRequest(std::string_view client_ip, std::string_view target, std::string_view method) {
-    json::value data = {
-        {"ip", client_ip},
-        {"URI", target},
-        {"method", method}
-    };
-    LogJson("request received", data);
+    Push(LogEvent::request, {0, 0}, {client_ip, target, method});
 }
 
 void JsonLogger::LogResponse(std::chrono::steady_clock::duration dur, unsigned int code, std::string_view content_type) {
     using namespace std::chrono;
-    json::value data = {
-        {"response_time", duration_cast<milliseconds>(dur).count()},
-        {"code", code},
-        {"content_type", content_type}
-    };
-    LogJson("response sent", data);
+    Push(LogEvent::response, {duration_cast<milliseconds>(dur).count(), code}, {content_type});
+}
+
+bool JsonLogger::SampleRequest() {
+    uint64_t rate = config_.request_sample_rate;
+    if (rate <= 1) {
+        return rate == 1;
+    }
+    return request_counter_.fetch_add(1, std::memory_order_relaxed) % rate == 0;
 }
 
+void JsonLogger::Flush() {
+    uint64_t target = pushed_.load(std::memory_order_acquire);
 
-JsonLogger::JsonLogger() {
-    logging::add_common_attributes();
-    logging::add_console_log(
-        std::cout,
-        keywords::format = &MyFormatter,
-        keywords::auto_flush = true
-    );
+    std::unique_lock lock{wake_mutex_};
+    while (written_.load(std::memory_order_acquire) < target) {
+        wake_cv_.notify_one();
+        flushed_cv_.wait_for(lock, detail::IDLE_WAIT);
+    }
 }
 
+void JsonLogger::Run() {
+    std::string batch;
+
+    while (true) {
+        size_t count = 0;
+        while (count < detail::MAX_BATCH && ring_.TryPopWith([this, &batch](const LogRecord& record) {
+                   FormatRecord(record, batch);
+               })) {
+            ++count;
+        }
+        ring_.PublishHead();
+
+        uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+        if (dropped != reported_dropped_) {
+            batch += "{\"timestamp\":"sv;
+            detail::AppendJsonString(batch, to_iso_extended_string(boost::posix_time::microsec_clock::local_time()));
+            batch += ",\"data\":{\"dropped\":"sv;
+            batch += std::to_string(dropped - reported_dropped_);
+            batch += "},\"message\":\"log records dropped\"}\n"sv;
+            reported_dropped_ = dropped;
+        }
+
+        if (!batch.empty()) {
+            WriteBatch(batch);
+            batch.clear();
+        }
+
+        if (count > 0) {
+            written_.fetch_add(count, std::memory_order_release);
+            flushed_cv_.notify_all();
+            continue;
+        }
+
+        if (stop_) {
+            break;
+        }
+
+        std::unique_lock lock{wake_mutex_};
+        consumer_sleeping_ = true;
+        wake_cv_.wait_for(lock, detail::IDLE_WAIT);
+        consumer_sleeping_ = false;
+    }
+}
+
+void JsonLogger::FormatRecord(const LogRecord& record, std::string& out) const {
+    out += "{\"timestamp\":"sv;
+    detail::AppendJsonString(out, to_iso_extended_string(record.timestamp));
+    out += ",\"data\":"sv;
+
+    switch (record.event) {
+    case LogEvent::json:
+        out += detail::GetString(record, 1);
+        out += ",\"message\":"sv;
+        detail::AppendJsonString(out, detail::GetString(record, 0));
+        break;
+    case LogEvent::request:
+        out += "{\"ip\":"sv;
+        detail::AppendJsonString(out, detail::GetString(record, 0));
+        out += ",\"URI\":"sv;
+        detail::AppendJsonString(out, detail::GetString(record, 1));
+        out += ",\"method\":"sv;
+        detail::AppendJsonString(out, detail::GetString(record, 2));
+        out += "},\"message\":\"request received\""sv;
+        break;
+    case LogEvent::response:
+        out += "{\"response_time\":"sv;
+        out += std::to_string(record.numbers[0]);
+        out += ",\"code\":"sv;
+        out += std::to_string(record.numbers[1]);
+        out += ",\"content_type\":"sv;
+        detail::AppendJsonString(out, detail::GetString(record, 0));
+        out += "},\"message\":\"response sent\""sv;
+        break;
+    }
+
+    out += "}\n"sv;
+}
+
+void JsonLogger::WriteBatch(std::string& batch) {
+    static std::mutex out_mutex;
+    std::lock_guard lock{out_mutex};
+    std::cout.write(batch.data(), batch.size());
+    std::cout.flush();
+}
 
 } // namespace json_logger
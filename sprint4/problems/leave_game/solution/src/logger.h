@@ -2,51 +2,117 @@
 
 #define BOOST_BEAST_USE_STD_STRING_VIEW
 
-#include <boost/log/trivial.hpp>
 #include <string>
 #include <chrono>
 #include <string_view>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <array>
+#include <initializer_list>
 
-#include <boost/log/core.hpp>        // для logging::core
-#include <boost/log/expressions.hpp> // для выражения, задающего фильтр
-#include <boost/log/utility/setup/common_attributes.hpp>
 #include <boost/date_time.hpp>
-#include <boost/log/utility/setup/console.hpp>
 #include <boost/json.hpp>
-#include <boost/log/utility/setup/file.hpp>
-#include <boost/log/utility/manipulators/add_value.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/beast/http.hpp>
 
-BOOST_LOG_ATTRIBUTE_KEYWORD(timestamp, "TimeStamp", boost::posix_time::ptime);
-BOOST_LOG_ATTRIBUTE_KEYWORD(additional_data, "AdditionalData", boost::json::value);
+#include "mpsc_ring.h"
 
 namespace json_logger {
 
-namespace logging = boost::log;
 namespace json = boost::json;
-namespace keywords = boost::log::keywords;
-namespace expr = boost::log::expressions;
 namespace sys = boost::system;
 namespace net = boost::asio;
 namespace http = boost::beast::http;
 
 using tcp = net::ip::tcp;
 
-void MyFormatter(logging::record_view const& rec, logging::formatting_ostream& strm);
+enum class LogEvent : uint8_t {
+    json,
+    request,
+    response
+};
+
+// Запись кольцевого буфера. Строки копируются в text подряд, их длины - в lengths.
+// Не поместившиеся строки обрезаются
+struct LogRecord {
+    static constexpr size_t TEXT_SIZE = 480;
+    static constexpr size_t MAX_STRINGS = 3;
+
+    LogEvent event;
+    boost::posix_time::ptime timestamp;
+    std::array<int64_t, 2> numbers;
+    std::array<uint16_t, MAX_STRINGS> lengths;
+    std::array<char, TEXT_SIZE> text;
+};
+
+struct LoggerConfig {
+    // Логируется один запрос (вместе с ответом) из request_sample_rate
+    uint64_t request_sample_rate = 1;
+    size_t ring_capacity = 1 << 12;
+};
 
 class JsonLogger {
 public:
     static JsonLogger& GetInstance();
+
+    // Вызывать до первого GetInstance
+    static void Configure(LoggerConfig config);
+
+    JsonLogger(const JsonLogger&) = delete;
+    JsonLogger& operator=(const JsonLogger&) = delete;
+    ~JsonLogger();
+
     void LogJson(std::string_view message, const json::value& data);
     void LogError(std::string_view where, const sys::error_code& ec);
-    void LogServerStarted(const tcp::endpoint& ep);
+    void LogException(std::string_view where, std::string_view what);
+    void LogServerStarted(const tcp::endpoint& ep, std::string_view io_backend);
     void LogServerNormalFinish();
     void LogServerErrorFinish(const std::exception& ec);
     void LogRequest(std::string_view client_ip, std::string_view target, std::string_view method);
     void LogResponse(std::chrono::steady_clock::duration dur, unsigned int code, std::string_view content_type);
+
+    // Решает, логировать ли очередной запрос
+    bool SampleRequest();
+
+    // Дожидается записи всех принятых записей
+    void Flush();
+
+    uint64_t GetDroppedCount() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
 private:
-    JsonLogger();
+    explicit JsonLogger(LoggerConfig config);
+
+    void Push(LogEvent event, std::array<int64_t, 2> numbers,
+              std::initializer_list<std::string_view> strings);
+
+    void Run();
+
+    void FormatRecord(const LogRecord& record, std::string& out) const;
+
+    void WriteBatch(std::string& batch);
+
+    static LoggerConfig& GetConfig();
+
+    LoggerConfig config_;
+    mpsc_ring::MpscRing<LogRecord> ring_;
+
+    std::atomic<uint64_t> request_counter_ = 0;
+    std::atomic<uint64_t> dropped_ = 0;
+    uint64_t reported_dropped_ = 0;
+
+    std::atomic<uint64_t> pushed_ = 0;
+    std::atomic<uint64_t> written_ = 0;
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    std::condition_variable flushed_cv_;
+    std::atomic<bool> consumer_sleeping_ = false;
+    std::atomic<bool> stop_ = false;
+
+    std::thread worker_;
 };
 
 } // namespace json_logger
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <string_view>
 #include <chrono>
 
@@ -13,6 +14,7 @@
 #include <boost/log/utility/setup/console.hpp>
 #include "http_server.h"
 #include "logger.h"
+#include "traffic_capture.h"
 
 namespace net = boost::asio;
 using tcp = net::ip::tcp;
@@ -36,6 +38,48 @@ public:
 private:
     std::chrono::steady_clock::time_point start_ts_ = std::chrono::steady_clock::now();
 };
+
+// Заголовки, которые попадают в запись трафика
+const std::array captured_fields = {
+    http::field::authorization,
+    http::field::content_type,
+    http::field::accept
+};
+
+template <typename Request>
+traffic_capture::Record MakeCaptureRecord(traffic_capture::Capture& capture, const Request& req) {
+    traffic_capture::Record record;
+    record.timestamp_us = capture.GetTimestamp(std::chrono::steady_clock::now());
+    record.method = static_cast<uint16_t>(req.method());
+    record.target = req.target();
+    record.body = req.body();
+
+    for (http::field field : captured_fields) {
+        auto it = req.find(field);
+        if (it == req.end()) {
+            continue;
+        }
+        std::string value{it->value()};
+        if (field == http::field::authorization) {
+            value = capture.PseudonymizeAuthorization(value);
+        }
+        record.headers.emplace_back(static_cast<uint16_t>(field), std::move(value));
+    }
+    return record;
+}
+
+template <typename Response>
+void CompleteCaptureRecord(traffic_capture::Capture& capture, traffic_capture::Record& record,
+                           const Response& response, std::chrono::steady_clock::duration duration) {
+    record.latency_us = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    record.status = response.result_int();
+
+    if constexpr (std::is_same_v<typename Response::body_type, http::string_body>) {
+        if (auto token = traffic_capture::FindIssuedToken(response.body())) {
+            record.issued_token = capture.Pseudonymize(*token);
+        }
+    }
+}
 } // namespace detail
 
 using namespace std::string_literals;
@@ -51,7 +95,33 @@ public:
     void operator()(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
         using ReqType = http::request<Body, http::basic_fields<Allocator>>;
 
-        json_logger::JsonLogger::GetInstance().LogRequest(
+        traffic_capture::Capture& capture = traffic_capture::Capture::GetInstance();
+
+        if (!capture.IsEnabled()) {
+            return Log(std::forward<ReqType>(req), std::forward<Send>(send));
+        }
+
+        auto capturing_send = [send = std::forward<Send>(send), record = detail::MakeCaptureRecord(capture, req),
+                               dur_measure = detail::DurationMeasure{}, &capture](auto&& response) mutable {
+            detail::CompleteCaptureRecord(capture, record, response, dur_measure.GetDuration());
+            capture.Write(record);
+            send(response);
+        };
+
+        Log(std::forward<ReqType>(req), std::move(capturing_send));
+    }
+private:
+    template <typename Body, typename Allocator, typename Send>
+    void Log(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
+        using ReqType = http::request<Body, http::basic_fields<Allocator>>;
+
+        json_logger::JsonLogger& logger = json_logger::JsonLogger::GetInstance();
+
+        if (!logger.SampleRequest()) {
+            return request_handler_(std::forward<ReqType>(req), std::forward<Send>(send));
+        }
+
+        logger.LogRequest(
                     req.at(http::field::sender),
                     req.target(),
                     req.method_string()
@@ -59,8 +129,8 @@ public:
 
         detail::DurationMeasure dur_measure;
 
-        request_handler_(std::forward<ReqType>(req), [send = std::forward<Send>(send), &dur_measure](auto&& response){
-            json_logger::JsonLogger::GetInstance().LogResponse(
+        request_handler_(std::forward<ReqType>(req), [send = std::forward<Send>(send), dur_measure, &logger](auto&& response)mutable{
+            logger.LogResponse(
                         dur_measure.GetDuration(),
                         static_cast<int>(response.result()),
                         response.at(http::field::content_type)
@@ -68,7 +138,7 @@ public:
             send(response);
         });
     }
-private:
+
     RequestHandler& request_handler_;
 };
 
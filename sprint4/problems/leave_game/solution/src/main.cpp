@@ -11,10 +11,20 @@
 #include "json_loader.h"
 #include "request_handler.h"
 #include "logging_request_handler.h"
+#include "metrics_request_handler.h"
 #include "logger.h"
 #include "game_manager.h"
 #include "game_serialization.h"
+#include "game_journal.h"
 #include "record_saver.h"
+#include "tick_profiler.h"
+#include "request_tracer.h"
+#include "traffic_capture.h"
+#include "map_cache.h"
+#include "takeover.h"
+#include "router.h"
+#include "routing_request_handler.h"
+#include "admission.h"
 
 using namespace std::literals;
 
@@ -25,6 +35,32 @@ struct Args {
     uint64_t save_period = 0;
     uint64_t milliseconds = 0;
     bool random_spawn = false;
+    bool state_journal = false;
+    uint64_t log_sample_rate = 1;
+    std::string tick_profile;
+    std::string request_trace;
+    uint64_t request_trace_rate = 100;
+    std::string capture_traffic;
+    std::string map_cache;
+    std::string takeover_socket;
+    bool takeover = false;
+    boost::asio::ip::port_type port = 8080;
+    std::optional<size_t> shard_id;
+    std::vector<boost::asio::ip::port_type> workers;
+    size_t spawn_workers = 0;
+    std::unordered_map<std::string, size_t> map_shards;
+    admission::Limits limits;
+    uint64_t session_grace_period = 60;
+    bool fixed_timestep = false;
+    uint64_t max_tick_delta = 0;
+    std::string tick_overrun = "catch-up"s;
+    size_t large_session_players = 0;
+    size_t session_regions = 0;
+    http2::Options http2;
+
+    bool IsRouter() const {
+        return !workers.empty() || spawn_workers != 0;
+    }
 };
 
 namespace po = boost::program_options;
@@ -34,6 +70,10 @@ namespace po = boost::program_options;
     po::options_description desc{"Allowed options"s};
 
     Args args;
+    size_t shard_id;
+    std::string workers;
+    std::string map_shards;
+    uint64_t read_timeout = args.limits.read_timeout.count();
     desc.add_options()
     ("help,h", "produce help message")
     ("tick-period,t", po::value(&args.milliseconds)->value_name("milliseconds"s), "set tick period")
@@ -41,6 +81,35 @@ namespace po = boost::program_options;
     ("www-root,w", po::value(&args.dir)->value_name("dir"s), "set static files root")
     ("state-file", po::value(&args.state_file)->value_name("state_file"s), "set state file")
     ("save-state-period", po::value(&args.save_period)->value_name("save_period"s), "set save period")
+    ("state-journal", "write journal of changes between state saves")
+    ("log-sample-rate", po::value(&args.log_sample_rate)->value_name("n"s), "log one of n requests (0 - none)")
+    ("tick-profile", po::value(&args.tick_profile)->value_name("file"s), "profile tick phases and write Chrome trace to file on exit")
+    ("request-trace", po::value(&args.request_trace)->value_name("file"s), "write sampled request traces to file in Chrome trace format")
+    ("request-trace-rate", po::value(&args.request_trace_rate)->value_name("n"s), "trace one of n requests (default 100)")
+    ("capture-traffic", po::value(&args.capture_traffic)->value_name("file"s), "record requests with pseudonymized tokens for traffic_replay")
+    ("map-cache", po::value(&args.map_cache)->value_name("file"s), "keep preprocessed maps in file, rebuilt when config changes")
+    ("takeover-socket", po::value(&args.takeover_socket)->value_name("path"s), "hand the server over to a successor connecting to unix socket path")
+    ("takeover", "take listening socket and game state from the server on --takeover-socket")
+    ("port", po::value(&args.port)->value_name("port"s), "set listening port (default 8080)")
+    ("shard-id", po::value(&shard_id)->value_name("n"s), "run as worker n of a router, its number is put into player tokens")
+    ("workers", po::value(&workers)->value_name("ports"s), "run as router for workers on localhost ports, e.g. 8081,8082")
+    ("spawn-workers", po::value(&args.spawn_workers)->value_name("n"s), "run as router and start n workers on the following ports")
+    ("map-shards", po::value(&map_shards)->value_name("spec"s), "pin maps to workers, e.g. map1=0,map2=1. Other maps go to the least loaded worker")
+    ("max-connections", po::value(&args.limits.max_connections)->value_name("n"s), "answer 503 to connections over n")
+    ("token-rate", po::value(&args.limits.token_rate)->value_name("rps"s), "limit requests per second of one player, answer 429 over it")
+    ("token-burst", po::value(&args.limits.token_burst)->value_name("n"s), "allowed burst of requests of one player (default - token rate)")
+    ("ip-rate", po::value(&args.limits.ip_rate)->value_name("rps"s), "limit requests per second from one address, answer 429 over it")
+    ("ip-burst", po::value(&args.limits.ip_burst)->value_name("n"s), "allowed burst of requests from one address (default - ip rate)")
+    ("session-queue-limit", po::value(&args.limits.session_queue)->value_name("n"s), "answer 503 to player requests when n handlers wait in the game session")
+    ("http2", "accept HTTP/2 without TLS: with prior knowledge and by Upgrade: h2c")
+    ("http2-max-streams", po::value(&args.http2.max_concurrent_streams)->value_name("n"s), "requests in progress on one HTTP/2 connection (default 100)")
+    ("read-timeout", po::value(&read_timeout)->value_name("seconds"s), "close connections idle for this time (default 30)")
+    ("fixed-timestep", "advance the game by steps of exactly the tick period")
+    ("max-tick-delta", po::value(&args.max_tick_delta)->value_name("milliseconds"s), "split longer ticks into steps of at most this length")
+    ("tick-overrun", po::value(&args.tick_overrun)->value_name("policy"s), "what to do with time over one step: catch-up (default) or drop")
+    ("session-grace-period", po::value(&args.session_grace_period)->value_name("seconds"s), "remove game sessions left without players for this time (default 60)")
+    ("large-session-players", po::value(&args.large_session_players)->value_name("n"s), "split ticks of sessions with at least n players between threads")
+    ("session-regions", po::value(&args.session_regions)->value_name("n"s), "map regions of a large session processed in parallel (default - number of threads)")
     ("randomize-spawn-points", "spawn dogs at random positions");
 
     po::variables_map vm;
@@ -62,6 +131,60 @@ namespace po = boost::program_options;
     }
 
     args.random_spawn = vm.contains("randomize-spawn-points");
+    args.state_journal = vm.contains("state-journal");
+    args.takeover = vm.contains("takeover");
+    args.fixed_timestep = vm.contains("fixed-timestep");
+    args.http2.enabled = vm.contains("http2");
+
+    args.limits.read_timeout = std::chrono::seconds{read_timeout};
+    if (args.limits.token_burst == 0) {
+        args.limits.token_burst = args.limits.token_rate;
+    }
+    if (args.limits.ip_burst == 0) {
+        args.limits.ip_burst = args.limits.ip_rate;
+    }
+
+    if (vm.contains("shard-id"s)) {
+        args.shard_id = shard_id;
+    }
+    if (!workers.empty()) {
+        args.workers = router::ParsePorts(workers);
+    }
+    if (!map_shards.empty()) {
+        args.map_shards = router::ParseMapShards(map_shards);
+    }
+
+    if (args.tick_overrun != "catch-up"sv && args.tick_overrun != "drop"sv) {
+        throw std::runtime_error("Unknown tick overrun policy "s + args.tick_overrun);
+    }
+
+    if (args.fixed_timestep && args.milliseconds == 0) {
+        throw std::runtime_error("Fixed timestep requires tick period"s);
+    }
+
+    if (args.state_journal && args.state_file.empty()) {
+        throw std::runtime_error("State journal requires state file"s);
+    }
+
+    if (args.takeover && args.takeover_socket.empty()) {
+        throw std::runtime_error("Takeover requires takeover socket"s);
+    }
+
+    if (!args.workers.empty() && args.spawn_workers != 0) {
+        throw std::runtime_error("Workers and spawn workers can't be used together"s);
+    }
+
+    if (args.spawn_workers + args.workers.size() > router::MAX_SHARDS) {
+        throw std::runtime_error("Too many workers"s);
+    }
+
+    if (args.IsRouter() && (args.shard_id || !args.takeover_socket.empty())) {
+        throw std::runtime_error("Router can't be a worker or take over a server"s);
+    }
+
+    if (!args.map_shards.empty() && !args.IsRouter()) {
+        throw std::runtime_error("Map shards require workers"s);
+    }
 
     return args;
 }
@@ -86,13 +209,125 @@ void RunWorkers(unsigned n, const Fn& fn) {
     fn();
 }
 
+// Загружает конфиг и готовит карты к игре. С кэшем при неизменном конфиге
+// разбор JSON и построение графов пропускаются
+map_cache::PreprocessedGame LoadGame(const Args& args) {
+    if (args.map_cache.empty()) {
+        map_cache::PreprocessedGame result{json_loader::LoadGame(args.file), {}};
+        result.graphs = move_manager::BuildAreaGraphs(result.game.GetMaps());
+        return result;
+    }
+
+    uint64_t config_hash = map_cache::HashConfig(args.file);
+
+    if (auto cached = map_cache::Load(args.map_cache, config_hash)) {
+        return std::move(*cached);
+    }
+
+    map_cache::PreprocessedGame result{json_loader::LoadGame(args.file), {}};
+    result.graphs = move_manager::BuildAreaGraphs(result.game.GetMaps());
+    map_cache::Save(args.map_cache, config_hash, result);
+    return result;
+}
+
+// Аргументы воркера повторяют настройки маршрутизатора. Состояние каждый воркер хранит в своём файле
+std::vector<std::string> MakeWorkerArgs(const Args& args, size_t shard_id, net::ip::port_type port) {
+    std::vector<std::string> result{
+        "--config-file"s, args.file,
+        "--www-root"s, args.dir,
+        "--port"s, std::to_string(port),
+        "--shard-id"s, std::to_string(shard_id),
+        "--log-sample-rate"s, std::to_string(args.log_sample_rate)
+    };
+
+    if (args.milliseconds != 0) {
+        result.insert(result.end(), {"--tick-period"s, std::to_string(args.milliseconds)});
+    }
+    if (args.random_spawn) {
+        result.push_back("--randomize-spawn-points"s);
+    }
+    if (!args.state_file.empty()) {
+        result.insert(result.end(), {"--state-file"s, args.state_file + ".shard"s + std::to_string(shard_id)});
+        result.insert(result.end(), {"--save-state-period"s, std::to_string(args.save_period)});
+    }
+    if (args.state_journal) {
+        result.push_back("--state-journal"s);
+    }
+    if (!args.map_cache.empty()) {
+        result.insert(result.end(), {"--map-cache"s, args.map_cache});
+    }
+    result.insert(result.end(), {"--session-grace-period"s, std::to_string(args.session_grace_period)});
+    if (args.fixed_timestep) {
+        result.push_back("--fixed-timestep"s);
+    }
+    if (args.max_tick_delta != 0) {
+        result.insert(result.end(), {"--max-tick-delta"s, std::to_string(args.max_tick_delta)});
+    }
+    result.insert(result.end(), {"--tick-overrun"s, args.tick_overrun});
+    if (args.large_session_players != 0) {
+        result.insert(result.end(), {"--large-session-players"s, std::to_string(args.large_session_players)});
+    }
+    if (args.session_regions != 0) {
+        result.insert(result.end(), {"--session-regions"s, std::to_string(args.session_regions)});
+    }
+    // Ограничения по адресу и токену проверяет маршрутизатор: к воркеру все запросы приходят с localhost
+    if (args.limits.session_queue != 0) {
+        result.insert(result.end(), {"--session-queue-limit"s, std::to_string(args.limits.session_queue)});
+    }
+
+    return result;
+}
+
+// Останавливает запущенные воркеры при любом выходе из main
+class SpawnedWorkers {
+public:
+    SpawnedWorkers() = default;
+
+    SpawnedWorkers(const SpawnedWorkers&) = delete;
+    SpawnedWorkers& operator=(const SpawnedWorkers&) = delete;
+
+    ~SpawnedWorkers() {
+        router::StopWorkers(pids_);
+    }
+
+    void Spawn(const std::vector<std::string>& args) {
+        pids_.push_back(router::SpawnWorker(args));
+    }
+private:
+    std::vector<pid_t> pids_;
+};
+
 }  // namespace
 
 int main(int argc, const char* argv[]) {
     try {
         auto args = ParseCommandLine(argc, argv);
+        if (!args) {
+            return EXIT_SUCCESS;
+        }
+
+        json_logger::LoggerConfig logger_config;
+        logger_config.request_sample_rate = args->log_sample_rate;
+        json_logger::JsonLogger::Configure(logger_config);
+
+        if (!args->tick_profile.empty()) {
+            tick_profiler::Profiler::GetInstance().Enable();
+        }
+
+        if (!args->request_trace.empty()) {
+            request_tracer::Tracer::GetInstance().Enable(args->request_trace, args->request_trace_rate);
+        }
+
+        if (!args->capture_traffic.empty()) {
+            traffic_capture::Capture::GetInstance().Enable(args->capture_traffic);
+        }
+
+        admission::Admission::GetInstance().Configure(args->limits);
+        http2::Configure(args->http2);
+
         // 1. Загружаем карту из файла и построить модель игры
-        model::Game game = json_loader::LoadGame(args->file);
+        map_cache::PreprocessedGame preprocessed = LoadGame(*args);
+        model::Game& game = preprocessed.game;
 
         // 2. Инициализируем io_context
         const unsigned num_threads = std::thread::hardware_concurrency();
@@ -106,7 +341,24 @@ int main(int argc, const char* argv[]) {
 
         // 2.1. Инициализируем endpoint
         const auto address = net::ip::make_address("0.0.0.0");
-        constexpr net::ip::port_type port {8080};
+        const net::ip::port_type port = args->port;
+
+        // 2.2. В режиме маршрутизатора игру ведут воркеры на localhost
+        const auto worker_address = net::ip::make_address("127.0.0.1");
+        std::vector<tcp::endpoint> worker_endpoints;
+        SpawnedWorkers spawned_workers;
+
+        for (net::ip::port_type worker_port : args->workers) {
+            worker_endpoints.emplace_back(worker_address, worker_port);
+        }
+        for (size_t i = 0; i < args->spawn_workers; ++i) {
+            net::ip::port_type worker_port = port + 1 + i;
+            spawned_workers.Spawn(MakeWorkerArgs(*args, i, worker_port));
+            worker_endpoints.emplace_back(worker_address, worker_port);
+        }
+        for (const tcp::endpoint& endpoint : worker_endpoints) {
+            router::WaitForWorker(endpoint, router::WORKER_TIMEOUT);
+        }
 
         // 3. Добавляем асинхронный обработчик сигналов SIGINT и SIGTERM
         net::signal_set signals(ioc, SIGINT, SIGTERM);
@@ -118,43 +370,124 @@ int main(int argc, const char* argv[]) {
         // 4. Создаём обработчик HTTP-запросов и связываем его с моделью игры
         const std::filesystem::path static_path(std::filesystem::weakly_canonical(args->dir));
 
-        game_manager::GameManager game_m{game, ioc, args->random_spawn, args->milliseconds};
+        game_manager::GameManager game_m{game, preprocessed.graphs, ioc, args->random_spawn, args->milliseconds};
+
+        game_m.SetMaxSessionQueue(args->limits.session_queue);
+        game_m.SetSessionGracePeriod(args->session_grace_period * 1000);
+
+        game_manager::PartitionOptions partitioning;
+        partitioning.min_players = args->large_session_players;
+        partitioning.regions = args->session_regions != 0 ? args->session_regions : num_threads;
+        game_m.SetPartitioning(partitioning);
+
+        ticker::TickOptions tick_options;
+        if (args->fixed_timestep) {
+            tick_options.fixed_step = std::chrono::milliseconds{args->milliseconds};
+        }
+        tick_options.max_delta = std::chrono::milliseconds{args->max_tick_delta};
+        if (args->tick_overrun == "drop"sv) {
+            tick_options.overrun = ticker::OverrunPolicy::drop;
+        }
+        game_m.SetTickOptions(tick_options);
+
+        if (args->shard_id) {
+            game_m.SetTokenPrefix(router::MakeTokenPrefix(*args->shard_id));
+        }
 
         game_m.SetRecordSaver(std::make_shared<record_saver_pq::RecordSaverPQ>(db_url));
 
         http_handler::RequestHandler handler{game_m, static_path};
 
-        auto l_handler = logging_handler::MakeHandler(handler);
+        routing_handler::RoutingRequestHandler r_handler{handler, ioc, worker_endpoints, args->map_shards};
+
+        auto l_handler = logging_handler::MakeHandler(r_handler);
+
+        auto m_handler = metrics_handler::MakeHandler(l_handler);
 
         json_logger::JsonLogger& logger = json_logger::JsonLogger::GetInstance();
 
         std::shared_ptr<game_serialization::Serializator> serializator;
 
-        if (args->state_file != "") {
+        // Состояние маршрутизатора пусто, игроков хранят воркеры
+        if (args->state_file != "" && !args->IsRouter()) {
             serializator = std::make_shared<game_serialization::Serializator>(
                         game_m, args->state_file, args->save_period
             );
+        }
 
-            serializator->Load();
+        // Принимаем сервер у работающего процесса как можно позже: пока мы здесь, запросы
+        // ждут в очереди слушающего сокета
+        std::optional<takeover::Handoff> handoff;
+        if (args->takeover) {
+            handoff = takeover::TakeOver(args->takeover_socket);
+        }
+
+        // Журнал открывается после передачи: до неё в тот же файл пишет старый процесс
+        std::shared_ptr<game_journal::Journal> journal;
+        if (serializator && args->state_journal) {
+            journal = std::make_shared<game_journal::Journal>(
+                        game_journal::Journal::GetPathForState(args->state_file)
+            );
+            serializator->SetJournal(journal);
+            game_m.SetJournal(journal);
+            game_m.Subscribe(journal);
+        }
 
-            if (args->save_period != 0) {
-                game_m.Subscribe(serializator);
+        if (handoff && handoff->state) {
+            game_m.Restore(std::move(*handoff->state));
+            if (serializator) {
+                // Файл состояния и журнал старого процесса больше не нужны
+                serializator->Save();
             }
+        } else if (serializator) {
+            serializator->Load();
+        }
+
+        if (serializator && args->save_period != 0) {
+            game_m.Subscribe(serializator);
         }
 
         // 5. Запустить обработчик HTTP-запросов, делегируя их обработчику запросов
-        http_server::ServeHttp(ioc, {address, port}, [&l_handler](auto&& req, auto&& send) {
-            l_handler(std::forward<decltype(req)>(req), std::forward<decltype(send)>(send));
-        });
+        auto serve = [&m_handler](auto&& req, auto&& send) {
+            m_handler(std::forward<decltype(req)>(req), std::forward<decltype(send)>(send));
+        };
+        std::shared_ptr<http_server::ListenerBase> listener = handoff
+            ? http_server::ServeHttp(ioc, handoff->listen_fd, serve)
+            : http_server::ServeHttp(ioc, {address, port}, serve);
+
+        // Сервер отдан преемнику вместе с состоянием, сохранять его при выходе нельзя:
+        // файлы состояния и журнала уже принадлежат преемнику
+        bool handed_over = false;
+
+        if (!args->takeover_socket.empty()) {
+            std::make_shared<takeover::Donor>(ioc, args->takeover_socket, listener, game_m,
+                serializator, journal,
+                [&ioc, &handed_over] {
+                    handed_over = true;
+                    ioc.stop();
+                },
+                http_server::ReportError
+            )->Run();
+        }
 
-        logger.LogServerStarted({address, port});
+        logger.LogServerStarted({address, port}, http_server::GetIoBackend());
 
         // 6. Запускаем обработку асинхронных операций
         RunWorkers(std::max(1u, num_threads), [&ioc] {
             ioc.run();
         });
 
-        serializator->Save();
+        if (serializator && !handed_over) {
+            serializator->Save();
+        }
+
+        if (!args->tick_profile.empty()) {
+            tick_profiler::Profiler::GetInstance().WriteChromeTrace(args->tick_profile);
+        }
+
+        if (!args->capture_traffic.empty()) {
+            traffic_capture::Capture::GetInstance().Flush();
+        }
 
         logger.LogServerNormalFinish();
 
@@ -0,0 +1,302 @@
+#include "map_cache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "binary_io.h"
+
+namespace map_cache {
+
+using namespace std::literals;
+
+namespace detail {
+
+const std::string_view FILE_SIGNATURE = "GSMAPC\n\0"sv;
+
+const uint64_t FNV_OFFSET = 14695981039346656037ull;
+const uint64_t FNV_PRIME = 1099511628211ull;
+
+// Файл, отображённый в память только для чтения
+class MappedFile {
+public:
+    explicit MappedFile(const std::filesystem::path& file) {
+        int fd = ::open(file.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                data_ = static_cast<char*>(data);
+                size_ = st.st_size;
+            }
+        }
+        ::close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (data_) {
+            ::munmap(data_, size_);
+        }
+    }
+
+    std::string_view GetData() const {
+        return {data_, size_};
+    }
+private:
+    char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+void PutPoint(std::string& out, model::Point point) {
+    binary_io::Put<int32_t>(out, point.x);
+    binary_io::Put<int32_t>(out, point.y);
+}
+
+model::Point GetPoint(binary_io::Reader& reader) {
+    model::Coord x = reader.Get<int32_t>();
+    model::Coord y = reader.Get<int32_t>();
+    return {x, y};
+}
+
+void PutMap(std::string& out, const model::Map& map) {
+    binary_io::PutString<uint16_t>(out, *map.GetId());
+    binary_io::PutString<uint16_t>(out, map.GetName());
+    binary_io::Put<double>(out, map.GetDogSpeed());
+    binary_io::Put<uint64_t>(out, map.GetBagCapacity());
+    binary_io::Put<uint64_t>(out, map.GetMaxPlayersPerSession());
+    binary_io::Put<double>(out, map.GetInterestRadius());
+
+    binary_io::Put<uint32_t>(out, map.GetRoads().size());
+    for (const model::Road& road : map.GetRoads()) {
+        PutPoint(out, road.GetStart());
+        PutPoint(out, road.GetEnd());
+        binary_io::Put<double>(out, road.GetSpawnWeight());
+    }
+
+    binary_io::Put<uint32_t>(out, map.GetBuildings().size());
+    for (const model::Building& building : map.GetBuildings()) {
+        const model::Rectangle& bounds = building.GetBounds();
+        PutPoint(out, bounds.position);
+        PutPoint(out, {bounds.size.width, bounds.size.height});
+    }
+
+    binary_io::Put<uint32_t>(out, map.GetOffices().size());
+    for (const model::Office& office : map.GetOffices()) {
+        binary_io::PutString<uint16_t>(out, *office.GetId());
+        PutPoint(out, office.GetPosition());
+        PutPoint(out, {office.GetOffset().dx, office.GetOffset().dy});
+    }
+
+    binary_io::Put<uint32_t>(out, map.GetLootTypes().size());
+    for (const model::LootType& type : map.GetLootTypes()) {
+        binary_io::PutString<uint16_t>(out, type.name);
+        binary_io::PutString<uint16_t>(out, type.file);
+        binary_io::Put<uint8_t>(out, static_cast<uint8_t>(type.type));
+        binary_io::Put<uint8_t>(out, type.rotation.has_value());
+        binary_io::Put<int32_t>(out, type.rotation.value_or(0));
+        binary_io::PutString<uint16_t>(out, type.color);
+        binary_io::Put<double>(out, type.scale);
+        binary_io::Put<int32_t>(out, type.value);
+    }
+}
+
+model::Map GetMap(binary_io::Reader& reader) {
+    model::Map::Id id{reader.GetString<uint16_t>()};
+    std::string name = reader.GetString<uint16_t>();
+
+    // Скорость и вместимость сохраняются уже с подставленными значениями по умолчанию
+    model::MapConfig config;
+    config.dog_speed = reader.Get<double>();
+    config.bag_capacity = reader.Get<uint64_t>();
+    config.max_players_per_session = reader.Get<uint64_t>();
+    config.interest_radius = reader.Get<double>();
+
+    model::Map map{std::move(id), std::move(name), config};
+
+    for (uint32_t i = 0, n = reader.Get<uint32_t>(); i < n; ++i) {
+        model::Point start = GetPoint(reader);
+        model::Point end = GetPoint(reader);
+        double spawn_weight = reader.Get<double>();
+        if (start.y == end.y) {
+            map.AddRoad({model::Road::HORIZONTAL, start, end.x, spawn_weight});
+        } else {
+            map.AddRoad({model::Road::VERTICAL, start, end.y, spawn_weight});
+        }
+    }
+
+    for (uint32_t i = 0, n = reader.Get<uint32_t>(); i < n; ++i) {
+        model::Point position = GetPoint(reader);
+        model::Point size = GetPoint(reader);
+        map.AddBuilding(model::Building{{position, {size.x, size.y}}});
+    }
+
+    for (uint32_t i = 0, n = reader.Get<uint32_t>(); i < n; ++i) {
+        model::Office::Id office_id{reader.GetString<uint16_t>()};
+        model::Point position = GetPoint(reader);
+        model::Point offset = GetPoint(reader);
+        map.AddOffice({std::move(office_id), position, {offset.x, offset.y}});
+    }
+
+    for (uint32_t i = 0, n = reader.Get<uint32_t>(); i < n; ++i) {
+        model::LootType type;
+        type.name = reader.GetString<uint16_t>();
+        type.file = reader.GetString<uint16_t>();
+        type.type = static_cast<model::LootSort>(reader.Get<uint8_t>());
+        bool has_rotation = reader.Get<uint8_t>();
+        int32_t rotation = reader.Get<int32_t>();
+        if (has_rotation) {
+            type.rotation = rotation;
+        }
+        type.color = reader.GetString<uint16_t>();
+        type.scale = reader.Get<double>();
+        type.value = reader.Get<int32_t>();
+        map.AddLootType(std::move(type));
+    }
+
+    return map;
+}
+
+void PutGraph(std::string& out, const move_manager::AreaGraph& graph) {
+    using Node = move_manager::AreaGraph::Node;
+    static_assert(std::is_trivially_copyable_v<Node>);
+
+    binary_io::Put<uint32_t>(out, graph.nodes.size());
+    out.append(reinterpret_cast<const char*>(graph.nodes.data()), graph.nodes.size() * sizeof(Node));
+}
+
+move_manager::AreaGraph GetGraph(binary_io::Reader& reader) {
+    using Node = move_manager::AreaGraph::Node;
+
+    uint32_t size = reader.Get<uint32_t>();
+    std::string_view bytes = reader.GetBytes(static_cast<size_t>(size) * sizeof(Node));
+
+    move_manager::AreaGraph graph;
+    graph.nodes.resize(size);
+    std::memcpy(graph.nodes.data(), bytes.data(), bytes.size());
+
+    for (const Node& node : graph.nodes) {
+        for (int32_t neighbour : node.neighbours) {
+            if (neighbour != move_manager::AreaGraph::NO_NEIGHBOUR && (neighbour < 0 || neighbour >= static_cast<int64_t>(size))) {
+                throw std::runtime_error("Map cache: bad area index");
+            }
+        }
+    }
+    return graph;
+}
+
+} // namespace detail
+
+uint64_t HashConfig(const std::filesystem::path& config) {
+    std::ifstream input(config, std::ios::binary);
+    if (!input.is_open()) {
+        throw std::runtime_error("The configuration file could not be opened!");
+    }
+
+    uint64_t hash = detail::FNV_OFFSET;
+    char buf[1 << 16];
+    while (input.read(buf, sizeof(buf)) || input.gcount() > 0) {
+        for (std::streamsize i = 0; i < input.gcount(); ++i) {
+            hash = (hash ^ static_cast<uint8_t>(buf[i])) * detail::FNV_PRIME;
+        }
+    }
+    return hash;
+}
+
+std::optional<PreprocessedGame> Load(const std::filesystem::path& file, uint64_t config_hash) {
+    detail::MappedFile mapped{file};
+    std::string_view data = mapped.GetData();
+
+    if (!data.starts_with(detail::FILE_SIGNATURE)) {
+        return std::nullopt;
+    }
+
+    try {
+        binary_io::Reader reader{data.substr(detail::FILE_SIGNATURE.size())};
+        if (reader.Get<uint32_t>() != VERSION || reader.Get<uint64_t>() != config_hash) {
+            return std::nullopt;
+        }
+
+        model::GameConfig config;
+        config.loot_config.period = reader.Get<double>();
+        config.loot_config.probability = reader.Get<double>();
+        config.default_speed = reader.Get<double>();
+        config.default_capacity = reader.Get<uint64_t>();
+        config.retirement_time = reader.Get<double>();
+
+        PreprocessedGame result{model::Game{config}, {}};
+
+        uint32_t maps = reader.Get<uint32_t>();
+        for (uint32_t i = 0; i < maps; ++i) {
+            result.game.AddMap(detail::GetMap(reader));
+        }
+
+        result.graphs.reserve(maps);
+        for (uint32_t i = 0; i < maps; ++i) {
+            result.graphs.push_back(detail::GetGraph(reader));
+        }
+
+        if (!reader.IsEnd()) {
+            return std::nullopt;
+        }
+        return result;
+    } catch (const std::runtime_error&) {
+        return std::nullopt;
+    } catch (const std::logic_error&) {
+        // Повторяющиеся id карт или офисов
+        return std::nullopt;
+    }
+}
+
+void Save(const std::filesystem::path& file, uint64_t config_hash, const PreprocessedGame& game) {
+    const auto& maps = game.game.GetMaps();
+    if (maps.size() != game.graphs.size()) {
+        throw std::invalid_argument("Map cache: area graphs do not match maps");
+    }
+
+    std::string data{detail::FILE_SIGNATURE};
+    binary_io::Put<uint32_t>(data, VERSION);
+    binary_io::Put<uint64_t>(data, config_hash);
+
+    model::GameConfig config = game.game.GetConfig();
+    binary_io::Put<double>(data, config.loot_config.period);
+    binary_io::Put<double>(data, config.loot_config.probability);
+    binary_io::Put<double>(data, config.default_speed);
+    binary_io::Put<uint64_t>(data, config.default_capacity);
+    binary_io::Put<double>(data, config.retirement_time);
+
+    binary_io::Put<uint32_t>(data, maps.size());
+    for (const model::Map& map : maps) {
+        detail::PutMap(data, map);
+    }
+    for (const move_manager::AreaGraph& graph : game.graphs) {
+        detail::PutGraph(data, graph);
+    }
+
+    // Пишем во временный файл, чтобы параллельный запуск не прочитал недописанный кэш
+    std::filesystem::path tmp = file;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary);
+        if (!out.write(data.data(), data.size())) {
+            throw std::runtime_error("Failed to write map cache " + tmp.string());
+        }
+    }
+    std::filesystem::rename(tmp, file);
+}
+
+} // namespace map_cache
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include "model.h"
+#include "move_manager.h"
+
+// Кэш предобработанных карт: модель игры и графы клеток дорог.
+// Файл привязан к хешу конфига и версии формата, при несовпадении считается устаревшим
+namespace map_cache {
+
+// Увеличивать при любом изменении формата файла или AreaGraph
+const uint32_t VERSION = 4;
+
+struct PreprocessedGame {
+    model::Game game;
+    // В порядке game.GetMaps()
+    std::vector<move_manager::AreaGraph> graphs;
+};
+
+// FNV-1a от содержимого файла конфига
+uint64_t HashConfig(const std::filesystem::path& config);
+
+// Читает кэш через mmap. nullopt, если файла нет, он повреждён или устарел
+std::optional<PreprocessedGame> Load(const std::filesystem::path& file, uint64_t config_hash);
+
+void Save(const std::filesystem::path& file, uint64_t config_hash, const PreprocessedGame& game);
+
+} // namespace map_cache
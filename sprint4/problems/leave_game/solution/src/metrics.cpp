@@ -0,0 +1,254 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <bit>
+#include <sstream>
+
+namespace metrics {
+
+using namespace std::literals;
+
+namespace detail {
+
+size_t GetThreadShard() {
+    static std::atomic<size_t> next_shard = 0;
+    thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+    return shard;
+}
+
+} // namespace detail
+
+void WriteHeader(std::ostream& out, std::string_view name, std::string_view type, std::string_view help) {
+    out << "# HELP "sv << name << ' ' << help << '\n';
+    out << "# TYPE "sv << name << ' ' << type << '\n';
+}
+
+void WriteGauge(std::ostream& out, std::string_view name, std::string_view help, const Gauge& gauge) {
+    WriteHeader(out, name, "gauge"sv, help);
+    out << name << ' ' << gauge.Get() << '\n';
+}
+
+void WriteHistogram(std::ostream& out, std::string_view name, std::string_view labels,
+                    const Histogram& histogram) {
+    Histogram::Snapshot snapshot = histogram.GetSnapshot();
+    std::string_view sep = labels.empty() ? ""sv : ","sv;
+
+    // Наружу отдаются только границы степеней двойки
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < Histogram::BUCKETS; ++i) {
+        cumulative += snapshot.buckets[i];
+        if (i % Histogram::SUB_BUCKETS != Histogram::SUB_BUCKETS - 1) {
+            continue;
+        }
+        double le = static_cast<double>(Histogram::GetBucketUpperBound(i) + 1) / 1e6;
+        out << name << "_bucket{"sv << labels << sep << "le=\""sv << le << "\"} "sv << cumulative << '\n';
+    }
+    out << name << "_bucket{"sv << labels << sep << "le=\"+Inf\"} "sv << snapshot.count << '\n';
+    out << name << "_sum{"sv << labels << "} "sv << static_cast<double>(snapshot.sum) / 1e6 << '\n';
+    out << name << "_count{"sv << labels << "} "sv << snapshot.count << '\n';
+}
+
+uint64_t Counter::Get() const {
+    uint64_t result = 0;
+    for (const Shard& shard : shards_) {
+        result += shard.value.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+void Histogram::Record(uint64_t value) {
+    Shard& shard = shards_[detail::GetThreadShard()];
+    shard.buckets[GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::GetSnapshot() const {
+    Snapshot result;
+    for (const Shard& shard : shards_) {
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            result.buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+        }
+        result.sum += shard.sum.load(std::memory_order_relaxed);
+        result.count += shard.count.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+size_t Histogram::GetBucketIndex(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return value;
+    }
+    size_t exponent = std::bit_width(value) - 1;
+    if (exponent > MAX_EXPONENT) {
+        return BUCKETS - 1;
+    }
+    size_t sub = (value >> (exponent - 2)) - SUB_BUCKETS;
+    return SUB_BUCKETS + (exponent - 2) * SUB_BUCKETS + sub;
+}
+
+uint64_t Histogram::GetBucketUpperBound(size_t index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    size_t exponent = (index - SUB_BUCKETS) / SUB_BUCKETS + 2;
+    uint64_t sub = (index - SUB_BUCKETS) % SUB_BUCKETS;
+    return ((SUB_BUCKETS + sub + 1) << (exponent - 2)) - 1;
+}
+
+std::string_view GetRouteName(Route route) {
+    switch (route) {
+    case Route::join:
+        return "join"sv;
+    case Route::state:
+        return "state"sv;
+    case Route::players:
+        return "players"sv;
+    case Route::action:
+        return "action"sv;
+    case Route::tick:
+        return "tick"sv;
+    case Route::batch:
+        return "batch"sv;
+    case Route::records:
+        return "records"sv;
+    case Route::maps:
+        return "maps"sv;
+    case Route::static_files:
+        return "static"sv;
+    default:
+        return "other"sv;
+    }
+}
+
+Route GetRoute(std::string_view target) {
+    if (!target.starts_with("/api/"sv)) {
+        return Route::static_files;
+    }
+    target = target.substr(0, target.find('?'));
+
+    if (target.starts_with("/api/v1/maps"sv)) {
+        return Route::maps;
+    }
+    if (target == "/api/v1/game/join"sv) {
+        return Route::join;
+    }
+    if (target == "/api/v1/game/state"sv) {
+        return Route::state;
+    }
+    if (target == "/api/v1/game/players"sv) {
+        return Route::players;
+    }
+    if (target == "/api/v1/game/player/action"sv) {
+        return Route::action;
+    }
+    if (target == "/api/v1/game/tick"sv) {
+        return Route::tick;
+    }
+    if (target == "/api/v1/game/batch"sv) {
+        return Route::batch;
+    }
+    if (target == "/api/v1/game/records"sv) {
+        return Route::records;
+    }
+    return Route::other;
+}
+
+Registry& Registry::GetInstance() {
+    static Registry registry;
+    return registry;
+}
+
+void Registry::RecordRequest(Route route, unsigned status, std::chrono::steady_clock::duration duration) {
+    size_t index = static_cast<size_t>(route);
+    size_t status_class = std::clamp<size_t>(status / 100, 1, STATUS_CLASSES) - 1;
+    request_duration_[index].Record(duration);
+    requests_[index][status_class].Add();
+}
+
+void Registry::SetPlayersOnMap(std::string_view map, int64_t players) {
+    std::lock_guard lock{players_mutex_};
+    players_on_map_[std::string{map}] = players;
+}
+
+std::string Registry::RenderPrometheus() const {
+    std::ostringstream out;
+
+    WriteHeader(out, "game_http_requests_total"sv, "counter"sv, "HTTP requests by route and status class"sv);
+    for (size_t r = 0; r < ROUTES; ++r) {
+        for (size_t s = 0; s < STATUS_CLASSES; ++s) {
+            uint64_t value = requests_[r][s].Get();
+            if (value == 0) {
+                continue;
+            }
+            out << "game_http_requests_total{route=\""sv << GetRouteName(static_cast<Route>(r))
+                << "\",code=\""sv << s + 1 << "xx\"} "sv << value << '\n';
+        }
+    }
+
+    WriteHeader(out, "game_http_request_duration_seconds"sv, "histogram"sv, "HTTP request latency by route"sv);
+    for (size_t r = 0; r < ROUTES; ++r) {
+        std::string labels = "route=\""s + std::string{GetRouteName(static_cast<Route>(r))} + "\""s;
+        WriteHistogram(out, "game_http_request_duration_seconds"sv, labels, request_duration_[r]);
+    }
+
+    WriteGauge(out, "game_sessions"sv, "Number of game sessions"sv, sessions);
+    WriteGauge(out, "game_sessions_hibernating"sv, "Game sessions skipped by ticks because nobody moves"sv,
+               hibernating_sessions);
+
+    WriteHeader(out, "game_players"sv, "gauge"sv, "Players per map"sv);
+    {
+        std::lock_guard lock{players_mutex_};
+        for (const auto& [map, players] : players_on_map_) {
+            out << "game_players{map=\""sv << map << "\"} "sv << players << '\n';
+        }
+    }
+
+    WriteHeader(out, "game_strand_queue_depth"sv, "gauge"sv, "Handlers waiting on game strands"sv);
+    out << "game_strand_queue_depth{strand=\"tokens\"} "sv << tokens_strand_queue.Get() << '\n';
+    out << "game_strand_queue_depth{strand=\"sessions\"} "sv << sessions_strand_queue.Get() << '\n';
+    out << "game_strand_queue_depth{strand=\"session\"} "sv << session_strands_queue.Get() << '\n';
+
+    WriteHeader(out, "game_session_inbox_overflows_total"sv, "counter"sv,
+                "Move commands executed on the session strand because its inbox was full"sv);
+    out << "game_session_inbox_overflows_total "sv << session_inbox_overflows.Get() << '\n';
+
+    WriteGauge(out, "game_db_queue_length"sv, "Threads waiting for a database connection"sv, db_queue);
+
+    WriteHeader(out, "game_tick_duration_seconds"sv, "histogram"sv, "Game tick dispatch duration"sv);
+    WriteHistogram(out, "game_tick_duration_seconds"sv, ""sv, tick_duration);
+
+    WriteHeader(out, "game_tick_jitter_seconds"sv, "histogram"sv, "Delay of tick timer behind its schedule"sv);
+    WriteHistogram(out, "game_tick_jitter_seconds"sv, ""sv, tick_jitter);
+
+    WriteHeader(out, "game_tick_steps_total"sv, "counter"sv, "Simulation steps, long ticks are split into several"sv);
+    out << "game_tick_steps_total "sv << tick_steps.Get() << '\n';
+
+    WriteHeader(out, "game_tick_overruns_total"sv, "counter"sv, "Ticks that took longer than the tick period"sv);
+    out << "game_tick_overruns_total "sv << tick_overruns.Get() << '\n';
+
+    WriteHeader(out, "game_tick_dropped_milliseconds_total"sv, "counter"sv, "Game time dropped by the overrun policy"sv);
+    out << "game_tick_dropped_milliseconds_total "sv << tick_dropped_ms.Get() << '\n';
+
+    WriteGauge(out, "game_tick_drift_milliseconds"sv, "Lag of game time behind wall time"sv, tick_drift_ms);
+
+    WriteHeader(out, "game_session_tick_duration_seconds"sv, "histogram"sv, "Tick duration of one session"sv);
+    WriteHistogram(out, "game_session_tick_duration_seconds"sv, ""sv, session_tick_duration);
+
+    WriteHeader(out, "game_snapshot_duration_seconds"sv, "histogram"sv, "State snapshot write duration"sv);
+    WriteHistogram(out, "game_snapshot_duration_seconds"sv, ""sv, snapshot_duration);
+
+    std::lock_guard lock{collectors_mutex_};
+    for (const Collector& collector : collectors_) {
+        collector(out);
+    }
+
+    return out.str();
+}
+
+void Registry::AddCollector(Collector collector) {
+    std::lock_guard lock{collectors_mutex_};
+    collectors_.push_back(std::move(collector));
+}
+
+} // namespace metrics
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace metrics {
+
+namespace detail {
+
+const size_t SHARDS = 8;
+
+// Номер шарда для текущего потока: потоки пишут в разные кэш-линии
+size_t GetThreadShard();
+
+} // namespace detail
+
+class Counter {
+public:
+    void Add(uint64_t value = 1) {
+        shards_[detail::GetThreadShard()].value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    uint64_t Get() const;
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value = 0;
+    };
+    std::array<Shard, detail::SHARDS> shards_;
+};
+
+class Gauge {
+public:
+    void Add(int64_t value) {
+        value_.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    void Set(int64_t value) {
+        value_.store(value, std::memory_order_relaxed);
+    }
+
+    int64_t Get() const {
+        return value_.load(std::memory_order_relaxed);
+    }
+private:
+    std::atomic<int64_t> value_ = 0;
+};
+
+// Гистограмма с логарифмически-линейными корзинами (как в HdrHistogram):
+// на каждую степень двойки приходится SUB_BUCKETS корзин.
+// Значения в микросекундах
+class Histogram {
+public:
+    static constexpr size_t SUB_BUCKETS = 4;
+    static constexpr size_t MAX_EXPONENT = 40;
+    static constexpr size_t BUCKETS = SUB_BUCKETS + (MAX_EXPONENT - 1) * SUB_BUCKETS;
+
+    struct Snapshot {
+        std::array<uint64_t, BUCKETS> buckets{};
+        uint64_t sum = 0;
+        uint64_t count = 0;
+    };
+
+    void Record(uint64_t value);
+
+    void Record(std::chrono::steady_clock::duration duration) {
+        Record(static_cast<uint64_t>(
+                   std::chrono::duration_cast<std::chrono::microseconds>(duration).count()));
+    }
+
+    Snapshot GetSnapshot() const;
+
+    static size_t GetBucketIndex(uint64_t value);
+
+    // Наибольшее значение, попадающее в корзину
+    static uint64_t GetBucketUpperBound(size_t index);
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, BUCKETS> buckets{};
+        std::atomic<uint64_t> sum = 0;
+        std::atomic<uint64_t> count = 0;
+    };
+    std::array<Shard, detail::SHARDS> shards_;
+};
+
+enum class Route {
+    join,
+    state,
+    players,
+    action,
+    tick,
+    batch,
+    records,
+    maps,
+    static_files,
+    other,
+    count
+};
+
+std::string_view GetRouteName(Route route);
+
+Route GetRoute(std::string_view target);
+
+// Вывод в текстовом формате Prometheus
+void WriteHeader(std::ostream& out, std::string_view name, std::string_view type, std::string_view help);
+
+void WriteGauge(std::ostream& out, std::string_view name, std::string_view help, const Gauge& gauge);
+
+// labels - список меток без фигурных скобок, например route="join"
+void WriteHistogram(std::ostream& out, std::string_view name, std::string_view labels,
+                    const Histogram& histogram);
+
+class Registry {
+public:
+    // Дописывает в вывод метрики других модулей
+    using Collector = std::function<void(std::ostream&)>;
+
+    static Registry& GetInstance();
+
+    void AddCollector(Collector collector);
+
+    void RecordRequest(Route route, unsigned status, std::chrono::steady_clock::duration duration);
+
+    void SetPlayersOnMap(std::string_view map, int64_t players);
+
+    std::string RenderPrometheus() const;
+
+    Gauge sessions;
+    Gauge hibernating_sessions;
+    Gauge tokens_strand_queue;
+    Gauge sessions_strand_queue;
+    Gauge session_strands_queue;
+    Gauge db_queue;
+    // Команды, не поместившиеся во входящую очередь сессии
+    Counter session_inbox_overflows;
+
+    Histogram tick_duration;
+    // Опоздание срабатывания таймера тика
+    Histogram tick_jitter;
+    Counter tick_steps;
+    Counter tick_overruns;
+    Counter tick_dropped_ms;
+    Gauge tick_drift_ms;
+    Histogram session_tick_duration;
+    Histogram snapshot_duration;
+private:
+    Registry() = default;
+
+    static constexpr size_t ROUTES = static_cast<size_t>(Route::count);
+    // 1xx-5xx
+    static constexpr size_t STATUS_CLASSES = 5;
+
+    std::array<Histogram, ROUTES> request_duration_;
+    std::array<std::array<Counter, STATUS_CLASSES>, ROUTES> requests_;
+
+    mutable std::mutex players_mutex_;
+    std::unordered_map<std::string, int64_t> players_on_map_;
+
+    mutable std::mutex collectors_mutex_;
+    std::vector<Collector> collectors_;
+};
+
+} // namespace metrics
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string_view>
+#include <chrono>
+
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include "metrics.h"
+#include "request_tracer.h"
+#include "resp_maker.h"
+
+namespace metrics_handler {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+using namespace std::literals;
+
+const std::string_view metrics_path = "/metrics"sv;
+const std::string_view prometheus_content_type = "text/plain; version=0.0.4"sv;
+
+// Отдаёт /metrics и замеряет время обработки остальных запросов.
+// Стоит снаружи логирующего обработчика, чтобы опрос метрик не попадал в лог
+template <class RequestHandler>
+class MetricsRequestHandler {
+public:
+    MetricsRequestHandler(RequestHandler& request_handler)
+        : request_handler_(request_handler) {
+    }
+
+    template <typename Body, typename Allocator, typename Send>
+    void operator()(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send);
+
+private:
+    RequestHandler& request_handler_;
+};
+
+template <class RequestHandler>
+MetricsRequestHandler<RequestHandler> MakeHandler(RequestHandler& rh) {
+    return MetricsRequestHandler<RequestHandler>(rh);
+}
+
+} // namespace metrics_handler
+
+//===================================Templates implementation============================================
+
+namespace metrics_handler {
+
+template <class RequestHandler>
+template <typename Body, typename Allocator, typename Send>
+void MetricsRequestHandler<RequestHandler>::operator()(http::request<Body, http::basic_fields<Allocator>>&& req,
+                                                       Send&& send) {
+    using ReqType = http::request<Body, http::basic_fields<Allocator>>;
+
+    metrics::Registry& registry = metrics::Registry::GetInstance();
+
+    if (req.target() == metrics_path) {
+        resp_maker::detail::ResponseInfo info;
+        info.status = http::status::ok;
+        info.body = registry.RenderPrometheus();
+        info.content_type = prometheus_content_type;
+        info.no_cache = true;
+        send(resp_maker::detail::MakeTextResponse(req, info));
+        return;
+    }
+
+    metrics::Route route = metrics::GetRoute(req.target());
+    auto start = std::chrono::steady_clock::now();
+
+    // Трасса передаётся через strand'ы игры обёртками request_tracer::Hop
+    request_tracer::TracePtr trace = request_tracer::Tracer::GetInstance().StartTrace(metrics::GetRouteName(route));
+    request_tracer::CurrentScope scope{trace};
+
+    request_handler_(std::forward<ReqType>(req),
+                     [send = std::forward<Send>(send), route, start, trace, &registry](auto&& response) {
+        registry.RecordRequest(route, response.result_int(), std::chrono::steady_clock::now() - start);
+        if (trace) {
+            trace->Finish();
+        }
+        send(response);
+    });
+}
+
+} // namespace metrics_handler
@@ -4,6 +4,7 @@
 #include <vector>
 #include <deque>
 #include <optional>
+#include <stdexcept>
 
 #include "tagged.h"
 
@@ -69,6 +70,10 @@ struct GameConfig {
 struct MapConfig{
     double dog_speed = 0;
     size_t bag_capacity = 0;
+    // 0 - без ограничения
+    size_t max_players_per_session = 0;
+    // Радиус интереса для /state. 0 - игрок видит всю сессию
+    double interest_radius = 0;
 };
 
 class Road {
@@ -84,14 +89,18 @@ public:
     constexpr static HorizontalTag HORIZONTAL{};
     constexpr static VerticalTag VERTICAL{};
 
-    Road(HorizontalTag, Point start, Coord end_x) noexcept
+    // spawn_weight - во сколько раз чаще, чем на обычной дороге, на клетках этой дороги
+    // появляются собаки и лут
+    Road(HorizontalTag, Point start, Coord end_x, double spawn_weight = 1.) noexcept
         : start_{start}
-        , end_{end_x, start.y} {
+        , end_{end_x, start.y}
+        , spawn_weight_{spawn_weight} {
     }
 
-    Road(VerticalTag, Point start, Coord end_y) noexcept
+    Road(VerticalTag, Point start, Coord end_y, double spawn_weight = 1.) noexcept
         : start_{start}
-        , end_{start.x, end_y} {
+        , end_{start.x, end_y}
+        , spawn_weight_{spawn_weight} {
     }
 
     bool IsHorizontal() const noexcept {
@@ -110,9 +119,14 @@ public:
         return end_;
     }
 
+    double GetSpawnWeight() const noexcept {
+        return spawn_weight_;
+    }
+
 private:
     Point start_;
     Point end_;
+    double spawn_weight_;
 };
 
 class Building {
@@ -171,6 +185,8 @@ public:
         , dog_speed_(config.dog_speed)
         , defaultSpeed(config.dog_speed == 0)
         , bag_capacity_(config.bag_capacity)
+        , max_players_per_session_(config.max_players_per_session)
+        , interest_radius_(config.interest_radius)
     {}
 
     const Id& GetId() const noexcept {
@@ -228,6 +244,16 @@ public:
         throw std::logic_error("Bag capacity is not defined");
     }
 
+    // Когда сессия заполнена, для новых игроков создаётся ещё одна. 0 - без ограничения
+    size_t GetMaxPlayersPerSession() const {
+        return max_players_per_session_;
+    }
+
+    // Игрок получает в /state только собак и лут не дальше этого радиуса. 0 - всю сессию
+    double GetInterestRadius() const {
+        return interest_radius_;
+    }
+
     bool IsDefaultSpeed() const {
         return defaultSpeed;
     }
@@ -254,6 +280,8 @@ private:
     double dog_speed_;
     bool defaultSpeed;
     size_t bag_capacity_;
+    size_t max_players_per_session_;
+    double interest_radius_;
 };
 
 class MapInfo {
@@ -306,6 +334,10 @@ public:
         return retirement_time_;
     }
 
+    GameConfig GetConfig() const {
+        return {loot_config_, default_speed_, default_capacity_, retirement_time_};
+    }
+
 
 private:
     using MapIdHasher = util::TaggedHasher<Map::Id>;
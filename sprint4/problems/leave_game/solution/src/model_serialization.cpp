@@ -46,17 +46,27 @@ Road tag_invoke(json::value_to_tag<Road>&, const json::value& road) {
     int x0 = detail::GetInt(road, x0_key);
     int y0 = detail::GetInt(road, y0_key);
 
+    double spawn_weight = 1.;
+    if (const json::value* weight = road.as_object().if_contains(spawn_weight_key)) {
+        spawn_weight = weight->to_number<double>();
+        if (!(spawn_weight >= 0.)) {
+            throw std::invalid_argument("Road spawn weight must be non-negative");
+        }
+    }
+
     if (road.as_object().contains(x1_key)) {
         return Road {
             Road::HORIZONTAL,
             Point{x0, y0},
-            detail::GetInt(road, x1_key)
+            detail::GetInt(road, x1_key),
+            spawn_weight
         };
     }
     return model::Road {
         Road::VERTICAL,
         Point{x0, y0},
-        detail::GetInt(road, y1_key)
+        detail::GetInt(road, y1_key),
+        spawn_weight
     };
 
 }
@@ -120,6 +130,17 @@ Map tag_invoke(json::value_to_tag<Map>&, const json::value map) {
         config.bag_capacity = map.as_object().at(map_bag_capacity_key).as_uint64();
     }
 
+    if (map.as_object().contains(map_max_players_per_session_key)) {
+        config.max_players_per_session = map.as_object().at(map_max_players_per_session_key).as_uint64();
+    }
+
+    if (const json::value* radius = map.as_object().if_contains(map_interest_radius_key)) {
+        config.interest_radius = radius->to_number<double>();
+        if (!(config.interest_radius >= 0.)) {
+            throw std::invalid_argument("Map interest radius must be non-negative");
+        }
+    }
+
     Map result {
         detail::GetId<Map>(map),
         detail::StringFromJson(map.at(name_key).as_string()),
@@ -167,6 +188,9 @@ void tag_invoke (json::value_from_tag, json::value& jv, const Road& road) {
         {y0_key, road.GetStart().y},
         {end_coord_id, end_coor_val}
     };
+    if (road.GetSpawnWeight() != 1.) {
+        jv.as_object()[spawn_weight_key] = road.GetSpawnWeight();
+    }
 }
 
 void tag_invoke (json::value_from_tag, json::value& jv, const Building& building) {
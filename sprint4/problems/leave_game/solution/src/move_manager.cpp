@@ -1,5 +1,13 @@
 #include "move_manager.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <thread>
+
 namespace move_manager {
 
 size_t PointHasher::operator()(const model::Point& point) const {
@@ -66,172 +74,228 @@ const Area* Area::GetNeighbour(Direction dir) const {
     }
 }
 
-bool Area::IsIntersects(Coords coords, Direction dir, bool borders, bool other_axis) const {
-    double left_border   = base_.x - 0.4 - 0.1 * (l_ != nullptr || !borders);
-    double right_border  = base_.x + 0.4 + 0.1 * (r_ != nullptr || !borders);
-    double top_border    = base_.y - 0.4 - 0.1 * (u_ != nullptr || !borders);
-    double bottom_border = base_.y + 0.4 + 0.1 * (d_ != nullptr || !borders);
-
-    bool horizontal = (dir == Direction::EAST || dir == Direction::WEST) != other_axis;
-
-    if (dir == Direction::NONE) {
-        return left_border <= coords.x && coords.x <= right_border
-            && top_border  <= coords.y && coords.y <= bottom_border;
-    } else if (horizontal) {
-        return left_border <= coords.x && coords.x <= right_border;
-    } else {
-        return top_border  <= coords.y && coords.y <= bottom_border;
-    }
-}
-
-double Area::GetMaxCoor(Direction dir) const {
-    double max_delta = 0.4;
-    if (GetNeighbour(dir)) {
-        max_delta = 0.5;
-    }
-
-    switch (dir) {
-    case Direction::NORTH:
-        return base_.y - max_delta;
-    case Direction::EAST:
-        return base_.x + max_delta;
-    case Direction::SOUTH:
-        return base_.y + max_delta;
-    case Direction::WEST:
-        return base_.x - max_delta;
-    default:
-        throw std::logic_error("Area: NONE direction borders");
-    }
-}
-
-Coords Area::Place(Coords coor) const {
-    coor.x = std::clamp(coor.x, base_.x - 0.4 - 0.1 * (l_ != nullptr), base_.x + 0.4 + 0.1 * (r_ != nullptr));
-    coor.y = std::clamp(coor.y, base_.y - 0.4 - 0.1 * (u_ != nullptr), base_.y + 0.4 + 0.1 * (d_ != nullptr));
-    return coor;
-}
-
-void State::Move(uint64_t dur) {
-    Coords target_position;
-    target_position.x = position.coor.x + (speed.x_axis * dur) / 1000;
-    target_position.y = position.coor.y + (speed.y_axis * dur) / 1000;
-
-    while (!position.area->IsIntersects(target_position, Direction::NONE, false) && position.area->GetNeighbour(dir)) {
-        position.area = position.area->GetNeighbour(dir);
-    }
-
-    if (!position.area->IsIntersects(target_position, dir)) {
-        speed = {0.0, 0.0};
-        if (dir == Direction::NORTH || dir == Direction::SOUTH) {
-            position.coor.y = position.area->GetMaxCoor(dir);
-        } else {
-            position.coor.x = position.area->GetMaxCoor(dir);
-        }
-    } else {
-        if (!position.area->IsIntersects(target_position, dir, true, true)) {
-            target_position = position.area->Place(target_position);
-        }
-        position.coor = target_position;
-
-    }
-}
+namespace {
 
-void Map::AddRoad(const model::Road& road, AreaMap& area_map) {
+// Вызывает fn для каждой клетки дороги в порядке возрастания координаты
+template <typename Fn>
+void ForEachRoadPoint(const model::Road& road, Fn&& fn) {
     if (road.IsHorizontal()) {
         int y = road.GetStart().y;
         int x1 = std::min(road.GetStart().x, road.GetEnd().x);
         int x2 = std::max(road.GetStart().x, road.GetEnd().x);
         for (; x1 <= x2; x1++) {
-            AddArea({x1, y}, area_map);
+            fn(model::Point{x1, y});
         }
     } else {
         int x = road.GetStart().x;
         int y1 = std::min(road.GetStart().y, road.GetEnd().y);
         int y2 = std::max(road.GetStart().y, road.GetEnd().y);
         for (; y1 <= y2; y1++) {
-            AddArea({x, y1}, area_map);
+            fn(model::Point{x, y1});
         }
     }
 }
 
-Map::Map(const std::vector<model::Road>& roads) {
-    AreaMap areas;
+} // namespace
 
+AreaGraph BuildAreaGraph(const std::vector<model::Road>& roads) {
+    size_t max_points = 0;
     for (const model::Road& road : roads) {
-        AddRoad(road, areas);
+        model::Point start = road.GetStart();
+        model::Point end = road.GetEnd();
+        max_points += std::abs(end.x - start.x) + std::abs(end.y - start.y) + 1;
     }
-}
 
-PositionState Map::GetStartPlace() const {
-    const Area& area = areas_.at(0);
-    PositionState res;
-    res.coor.x = area.GetBase().x;
-    res.coor.y = area.GetBase().y;
-    res.area = &area;
+    AreaGraph graph;
+    graph.nodes.reserve(max_points);
 
-    return res;
+    std::unordered_map<model::Point, int32_t, PointHasher> index;
+    index.reserve(max_points);
+
+    const AreaGraph::Node empty_node{{}, {AreaGraph::NO_NEIGHBOUR, AreaGraph::NO_NEIGHBOUR,
+                                          AreaGraph::NO_NEIGHBOUR, AreaGraph::NO_NEIGHBOUR}};
+
+    for (const model::Road& road : roads) {
+        ForEachRoadPoint(road, [&](model::Point point) {
+            if (index.emplace(point, static_cast<int32_t>(graph.nodes.size())).second) {
+                graph.nodes.push_back(empty_node);
+                graph.nodes.back().base = point;
+            }
+        });
+    }
+
+    // Соседи ищутся после добавления всех клеток, поэтому связи получаются симметричными
+    const std::array<model::Offset, 4> offsets = {{{0, -1}, {1, 0}, {0, 1}, {-1, 0}}};
+
+    for (AreaGraph::Node& node : graph.nodes) {
+        for (size_t i = 0; i < offsets.size(); ++i) {
+            auto it = index.find({node.base.x + offsets[i].dx, node.base.y + offsets[i].dy});
+            if (it != index.end()) {
+                node.neighbours[i] = it->second;
+            }
+        }
+    }
+
+    return graph;
 }
 
-PositionState Map::GetRandomPlace() const {
-    const Area& random_area = GetRandomArea();
-    PositionState res;
-    res.coor = GetRandomOffset();
-    res.coor.x += random_area.GetBase().x;
-    res.coor.y += random_area.GetBase().y;
-    res.area = &random_area;
+std::vector<AreaGraph> BuildAreaGraphs(const model::Game::Maps& maps) {
+    std::vector<AreaGraph> graphs(maps.size());
+
+    std::atomic<size_t> next = 0;
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    auto worker = [&] {
+        for (size_t i = next++; i < maps.size(); i = next++) {
+            try {
+                graphs[i] = BuildAreaGraph(maps[i].GetRoads());
+            } catch (...) {
+                std::lock_guard lock{error_mutex};
+                error = std::current_exception();
+            }
+        }
+    };
 
-    return res;
+    size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), maps.size());
+    {
+        std::vector<std::jthread> workers;
+        for (size_t i = 1; i < threads; ++i) {
+            workers.emplace_back(worker);
+        }
+        worker();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return graphs;
 }
 
-void Map::AddArea (model::Point point, AreaMap& area_map) {
-    if (area_map.find(point) == area_map.end()) {
-        areas_.emplace_back(point);
-        area_map[point] = &areas_.back();
-        AddNeigbours(areas_.back(), area_map);
+AliasTable::AliasTable(const std::vector<double>& weights)
+    : probability_(weights.size())
+    , alias_(weights.size()) {
+    double total = 0;
+    for (double weight : weights) {
+        total += weight;
+    }
+
+    // Веса нормируются так, чтобы средний был равен 1. Каждая ячейка с весом меньше 1
+    // добирается до 1 за счёт ячейки с весом больше 1
+    std::vector<double> scaled(weights.size());
+    std::vector<uint32_t> small;
+    std::vector<uint32_t> large;
+    for (size_t i = 0; i < weights.size(); ++i) {
+        scaled[i] = weights[i] * weights.size() / total;
+        (scaled[i] < 1. ? small : large).push_back(i);
+    }
+
+    while (!small.empty() && !large.empty()) {
+        uint32_t less = small.back();
+        small.pop_back();
+        uint32_t more = large.back();
+
+        probability_[less] = scaled[less];
+        alias_[less] = more;
+        scaled[more] -= 1. - scaled[less];
+        if (scaled[more] < 1.) {
+            large.pop_back();
+            small.push_back(more);
+        }
+    }
+    // Остатки равны 1 с точностью до ошибок округления
+    for (uint32_t i : large) {
+        probability_[i] = 1.;
+        alias_[i] = i;
+    }
+    for (uint32_t i : small) {
+        probability_[i] = 1.;
+        alias_[i] = i;
     }
 }
 
-void Map::AddNeigbours(Area& area, AreaMap& area_map) {
-    model::Point coors = area.GetBase();
+Map::Map(const AreaGraph& graph, const std::vector<model::Road>& roads) {
+    for (size_t i = 0; i < graph.nodes.size(); ++i) {
+        areas_.emplace_back(graph.nodes[i].base, i);
+    }
 
-    auto u_it = area_map.find({coors.x, coors.y - 1});
-    auto r_it = area_map.find({coors.x + 1, coors.y});
-    auto d_it = area_map.find({coors.x, coors.y + 1});
-    auto l_it = area_map.find({coors.x - 1, coors.y});
-    auto end = area_map.end();
+    auto get_area = [this](int32_t index) -> Area* {
+        return index == AreaGraph::NO_NEIGHBOUR ? nullptr : &areas_.at(index);
+    };
+
+    for (size_t i = 0; i < graph.nodes.size(); ++i) {
+        const auto& neighbours = graph.nodes[i].neighbours;
+        Area& area = areas_[i];
+        area.SetUp(get_area(neighbours[0]));
+        area.SetRight(get_area(neighbours[1]));
+        area.SetDown(get_area(neighbours[2]));
+        area.SetLeft(get_area(neighbours[3]));
+    }
 
-    if (u_it != end) {
-        area.SetUp(u_it->second);
-        u_it->second->SetDown(&area);
+    if (areas_.empty()) {
+        return;
     }
 
-    if (r_it != end) {
-        area.SetRight(r_it->second);
-        r_it->second->SetLeft(&area);
+    model::Point min = areas_[0].GetBase();
+    model::Point max = min;
+    for (const Area& area : areas_) {
+        min = {std::min(min.x, area.GetBase().x), std::min(min.y, area.GetBase().y)};
+        max = {std::max(max.x, area.GetBase().x), std::max(max.y, area.GetBase().y)};
+    }
+    grid_origin_ = min;
+    grid_width_ = max.x - min.x + 1;
+    grid_height_ = max.y - min.y + 1;
+    grid_.assign(static_cast<size_t>(grid_width_) * grid_height_, NO_AREA);
+    for (const Area& area : areas_) {
+        model::Point base = area.GetBase();
+        grid_[static_cast<size_t>(base.y - min.y) * grid_width_ + (base.x - min.x)] = area.GetIndex();
     }
 
-    if (d_it != end) {
-        area.SetDown(d_it->second);
-        d_it->second->SetUp(&area);
+    // Клетка на пересечении дорог берёт наибольший из их весов
+    std::vector<double> weights(areas_.size(), 0.);
+    for (const model::Road& road : roads) {
+        ForEachRoadPoint(road, [&](model::Point point) {
+            const Area* area = FindArea({static_cast<double>(point.x), static_cast<double>(point.y)});
+            if (area) {
+                weights[area->GetIndex()] = std::max(weights[area->GetIndex()], road.GetSpawnWeight());
+            }
+        });
+    }
+    bool uniform = std::all_of(weights.begin(), weights.end(), [&weights](double weight) {
+        return weight == weights[0];
+    });
+    if (!roads.empty() && !uniform) {
+        spawn_table_ = AliasTable{weights};
     }
+}
 
-    if (l_it != end) {
-        area.SetLeft(l_it->second);
-        l_it->second->SetRight(&area);
+const Area* Map::FindArea(Coords coor) const {
+    double x = std::floor(fixed_point::ToDouble(coor.x) + 0.5) - grid_origin_.x;
+    double y = std::floor(fixed_point::ToDouble(coor.y) + 0.5) - grid_origin_.y;
+    if (!(x >= 0 && x < grid_width_ && y >= 0 && y < grid_height_)) {
+        return nullptr;
     }
+    int32_t index = grid_[static_cast<size_t>(y) * grid_width_ + static_cast<size_t>(x)];
+    return index == NO_AREA ? nullptr : &areas_[index];
 }
 
-const Area& Map::GetRandomArea() const {
-    std::random_device rd;
-    std::mt19937 generator = std::mt19937(rd());
-    std::uniform_int_distribution<int> dis{0, static_cast<int>(areas_.size() - 1)};
-    return areas_.at(dis(generator));
+void Map::PlaceCoors(std::vector<PositionState*>& positions) const {
+    for (PositionState* pos : positions) {
+        pos->area = FindArea(pos->coor);
+        if (!pos->area) {
+            throw std::out_of_range("Position is not on a road");
+        }
+    }
 }
 
-Coords Map::GetRandomOffset() const {
-    std::random_device rd;
-    std::mt19937 generator = std::mt19937(rd());
-    std::uniform_real_distribution<> dis(-0.4, 0.4);
-    return {dis(generator), dis(generator)};
+PositionState Map::GetStartPlace() const {
+    const Area& area = areas_.at(0);
+    PositionState res;
+    res.coor.x = area.GetBase().x;
+    res.coor.y = area.GetBase().y;
+    res.area = &area;
+
+    return res;
 }
 
 } // namespace move_manager
@@ -1,12 +1,17 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <deque>
 #include <optional>
 #include <unordered_map>
 #include <random>
+#include <stdexcept>
 #include <cassert>
 
 #include "model.h"
+#include "geom.h"
 
 namespace move_manager {
 
@@ -15,23 +20,30 @@ public:
     size_t operator()(const model::Point& point) const;
 };
 
-struct Coords {
-    double x;
-    double y;
-    bool operator==(const Coords&) const = default;
+// Ядро перемещения параметризовано типом координат S: double или fixed_point::Fixed.
+// Игра использует geom::Scalar
+template <typename S>
+struct BasicCoords {
+    S x;
+    S y;
+    bool operator==(const BasicCoords&) const = default;
 };
 
-struct Speed {
-    double x_axis = 0;
-    double y_axis = 0;
-    bool operator==(Speed other) const {
+template <typename S>
+struct BasicSpeed {
+    S x_axis = 0;
+    S y_axis = 0;
+    bool operator==(BasicSpeed other) const {
         return x_axis == other.x_axis && y_axis == other.y_axis;
     }
     bool IsNull() const {
-        return x_axis == 0 && y_axis == 0;
+        return x_axis == S{} && y_axis == S{};
     }
 };
 
+using Coords = BasicCoords<geom::Scalar>;
+using Speed = BasicSpeed<geom::Scalar>;
+
 enum class Direction {
     NORTH,
     EAST,
@@ -46,82 +58,263 @@ std::optional<Direction> GetDirectionFromString(std::string_view dir);
 
 class Area;
 
-struct MoveResult{
-    const Area* area;
-    Coords coords;
-};
-
 class Area{
 public:
-    Area(model::Point base) : base_(base) {}
+    Area(model::Point base, size_t index = 0) : base_(base), index_(index) {}
     void SetUp(Area* area) { u_ = area; }
     void SetRight(Area* area) { r_ = area; }
     void SetDown(Area* area) { d_ = area; }
     void SetLeft(Area* area) { l_ = area; }
 
     model::Point GetBase() const { return base_; }
+    // Номер клетки в карте, по нему заводятся данные о клетках
+    size_t GetIndex() const { return index_; }
     const Area* GetNeighbour(Direction dir) const;
-    bool IsIntersects(Coords coords, Direction dir, bool borders = true, bool other_axis = false) const;
-    double GetMaxCoor(Direction dir) const;
-    Coords Place(Coords coor) const;
+
+    template <typename S>
+    bool IsIntersects(BasicCoords<S> coords, Direction dir, bool borders = true, bool other_axis = false) const;
+
+    template <typename S>
+    S GetMaxCoor(Direction dir) const;
+
+    template <typename S>
+    BasicCoords<S> Place(BasicCoords<S> coor) const;
 
 private:
     model::Point base_;
+    size_t index_;
     Area* u_ = nullptr;
     Area* r_ = nullptr;
     Area* d_ = nullptr;
     Area* l_ = nullptr;
 };
 
-struct PositionState {
-    Coords coor;
+template <typename S>
+struct BasicPositionState {
+    BasicCoords<S> coor;
     const Area* area;
 };
 
-struct State{
-    Speed speed;
+template <typename S>
+struct BasicState {
+    BasicSpeed<S> speed;
     Direction dir = Direction::NORTH;
-    PositionState position;
+    BasicPositionState<S> position;
     void Move(uint64_t dur);
 };
 
+using PositionState = BasicPositionState<geom::Scalar>;
+using State = BasicState<geom::Scalar>;
+
+// Клетки дорог в порядке первого появления и индексы их соседей
+struct AreaGraph {
+    static constexpr int32_t NO_NEIGHBOUR = -1;
+
+    struct Node {
+        model::Point base;
+        // Соседи в порядке NORTH, EAST, SOUTH, WEST
+        std::array<int32_t, 4> neighbours;
+
+        bool operator==(const Node&) const = default;
+    };
+
+    std::vector<Node> nodes;
+
+    bool operator==(const AreaGraph&) const = default;
+};
+
+AreaGraph BuildAreaGraph(const std::vector<model::Road>& roads);
+
+// Строит графы всех карт параллельно, результат в порядке maps
+std::vector<AreaGraph> BuildAreaGraphs(const model::Game::Maps& maps);
+
+// Таблица псевдонимов Уолкера: выбор индекса с заданными весами за O(1)
+class AliasTable {
+public:
+    AliasTable() = default;
+
+    // Хотя бы один вес должен быть положительным
+    explicit AliasTable(const std::vector<double>& weights);
+
+    bool IsEmpty() const {
+        return probability_.empty();
+    }
+
+    template <typename Generator>
+    size_t Sample(Generator& generator) const;
+private:
+    // Вероятность оставить выпавший индекс, иначе берётся его псевдоним
+    std::vector<double> probability_;
+    std::vector<uint32_t> alias_;
+};
+
 class Map {
 public:
-    using AreaMap = std::unordered_map<model::Point, Area*, PointHasher>;
+    // Сколько раз GetRandomPlace ищет свободную клетку, прежде чем согласиться на занятую
+    static constexpr size_t MAX_PLACE_ATTEMPTS = 8;
 
     Map(const model::Map& map) : Map(map.GetRoads()) {}
 
-    Map(const std::vector<model::Road>& roads);
+    Map(const std::vector<model::Road>& roads) : Map(BuildAreaGraph(roads), roads) {}
+
+    // По roads берутся веса клеток для GetRandomPlace. Без них все клетки равновероятны
+    Map(const AreaGraph& graph, const std::vector<model::Road>& roads = {});
 
     PositionState GetStartPlace() const;
 
-    PositionState GetRandomPlace() const;
+    // Случайное место на дороге. Клетка выбирается за O(1) пропорционально весу её дороги
+    template <typename Generator>
+    PositionState GetRandomPlace(Generator& generator) const;
 
-    void PlaceCoors(std::vector<PositionState*>& positions) const {
-        std::unordered_map<model::Point, const Area*, PointHasher> point_to_area;
+    // То же, но клетки, для которых is_free(area) == false, пропускаются.
+    // После MAX_PLACE_ATTEMPTS попыток возвращается последнее выпавшее место
+    template <typename Generator, typename IsFree>
+    PositionState GetRandomPlace(Generator& generator, IsFree&& is_free) const;
 
-        for (const Area& area : areas_) {
-            point_to_area[area.GetBase()] = &area;
-        }
+    // Клетка, в которую попадает точка, или nullptr, если точка не на дороге
+    const Area* FindArea(Coords coor) const;
 
-        for (PositionState* pos : positions) {
-            model::Point point;
-            point.x = static_cast<int>(pos->coor.x + 0.5);
-            point.y = static_cast<int>(pos->coor.y + 0.5);
-            pos->area = point_to_area.at(point);
-        }
+    size_t GetAreasCount() const {
+        return areas_.size();
     }
+
+    // Бросает std::out_of_range, если какая-то позиция не на дороге
+    void PlaceCoors(std::vector<PositionState*>& positions) const;
 private:
-    void AddRoad (const model::Road& road, AreaMap& area_map);
+    static constexpr int32_t NO_AREA = -1;
 
-    void AddArea (model::Point point, AreaMap& area_map);
+    template <typename Generator>
+    const Area& GetRandomArea(Generator& generator) const;
 
-    void AddNeigbours(Area& area, AreaMap& area_map);
+    std::deque<Area> areas_;
+    // Плотная сетка охватывающего дороги прямоугольника: номер клетки или NO_AREA
+    model::Point grid_origin_{0, 0};
+    int grid_width_ = 0;
+    int grid_height_ = 0;
+    std::vector<int32_t> grid_;
+    // Пусто, если все клетки равновероятны
+    AliasTable spawn_table_;
+};
 
-    const Area& GetRandomArea() const;
+//===================================Templates implementation============================================
 
-    Coords GetRandomOffset() const;
+// Границы клетки: дорога шириной 0.8, у соседей - до середины стыка.
+// Выражения одинаковы для double и Fixed, чтобы double-режим считал как раньше
+template <typename S>
+bool Area::IsIntersects(BasicCoords<S> coords, Direction dir, bool borders, bool other_axis) const {
+    const S half_road = 0.4;
+    const S joint = 0.1;
+    S left_border   = S(base_.x) - half_road - joint * (l_ != nullptr || !borders);
+    S right_border  = S(base_.x) + half_road + joint * (r_ != nullptr || !borders);
+    S top_border    = S(base_.y) - half_road - joint * (u_ != nullptr || !borders);
+    S bottom_border = S(base_.y) + half_road + joint * (d_ != nullptr || !borders);
 
-    std::deque<Area> areas_;
-};
+    bool horizontal = (dir == Direction::EAST || dir == Direction::WEST) != other_axis;
+
+    if (dir == Direction::NONE) {
+        return left_border <= coords.x && coords.x <= right_border
+            && top_border  <= coords.y && coords.y <= bottom_border;
+    } else if (horizontal) {
+        return left_border <= coords.x && coords.x <= right_border;
+    } else {
+        return top_border  <= coords.y && coords.y <= bottom_border;
+    }
+}
+
+template <typename S>
+S Area::GetMaxCoor(Direction dir) const {
+    S max_delta = 0.4;
+    if (GetNeighbour(dir)) {
+        max_delta = 0.5;
+    }
+
+    switch (dir) {
+    case Direction::NORTH:
+        return S(base_.y) - max_delta;
+    case Direction::EAST:
+        return S(base_.x) + max_delta;
+    case Direction::SOUTH:
+        return S(base_.y) + max_delta;
+    case Direction::WEST:
+        return S(base_.x) - max_delta;
+    default:
+        throw std::logic_error("Area: NONE direction borders");
+    }
+}
+
+template <typename S>
+BasicCoords<S> Area::Place(BasicCoords<S> coor) const {
+    const S half_road = 0.4;
+    const S joint = 0.1;
+    coor.x = std::clamp<S>(coor.x, S(base_.x) - half_road - joint * (l_ != nullptr),
+                           S(base_.x) + half_road + joint * (r_ != nullptr));
+    coor.y = std::clamp<S>(coor.y, S(base_.y) - half_road - joint * (u_ != nullptr),
+                           S(base_.y) + half_road + joint * (d_ != nullptr));
+    return coor;
+}
+
+template <typename S>
+void BasicState<S>::Move(uint64_t dur) {
+    BasicCoords<S> target_position;
+    target_position.x = position.coor.x + (speed.x_axis * dur) / 1000;
+    target_position.y = position.coor.y + (speed.y_axis * dur) / 1000;
+
+    while (!position.area->IsIntersects(target_position, Direction::NONE, false) && position.area->GetNeighbour(dir)) {
+        position.area = position.area->GetNeighbour(dir);
+    }
+
+    if (!position.area->IsIntersects(target_position, dir)) {
+        speed = {0, 0};
+        if (dir == Direction::NORTH || dir == Direction::SOUTH) {
+            position.coor.y = position.area->template GetMaxCoor<S>(dir);
+        } else {
+            position.coor.x = position.area->template GetMaxCoor<S>(dir);
+        }
+    } else {
+        if (!position.area->IsIntersects(target_position, dir, true, true)) {
+            target_position = position.area->Place(target_position);
+        }
+        position.coor = target_position;
+
+    }
+}
+
+template <typename Generator>
+size_t AliasTable::Sample(Generator& generator) const {
+    std::uniform_int_distribution<size_t> index_dis{0, probability_.size() - 1};
+    std::uniform_real_distribution<double> coin_dis{0., 1.};
+    size_t index = index_dis(generator);
+    return coin_dis(generator) < probability_[index] ? index : alias_[index];
+}
+
+template <typename Generator>
+const Area& Map::GetRandomArea(Generator& generator) const {
+    if (!spawn_table_.IsEmpty()) {
+        return areas_[spawn_table_.Sample(generator)];
+    }
+    std::uniform_int_distribution<size_t> dis{0, areas_.size() - 1};
+    return areas_[dis(generator)];
+}
+
+template <typename Generator>
+PositionState Map::GetRandomPlace(Generator& generator) const {
+    return GetRandomPlace(generator, [](const Area&) {
+        return true;
+    });
+}
+
+template <typename Generator, typename IsFree>
+PositionState Map::GetRandomPlace(Generator& generator, IsFree&& is_free) const {
+    const Area* area = &GetRandomArea(generator);
+    for (size_t attempt = 1; attempt < MAX_PLACE_ATTEMPTS && !is_free(*area); ++attempt) {
+        area = &GetRandomArea(generator);
+    }
+
+    std::uniform_real_distribution<> dis(-0.4, 0.4);
+    PositionState res;
+    res.coor.x = area->GetBase().x + dis(generator);
+    res.coor.y = area->GetBase().y + dis(generator);
+    res.area = area;
+    return res;
+}
 } // namespace move_manager
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+
+namespace mpsc_ring {
+
+// Ограниченная очередь без блокировок: много производителей, один потребитель.
+// Каждая ячейка хранит номер последовательности, по которому производитель
+// понимает, свободна ли ячейка, а потребитель - записана ли она (схема Вьюкова).
+// Ёмкость должна быть степенью двойки
+template <typename T>
+class MpscRing {
+public:
+    explicit MpscRing(size_t capacity)
+        : capacity_(capacity)
+        , mask_(capacity - 1)
+        , cells_(std::make_unique<Cell[]>(capacity)) {
+        if (capacity < 2 || (capacity & mask_) != 0) {
+            throw std::invalid_argument("MpscRing capacity must be a power of two");
+        }
+        for (size_t i = 0; i < capacity_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    // fill вызывается с ссылкой на ячейку и заполняет её на месте
+    template <typename Fill>
+    bool TryPushWith(Fill&& fill) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        Cell* cell;
+
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+
+        fill(cell->value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPush(const T& value) {
+        return TryPushWith([&value](T& cell) { cell = value; });
+    }
+
+    // Вызывать только из потока-потребителя
+    template <typename Consume>
+    bool TryPopWith(Consume&& consume) {
+        Cell& cell = cells_[head_ & mask_];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+
+        if (seq != head_ + 1) {
+            return false;
+        }
+
+        consume(cell.value);
+        cell.sequence.store(head_ + capacity_, std::memory_order_release);
+        ++head_;
+        return true;
+    }
+
+    bool TryPop(T& value) {
+        return TryPopWith([&value](T& cell) { value = std::move(cell); });
+    }
+
+    size_t Capacity() const {
+        return capacity_;
+    }
+
+    // Приблизительный размер, пригоден только для метрик
+    size_t ApproxSize() const {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_seen_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    // Потребитель публикует свою позицию для ApproxSize
+    void PublishHead() {
+        head_seen_.store(head_, std::memory_order_relaxed);
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+
+    alignas(64) std::atomic<size_t> tail_ = 0;
+    alignas(64) size_t head_ = 0;
+    std::atomic<size_t> head_seen_ = 0;
+};
+
+} // namespace mpsc_ring
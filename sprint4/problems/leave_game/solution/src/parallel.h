@@ -0,0 +1,81 @@
+#pragma once
+
+#include <boost/asio/post.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+
+namespace parallel {
+
+// Выполняет task(i) для всех i из [0, count) и возвращается, когда все задачи выполнены.
+// В executor отправляются helpers помощников, но задачи разбирает и вызывающий поток,
+// поэтому он не ждёт свободных потоков executor'а - только помощников, уже взявших задачу.
+// Так вызов из обработчика io_context не блокируется, даже если все его потоки заняты.
+// Первое исключение из task пробрасывается вызывающему после завершения всех взятых задач,
+// оставшиеся задачи после него не выполняются
+template <class Executor, class Task>
+void For(const Executor& executor, size_t count, size_t helpers, const Task& task);
+
+//===================================Templates implementation============================================
+
+template <class Executor, class Task>
+void For(const Executor& executor, size_t count, size_t helpers, const Task& task) {
+    struct State {
+        std::atomic<size_t> next = 0;
+        std::atomic<size_t> done = 0;
+        std::atomic<bool> failed = false;
+        // Пишется только первым упавшим, читается вызывающим после done == count
+        std::exception_ptr error;
+        size_t count = 0;
+        const Task* task = nullptr;
+
+        // Помощник, пришедший после разбора всех задач, к task не обращается.
+        // Задача считается выполненной и при исключении, иначе вызывающий не дождётся
+        // помощников и уйдёт, пока они ещё обращаются к task
+        void Work() {
+            for (size_t i = next++; i < count; i = next++) {
+                if (!failed.load(std::memory_order_relaxed)) {
+                    try {
+                        (*task)(i);
+                    } catch (...) {
+                        if (!failed.exchange(true, std::memory_order_relaxed)) {
+                            error = std::current_exception();
+                        }
+                    }
+                }
+                if (done.fetch_add(1, std::memory_order_acq_rel) + 1 == count) {
+                    done.notify_all();
+                }
+            }
+        }
+    };
+
+    if (count == 0) {
+        return;
+    }
+    // Помощники переживают вызов, если их очередь подошла позже
+    auto state = std::make_shared<State>();
+    state->count = count;
+    state->task = &task;
+
+    for (size_t i = 0; i < std::min(helpers, count - 1); ++i) {
+        boost::asio::post(executor, [state] {
+            state->Work();
+        });
+    }
+    state->Work();
+
+    for (size_t done = state->done.load(std::memory_order_acquire); done != count;
+         done = state->done.load(std::memory_order_acquire)) {
+        state->done.wait(done, std::memory_order_acquire);
+    }
+
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+} // namespace parallel
@@ -0,0 +1,129 @@
+#include "request_tracer.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace request_tracer {
+
+using namespace std::literals;
+
+namespace detail {
+
+thread_local TracePtr current_trace;
+
+chrome_trace::TraceEvent MakeEvent(uint32_t trace_id, std::string_view name, std::string_view category,
+                                   chrome_trace::Clock::time_point start, chrome_trace::Clock::time_point end) {
+    chrome_trace::TraceEvent event;
+    event.name = name;
+    event.category = category;
+    event.ts = chrome_trace::GetTimestamp(start);
+    event.dur = chrome_trace::GetTimestamp(end) - event.ts;
+    // Каждая трасса выводится отдельной строкой
+    event.tid = trace_id;
+    event.args[0] = {"trace"sv, trace_id};
+    event.args[1] = {"thread"sv, chrome_trace::GetThreadId()};
+    return event;
+}
+
+} // namespace detail
+
+std::string_view GetStageName(Stage stage) {
+    switch (stage) {
+    case Stage::tokens:
+        return "tokens_strand"sv;
+    case Stage::sessions:
+        return "sessions_strand"sv;
+    case Stage::session:
+        return "session_strand"sv;
+    }
+    return "unknown"sv;
+}
+
+std::string_view GetQueueName(Stage stage) {
+    switch (stage) {
+    case Stage::tokens:
+        return "tokens_strand queue"sv;
+    case Stage::sessions:
+        return "sessions_strand queue"sv;
+    case Stage::session:
+        return "session_strand queue"sv;
+    }
+    return "unknown queue"sv;
+}
+
+Trace::Trace(uint32_t id, std::string_view name)
+    : id_(id)
+    , name_(name)
+    , start_(chrome_trace::Clock::now()) {
+}
+
+Trace::~Trace() {
+    Tracer::GetInstance().Write(events_);
+}
+
+void Trace::AddHop(Stage stage, chrome_trace::Clock::time_point enqueued,
+                   chrome_trace::Clock::time_point started, chrome_trace::Clock::time_point finished) {
+    std::lock_guard lock{mutex_};
+    events_.push_back(detail::MakeEvent(id_, GetQueueName(stage), "queue"sv, enqueued, started));
+    events_.push_back(detail::MakeEvent(id_, GetStageName(stage), "work"sv, started, finished));
+}
+
+void Trace::Finish() {
+    std::lock_guard lock{mutex_};
+    events_.push_back(detail::MakeEvent(id_, name_, "request"sv, start_, chrome_trace::Clock::now()));
+}
+
+TracePtr GetCurrent() {
+    return detail::current_trace;
+}
+
+CurrentScope::CurrentScope(TracePtr trace)
+    : previous_(std::exchange(detail::current_trace, std::move(trace))) {
+}
+
+CurrentScope::~CurrentScope() {
+    detail::current_trace = std::move(previous_);
+}
+
+Tracer& Tracer::GetInstance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+void Tracer::Enable(const std::filesystem::path& file, uint64_t sample_rate) {
+    std::lock_guard lock{out_mutex_};
+
+    out_.open(file);
+    if (!out_) {
+        throw std::runtime_error("Failed to open request trace file " + file.string());
+    }
+    out_ << "[\n"sv;
+
+    sample_rate_ = std::max<uint64_t>(sample_rate, 1);
+    enabled_ = true;
+}
+
+TracePtr Tracer::StartTrace(std::string_view name) {
+    if (!enabled_.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    if (counter_.fetch_add(1, std::memory_order_relaxed) % sample_rate_ != 0) {
+        return nullptr;
+    }
+    return std::make_shared<Trace>(next_id_.fetch_add(1, std::memory_order_relaxed), name);
+}
+
+void Tracer::Write(const std::vector<chrome_trace::TraceEvent>& events) {
+    std::lock_guard lock{out_mutex_};
+    if (!out_.is_open()) {
+        return;
+    }
+    for (const chrome_trace::TraceEvent& event : events) {
+        chrome_trace::WriteEvent(out_, event);
+        out_ << ",\n"sv;
+    }
+    out_.flush();
+}
+
+} // namespace request_tracer
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "chrome_trace.h"
+
+namespace request_tracer {
+
+// Strand'ы, через которые проходит запрос
+enum class Stage {
+    tokens,
+    sessions,
+    session
+};
+
+std::string_view GetStageName(Stage stage);
+
+std::string_view GetQueueName(Stage stage);
+
+// Трасса одного запроса: для каждого перехода между strand'ами хранится
+// время ожидания в очереди и время работы обработчика.
+// Ответ может быть отправлен раньше, чем завершатся внешние обработчики,
+// поэтому трасса пишется в файл, когда на неё не остаётся ссылок
+class Trace {
+public:
+    Trace(uint32_t id, std::string_view name);
+    ~Trace();
+
+    Trace(const Trace&) = delete;
+    Trace& operator=(const Trace&) = delete;
+
+    uint32_t GetId() const {
+        return id_;
+    }
+
+    void AddHop(Stage stage, chrome_trace::Clock::time_point enqueued,
+                chrome_trace::Clock::time_point started, chrome_trace::Clock::time_point finished);
+
+    // Отмечает момент отправки ответа
+    void Finish();
+private:
+    uint32_t id_;
+    std::string_view name_;
+    chrome_trace::Clock::time_point start_;
+
+    // Переходы могут завершаться в разных потоках одновременно
+    std::mutex mutex_;
+    std::vector<chrome_trace::TraceEvent> events_;
+};
+
+using TracePtr = std::shared_ptr<Trace>;
+
+// Трасса, в контексте которой выполняется текущий поток
+TracePtr GetCurrent();
+
+// Устанавливает текущую трассу потока на время жизни объекта
+class CurrentScope {
+public:
+    explicit CurrentScope(TracePtr trace);
+    ~CurrentScope();
+
+    CurrentScope(const CurrentScope&) = delete;
+    CurrentScope& operator=(const CurrentScope&) = delete;
+private:
+    TracePtr previous_;
+};
+
+// Пишет каждую sample_rate-ю трассу в файл в формате Chrome trace (JSON Array Format,
+// закрывающая скобка не обязательна, поэтому файл можно открыть в любой момент)
+class Tracer {
+public:
+    static Tracer& GetInstance();
+
+    void Enable(const std::filesystem::path& file, uint64_t sample_rate);
+
+    // nullptr, если трасса не попала в выборку
+    TracePtr StartTrace(std::string_view name);
+
+    void Write(const std::vector<chrome_trace::TraceEvent>& events);
+private:
+    Tracer() = default;
+
+    std::atomic<bool> enabled_ = false;
+    uint64_t sample_rate_ = 1;
+    std::atomic<uint64_t> counter_ = 0;
+    std::atomic<uint32_t> next_id_ = 1;
+
+    std::mutex out_mutex_;
+    std::ofstream out_;
+};
+
+// Оборачивает обработчик, отправляемый в strand: запоминает момент постановки в очередь
+// и восстанавливает текущую трассу в потоке, где обработчик будет выполнен.
+// Вне трассы обработчик вызывается как есть
+template <class Handler>
+auto Hop(Stage stage, Handler&& handler);
+
+} // namespace request_tracer
+
+//===================================Templates implementation============================================
+
+namespace request_tracer {
+
+template <class Handler>
+auto Hop(Stage stage, Handler&& handler) {
+    TracePtr trace = GetCurrent();
+    chrome_trace::Clock::time_point enqueued;
+    if (trace) {
+        enqueued = chrome_trace::Clock::now();
+    }
+
+    return [stage, enqueued, trace = std::move(trace), handler = std::forward<Handler>(handler)]
+           (auto&&... args) mutable {
+        if (!trace) {
+            return handler(std::forward<decltype(args)>(args)...);
+        }
+
+        auto started = chrome_trace::Clock::now();
+        {
+            CurrentScope scope{trace};
+            handler(std::forward<decltype(args)>(args)...);
+        }
+        trace->AddHop(stage, enqueued, started, chrome_trace::Clock::now());
+    };
+}
+
+} // namespace request_tracer
@@ -0,0 +1,275 @@
+#include "router.h"
+
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/strand.hpp>
+
+extern char** environ;
+
+namespace router {
+
+using namespace std::literals;
+
+namespace detail {
+
+std::vector<std::string_view> Split(std::string_view spec, char delimiter) {
+    std::vector<std::string_view> result;
+    while (!spec.empty()) {
+        size_t pos = spec.find(delimiter);
+        result.push_back(spec.substr(0, pos));
+        if (pos == std::string_view::npos) {
+            break;
+        }
+        spec.remove_prefix(pos + 1);
+    }
+    return result;
+}
+
+template <typename Number>
+Number ParseNumber(std::string_view str, std::string_view what) {
+    Number result{};
+    auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), result);
+    if (ec != std::errc{} || ptr != str.data() + str.size()) {
+        throw std::invalid_argument("Invalid "s + std::string{what} + ": "s + std::string{str});
+    }
+    return result;
+}
+
+// Один обмен запрос-ответ с воркером. Если переиспользованное соединение оказалось
+// закрыто воркером, запрос повторяется один раз на новом соединении. После отправки
+// повторяются только GET и HEAD: POST мог быть уже выполнен воркером
+// (например, join создал бы второго игрока), и на него отвечают ошибкой
+class Exchange : public std::enable_shared_from_this<Exchange> {
+public:
+    Exchange(WorkerClient& client, WorkerClient::Request&& request, WorkerClient::Handler&& handler)
+        : client_(client)
+        , request_(std::move(request))
+        , handler_(std::move(handler)) {
+    }
+
+    void Run() {
+        if (auto stream = client_.TakeConnection()) {
+            stream_.emplace(std::move(*stream));
+            reused_ = true;
+            return Write();
+        }
+        Connect();
+    }
+private:
+    void Connect() {
+        reused_ = false;
+        stream_.emplace(net::make_strand(client_.GetContext()));
+        stream_->expires_after(WORKER_TIMEOUT);
+        stream_->async_connect(client_.GetEndpoint(), [self = shared_from_this()](sys::error_code ec) {
+            if (ec) {
+                return self->Finish(ec);
+            }
+            self->Write();
+        });
+    }
+
+    void Write() {
+        stream_->expires_after(WORKER_TIMEOUT);
+        http::async_write(*stream_, request_, [self = shared_from_this()](sys::error_code ec, size_t) {
+            if (ec) {
+                return self->Retry(ec, false);
+            }
+            self->Read();
+        });
+    }
+
+    void Read() {
+        response_ = {};
+        buffer_.clear();
+        http::async_read(*stream_, buffer_, response_, [self = shared_from_this()](sys::error_code ec, size_t) {
+            if (ec) {
+                return self->Retry(ec, true);
+            }
+            self->Finish(ec);
+        });
+    }
+
+    void Retry(sys::error_code ec, bool written) {
+        if (!reused_ || (written && !IsIdempotent())) {
+            return Finish(ec);
+        }
+        Connect();
+    }
+
+    bool IsIdempotent() const {
+        return request_.method() == http::verb::get || request_.method() == http::verb::head;
+    }
+
+    void Finish(sys::error_code ec) {
+        if (!ec && response_.keep_alive()) {
+            stream_->expires_never();
+            client_.ReturnConnection(std::move(*stream_));
+        }
+        handler_(ec, std::move(response_));
+    }
+
+    WorkerClient& client_;
+    WorkerClient::Request request_;
+    WorkerClient::Handler handler_;
+
+    std::optional<beast::tcp_stream> stream_;
+    bool reused_ = false;
+    beast::flat_buffer buffer_;
+    WorkerClient::Response response_;
+};
+
+} // namespace detail
+
+std::string MakeTokenPrefix(size_t shard) {
+    if (shard >= MAX_SHARDS) {
+        throw std::invalid_argument("Shard id must be less than "s + std::to_string(MAX_SHARDS));
+    }
+
+    char prefix[TOKEN_PREFIX_SIZE + 1];
+    std::snprintf(prefix, sizeof(prefix), "%02zx", shard);
+    return std::string{prefix, TOKEN_PREFIX_SIZE};
+}
+
+std::optional<size_t> GetTokenShard(std::string_view token) {
+    if (token.size() < TOKEN_PREFIX_SIZE) {
+        return std::nullopt;
+    }
+
+    size_t shard = 0;
+    auto [ptr, ec] = std::from_chars(token.data(), token.data() + TOKEN_PREFIX_SIZE, shard, 16);
+    if (ec != std::errc{} || ptr != token.data() + TOKEN_PREFIX_SIZE) {
+        return std::nullopt;
+    }
+    return shard;
+}
+
+std::unordered_map<std::string, size_t> ParseMapShards(std::string_view spec) {
+    std::unordered_map<std::string, size_t> result;
+
+    for (std::string_view item : detail::Split(spec, ',')) {
+        size_t pos = item.find('=');
+        if (pos == 0 || pos == std::string_view::npos) {
+            throw std::invalid_argument("Invalid map shard: "s + std::string{item});
+        }
+        result[std::string{item.substr(0, pos)}] = detail::ParseNumber<size_t>(item.substr(pos + 1), "shard id"sv);
+    }
+
+    return result;
+}
+
+std::vector<uint16_t> ParsePorts(std::string_view spec) {
+    std::vector<uint16_t> result;
+
+    for (std::string_view item : detail::Split(spec, ',')) {
+        result.push_back(detail::ParseNumber<uint16_t>(item, "port"sv));
+    }
+
+    return result;
+}
+
+MapAssignment::MapAssignment(size_t shards, std::unordered_map<std::string, size_t> fixed)
+    : shards_(std::move(fixed))
+    , joins_(shards, 0) {
+    for (const auto& [map_id, shard] : shards_) {
+        if (shard >= shards) {
+            throw std::invalid_argument("Map "s + map_id + " is assigned to unknown shard "s + std::to_string(shard));
+        }
+    }
+}
+
+size_t MapAssignment::Join(const std::string& map_id) {
+    std::lock_guard lock{mutex_};
+
+    auto it = shards_.find(map_id);
+    if (it == shards_.end()) {
+        size_t fewest_joins = std::min_element(joins_.begin(), joins_.end()) - joins_.begin();
+        it = shards_.emplace(map_id, fewest_joins).first;
+    }
+
+    ++joins_[it->second];
+    return it->second;
+}
+
+void WorkerClient::Forward(Request&& request, Handler handler) {
+    std::make_shared<detail::Exchange>(*this, std::move(request), std::move(handler))->Run();
+}
+
+std::optional<beast::tcp_stream> WorkerClient::TakeConnection() {
+    std::lock_guard lock{mutex_};
+
+    if (idle_.empty()) {
+        return std::nullopt;
+    }
+
+    beast::tcp_stream stream = std::move(idle_.back());
+    idle_.pop_back();
+    return stream;
+}
+
+void WorkerClient::ReturnConnection(beast::tcp_stream&& stream) {
+    std::lock_guard lock{mutex_};
+
+    if (idle_.size() < MAX_IDLE) {
+        idle_.push_back(std::move(stream));
+    }
+}
+
+pid_t SpawnWorker(const std::vector<std::string>& args) {
+    static const char* const self_path = "/proc/self/exe";
+
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(self_path));
+    for (const std::string& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid;
+    int error = ::posix_spawn(&pid, self_path, nullptr, nullptr, argv.data(), environ);
+    if (error != 0) {
+        throw sys::system_error(error, sys::system_category(), "posix_spawn");
+    }
+    return pid;
+}
+
+void StopWorkers(const std::vector<pid_t>& workers) {
+    for (pid_t pid : workers) {
+        ::kill(pid, SIGTERM);
+    }
+
+    for (pid_t pid : workers) {
+        while (::waitpid(pid, nullptr, 0) < 0 && errno == EINTR) {
+        }
+    }
+}
+
+void WaitForWorker(const tcp::endpoint& endpoint, std::chrono::milliseconds timeout) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    net::io_context ioc;
+    while (true) {
+        tcp::socket socket(ioc);
+        sys::error_code ec;
+        socket.connect(endpoint, ec);
+        if (!ec) {
+            return;
+        }
+
+        if (std::chrono::steady_clock::now() >= deadline) {
+            throw std::runtime_error("Worker on port "s + std::to_string(endpoint.port()) + " has not started"s);
+        }
+        std::this_thread::sleep_for(100ms);
+    }
+}
+
+} // namespace router
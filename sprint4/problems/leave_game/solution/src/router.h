@@ -0,0 +1,112 @@
+#pragma once
+
+#include "http_server.h"
+
+#include <sys/types.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Режим маршрутизатора: карты распределяются между процессами-воркерами на localhost.
+// Пересылку запросов выполняет routing_handler::RoutingRequestHandler
+namespace router {
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace sys = boost::system;
+using tcp = net::ip::tcp;
+
+// Номер воркера записывается в начало токена двумя шестнадцатеричными цифрами
+const size_t MAX_SHARDS = 256;
+const size_t TOKEN_PREFIX_SIZE = 2;
+
+const std::chrono::seconds WORKER_TIMEOUT{10};
+
+std::string MakeTokenPrefix(size_t shard);
+
+std::optional<size_t> GetTokenShard(std::string_view token);
+
+// Разбирает "map1=0,map2=1"
+std::unordered_map<std::string, size_t> ParseMapShards(std::string_view spec);
+
+// Разбирает "8081,8082"
+std::vector<uint16_t> ParsePorts(std::string_view spec);
+
+// Закрепление карт за воркерами. Карта без явного назначения закрепляется при первом
+// входе за воркером, в который вошло меньше всего игроков
+class MapAssignment {
+public:
+    MapAssignment(size_t shards, std::unordered_map<std::string, size_t> fixed);
+
+    // Воркер для входа на карту. Новая карта достаётся воркеру, принявшему меньше всего входов
+    size_t Join(const std::string& map_id);
+
+    size_t GetShardsCount() const {
+        return joins_.size();
+    }
+private:
+    std::mutex mutex_;
+    std::unordered_map<std::string, size_t> shards_;
+    // Сколько входов отправлено воркеру за всё время. Уход игроков маршрутизатор не видит,
+    // поэтому это не число игроков на воркере
+    std::vector<uint64_t> joins_;
+};
+
+// Пересылка запросов одному воркеру через пул постоянных соединений
+class WorkerClient {
+public:
+    using Request = http::request<http::string_body>;
+    using Response = http::response<http::string_body>;
+    using Handler = std::function<void(sys::error_code ec, Response&& response)>;
+
+    // Простаивающих соединений больше этого закрываются
+    static constexpr size_t MAX_IDLE = 64;
+
+    WorkerClient(net::io_context& ioc, tcp::endpoint endpoint)
+        : ioc_(ioc)
+        , endpoint_(std::move(endpoint)) {
+    }
+
+    WorkerClient(const WorkerClient&) = delete;
+    WorkerClient& operator=(const WorkerClient&) = delete;
+
+    // handler вызывается из потока ioc
+    void Forward(Request&& request, Handler handler);
+
+    const tcp::endpoint& GetEndpoint() const {
+        return endpoint_;
+    }
+
+    net::io_context& GetContext() {
+        return ioc_;
+    }
+
+    std::optional<beast::tcp_stream> TakeConnection();
+
+    void ReturnConnection(beast::tcp_stream&& stream);
+private:
+    net::io_context& ioc_;
+    tcp::endpoint endpoint_;
+
+    std::mutex mutex_;
+    std::vector<beast::tcp_stream> idle_;
+};
+
+// Запускает воркер - этот же исполняемый файл с аргументами args
+pid_t SpawnWorker(const std::vector<std::string>& args);
+
+// Посылает воркерам SIGTERM и дожидается их завершения
+void StopWorkers(const std::vector<pid_t>& workers);
+
+// Ждёт, пока воркер начнёт принимать соединения. Бросает std::runtime_error по таймауту
+void WaitForWorker(const tcp::endpoint& endpoint, std::chrono::milliseconds timeout);
+
+} // namespace router
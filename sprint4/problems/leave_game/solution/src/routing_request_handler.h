@@ -0,0 +1,336 @@
+#pragma once
+
+#include "http_server.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/json.hpp>
+
+#include "body_types.h"
+#include "http_strs.h"
+#include "json_keys.h"
+#include "resp_maker.h"
+#include "router.h"
+
+namespace routing_handler {
+
+namespace net = boost::asio;
+namespace http = boost::beast::http;
+namespace sys = boost::system;
+namespace json = boost::json;
+using tcp = net::ip::tcp;
+
+namespace detail {
+
+inline router::WorkerClient::Response MakeUnavailableResponse(unsigned version, bool keep_alive) {
+    resp_maker::detail::ResponseInfo info;
+    info.status = http::status::bad_gateway;
+    info.body = resp_maker::json_resp::GetBadRequestResponseBody(json_keys::worker_unavailable_mess,
+                                                                json_keys::worker_unavailable_key);
+    info.content_type = body_type::json;
+    info.no_cache = true;
+    info.version = version;
+    info.keep_alive = keep_alive;
+    return resp_maker::detail::MakeTextResponse<http::string_body, std::allocator<char>>(info);
+}
+
+inline json::value MakeUnavailableBatchResult() {
+    return {
+        {json_keys::batch_status_key, static_cast<unsigned>(http::status::bad_gateway)},
+        {json_keys::code_key, json_keys::worker_unavailable_key},
+        {json_keys::message_key, json_keys::worker_unavailable_mess}
+    };
+}
+
+} // namespace detail
+
+// Пересылает запросы /api/v1/game/* воркерам: /join - по id карты, остальные - по номеру
+// воркера в токене. /records и остальное обрабатывает RequestHandler: база рекордов у всех
+// процессов общая. Без воркеров всё обрабатывается локально
+template <class RequestHandler>
+class RoutingRequestHandler {
+public:
+    RoutingRequestHandler(RequestHandler& local, net::io_context& ioc, const std::vector<tcp::endpoint>& workers,
+                          std::unordered_map<std::string, size_t> fixed_shards);
+
+    RoutingRequestHandler(const RoutingRequestHandler&) = delete;
+    RoutingRequestHandler& operator=(const RoutingRequestHandler&) = delete;
+
+    template <typename Allocator, typename Send>
+    void operator()(http::request<http::string_body, http::basic_fields<Allocator>>&& req, Send&& send);
+private:
+    template <typename Request>
+    size_t GetShard(const Request& req);
+
+    template <typename Request, typename Send>
+    void Forward(size_t shard, Request&& req, Send&& send);
+
+    // /tick должен дойти до всех воркеров. Клиенту уходит ответ воркера 0 или первая ошибка
+    template <typename Request, typename Send>
+    void Broadcast(Request&& req, Send&& send);
+
+    // Команды /batch раскладываются по воркерам по номеру в токене, результаты собираются
+    // в исходном порядке. Команды недоступного воркера получают результат 502
+    template <typename Request, typename Send>
+    void SplitBatch(Request&& req, Send&& send);
+
+    RequestHandler& local_;
+    std::vector<std::unique_ptr<router::WorkerClient>> workers_;
+    router::MapAssignment assignment_;
+};
+
+} // namespace routing_handler
+
+//===================================Templates implementation============================================
+
+namespace routing_handler {
+
+template <class RequestHandler>
+RoutingRequestHandler<RequestHandler>::RoutingRequestHandler(RequestHandler& local, net::io_context& ioc,
+        const std::vector<tcp::endpoint>& workers, std::unordered_map<std::string, size_t> fixed_shards)
+    : local_(local)
+    , assignment_(workers.size(), std::move(fixed_shards)) {
+    for (const tcp::endpoint& endpoint : workers) {
+        workers_.push_back(std::make_unique<router::WorkerClient>(ioc, endpoint));
+    }
+}
+
+template <class RequestHandler>
+template <typename Allocator, typename Send>
+void RoutingRequestHandler<RequestHandler>::operator()(
+        http::request<http::string_body, http::basic_fields<Allocator>>&& req, Send&& send) {
+    std::string_view target = req.target();
+
+    if (workers_.empty() || !target.starts_with(http_strs::game_path)
+            || target.substr(http_strs::game_path.size()).starts_with(http_strs::records)) {
+        return local_(std::move(req), std::forward<Send>(send));
+    }
+
+    if (target.substr(http_strs::game_path.size()).starts_with(http_strs::tick)) {
+        return Broadcast(std::move(req), std::forward<Send>(send));
+    }
+
+    if (target.substr(http_strs::game_path.size()) == http_strs::batch) {
+        return SplitBatch(std::move(req), std::forward<Send>(send));
+    }
+
+    size_t shard = GetShard(req);
+    Forward(shard, std::move(req), std::forward<Send>(send));
+}
+
+template <class RequestHandler>
+template <typename Request>
+size_t RoutingRequestHandler<RequestHandler>::GetShard(const Request& req) {
+    std::string_view path = std::string_view{req.target()}.substr(http_strs::game_path.size());
+
+    // Ошибочные запросы уходят воркеру 0, он и ответит клиенту как обычный сервер
+    if (path.starts_with(http_strs::join)) {
+        try {
+            json::value body = json::parse(req.body());
+            if (const json::value* map_id = body.as_object().if_contains(json_keys::map_id_key)) {
+                return assignment_.Join(std::string{map_id->as_string()});
+            }
+        } catch (const std::exception&) {
+        }
+        return 0;
+    }
+
+    auto auth = req.find(http::field::authorization);
+    if (auth == req.end()) {
+        return 0;
+    }
+
+    std::string_view value = auth->value();
+    if (!value.starts_with(json_keys::token_prefix)) {
+        return 0;
+    }
+
+    std::optional<size_t> shard = router::GetTokenShard(value.substr(json_keys::token_prefix.size()));
+    return shard && *shard < workers_.size() ? *shard : 0;
+}
+
+template <class RequestHandler>
+template <typename Request, typename Send>
+void RoutingRequestHandler<RequestHandler>::Forward(size_t shard, Request&& req, Send&& send) {
+    unsigned version = req.version();
+    bool keep_alive = req.keep_alive();
+
+    router::WorkerClient::Request request{std::move(req)};
+    request.keep_alive(true);
+
+    workers_.at(shard)->Forward(std::move(request),
+        [send = std::forward<Send>(send), version, keep_alive](sys::error_code ec,
+                                                                 router::WorkerClient::Response&& response) mutable {
+            if (ec) {
+                return send(detail::MakeUnavailableResponse(version, keep_alive));
+            }
+            response.version(version);
+            response.keep_alive(keep_alive);
+            send(std::move(response));
+        }
+    );
+}
+
+template <class RequestHandler>
+template <typename Request, typename Send>
+void RoutingRequestHandler<RequestHandler>::Broadcast(Request&& req, Send&& send) {
+    struct State {
+        State(size_t remaining, std::decay_t<Send> send)
+            : remaining(remaining)
+            , send(std::move(send)) {
+        }
+
+        std::mutex mutex;
+        size_t remaining;
+        std::optional<router::WorkerClient::Response> response;
+        std::decay_t<Send> send;
+    };
+
+    unsigned version = req.version();
+    bool keep_alive = req.keep_alive();
+
+    auto state = std::make_shared<State>(workers_.size(), std::forward<Send>(send));
+
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        router::WorkerClient::Request request{req};
+        request.keep_alive(true);
+
+        workers_[i]->Forward(std::move(request),
+            [state, i, version, keep_alive](sys::error_code ec, router::WorkerClient::Response&& response) {
+                std::unique_lock lock{state->mutex};
+
+                if (ec) {
+                    state->response = detail::MakeUnavailableResponse(version, keep_alive);
+                } else if (response.result() != http::status::ok || (i == 0 && !state->response)) {
+                    state->response = std::move(response);
+                }
+
+                if (--state->remaining > 0) {
+                    return;
+                }
+                lock.unlock();
+
+                router::WorkerClient::Response result = std::move(*state->response);
+                result.version(version);
+                result.keep_alive(keep_alive);
+                state->send(std::move(result));
+            }
+        );
+    }
+}
+
+template <class RequestHandler>
+template <typename Request, typename Send>
+void RoutingRequestHandler<RequestHandler>::SplitBatch(Request&& req, Send&& send) {
+    json::value body;
+    try {
+        body = json::parse(req.body());
+    } catch (const std::exception&) {
+    }
+
+    // Ошибку формата пакета вернёт воркер 0
+    if (!body.is_array()) {
+        return Forward(0, std::move(req), std::forward<Send>(send));
+    }
+
+    const json::array& commands = body.as_array();
+    std::vector<json::array> shard_commands(workers_.size());
+    std::vector<std::vector<size_t>> positions(workers_.size());
+
+    for (size_t i = 0; i < commands.size(); ++i) {
+        size_t shard = 0;
+        if (const json::object* command = commands[i].if_object()) {
+            const json::value* token = command->if_contains(json_keys::auth_token_key);
+            if (token && token->is_string()) {
+                std::optional<size_t> token_shard = router::GetTokenShard(token->as_string());
+                shard = token_shard && *token_shard < workers_.size() ? *token_shard : 0;
+            }
+        }
+        shard_commands[shard].push_back(commands[i]);
+        positions[shard].push_back(i);
+    }
+
+    struct State {
+        State(size_t remaining, size_t commands, std::decay_t<Send> send)
+            : remaining(remaining)
+            , results(commands)
+            , send(std::move(send)) {
+        }
+
+        std::mutex mutex;
+        size_t remaining;
+        json::array results;
+        std::decay_t<Send> send;
+    };
+
+    unsigned version = req.version();
+    bool keep_alive = req.keep_alive();
+
+    size_t used_shards = std::count_if(positions.begin(), positions.end(), [](const auto& shard_positions) {
+        return !shard_positions.empty();
+    });
+    if (used_shards <= 1) {
+        size_t shard = std::find_if(positions.begin(), positions.end(), [](const auto& shard_positions) {
+            return !shard_positions.empty();
+        }) - positions.begin();
+        return Forward(shard == positions.size() ? 0 : shard, std::move(req), std::forward<Send>(send));
+    }
+
+    auto state = std::make_shared<State>(used_shards, commands.size(), std::forward<Send>(send));
+
+    for (size_t shard = 0; shard < workers_.size(); ++shard) {
+        if (positions[shard].empty()) {
+            continue;
+        }
+
+        router::WorkerClient::Request request{req};
+        request.body() = json::serialize(shard_commands[shard]);
+        request.prepare_payload();
+        request.keep_alive(true);
+
+        workers_[shard]->Forward(std::move(request),
+            [state, shard_positions = std::move(positions[shard]), version, keep_alive]
+            (sys::error_code ec, router::WorkerClient::Response&& response) {
+                json::value results;
+                if (!ec && response.result() == http::status::ok) {
+                    try {
+                        results = json::parse(response.body());
+                    } catch (const std::exception&) {
+                    }
+                }
+
+                std::unique_lock lock{state->mutex};
+
+                const json::array* shard_results = results.if_array();
+                for (size_t k = 0; k < shard_positions.size(); ++k) {
+                    state->results[shard_positions[k]] = shard_results && k < shard_results->size()
+                        ? (*shard_results)[k]
+                        : detail::MakeUnavailableBatchResult();
+                }
+
+                if (--state->remaining > 0) {
+                    return;
+                }
+                lock.unlock();
+
+                resp_maker::detail::ResponseInfo info;
+                info.status = http::status::ok;
+                info.body = json::serialize(state->results);
+                info.content_type = body_type::json;
+                info.no_cache = true;
+                info.version = version;
+                info.keep_alive = keep_alive;
+                state->send(resp_maker::detail::MakeTextResponse<http::string_body, std::allocator<char>>(info));
+            }
+        );
+    }
+}
+
+} // namespace routing_handler
@@ -0,0 +1,130 @@
+#include "state_codec.h"
+#include "binary_io.h"
+#include "body_types.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <type_traits>
+
+namespace state_codec {
+
+namespace {
+
+// Координаты и скорости бывают double или Fixed в зависимости от GAME_FIXED_POINT
+template <typename Scalar>
+int64_t Quantize(Scalar value) {
+    if constexpr (std::is_same_v<Scalar, fixed_point::Fixed>) {
+        return value.GetRaw();
+    } else {
+        return std::llround(value * fixed_point::Fixed::ONE);
+    }
+}
+
+std::string_view Trim(std::string_view str) {
+    while (!str.empty() && std::isspace(static_cast<unsigned char>(str.front()))) {
+        str.remove_prefix(1);
+    }
+    while (!str.empty() && std::isspace(static_cast<unsigned char>(str.back()))) {
+        str.remove_suffix(1);
+    }
+    return str;
+}
+
+bool EqualsIgnoreCase(std::string_view lhs, std::string_view rhs) {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](char a, char b) {
+        return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+    });
+}
+
+// q=0 означает, что тип не принимается
+bool IsRejected(std::string_view params) {
+    while (!params.empty()) {
+        size_t end = params.find(';');
+        std::string_view param = Trim(params.substr(0, end));
+        params = end == params.npos ? std::string_view{} : params.substr(end + 1);
+        if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+            std::string_view value = param.substr(2);
+            return value.find_first_not_of("0.") == value.npos;
+        }
+    }
+    return false;
+}
+
+void PutHeader(std::string& out, Kind kind) {
+    out.push_back(static_cast<char>(VERSION));
+    out.push_back(static_cast<char>(kind));
+}
+
+void PutPlayer(std::string& out, const game_manager::Player& player) {
+    const move_manager::State& state = player.state;
+    binary_io::PutVarint(out, player.id);
+    binary_io::PutZigzag(out, Quantize(state.position.coor.x));
+    binary_io::PutZigzag(out, Quantize(state.position.coor.y));
+    binary_io::PutZigzag(out, Quantize(state.speed.x_axis));
+    binary_io::PutZigzag(out, Quantize(state.speed.y_axis));
+    out.push_back(static_cast<char>(state.dir));
+    binary_io::PutVarint(out, player.score);
+    binary_io::PutVarint(out, player.items_in_bag.size());
+    for (const game_manager::ItemInfo& item : player.items_in_bag) {
+        binary_io::PutVarint(out, item.id);
+        binary_io::PutVarint(out, item.type);
+    }
+}
+
+void PutLootObject(std::string& out, const game_manager::LootObject& object) {
+    binary_io::PutVarint(out, object.id);
+    binary_io::PutVarint(out, object.type);
+    binary_io::PutZigzag(out, Quantize(object.position.x));
+    binary_io::PutZigzag(out, Quantize(object.position.y));
+}
+
+template <class Container, class Put>
+void PutList(std::string& out, const Container& elements, const std::vector<uint32_t>* visible, Put&& put) {
+    size_t count = visible ? visible->size() : elements.size();
+    binary_io::PutVarint(out, count);
+    for (size_t i = 0; i < count; ++i) {
+        put(out, elements[visible ? (*visible)[i] : i]);
+    }
+}
+
+} // namespace
+
+bool IsAccepted(std::string_view accept) {
+    while (!accept.empty()) {
+        size_t end = accept.find(',');
+        std::string_view range = accept.substr(0, end);
+        accept = end == accept.npos ? std::string_view{} : accept.substr(end + 1);
+
+        size_t params = range.find(';');
+        std::string_view type = Trim(range.substr(0, params));
+        if (EqualsIgnoreCase(type, body_type::game_state)) {
+            return params == range.npos || !IsRejected(range.substr(params + 1));
+        }
+    }
+    return false;
+}
+
+std::string EncodeState(const game_manager::PlayersAndObjects& state) {
+    std::string out;
+    // Собака с пустым рюкзаком в среднем занимает около 12 байт, предмет - около 8
+    out.reserve(4 + state.players.size() * 16 + state.objects.size() * 8);
+    PutHeader(out, Kind::state);
+    PutList(out, state.players, state.visible_players, PutPlayer);
+    PutList(out, state.objects, state.visible_objects, PutLootObject);
+    return out;
+}
+
+std::string EncodePlayersList(const std::deque<game_manager::Player>& players) {
+    std::string out;
+    PutHeader(out, Kind::players);
+    binary_io::PutVarint(out, players.size());
+    for (const game_manager::Player& player : players) {
+        binary_io::PutVarint(out, player.id);
+        binary_io::PutVarint(out, player.name.size());
+        out.append(player.name);
+    }
+    return out;
+}
+
+} // namespace state_codec
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+
+#include "game_manager.h"
+
+// Бинарные ответы /api/v1/game/state и /api/v1/game/players для клиентов,
+// приславших Accept: application/x-game-state. Декодер - static/js/state_codec.js.
+//
+// Целые числа - varint (binary_io::PutVarint), знаковые - zigzag. Координаты и скорости -
+// в 1/1024 клетки, как fixed_point::Fixed, поэтому в режиме GAME_FIXED_POINT передаются точно.
+//   u8 VERSION, u8 Kind
+//   Kind::state:
+//     varint число собак, для каждой:
+//       varint id, zigzag x, y, zigzag скорость x, y, u8 move_manager::Direction, varint score,
+//       varint размер рюкзака, для каждого предмета varint id, varint type
+//     varint число предметов лута, для каждого: varint id, varint type, zigzag x, y
+//   Kind::players:
+//     varint число собак, для каждой: varint id, varint длина имени, имя в UTF-8
+namespace state_codec {
+
+constexpr uint8_t VERSION = 1;
+
+enum class Kind : uint8_t {
+    state = 1,
+    players = 2
+};
+
+// Есть ли body_type::game_state среди типов заголовка Accept (без q=0)
+bool IsAccepted(std::string_view accept);
+
+// Учитывает visible_players и visible_objects
+std::string EncodeState(const game_manager::PlayersAndObjects& state);
+
+std::string EncodePlayersList(const std::deque<game_manager::Player>& players);
+
+} // namespace state_codec
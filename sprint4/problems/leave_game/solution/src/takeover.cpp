@@ -0,0 +1,252 @@
+#include "takeover.h"
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/write.hpp>
+
+namespace takeover {
+
+using namespace std::literals;
+
+namespace detail {
+
+// Состояние больше считается повреждённым
+const uint64_t MAX_STATE_SIZE = 1ull << 32;
+
+sys::system_error MakeError(std::string_view what) {
+    return sys::system_error(errno, sys::system_category(), std::string{what});
+}
+
+pid_t GetPeerPid(local::socket& socket) {
+    ucred cred{};
+    socklen_t size = sizeof(cred);
+    if (::getsockopt(socket.native_handle(), SOL_SOCKET, SO_PEERCRED, &cred, &size) != 0) {
+        throw MakeError("getsockopt SO_PEERCRED"sv);
+    }
+    return cred.pid;
+}
+
+void WaitForExit(pid_t pid) {
+    int fd = static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+    if (fd >= 0) {
+        // pidfd становится читаемым, когда процесс завершился
+        pollfd poll_fd{fd, POLLIN, 0};
+        while (::poll(&poll_fd, 1, -1) < 0 && errno == EINTR) {
+        }
+        ::close(fd);
+        return;
+    }
+    // Ядро без pidfd_open
+    while (::kill(pid, 0) == 0 || errno == EPERM) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+}
+
+} // namespace detail
+
+void SendDescriptor(local::socket& socket, int fd) {
+    // Вместе с дескриптором нужно передать хотя бы один байт данных
+    char data = 'F';
+    iovec iov{&data, sizeof(data)};
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))]{};
+
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    if (::sendmsg(socket.native_handle(), &msg, MSG_NOSIGNAL) != sizeof(data)) {
+        throw detail::MakeError("sendmsg"sv);
+    }
+}
+
+int ReceiveDescriptor(local::socket& socket) {
+    char data;
+    iovec iov{&data, sizeof(data)};
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))]{};
+
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t received = ::recvmsg(socket.native_handle(), &msg, MSG_CMSG_CLOEXEC);
+    if (received < 0) {
+        throw detail::MakeError("recvmsg"sv);
+    }
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (received == 0 || !cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+        throw sys::system_error(net::error::eof, "recvmsg: no descriptor");
+    }
+
+    int fd;
+    std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    return fd;
+}
+
+void WriteState(local::socket& socket, const game_manager::GameRepr& repr) {
+    std::ostringstream out;
+    {
+        boost::archive::text_oarchive archive(out);
+        archive << repr;
+    }
+    std::string data = std::move(out).str();
+
+    uint64_t size = data.size();
+    net::write(socket, std::array{net::buffer(&size, sizeof(size)), net::buffer(data)});
+}
+
+game_manager::GameRepr ReadState(local::socket& socket) {
+    uint64_t size;
+    net::read(socket, net::buffer(&size, sizeof(size)));
+    if (size > detail::MAX_STATE_SIZE) {
+        throw std::runtime_error("Takeover: state is too large");
+    }
+
+    std::string data(size, '\0');
+    net::read(socket, net::buffer(data));
+
+    game_manager::GameRepr repr;
+    std::istringstream in(std::move(data));
+    boost::archive::text_iarchive archive(in);
+    archive >> repr;
+    return repr;
+}
+
+std::optional<Handoff> TakeOver(const std::filesystem::path& socket_path) {
+    net::io_context ioc;
+    local::socket socket(ioc);
+
+    sys::error_code ec;
+    socket.connect(local::endpoint(socket_path.string()), ec);
+    if (ec) {
+        return std::nullopt;
+    }
+
+    pid_t donor = detail::GetPeerPid(socket);
+    Handoff handoff{ReceiveDescriptor(socket), std::nullopt};
+
+    // Сокет уже у нас, а старый процесс перестал принимать соединения.
+    // Если состояние не пришло, сервер всё равно должен запуститься, но файлы состояния
+    // и журнала можно читать только после того, как старый процесс их сохранит и завершится
+    try {
+        handoff.state = ReadState(socket);
+    } catch (const std::exception&) {
+        detail::WaitForExit(donor);
+    }
+
+    return handoff;
+}
+
+Donor::Donor(net::io_context& ioc, const std::filesystem::path& socket_path,
+             std::shared_ptr<http_server::ListenerBase> listener, game_manager::GameManager& game,
+             std::shared_ptr<game_serialization::Serializator> serializator,
+             std::shared_ptr<game_journal::Journal> journal,
+             std::function<void()> on_finish, ErrorHandler on_error)
+    : acceptor_(net::make_strand(ioc))
+    , listener_(std::move(listener))
+    , game_(game)
+    , serializator_(std::move(serializator))
+    , journal_(std::move(journal))
+    , on_finish_(std::move(on_finish))
+    , on_error_(std::move(on_error)) {
+    // Файл сокета остаётся от предыдущего процесса, в том числе того, у которого мы приняли сервер
+    std::filesystem::remove(socket_path);
+
+    local::endpoint endpoint(socket_path.string());
+    acceptor_.open(endpoint.protocol());
+    acceptor_.bind(endpoint);
+    acceptor_.listen();
+}
+
+void Donor::Run() {
+    DoAccept();
+}
+
+void Donor::DoAccept() {
+    acceptor_.async_accept([self = shared_from_this()](sys::error_code ec, local::socket socket) {
+        self->OnAccept(ec, std::move(socket));
+    });
+}
+
+void Donor::OnAccept(sys::error_code ec, local::socket socket) {
+    if (ec) {
+        return on_error_(ec, "takeover accept"sv);
+    }
+
+    try {
+        SendDescriptor(socket, listener_->GetNativeHandle());
+    } catch (const sys::system_error& e) {
+        // Преемник не получил сокет, продолжаем работать
+        on_error_(e.code(), "takeover send descriptor"sv);
+        return DoAccept();
+    }
+
+    sys::error_code close_ec;
+    acceptor_.close(close_ec);
+
+    // Состояние снимается после обработки начатых запросов, чтобы их результат не потерялся
+    listener_->Stop([self = shared_from_this(), socket = std::make_shared<local::socket>(std::move(socket))] {
+        self->TransferState(socket);
+    }, DRAIN_TIMEOUT);
+}
+
+void Donor::TransferState(std::shared_ptr<local::socket> socket) {
+    if (!serializator_) {
+        return SendState(std::move(socket));
+    }
+    // Начатое периодическое сохранение могло бы записать старый снимок поверх снимка преемника
+    serializator_->Stop([self = shared_from_this(), socket] {
+        // Stop может позвать нас из обработчика сохранения, снимок снимается уже вне его
+        net::post(self->acceptor_.get_executor(), [self, socket] {
+            self->SendState(socket);
+        });
+    });
+}
+
+void Donor::SendState(std::shared_ptr<local::socket> socket) {
+    game_.GetRepresentationAsync([self = shared_from_this(), socket](game_manager::GameRepr&& repr) {
+        // Получив состояние, преемник сбрасывает журнал и пишет в него сам.
+        // События после снимка ему не нужны
+        if (self->journal_) {
+            self->journal_->Detach();
+        }
+        try {
+            WriteState(*socket, repr);
+        } catch (const sys::system_error& e) {
+            self->on_error_(e.code(), "takeover send state"sv);
+            // Преемник загрузит снимок из файла, дождавшись нашего завершения.
+            // События после снимка остались в журнале
+            if (self->serializator_) {
+                self->serializator_->SaveRepr(std::move(repr));
+            }
+        }
+        self->on_finish_();
+    });
+}
+
+} // namespace takeover
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+
+// http_server.h задаёт настройки Beast и должен подключаться первым
+#include "http_server.h"
+#include "game_manager.h"
+#include "game_journal.h"
+#include "game_serialization.h"
+
+// Перезапуск без остановки сервиса. Новый процесс подключается к старому через Unix-сокет,
+// получает слушающий сокет через SCM_RIGHTS и состояние игры в памяти, минуя файл состояния
+namespace takeover {
+
+namespace net = boost::asio;
+namespace sys = boost::system;
+using local = net::local::stream_protocol;
+
+// Сколько старый процесс ждёт завершения начатых запросов. Новый процесс отвечает только
+// после получения состояния, так что перерыв в обслуживании - это ожидание начатых запросов
+// (не дольше DRAIN_TIMEOUT) плюс снятие, передача и восстановление состояния
+const std::chrono::milliseconds DRAIN_TIMEOUT{5000};
+
+// Передают открытый дескриптор fd через Unix-сокет. При ошибке бросают sys::system_error
+void SendDescriptor(local::socket& socket, int fd);
+
+int ReceiveDescriptor(local::socket& socket);
+
+void WriteState(local::socket& socket, const game_manager::GameRepr& repr);
+
+game_manager::GameRepr ReadState(local::socket& socket);
+
+struct Handoff {
+    int listen_fd;
+    // nullopt, если старый процесс не смог передать состояние.
+    // Тогда его нужно загрузить из файла: к возврату TakeOver старый процесс
+    // сохранил его и завершился
+    std::optional<game_manager::GameRepr> state;
+};
+
+// Сторона нового процесса. Блокируется, пока старый процесс не обработает начатые запросы.
+// nullopt, если на socket_path никто не ждёт преемника. К возврату старый процесс
+// уже отпустил журнал, и его можно открывать
+std::optional<Handoff> TakeOver(const std::filesystem::path& socket_path);
+
+// Сторона работающего процесса: ждёт преемника на socket_path и отдаёт ему сервер.
+// После on_finish процесс должен завершиться, не сохраняя состояние: если передать его
+// не удалось, Donor сам сохраняет снимок через serializator до закрытия соединения.
+// serializator и journal могут быть nullptr. Периодическое сохранение останавливается до
+// снятия состояния, journal закрывается перед передачей: дальше в файлы пишет преемник
+class Donor : public std::enable_shared_from_this<Donor> {
+public:
+    using ErrorHandler = std::function<void(sys::error_code ec, std::string_view what)>;
+
+    Donor(net::io_context& ioc, const std::filesystem::path& socket_path,
+          std::shared_ptr<http_server::ListenerBase> listener, game_manager::GameManager& game,
+          std::shared_ptr<game_serialization::Serializator> serializator,
+          std::shared_ptr<game_journal::Journal> journal,
+          std::function<void()> on_finish, ErrorHandler on_error);
+
+    void Run();
+private:
+    void DoAccept();
+
+    void OnAccept(sys::error_code ec, local::socket socket);
+
+    void TransferState(std::shared_ptr<local::socket> socket);
+
+    void SendState(std::shared_ptr<local::socket> socket);
+
+    local::acceptor acceptor_;
+    std::shared_ptr<http_server::ListenerBase> listener_;
+    game_manager::GameManager& game_;
+    std::shared_ptr<game_serialization::Serializator> serializator_;
+    std::shared_ptr<game_journal::Journal> journal_;
+    std::function<void()> on_finish_;
+    ErrorHandler on_error_;
+};
+
+} // namespace takeover
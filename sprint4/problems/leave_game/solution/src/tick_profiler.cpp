@@ -0,0 +1,126 @@
+#include "tick_profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace tick_profiler {
+
+using namespace std::literals;
+
+std::string_view GetPhaseName(Phase phase) {
+    switch (phase) {
+    case Phase::tick:
+        return "tick"sv;
+    case Phase::inbox:
+        return "inbox"sv;
+    case Phase::retire:
+        return "retire"sv;
+    case Phase::collisions:
+        return "collisions"sv;
+    case Phase::move:
+        return "move"sv;
+    case Phase::remove_retirees:
+        return "remove_retirees"sv;
+    case Phase::loot:
+        return "loot"sv;
+    default:
+        return "unknown"sv;
+    }
+}
+
+Profiler& Profiler::GetInstance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+void Profiler::Enable(size_t events_per_thread) {
+    if (enabled_.exchange(true)) {
+        return;
+    }
+    events_per_thread_ = std::max<size_t>(events_per_thread, 1);
+    metrics::Registry::GetInstance().AddCollector([this](std::ostream& out) {
+        WriteMetrics(out);
+    });
+}
+
+Profiler::ThreadBuffer& Profiler::GetThreadBuffer() {
+    thread_local std::shared_ptr<ThreadBuffer> buffer;
+
+    if (!buffer) {
+        buffer = std::make_shared<ThreadBuffer>();
+        buffer->events.reserve(events_per_thread_);
+
+        std::lock_guard lock{buffers_mutex_};
+        buffers_.push_back(buffer);
+    }
+    return *buffer;
+}
+
+void Profiler::Record(Phase phase, uint32_t session_id, size_t entities,
+                      chrome_trace::Clock::time_point start, chrome_trace::Clock::time_point end) {
+    size_t index = static_cast<size_t>(phase);
+    durations_[index].Record(end - start);
+    entities_[index].Set(entities);
+
+    chrome_trace::TraceEvent event;
+    event.name = GetPhaseName(phase);
+    event.category = "tick"sv;
+    event.ts = chrome_trace::GetTimestamp(start);
+    event.dur = chrome_trace::GetTimestamp(end) - event.ts;
+    event.tid = chrome_trace::GetThreadId();
+    event.args[0] = {"session"sv, session_id};
+    event.args[1] = {"entities"sv, static_cast<int64_t>(entities)};
+
+    ThreadBuffer& buffer = GetThreadBuffer();
+    std::lock_guard lock{buffer.mutex};
+    // Когда буфер заполнен, новые события вытесняют самые старые
+    if (buffer.events.size() < events_per_thread_) {
+        buffer.events.push_back(event);
+    } else {
+        buffer.events[buffer.next] = event;
+    }
+    buffer.next = (buffer.next + 1) % events_per_thread_;
+}
+
+std::vector<chrome_trace::TraceEvent> Profiler::Collect() const {
+    std::vector<chrome_trace::TraceEvent> result;
+    {
+        std::lock_guard lock{buffers_mutex_};
+        for (const std::shared_ptr<ThreadBuffer>& buffer : buffers_) {
+            std::lock_guard buffer_lock{buffer->mutex};
+            result.insert(result.end(), buffer->events.begin(), buffer->events.end());
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.ts < rhs.ts;
+    });
+    return result;
+}
+
+void Profiler::WriteChromeTrace(const std::filesystem::path& file) const {
+    std::ofstream out(file);
+    if (!out) {
+        throw std::runtime_error("Failed to open tick profile file " + file.string());
+    }
+    chrome_trace::WriteEvents(out, Collect());
+}
+
+void Profiler::WriteMetrics(std::ostream& out) const {
+    metrics::WriteHeader(out, "game_tick_phase_duration_seconds"sv, "histogram"sv,
+                         "Duration of game session tick phases"sv);
+    for (size_t i = 0; i < PHASES; ++i) {
+        std::string labels = "phase=\""s + std::string{GetPhaseName(static_cast<Phase>(i))} + "\""s;
+        metrics::WriteHistogram(out, "game_tick_phase_duration_seconds"sv, labels, durations_[i]);
+    }
+
+    metrics::WriteHeader(out, "game_tick_phase_entities"sv, "gauge"sv,
+                         "Entities processed by the last measured tick phase"sv);
+    for (size_t i = 0; i < PHASES; ++i) {
+        out << "game_tick_phase_entities{phase=\""sv << GetPhaseName(static_cast<Phase>(i)) << "\"} "sv
+            << entities_[i].Get() << '\n';
+    }
+}
+
+} // namespace tick_profiler
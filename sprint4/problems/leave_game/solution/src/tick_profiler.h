@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "chrome_trace.h"
+#include "metrics.h"
+
+namespace tick_profiler {
+
+enum class Phase {
+    tick,
+    inbox,
+    retire,
+    collisions,
+    move,
+    remove_retirees,
+    loot,
+    count
+};
+
+std::string_view GetPhaseName(Phase phase);
+
+// Профилировщик фаз тика игровой сессии. Пока не включён, Span ничего не делает.
+// Каждый поток пишет в свой кольцевой буфер последних событий, поэтому
+// запись не мешает тикам других сессий
+class Profiler {
+public:
+    static constexpr size_t DEFAULT_EVENTS_PER_THREAD = 1 << 16;
+
+    static Profiler& GetInstance();
+
+    void Enable(size_t events_per_thread = DEFAULT_EVENTS_PER_THREAD);
+
+    bool IsEnabled() const {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    void Record(Phase phase, uint32_t session_id, size_t entities,
+                chrome_trace::Clock::time_point start, chrome_trace::Clock::time_point end);
+
+    // События всех потоков в порядке времени начала
+    std::vector<chrome_trace::TraceEvent> Collect() const;
+
+    void WriteChromeTrace(const std::filesystem::path& file) const;
+
+    void WriteMetrics(std::ostream& out) const;
+private:
+    Profiler() = default;
+
+    struct ThreadBuffer {
+        std::mutex mutex;
+        std::vector<chrome_trace::TraceEvent> events;
+        size_t next = 0;
+    };
+
+    ThreadBuffer& GetThreadBuffer();
+
+    static constexpr size_t PHASES = static_cast<size_t>(Phase::count);
+
+    std::atomic<bool> enabled_ = false;
+    size_t events_per_thread_ = DEFAULT_EVENTS_PER_THREAD;
+
+    mutable std::mutex buffers_mutex_;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+
+    std::array<metrics::Histogram, PHASES> durations_;
+    // Количество сущностей при последнем замере фазы
+    std::array<metrics::Gauge, PHASES> entities_;
+};
+
+// Замеряет время от создания до разрушения
+class Span {
+public:
+    Span(Phase phase, uint32_t session_id, size_t entities = 0)
+        : enabled_(Profiler::GetInstance().IsEnabled())
+        , phase_(phase)
+        , session_id_(session_id)
+        , entities_(entities) {
+        if (enabled_) {
+            start_ = chrome_trace::Clock::now();
+        }
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    ~Span() {
+        if (enabled_) {
+            Profiler::GetInstance().Record(phase_, session_id_, entities_, start_, chrome_trace::Clock::now());
+        }
+    }
+private:
+    bool enabled_;
+    Phase phase_;
+    uint32_t session_id_;
+    size_t entities_;
+    chrome_trace::Clock::time_point start_;
+};
+
+} // namespace tick_profiler
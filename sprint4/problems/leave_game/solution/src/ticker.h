@@ -1,10 +1,13 @@
 #pragma once
 
 #include <boost/asio.hpp>
+#include <algorithm>
 #include <memory>
 #include <functional>
 #include <chrono>
 
+#include "metrics.h"
+
 //#include "my_debug.h"
 
 namespace ticker {
@@ -12,6 +15,48 @@ namespace ticker {
 namespace net = boost::asio;
 namespace sys = boost::system ;
 
+// Что делать со временем, которое не укладывается в один тик
+enum class OverrunPolicy {
+    // Доиграть всё пропущенное время шагами
+    catch_up,
+    // Сыграть один шаг, остальное выбросить
+    drop
+};
+
+struct TickOptions {
+    // Длина шага симуляции. 0 - шаг равен прошедшему времени
+    std::chrono::milliseconds fixed_step{0};
+    // Наибольшая длина шага при переменном шаге. 0 - без ограничения
+    std::chrono::milliseconds max_delta{0};
+    OverrunPolicy overrun = OverrunPolicy::catch_up;
+};
+
+// Делит прошедшее время на шаги симуляции
+class Stepper {
+public:
+    explicit Stepper(TickOptions options = {})
+        : options_{options} {
+    }
+
+    // Вызывает step(delta) для каждого шага, на которые делится elapsed
+    template <typename Step>
+    void Advance(std::chrono::milliseconds elapsed, Step&& step);
+
+    // Выброшенное по OverrunPolicy::drop время
+    std::chrono::milliseconds GetDropped() const {
+        return dropped_;
+    }
+
+    // Накопленное, но ещё не сыгранное время при фиксированном шаге
+    std::chrono::milliseconds GetLag() const {
+        return accumulated_;
+    }
+private:
+    TickOptions options_;
+    std::chrono::milliseconds accumulated_{0};
+    std::chrono::milliseconds dropped_{0};
+};
+
 class Ticker : public std::enable_shared_from_this<Ticker> {
 
 public:
@@ -19,15 +64,24 @@ public:
     using Handler = std::function<void(std::chrono::milliseconds delta)>;
 
     // Функция handler будет вызываться внутри strand с интервалом period
-    Ticker(Strand strand, std::chrono::milliseconds period, Handler handler)
+    // для каждого шага, на которые options делят прошедшее время
+    Ticker(Strand strand, std::chrono::milliseconds period, Handler handler, TickOptions options = {})
         : strand_{strand}
         , period_{period}
-        , handler_{std::move(handler)} {
+        , handler_{std::move(handler)}
+        , stepper_{options} {
+    }
+
+    // Вызывать до запуска ioc или из strand
+    void SetOptions(TickOptions options) {
+        stepper_ = Stepper{options};
     }
 
     void Start() {
         net::dispatch(strand_, [self = shared_from_this()] {
-            self->last_tick_ = Clock::now();
+            self->start_ = Clock::now();
+            self->last_tick_ = self->start_;
+            self->deadline_ = self->start_;
             self->ScheduleTick();
         });
     }
@@ -35,7 +89,10 @@ public:
 private:
     void ScheduleTick() {
         assert(strand_.running_in_this_thread());
-        timer_.expires_after(period_);
+        // Тики привязаны к расписанию, а не ко времени окончания предыдущего тика,
+        // поэтому длительность обработки не копится в дрейф
+        deadline_ += period_;
+        timer_.expires_at(deadline_);
         timer_.async_wait([self = shared_from_this()](sys::error_code ec) {
             self->OnTick(ec);
         });
@@ -46,12 +103,33 @@ private:
         assert(strand_.running_in_this_thread());
 
         if (!ec) {
+            metrics::Registry& registry = metrics::Registry::GetInstance();
+
             auto this_tick = Clock::now();
+            registry.tick_jitter.Record(this_tick - deadline_);
+
             auto delta = duration_cast<milliseconds>(this_tick - last_tick_);
-            last_tick_ = this_tick;
-            try {
-                handler_(delta);
-            } catch (...) {
+            // Остаток меньше миллисекунды не теряется
+            last_tick_ += delta;
+
+            auto dropped = stepper_.GetDropped();
+            stepper_.Advance(delta, [this, &registry](milliseconds step) {
+                registry.tick_steps.Add();
+                simulated_ += step;
+                try {
+                    handler_(step);
+                } catch (...) {
+                }
+            });
+            registry.tick_dropped_ms.Add((stepper_.GetDropped() - dropped).count());
+            // Насколько игровое время отстало от настоящего
+            registry.tick_drift_ms.Set(duration_cast<milliseconds>(last_tick_ - start_ - simulated_).count());
+
+            // Тик занял больше периода: следующий пропущен, расписание сдвигается
+            auto now = Clock::now();
+            if (now >= deadline_ + period_) {
+                registry.tick_overruns.Add();
+                deadline_ = now;
             }
             ScheduleTick();
         }
@@ -63,7 +141,49 @@ private:
     std::chrono::milliseconds period_;
     net::steady_timer timer_{strand_};
     Handler handler_;
-    std::chrono::steady_clock::time_point last_tick_;
+    Stepper stepper_;
+    Clock::time_point start_;
+    Clock::time_point last_tick_;
+    Clock::time_point deadline_;
+    std::chrono::milliseconds simulated_{0};
 };
 
+//===================================Templates implementation============================================
+
+template <typename Step>
+void Stepper::Advance(std::chrono::milliseconds elapsed, Step&& step) {
+    using namespace std::chrono_literals;
+
+    if (options_.fixed_step > 0ms) {
+        accumulated_ += elapsed;
+        if (options_.overrun == OverrunPolicy::drop && accumulated_ >= 2 * options_.fixed_step) {
+            std::chrono::milliseconds excess = accumulated_ - accumulated_ % options_.fixed_step - options_.fixed_step;
+            dropped_ += excess;
+            accumulated_ -= excess;
+        }
+        while (accumulated_ >= options_.fixed_step) {
+            accumulated_ -= options_.fixed_step;
+            step(options_.fixed_step);
+        }
+        return;
+    }
+
+    if (options_.max_delta == 0ms || elapsed <= options_.max_delta) {
+        step(elapsed);
+        return;
+    }
+
+    if (options_.overrun == OverrunPolicy::drop) {
+        dropped_ += elapsed - options_.max_delta;
+        step(options_.max_delta);
+        return;
+    }
+
+    while (elapsed > 0ms) {
+        std::chrono::milliseconds delta = std::min(elapsed, options_.max_delta);
+        elapsed -= delta;
+        step(delta);
+    }
+}
+
 } // namespace ticker
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace timing_wheel {
+
+// Иерархическое колесо таймеров с шагом в 1 мс. На каждом из LEVELS уровней 64 ячейки,
+// ячейка уровня k накрывает 64^k мс. Срок кладётся на самый нижний уровень, в окне
+// которого он лежит, и по мере хода времени переносится на уровни ниже.
+// Занятые ячейки отмечены битами, поэтому пустые промежутки пропускаются сразу,
+// и продвижение стоит O(сработавших + перенесённых), а не O(всех таймеров).
+// Отмены нет: владелец сам проверяет, актуален ли сработавший срок
+template <typename Id>
+class TimingWheel {
+public:
+    static constexpr size_t LEVELS = 4;
+    static constexpr uint64_t NEVER = std::numeric_limits<uint64_t>::max();
+
+    // Срок раньше текущего момента сработает при следующем Advance
+    void Schedule(Id id, uint64_t deadline) {
+        Place({id, std::max(deadline, current_)});
+    }
+
+    // Вызывает fire(id, deadline) для всех сроков не позже now в порядке возрастания.
+    // Из fire нельзя вызывать Schedule
+    template <typename Fire>
+    void Advance(uint64_t now, Fire&& fire);
+
+    // Ближайший момент, когда что-то сработает или перенесётся на нижний уровень.
+    // Раньше него Advance ничего не делает. NEVER, если колесо пусто
+    uint64_t GetNextEventTime() const;
+
+    size_t GetSize() const {
+        return size_;
+    }
+
+private:
+    static constexpr size_t BITS = 6;
+    static constexpr size_t SLOTS = 1 << BITS;
+    static constexpr uint64_t SLOT_MASK = SLOTS - 1;
+    static constexpr size_t RANGE_BITS = BITS * LEVELS;
+
+    struct Entry {
+        Id id;
+        uint64_t deadline;
+    };
+
+    struct Level {
+        std::array<std::vector<Entry>, SLOTS> slots;
+        uint64_t occupied = 0;
+    };
+
+    static size_t GetSlot(uint64_t time, size_t level) {
+        return (time >> (BITS * level)) & SLOT_MASK;
+    }
+
+    void Place(Entry entry);
+
+    // Переносит ячейку уровня level, в которую вошёл current_, на нижние уровни
+    void Cascade(size_t level);
+
+    std::array<Level, LEVELS> levels_;
+    // Сроки дальше всех уровней
+    std::vector<Entry> overflow_;
+    // Первый ещё не обработанный момент
+    uint64_t current_ = 0;
+    size_t size_ = 0;
+};
+
+//===================================Templates implementation============================================
+
+template <typename Id>
+void TimingWheel<Id>::Place(Entry entry) {
+    ++size_;
+    for (size_t level = 0; level < LEVELS; ++level) {
+        size_t window_bits = BITS * (level + 1);
+        if ((entry.deadline >> window_bits) == (current_ >> window_bits)) {
+            size_t slot = GetSlot(entry.deadline, level);
+            levels_[level].slots[slot].push_back(entry);
+            levels_[level].occupied |= 1ull << slot;
+            return;
+        }
+    }
+    overflow_.push_back(entry);
+}
+
+template <typename Id>
+void TimingWheel<Id>::Cascade(size_t level) {
+    size_t slot = GetSlot(current_, level);
+    Level& source = levels_[level];
+    if (!(source.occupied & (1ull << slot))) {
+        return;
+    }
+
+    std::vector<Entry> entries;
+    entries.swap(source.slots[slot]);
+    source.occupied &= ~(1ull << slot);
+    size_ -= entries.size();
+
+    for (const Entry& entry : entries) {
+        Place(entry);
+    }
+}
+
+template <typename Id>
+uint64_t TimingWheel<Id>::GetNextEventTime() const {
+    uint64_t result = NEVER;
+
+    for (size_t level = 0; level < LEVELS; ++level) {
+        // Ячейки раньше текущей на уровне уже пусты
+        uint64_t pending = levels_[level].occupied & (~0ull << GetSlot(current_, level));
+        if (pending == 0) {
+            continue;
+        }
+        size_t window_bits = BITS * (level + 1);
+        uint64_t window_start = (current_ >> window_bits) << window_bits;
+        uint64_t time = window_start + (static_cast<uint64_t>(std::countr_zero(pending)) << (BITS * level));
+        result = std::min(result, std::max(time, current_));
+    }
+
+    if (!overflow_.empty()) {
+        uint64_t time = ((current_ >> RANGE_BITS) + 1) << RANGE_BITS;
+        if ((current_ & ((1ull << RANGE_BITS) - 1)) == 0) {
+            time = current_;
+        }
+        result = std::min(result, time);
+    }
+    return result;
+}
+
+template <typename Id>
+template <typename Fire>
+void TimingWheel<Id>::Advance(uint64_t now, Fire&& fire) {
+    while (true) {
+        uint64_t next = GetNextEventTime();
+        if (next > now) {
+            // Ни один срок и ни один перенос не пропускаются
+            current_ = std::max(current_, now + 1);
+            return;
+        }
+        current_ = next;
+
+        if ((current_ & ((1ull << RANGE_BITS) - 1)) == 0 && !overflow_.empty()) {
+            std::vector<Entry> entries;
+            entries.swap(overflow_);
+            size_ -= entries.size();
+            for (const Entry& entry : entries) {
+                Place(entry);
+            }
+        }
+        for (size_t level = LEVELS - 1; level > 0; --level) {
+            if ((current_ & ((1ull << (BITS * level)) - 1)) == 0) {
+                Cascade(level);
+            }
+        }
+
+        // В ячейке нулевого уровня лежат сроки ровно current_
+        size_t slot = GetSlot(current_, 0);
+        if (levels_[0].occupied & (1ull << slot)) {
+            std::vector<Entry> entries;
+            entries.swap(levels_[0].slots[slot]);
+            levels_[0].occupied &= ~(1ull << slot);
+            size_ -= entries.size();
+            for (const Entry& entry : entries) {
+                fire(entry.id, entry.deadline);
+            }
+        }
+        ++current_;
+    }
+}
+
+} // namespace timing_wheel
@@ -0,0 +1,155 @@
+#include "traffic_capture.h"
+
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include "binary_io.h"
+#include "json_keys.h"
+
+namespace traffic_capture {
+
+using namespace std::literals;
+
+namespace detail {
+
+const std::string_view FILE_SIGNATURE = "GSCAPv1\n"sv;
+
+// Запись длиннее считается повреждённой
+const uint32_t MAX_RECORD_SIZE = 64 << 20;
+
+} // namespace detail
+
+void WriteFileHeader(std::ostream& out) {
+    out.write(detail::FILE_SIGNATURE.data(), detail::FILE_SIGNATURE.size());
+}
+
+bool ReadFileHeader(std::istream& in) {
+    std::string signature(detail::FILE_SIGNATURE.size(), '\0');
+    in.read(signature.data(), signature.size());
+    return in && signature == detail::FILE_SIGNATURE;
+}
+
+void WriteRecord(std::ostream& out, const Record& record) {
+    std::string data;
+    binary_io::Put(data, record.timestamp_us);
+    binary_io::Put(data, record.latency_us);
+    binary_io::Put(data, record.method);
+    binary_io::Put(data, record.status);
+    binary_io::PutString<uint16_t>(data, record.target);
+    binary_io::Put(data, static_cast<uint8_t>(record.headers.size()));
+    for (const auto& [field, value] : record.headers) {
+        binary_io::Put(data, field);
+        binary_io::PutString<uint16_t>(data, value);
+    }
+    binary_io::PutString<uint32_t>(data, record.body);
+    binary_io::PutString<uint8_t>(data, record.issued_token);
+
+    uint32_t size = data.size();
+    out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    out.write(data.data(), data.size());
+}
+
+std::optional<Record> ReadRecord(std::istream& in) {
+    uint32_t size;
+    if (!in.read(reinterpret_cast<char*>(&size), sizeof(size)) || size > detail::MAX_RECORD_SIZE) {
+        return std::nullopt;
+    }
+
+    std::string data(size, '\0');
+    if (!in.read(data.data(), size)) {
+        return std::nullopt;
+    }
+
+    try {
+        binary_io::Reader reader{data};
+        Record record;
+        record.timestamp_us = reader.Get<uint64_t>();
+        record.latency_us = reader.Get<uint32_t>();
+        record.method = reader.Get<uint16_t>();
+        record.status = reader.Get<uint16_t>();
+        record.target = reader.GetString<uint16_t>();
+        uint8_t headers = reader.Get<uint8_t>();
+        for (uint8_t i = 0; i < headers; ++i) {
+            uint16_t field = reader.Get<uint16_t>();
+            record.headers.emplace_back(field, reader.GetString<uint16_t>());
+        }
+        record.body = reader.GetString<uint32_t>();
+        record.issued_token = reader.GetString<uint8_t>();
+        return record;
+    } catch (const std::runtime_error&) {
+        return std::nullopt;
+    }
+}
+
+Capture& Capture::GetInstance() {
+    static Capture capture;
+    return capture;
+}
+
+void Capture::Enable(const std::filesystem::path& file) {
+    std::lock_guard lock{out_mutex_};
+
+    out_.open(file, std::ios::binary);
+    if (!out_) {
+        throw std::runtime_error("Failed to open traffic capture file " + file.string());
+    }
+    WriteFileHeader(out_);
+
+    start_ = std::chrono::steady_clock::now();
+    enabled_ = true;
+}
+
+uint64_t Capture::GetTimestamp(std::chrono::steady_clock::time_point time) const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time - start_).count();
+}
+
+std::string Capture::Pseudonymize(std::string_view token) {
+    std::lock_guard lock{tokens_mutex_};
+
+    auto it = pseudonyms_.find(std::string{token});
+    if (it != pseudonyms_.end()) {
+        return it->second;
+    }
+
+    // Псевдоним той же длины, чтобы запрос проходил те же проверки формата
+    std::ostringstream pseudonym;
+    pseudonym << std::hex << std::setfill('0') << std::setw(token.size()) << pseudonyms_.size() + 1;
+
+    return pseudonyms_.emplace(std::string{token}, pseudonym.str()).first->second;
+}
+
+std::string Capture::PseudonymizeAuthorization(std::string_view value) {
+    if (!value.starts_with(json_keys::token_prefix)) {
+        return std::string{value};
+    }
+    return json_keys::token_prefix + Pseudonymize(value.substr(json_keys::token_prefix.size()));
+}
+
+void Capture::Write(const Record& record) {
+    std::lock_guard lock{out_mutex_};
+    WriteRecord(out_, record);
+}
+
+void Capture::Flush() {
+    std::lock_guard lock{out_mutex_};
+    out_.flush();
+}
+
+std::optional<std::string_view> FindIssuedToken(std::string_view body) {
+    std::string key = "\""s + json_keys::auth_token_key + "\":\""s;
+
+    size_t start = body.find(key);
+    if (start == body.npos) {
+        return std::nullopt;
+    }
+    start += key.size();
+
+    size_t end = body.find('"', start);
+    if (end == body.npos) {
+        return std::nullopt;
+    }
+    return body.substr(start, end - start);
+}
+
+} // namespace traffic_capture
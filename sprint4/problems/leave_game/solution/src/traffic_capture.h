@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace traffic_capture {
+
+// Один запрос и итог его обработки. method и заголовки хранятся как числовые
+// значения boost::beast::http::verb и http::field
+struct Record {
+    // Микросекунды от начала записи до получения запроса
+    uint64_t timestamp_us = 0;
+    uint32_t latency_us = 0;
+    uint16_t method = 0;
+    uint16_t status = 0;
+    std::string target;
+    std::vector<std::pair<uint16_t, std::string>> headers;
+    std::string body;
+    // Псевдоним токена, выданного в ответ на /join
+    std::string issued_token;
+
+    bool operator==(const Record&) const = default;
+};
+
+// Формат файла: сигнатура, затем записи с префиксом длины.
+// Числа пишутся в порядке байт машины, на которой сделана запись
+void WriteFileHeader(std::ostream& out);
+
+bool ReadFileHeader(std::istream& in);
+
+void WriteRecord(std::ostream& out, const Record& record);
+
+// nullopt в конце файла или на оборванной записи
+std::optional<Record> ReadRecord(std::istream& in);
+
+// Запись трафика сервера. Токены заменяются псевдонимами той же длины,
+// одинаковыми для одного токена на всё время записи
+class Capture {
+public:
+    static Capture& GetInstance();
+
+    void Enable(const std::filesystem::path& file);
+
+    bool IsEnabled() const {
+        return enabled_;
+    }
+
+    uint64_t GetTimestamp(std::chrono::steady_clock::time_point time) const;
+
+    std::string Pseudonymize(std::string_view token);
+
+    // Заменяет токен в значении заголовка Authorization
+    std::string PseudonymizeAuthorization(std::string_view value);
+
+    void Write(const Record& record);
+
+    void Flush();
+private:
+    Capture() = default;
+
+    bool enabled_ = false;
+    std::chrono::steady_clock::time_point start_;
+
+    std::mutex tokens_mutex_;
+    std::unordered_map<std::string, std::string> pseudonyms_;
+
+    std::mutex out_mutex_;
+    std::ofstream out_;
+};
+
+// Находит значение "authToken" в теле ответа на /join
+std::optional<std::string_view> FindIssuedToken(std::string_view body);
+
+} // namespace traffic_capture
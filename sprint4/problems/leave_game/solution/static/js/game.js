@@ -411,13 +411,24 @@ class GameState {
 
   _updateState(then) {
     let self = this;
-    $.get({
-      url: '/api/v1/game/state',
-      dataType: 'json',
-      beforeSend: function(xhr) {
-        xhr.setRequestHeader("Authorization", "Bearer " + Cookies.get('authToken'));
+    fetch('/api/v1/game/state', {
+      headers: {
+        'Authorization': 'Bearer ' + Cookies.get('authToken'),
+        'Accept': GAME_STATE_TYPE + ', application/json;q=0.5'
+      }
+    }).then(function(response) {
+      if (!response.ok) {
+        return undefined;
+      }
+      // Сервер без бинарного формата отвечает JSON
+      if (response.headers.get('Content-Type') == GAME_STATE_TYPE) {
+        return response.arrayBuffer().then(decodeGameState);
+      }
+      return response.json();
+    }).then(function(x){
+      if (x === undefined) {
+        return;
       }
-    }).done(function(x){
       self.desiredState = x;
       self.stateTime = performance.now();
       then();
@@ -0,0 +1,104 @@
+// Декодер ответов /api/v1/game/state и /api/v1/game/players в формате
+// application/x-game-state (см. src/state_codec.h). Возвращает те же объекты, что и JSON-ответ
+
+const GAME_STATE_TYPE = 'application/x-game-state';
+const GAME_STATE_VERSION = 1;
+const GAME_STATE_KIND_STATE = 1;
+const GAME_STATE_KIND_PLAYERS = 2;
+// Координаты передаются в 1/1024 клетки
+const GAME_STATE_SCALE = 1024;
+// Порядок move_manager::Direction
+const GAME_STATE_DIRECTIONS = ['U', 'R', 'D', 'L'];
+
+class GameStateReader {
+  constructor(buffer) {
+    this.bytes = new Uint8Array(buffer);
+    this.pos = 0;
+  }
+
+  byte() {
+    if (this.pos >= this.bytes.length) {
+      throw new Error('Game state is truncated');
+    }
+    return this.bytes[this.pos++];
+  }
+
+  // Без побитовых операций, чтобы не обрезать числа до 32 бит
+  varint() {
+    let value = 0;
+    let scale = 1;
+    for (;;) {
+      const b = this.byte();
+      value += (b & 0x7f) * scale;
+      if (b < 0x80) {
+        return value;
+      }
+      scale *= 128;
+    }
+  }
+
+  zigzag() {
+    const value = this.varint();
+    return value % 2 == 0 ? value / 2 : -(value + 1) / 2;
+  }
+
+  coord() {
+    return this.zigzag() / GAME_STATE_SCALE;
+  }
+
+  string() {
+    const size = this.varint();
+    const str = new TextDecoder().decode(this.bytes.subarray(this.pos, this.pos + size));
+    this.pos += size;
+    return str;
+  }
+
+  header(kind) {
+    const version = this.byte();
+    if (version != GAME_STATE_VERSION || this.byte() != kind) {
+      throw new Error('Unsupported game state version ' + version);
+    }
+  }
+}
+
+// {players: {id: {pos, speed, dir, bag, score}}, lostObjects: {id: {type, pos}}}
+function decodeGameState(buffer) {
+  const reader = new GameStateReader(buffer);
+  reader.header(GAME_STATE_KIND_STATE);
+
+  const players = {};
+  for (let n = reader.varint(); n > 0; --n) {
+    const id = reader.varint();
+    const pos = [reader.coord(), reader.coord()];
+    const speed = [reader.coord(), reader.coord()];
+    const dir = GAME_STATE_DIRECTIONS[reader.byte()];
+    const score = reader.varint();
+    const bag = [];
+    for (let k = reader.varint(); k > 0; --k) {
+      bag.push({id: reader.varint(), type: reader.varint()});
+    }
+    players[id] = {pos: pos, speed: speed, dir: dir, bag: bag, score: score};
+  }
+
+  const lostObjects = {};
+  for (let n = reader.varint(); n > 0; --n) {
+    const id = reader.varint();
+    const type = reader.varint();
+    lostObjects[id] = {type: type, pos: [reader.coord(), reader.coord()]};
+  }
+
+  return {players: players, lostObjects: lostObjects};
+}
+
+// {id: {name}}
+function decodeGamePlayers(buffer) {
+  const reader = new GameStateReader(buffer);
+  reader.header(GAME_STATE_KIND_PLAYERS);
+
+  const players = {};
+  for (let n = reader.varint(); n > 0; --n) {
+    const id = reader.varint();
+    players[id] = {name: reader.string()};
+  }
+  return players;
+}
@@ -0,0 +1,124 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/admission.h"
+
+using namespace std::literals;
+
+SCENARIO("Token bucket rate limiter") {
+    GIVEN("a limiter with 2 requests per second and burst of 3") {
+        admission::RateLimiter limiter{2., 3.};
+        const admission::Clock::time_point start = admission::Clock::now();
+
+        WHEN("a client sends a burst") {
+            THEN("requests over the burst are rejected") {
+                CHECK(limiter.TryAcquire("client", start));
+                CHECK(limiter.TryAcquire("client", start));
+                CHECK(limiter.TryAcquire("client", start));
+                CHECK_FALSE(limiter.TryAcquire("client", start));
+
+                AND_THEN("other clients are not affected") {
+                    CHECK(limiter.TryAcquire("other", start));
+                }
+
+                AND_THEN("tokens are refilled with time") {
+                    CHECK(limiter.TryAcquire("client", start + 500ms));
+                    CHECK_FALSE(limiter.TryAcquire("client", start + 500ms));
+                    CHECK(limiter.TryAcquire("client", start + 1s));
+                }
+            }
+        }
+
+        THEN("retry after is at least a second") {
+            CHECK(limiter.GetRetryAfter() == 1s);
+            CHECK(admission::RateLimiter(0.25, 1.).GetRetryAfter() == 4s);
+        }
+    }
+
+    GIVEN("more clients than a shard keeps") {
+        admission::RateLimiter limiter{1., 1.};
+        const admission::Clock::time_point start = admission::Clock::now();
+
+        CHECK(limiter.TryAcquire("old", start));
+        CHECK(limiter.TryAcquire("active", start));
+
+        for (size_t i = 0; i < 20 * admission::RateLimiter::MAX_SHARD_KEYS; ++i) {
+            limiter.TryAcquire(std::to_string(i), start);
+            if (i % 100 == 0) {
+                limiter.TryAcquire("active", start);
+            }
+        }
+
+        THEN("recently used clients keep their limits") {
+            CHECK_FALSE(limiter.TryAcquire("active", start));
+        }
+
+        THEN("the least recently used client is evicted") {
+            CHECK(limiter.TryAcquire("old", start));
+        }
+    }
+}
+
+SCENARIO("Admission control") {
+    admission::Admission& admission = admission::Admission::GetInstance();
+
+    GIVEN("limits on connections and token rate") {
+        admission::Limits limits;
+        limits.max_connections = 2;
+        limits.token_rate = 0.5;
+        limits.token_burst = 1;
+        admission.Configure(limits);
+
+        WHEN("connections are opened over the limit") {
+            uint64_t rejected = admission.GetRejectedCount(admission::Reason::connections);
+
+            CHECK(admission.TryOpenConnection());
+            CHECK(admission.TryOpenConnection());
+            CHECK_FALSE(admission.TryOpenConnection());
+
+            THEN("the rejection is counted and a slot is freed on close") {
+                CHECK(admission.GetRejectedCount(admission::Reason::connections) == rejected + 1);
+                admission.CloseConnection();
+                CHECK(admission.TryOpenConnection());
+            }
+
+            admission.CloseConnection();
+            admission.CloseConnection();
+        }
+
+        WHEN("one player sends requests too often") {
+            const std::string_view auth = "Bearer 0123456789abcdef0123456789ABCDEF"sv;
+            CHECK_FALSE(admission.CheckRequest("127.0.0.1"sv, auth).has_value());
+
+            THEN("the next request is rejected by token rate") {
+                CHECK(admission.CheckRequest("127.0.0.1"sv, auth) == admission::Reason::token_rate);
+
+                AND_THEN("requests without token are not limited by it") {
+                    CHECK_FALSE(admission.CheckRequest("127.0.0.1"sv, ""sv).has_value());
+                }
+            }
+        }
+
+        WHEN("requests carry malformed tokens") {
+            THEN("they are not limited by token rate") {
+                CHECK_FALSE(admission.CheckRequest("127.0.0.1"sv, "Bearer abc"sv).has_value());
+                CHECK_FALSE(admission.CheckRequest("127.0.0.1"sv, "Bearer abc"sv).has_value());
+                CHECK_FALSE(admission.CheckRequest("127.0.0.1"sv, "Bearer 0123456789abcdef0123456789abcdeg"sv).has_value());
+                CHECK_FALSE(admission.CheckRequest("127.0.0.1"sv, "Bearer 0123456789abcdef0123456789abcdeg"sv).has_value());
+                CHECK_FALSE(admission.CheckRequest("127.0.0.1"sv, "0123456789abcdef0123456789abcdef"sv).has_value());
+                CHECK_FALSE(admission.CheckRequest("127.0.0.1"sv, "0123456789abcdef0123456789abcdef"sv).has_value());
+            }
+        }
+
+        THEN("rejections are pre-built HTTP responses with Retry-After") {
+            const std::string& too_many = admission.GetRejection(admission::Reason::token_rate);
+            CHECK(too_many.starts_with("HTTP/1.1 429 Too Many Requests\r\n"));
+            CHECK(too_many.find("Retry-After: 2\r\n") != std::string::npos);
+
+            const std::string& overloaded = admission.GetRejection(admission::Reason::connections);
+            CHECK(overloaded.starts_with("HTTP/1.1 503 Service Unavailable\r\n"));
+            CHECK(overloaded.find("Connection: close\r\n") != std::string::npos);
+        }
+
+        admission.Configure({});
+    }
+}
@@ -0,0 +1,74 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include "../src/game_manager.h"
+#include "game-fixtures.h"
+
+namespace {
+
+using game_fixtures::MakeGame;
+using game_fixtures::MakeJoin;
+using game_manager::BatchCommand;
+using game_manager::BatchResult;
+using game_manager::Result;
+using game_manager::Token;
+
+const std::string FIRST_TOKEN = "0123456789abcdef0123456789abcdef";
+const std::string SECOND_TOKEN = "fedcba9876543210fedcba9876543210";
+
+} // namespace
+
+SCENARIO("Batch commands") {
+    boost::asio::io_context ioc;
+    model::Game game = MakeGame();
+    game_manager::GameManager manager{game, ioc, false, 0};
+
+    GIVEN("two players in one session") {
+        std::vector<game_manager::JournalEvent> events;
+        events.push_back(MakeJoin(1, 1, FIRST_TOKEN));
+        events.push_back(MakeJoin(2, 2, SECOND_TOKEN));
+        REQUIRE(manager.Replay(std::move(events)) == 2);
+
+        WHEN("a batch of a move, a state request and an unknown token is applied") {
+            std::vector<BatchCommand> commands;
+            commands.push_back({Token{FIRST_TOKEN}, move_manager::Direction::EAST});
+            commands.push_back({Token{SECOND_TOKEN}, std::nullopt});
+            commands.push_back({Token{std::string(32, '0')}, move_manager::Direction::WEST});
+
+            std::vector<BatchResult> results;
+            manager.Batch(std::move(commands), [&results](std::vector<BatchResult>&& batch_results) {
+                results = std::move(batch_results);
+            });
+            ioc.run();
+
+            THEN("each command gets its own result in order") {
+                REQUIRE(results.size() == 3);
+                CHECK(results[0].result == Result::ok);
+                CHECK_FALSE(results[0].state);
+                CHECK(results[1].result == Result::ok);
+                CHECK(results[2].result == Result::no_token);
+            }
+
+            THEN("state is taken after the moves of the batch") {
+                REQUIRE(results.at(1).state);
+                const auto& players = results[1].state->players;
+                REQUIRE(players.size() == 2);
+                CHECK(players[0].state.dir == move_manager::Direction::EAST);
+                CHECK(players[1].state.dir == move_manager::Direction::NORTH);
+            }
+        }
+
+        WHEN("an empty batch is applied") {
+            bool called = false;
+            manager.Batch({}, [&called](std::vector<BatchResult>&& results) {
+                called = results.empty();
+            });
+            ioc.run();
+
+            THEN("the handler is still called") {
+                CHECK(called);
+            }
+        }
+    }
+}
@@ -0,0 +1,107 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/use_awaitable.hpp>
+
+#include "../src/game_manager.h"
+#include "game-fixtures.h"
+
+namespace {
+
+namespace net = boost::asio;
+using game_fixtures::MakeGame;
+using game_manager::Result;
+using game_manager::Token;
+
+} // namespace
+
+SCENARIO("Game requests as coroutines") {
+    net::io_context ioc;
+    model::Game game = MakeGame();
+    game_manager::GameManager manager{game, ioc, false, 0};
+
+    // Выполняет корутину до конца, пробрасывая её исключения
+    auto run = [&](auto coroutine) {
+        std::exception_ptr error;
+        net::co_spawn(manager.GetExecutor(), std::move(coroutine), [&error](std::exception_ptr e) {
+            error = e;
+        });
+        ioc.restart();
+        ioc.run();
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    };
+
+    GIVEN("a dog joined from a coroutine") {
+        game_manager::PlayerInfo info;
+        run([&]() -> net::awaitable<void> {
+            info = co_await manager.Join("Rex", model::Map::Id{"map1"}, net::use_awaitable);
+        });
+        REQUIRE(info.token.size() == static_cast<size_t>(manager.TOKEN_SIZE));
+
+        WHEN("it moves and the game ticks") {
+            Result moved = Result::no_token;
+            Result ticked = Result::no_token;
+            std::vector<std::string> names;
+            double x = 0.;
+
+            run([&]() -> net::awaitable<void> {
+                moved = co_await manager.MovePlayer(Token{info.token}, move_manager::Direction::EAST,
+                                                    net::use_awaitable);
+                ticked = co_await manager.CallTick(1000, net::use_awaitable);
+                auto [players, res] = co_await manager.GetPlayers(Token{info.token}, net::use_awaitable);
+                // Ссылки из ответа читаются до следующего co_await, пока корутина в strand'е сессии
+                REQUIRE(res == Result::ok);
+                for (const game_manager::Player& player : players->players) {
+                    names.push_back(player.name);
+                }
+                x = fixed_point::ToDouble(players->players.front().state.position.coor.x);
+            });
+
+            THEN("each step completes in order") {
+                CHECK(moved == Result::ok);
+                CHECK(ticked == Result::ok);
+                CHECK(names == std::vector<std::string>{"Rex"});
+                CHECK(x > 0.);
+            }
+        }
+
+        WHEN("a coroutine uses an unknown token") {
+            Result players_result = Result::ok;
+            Result state_result = Result::ok;
+            Result move_result = Result::ok;
+
+            run([&]() -> net::awaitable<void> {
+                Token unknown{std::string(manager.TOKEN_SIZE, '0')};
+                players_result = std::get<1>(co_await manager.GetPlayers(unknown, net::use_awaitable));
+                state_result = std::get<1>(co_await manager.GetState(unknown, net::use_awaitable));
+                move_result = co_await manager.MovePlayer(unknown, move_manager::Direction::NORTH, net::use_awaitable);
+            });
+
+            THEN("the error comes back as a result") {
+                CHECK(players_result == Result::no_token);
+                CHECK(state_result == Result::no_token);
+                CHECK(move_result == Result::no_token);
+            }
+        }
+
+        WHEN("a batch is awaited") {
+            std::vector<game_manager::BatchResult> results;
+            run([&]() -> net::awaitable<void> {
+                std::vector<game_manager::BatchCommand> commands;
+                commands.push_back({Token{info.token}, move_manager::Direction::WEST});
+                commands.push_back({Token{info.token}, std::nullopt});
+                results = co_await manager.Batch(std::move(commands), net::use_awaitable);
+            });
+
+            THEN("results are in the order of commands") {
+                REQUIRE(results.size() == 2);
+                CHECK(results[0].result == Result::ok);
+                CHECK(results[1].result == Result::ok);
+                CHECK(results[1].state);
+            }
+        }
+    }
+}
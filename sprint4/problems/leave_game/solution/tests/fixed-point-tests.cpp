@@ -0,0 +1,174 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <random>
+#include <sstream>
+
+#include "../src/collision_detector.h"
+#include "../src/fixed_point.h"
+#include "../src/move_manager.h"
+
+namespace {
+
+using fixed_point::Fixed;
+
+template <typename S>
+class TestProvider : public collision_detector::BasicItemGathererProvider<S> {
+public:
+    void AddItem(collision_detector::BasicItem<S> item) { items_.push_back(item); }
+    size_t ItemsCount() const override { return items_.size(); }
+    collision_detector::BasicItem<S> GetItem(size_t idx) const override { return items_.at(idx); }
+
+    void AddGatherer(collision_detector::BasicGatherer<S> gatherer) { gatherers_.push_back(gatherer); }
+    size_t GatherersCount() const override { return gatherers_.size(); }
+    collision_detector::BasicGatherer<S> GetGatherer(size_t idx) const override { return gatherers_.at(idx); }
+private:
+    std::vector<collision_detector::BasicItem<S>> items_;
+    std::vector<collision_detector::BasicGatherer<S>> gatherers_;
+};
+
+// Проходит одним и тем же маршрутом по карте и возвращает все промежуточные позиции
+template <typename S>
+std::vector<move_manager::BasicCoords<S>> Walk(const move_manager::Map& map) {
+    const move_manager::Direction route[] = {move_manager::Direction::EAST, move_manager::Direction::SOUTH,
+                                             move_manager::Direction::WEST, move_manager::Direction::NORTH};
+    move_manager::BasicState<S> state;
+    state.position.coor = {0, 0};
+    state.position.area = map.GetStartPlace().area;
+
+    std::vector<move_manager::BasicCoords<S>> result;
+    for (size_t step = 0; step < 200; ++step) {
+        state.dir = route[step / 17 % 4];
+        const S speed = 1.3;
+        switch (state.dir) {
+        case move_manager::Direction::EAST:
+            state.speed = {speed, 0};
+            break;
+        case move_manager::Direction::WEST:
+            state.speed = {-speed, 0};
+            break;
+        case move_manager::Direction::SOUTH:
+            state.speed = {0, speed};
+            break;
+        default:
+            state.speed = {0, -speed};
+        }
+        state.Move(37 + step % 50);
+        result.push_back(state.position.coor);
+    }
+    return result;
+}
+
+} // namespace
+
+SCENARIO("Fixed point numbers") {
+    GIVEN("values converted from double") {
+        Fixed a = 0.4;
+        Fixed b = 0.1;
+        Fixed c = -2.25;
+
+        THEN("they are rounded to 1/1024") {
+            CHECK(a.GetRaw() == 410);
+            CHECK(b.GetRaw() == 102);
+            CHECK(c.GetRaw() == -2304);
+            CHECK(c.ToDouble() == -2.25);
+        }
+
+        THEN("road bounds add up exactly") {
+            CHECK(a + b == Fixed{0.5});
+            CHECK(Fixed{3} - a - b == Fixed{2.5});
+        }
+
+        THEN("scaling by an integer is rounded once") {
+            Fixed speed = 1.3;
+            CHECK((speed * 1000) / 1000 == speed);
+            CHECK(((speed * 7) / 1000).GetRaw() == speed.GetRaw() * 7 / 1000);
+            CHECK(Fixed{2} * Fixed{-1.5} == Fixed{-3});
+            CHECK(-c == Fixed{2.25});
+        }
+
+        THEN("text round-trips the raw value") {
+            std::stringstream stream;
+            stream << c;
+            Fixed read;
+            stream >> read;
+            CHECK(stream.str() == "-2304");
+            CHECK(read == c);
+        }
+    }
+}
+
+SCENARIO("Fixed point movement kernel") {
+    GIVEN("a map with a loop of roads") {
+        std::vector<model::Road> roads{
+            {model::Road::HORIZONTAL, {0, 0}, 10},
+            {model::Road::VERTICAL, {10, 0}, 10},
+            {model::Road::HORIZONTAL, {10, 10}, 0},
+            {model::Road::VERTICAL, {0, 10}, 0}
+        };
+        move_manager::Map map{roads};
+
+        WHEN("the same route is walked with fixed point and double coordinates") {
+            auto fixed = Walk<Fixed>(map);
+            auto floating = Walk<double>(map);
+
+            THEN("fixed point positions stay on the roads and close to double ones") {
+                REQUIRE(fixed.size() == floating.size());
+                for (size_t i = 0; i < fixed.size(); ++i) {
+                    CHECK(map.FindArea({fixed[i].x.ToDouble(), fixed[i].y.ToDouble()}));
+                    CHECK(std::abs(fixed[i].x.ToDouble() - floating[i].x) < 0.05);
+                    CHECK(std::abs(fixed[i].y.ToDouble() - floating[i].y) < 0.05);
+                }
+            }
+
+            THEN("a second walk repeats the first one exactly") {
+                CHECK(Walk<Fixed>(map) == fixed);
+            }
+        }
+    }
+}
+
+SCENARIO("Fixed point collision kernel") {
+    GIVEN("the same gatherers and items in fixed point and double") {
+        TestProvider<Fixed> fixed;
+        TestProvider<double> floating;
+        std::mt19937 generator{3};
+        // Координаты кратны 1/1024, поэтому точно представимы в обоих типах
+        std::uniform_int_distribution<int32_t> coor{0, 100 * Fixed::ONE};
+        std::uniform_int_distribution<int32_t> shift{-5 * Fixed::ONE, 5 * Fixed::ONE};
+        auto make = [](int32_t raw) {
+            return Fixed::FromRaw(raw);
+        };
+
+        for (size_t i = 0; i < 400; ++i) {
+            int32_t x = coor(generator);
+            int32_t y = coor(generator);
+            fixed.AddItem({{make(x), make(y)}, 0.25, false});
+            floating.AddItem({{make(x).ToDouble(), make(y).ToDouble()}, 0.25, false});
+        }
+        for (size_t g = 0; g < 400; ++g) {
+            int32_t x = coor(generator);
+            int32_t y = coor(generator);
+            int32_t end_x = g % 2 ? x + shift(generator) : x;
+            int32_t end_y = g % 2 ? y : y + shift(generator);
+            fixed.AddGatherer({{make(x), make(y)}, {make(end_x), make(end_y)}, 0.3125});
+            floating.AddGatherer({{make(x).ToDouble(), make(y).ToDouble()},
+                                  {make(end_x).ToDouble(), make(end_y).ToDouble()}, 0.3125});
+        }
+
+        WHEN("gather events are found") {
+            auto fixed_events = collision_detector::FindGatherEvents(fixed);
+            auto floating_events = collision_detector::FindGatherEvents(floating);
+
+            THEN("both kernels find the same events") {
+                REQUIRE(!fixed_events.empty());
+                REQUIRE(fixed_events.size() == floating_events.size());
+                for (size_t i = 0; i < fixed_events.size(); ++i) {
+                    CHECK(fixed_events[i].gatherer_id == floating_events[i].gatherer_id);
+                    CHECK(fixed_events[i].item_id == floating_events[i].item_id);
+                    CHECK(fixed_events[i].time == floating_events[i].time);
+                    CHECK(std::abs(fixed_events[i].sq_distance - floating_events[i].sq_distance) < 1e-9);
+                }
+            }
+        }
+    }
+}
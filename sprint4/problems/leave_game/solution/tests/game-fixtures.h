@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+
+#include "../src/game_manager.h"
+
+// Общие для тестов игра и события журнала
+namespace game_fixtures {
+
+// Карта map1: горизонтальная дорога от (0, 0) длиной road_length и один тип лута
+inline model::Map MakeMap(model::MapConfig map_config = {1.}, model::Coord road_length = 10) {
+    model::Map map{model::Map::Id{"map1"}, "Map 1", map_config};
+    map.AddRoad({model::Road::HORIZONTAL, {0, 0}, road_length});
+    model::LootType type;
+    type.value = 10;
+    map.AddLootType(type);
+    return map;
+}
+
+inline model::GameConfig MakeConfig() {
+    model::GameConfig config;
+    config.loot_config = {5., 0.5};
+    return config;
+}
+
+inline model::Game MakeGame(model::GameConfig config = MakeConfig(), model::Map map = MakeMap()) {
+    model::Game game{config};
+    game.AddMap(std::move(map));
+    return game;
+}
+
+// Вход игрока на map1, по умолчанию в начале дороги
+inline game_manager::JournalEvent MakeJoin(uint64_t seq, game_manager::PlayerId id, std::string token,
+                                           std::string name = "Rex", move_manager::Coords position = {0.1, 0.}) {
+    game_manager::JournalEvent event = game_manager::JournalEvent::Join(
+        id, std::move(token), std::move(name), "map1", position
+    );
+    event.seq = seq;
+    return event;
+}
+
+} // namespace game_fixtures
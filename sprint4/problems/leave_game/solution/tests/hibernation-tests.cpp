@@ -0,0 +1,124 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include "../src/game_manager.h"
+#include "game-fixtures.h"
+
+namespace {
+
+using game_manager::Result;
+using game_manager::Retiree;
+using game_manager::Token;
+
+const std::string TOKEN = "0123456789abcdef0123456789abcdef";
+
+model::Game MakeGame() {
+    model::GameConfig config = game_fixtures::MakeConfig();
+    config.retirement_time = 10.;
+    return game_fixtures::MakeGame(config);
+}
+
+class RecordSaverMock : public game_manager::RecordSaverInterface {
+public:
+    void Save(std::vector<Retiree>&& retirees) override {
+        std::move(retirees.begin(), retirees.end(), std::back_inserter(saved));
+    }
+
+    std::vector<Retiree> GetRecords(size_t, size_t) override {
+        return saved;
+    }
+
+    std::vector<Retiree> saved;
+};
+
+} // namespace
+
+SCENARIO("Idle session hibernation") {
+    boost::asio::io_context ioc;
+    model::Game game = MakeGame();
+    game_manager::GameManager manager{game, ioc, false, 0};
+    auto saver = std::make_shared<RecordSaverMock>();
+    manager.SetRecordSaver(saver);
+    manager.SetSessionGracePeriod(5000);
+
+    std::vector<game_manager::JournalEvent> events;
+    events.push_back(game_fixtures::MakeJoin(1, 1, TOKEN));
+    REQUIRE(manager.Replay(std::move(events)) == 1);
+
+    auto run = [&ioc] {
+        ioc.restart();
+        ioc.run();
+    };
+
+    auto tick = [&](uint64_t duration, size_t count = 1) {
+        for (size_t i = 0; i < count; ++i) {
+            manager.CallTick(duration, [](Result) {});
+            run();
+        }
+    };
+
+    auto get_player = [&]() -> std::optional<game_manager::Player> {
+        std::optional<game_manager::Player> player;
+        manager.GetPlayers(Token{TOKEN},
+            [&player](const std::optional<game_manager::PlayersAndObjects>& players, Result res) {
+                if (res == Result::ok) {
+                    player = players->players.front();
+                }
+            });
+        run();
+        return player;
+    };
+
+    GIVEN("a session with one idle player") {
+        tick(1000, 4);
+
+        THEN("the session hibernates") {
+            CHECK(metrics::Registry::GetInstance().hibernating_sessions.Get() == 1);
+        }
+
+        THEN("skipped time is applied when the state is read") {
+            REQUIRE(get_player());
+            tick(1000, 6);
+            CHECK_FALSE(get_player());
+            REQUIRE(saver->saved.size() == 1);
+            CHECK(saver->saved[0].game_time == 10000);
+        }
+
+        WHEN("the player moves") {
+            manager.MovePlayer(Token{TOKEN}, move_manager::Direction::EAST, [](Result) {});
+            run();
+            tick(1000);
+
+            THEN("the session is ticked again") {
+                auto player = get_player();
+                REQUIRE(player);
+                CHECK(player->state.position.coor.x > 1.);
+            }
+
+            THEN("idle time starts over") {
+                tick(1000, 9);
+                CHECK(get_player());
+            }
+        }
+
+        WHEN("the retirement time passes") {
+            tick(1000, 6);
+
+            THEN("the player retires on time") {
+                CHECK_FALSE(get_player());
+                REQUIRE(saver->saved.size() == 1);
+                CHECK(saver->saved[0].game_time == 10000);
+            }
+
+            AND_WHEN("the session stays empty for the grace period") {
+                REQUIRE(manager.GetRepresentation().sessions.size() == 1);
+                tick(1000, 6);
+
+                THEN("it is reclaimed") {
+                    CHECK(manager.GetRepresentation().sessions.empty());
+                }
+            }
+        }
+    }
+}
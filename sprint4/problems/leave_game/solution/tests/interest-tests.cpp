@@ -0,0 +1,217 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include "../src/game_manager.h"
+#include "../src/interest_grid.h"
+#include "game-fixtures.h"
+
+#include <algorithm>
+#include <array>
+#include <random>
+
+namespace {
+
+using namespace std::literals;
+
+using game_manager::JournalEvent;
+using game_manager::JournalEventType;
+using game_manager::PlayersAndObjects;
+using game_manager::Result;
+using game_manager::Token;
+
+struct Point {
+    double x;
+    double y;
+};
+
+std::vector<uint32_t> FindNear(const interest_grid::InterestGrid& grid, Point center, double radius) {
+    std::vector<uint32_t> result;
+    grid.ForEachNear(center.x, center.y, radius, [&result](uint32_t i) {
+        result.push_back(i);
+    });
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::vector<uint32_t> FindNearBruteForce(const std::vector<Point>& points, Point center, double radius) {
+    std::vector<uint32_t> result;
+    for (uint32_t i = 0; i < points.size(); ++i) {
+        double dx = points[i].x - center.x;
+        double dy = points[i].y - center.y;
+        if (dx * dx + dy * dy <= radius * radius) {
+            result.push_back(i);
+        }
+    }
+    return result;
+}
+
+std::string MakeToken(size_t index) {
+    std::string result = std::to_string(index);
+    return std::string(32 - result.size(), '0') + result;
+}
+
+model::Game MakeGame(double interest_radius) {
+    model::GameConfig config;
+    config.loot_config = {1000., 0.};
+
+    model::MapConfig map_config;
+    map_config.dog_speed = 10.;
+    map_config.interest_radius = interest_radius;
+    return game_fixtures::MakeGame(config, game_fixtures::MakeMap(map_config, 100));
+}
+
+// Собаки в точках 0, 5 и 50 дороги, лут в 3 и 40
+std::vector<JournalEvent> MakeEvents() {
+    std::vector<JournalEvent> events;
+    uint64_t seq = 0;
+    for (size_t i = 0; i < 3; ++i) {
+        events.push_back(game_fixtures::MakeJoin(++seq, i, MakeToken(i), "Dog"s + std::to_string(i),
+                                                 {std::array{0., 5., 50.}[i], 0.}));
+    }
+    for (size_t i = 0; i < 2; ++i) {
+        JournalEvent loot{JournalEventType::loot};
+        loot.seq = ++seq;
+        loot.loot_id = i;
+        loot.position = {std::array{3., 40.}[i], 0.};
+        events.push_back(std::move(loot));
+    }
+    return events;
+}
+
+struct Visible {
+    std::vector<size_t> players;
+    std::vector<size_t> objects;
+};
+
+Visible GetState(game_manager::GameManager& manager, boost::asio::io_context& ioc, size_t player) {
+    Visible result;
+    manager.GetState(Token{MakeToken(player)},
+                     [&result](const std::optional<PlayersAndObjects>& state, Result res) {
+        REQUIRE(res == Result::ok);
+        size_t players = state->visible_players ? state->visible_players->size() : state->players.size();
+        for (size_t i = 0; i < players; ++i) {
+            result.players.push_back(state->players[state->visible_players ? (*state->visible_players)[i] : i].id);
+        }
+        size_t objects = state->visible_objects ? state->visible_objects->size() : state->objects.size();
+        for (size_t i = 0; i < objects; ++i) {
+            result.objects.push_back(state->objects[state->visible_objects ? (*state->visible_objects)[i] : i].id);
+        }
+    });
+    ioc.run();
+    ioc.restart();
+    return result;
+}
+
+} // namespace
+
+SCENARIO("Interest grid") {
+    GIVEN("random points") {
+        std::mt19937 generator{3};
+        std::uniform_real_distribution<double> coor{-50., 150.};
+        std::vector<Point> points;
+        for (size_t i = 0; i < 500; ++i) {
+            points.push_back({coor(generator), coor(generator)});
+        }
+
+        for (double radius : {0.5, 10., 40., 500.}) {
+            WHEN("the grid is built with radius " + std::to_string(radius)) {
+                interest_grid::InterestGrid grid;
+                grid.Build(points.size(), radius, [&points](size_t i) {
+                    return points[i];
+                });
+
+                THEN("neighbours are the same as found by brute force") {
+                    CHECK(grid.GetSize() == points.size());
+                    for (size_t i = 0; i < points.size(); i += 7) {
+                        CHECK(FindNear(grid, points[i], radius) == FindNearBruteForce(points, points[i], radius));
+                    }
+                    // Центр вне сетки
+                    Point outside{-100., 200.};
+                    CHECK(FindNear(grid, outside, radius) == FindNearBruteForce(points, outside, radius));
+                }
+            }
+        }
+    }
+
+    GIVEN("points on one road") {
+        std::vector<Point> points{{0., 0.}, {1., 0.}, {2., 0.}, {30., 0.}};
+        interest_grid::InterestGrid grid;
+        grid.Build(points.size(), 1.5, [&points](size_t i) {
+            return points[i];
+        });
+
+        THEN("only close points are found") {
+            CHECK(FindNear(grid, {1., 0.}, 1.5) == std::vector<uint32_t>{0, 1, 2});
+            CHECK(FindNear(grid, {30., 1.}, 1.5) == std::vector<uint32_t>{3});
+        }
+    }
+
+    GIVEN("an empty grid") {
+        interest_grid::InterestGrid grid;
+        grid.Build(0, 10., [](size_t) {
+            return Point{0., 0.};
+        });
+
+        THEN("nothing is found") {
+            CHECK(FindNear(grid, {0., 0.}, 10.).empty());
+        }
+    }
+}
+
+SCENARIO("Area of interest state") {
+    boost::asio::io_context ioc;
+
+    GIVEN("a map with the interest radius") {
+        model::Game game = MakeGame(10.);
+        game_manager::GameManager manager{game, ioc, false, 0};
+        manager.Replay(MakeEvents());
+
+        WHEN("players request the state") {
+            THEN("they see only nearby dogs and loot, themselves included") {
+                Visible first = GetState(manager, ioc, 0);
+                CHECK(first.players == std::vector<size_t>{0, 1});
+                CHECK(first.objects == std::vector<size_t>{0});
+
+                Visible far = GetState(manager, ioc, 2);
+                CHECK(far.players == std::vector<size_t>{2});
+                CHECK(far.objects == std::vector<size_t>{1});
+            }
+        }
+
+        WHEN("a dog runs towards the others") {
+            manager.MovePlayer(Token{MakeToken(2)}, move_manager::Direction::WEST, [](Result) {});
+            ioc.run();
+            ioc.restart();
+            // 36 клеток на запад: из 50 в 14, по пути подобран лут в 40
+            manager.CallTick(3600, [](Result) {});
+            ioc.run();
+            ioc.restart();
+
+            THEN("the grid follows it") {
+                Visible second = GetState(manager, ioc, 1);
+                CHECK(second.players == std::vector<size_t>{0, 1, 2});
+                CHECK(second.objects == std::vector<size_t>{0});
+
+                Visible first = GetState(manager, ioc, 0);
+                CHECK(first.players == std::vector<size_t>{0, 1});
+
+                Visible moved = GetState(manager, ioc, 2);
+                CHECK(moved.players == std::vector<size_t>{1, 2});
+                CHECK(moved.objects.empty());
+            }
+        }
+    }
+
+    GIVEN("a map without the interest radius") {
+        model::Game game = MakeGame(0.);
+        game_manager::GameManager manager{game, ioc, false, 0};
+        manager.Replay(MakeEvents());
+
+        THEN("every player sees the whole session") {
+            Visible far = GetState(manager, ioc, 2);
+            CHECK(far.players == std::vector<size_t>{0, 1, 2});
+            CHECK(far.objects == std::vector<size_t>{0, 1});
+        }
+    }
+}
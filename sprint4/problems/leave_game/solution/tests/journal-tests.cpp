@@ -0,0 +1,209 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <filesystem>
+#include <fstream>
+
+#include "../src/game_journal.h"
+#include "../src/game_manager.h"
+#include "game-fixtures.h"
+
+namespace {
+
+using game_fixtures::MakeGame;
+using game_fixtures::MakeJoin;
+using game_manager::JournalEvent;
+using game_manager::JournalEventType;
+
+JournalEvent MakeMove(uint64_t seq, game_manager::PlayerId id, move_manager::Direction dir) {
+    JournalEvent event = JournalEvent::Move(id, dir);
+    event.seq = seq;
+    return event;
+}
+
+JournalEvent MakeTick(uint64_t seq, uint64_t duration) {
+    JournalEvent event = JournalEvent::Tick(duration);
+    event.seq = seq;
+    return event;
+}
+
+class JournalMock : public game_manager::JournalInterface {
+public:
+    void Append(JournalEvent&& event) override {
+        events.push_back(std::move(event));
+    }
+
+    std::vector<JournalEvent> events;
+};
+
+std::filesystem::path TempJournalPath() {
+    return std::filesystem::temp_directory_path() / "game_journal_test.journal";
+}
+
+} // namespace
+
+SCENARIO("Journal event formatting") {
+    GIVEN("a join event with quoted name") {
+        JournalEvent event = MakeJoin(3, 7, "0123456789abcdef0123456789abcdef", "Dog \"Rex\"");
+        event.session_id = 2;
+
+        WHEN("it is formatted and parsed back") {
+            auto parsed = game_journal::Journal::ParseEvent(game_journal::Journal::FormatEvent(event));
+
+            THEN("all fields are restored") {
+                REQUIRE(parsed.has_value());
+                CHECK(parsed->type == JournalEventType::join);
+                CHECK(parsed->session_id == 2);
+                CHECK(parsed->seq == 3);
+                CHECK(parsed->player_id == 7);
+                CHECK(parsed->token == event.token);
+                CHECK(parsed->name == event.name);
+                CHECK(parsed->map_name == event.map_name);
+                CHECK(parsed->position == event.position);
+            }
+        }
+
+        WHEN("the line is cut off") {
+            std::string line = game_journal::Journal::FormatEvent(event);
+            line.resize(line.size() / 2);
+
+            THEN("it is rejected") {
+                CHECK_FALSE(game_journal::Journal::ParseEvent(line).has_value());
+            }
+        }
+    }
+}
+
+SCENARIO("Journal group commit and rotation") {
+    const auto path = TempJournalPath();
+    std::filesystem::remove(path);
+
+    GIVEN("a journal with appended events") {
+        game_journal::Journal journal{path};
+        journal.Append(MakeJoin(1, 0, "t0"));
+        journal.Append(MakeTick(2, 100));
+
+        THEN("nothing is read before commit") {
+            CHECK(journal.Load().empty());
+        }
+
+        WHEN("tick is notified") {
+            journal.Notify(100);
+
+            THEN("events are written to file") {
+                CHECK(journal.Load().size() == 2);
+            }
+
+            AND_WHEN("journal is rotated and new events are committed") {
+                journal.Rotate();
+                journal.Append(MakeTick(3, 100));
+                journal.Commit();
+
+                THEN("both parts are loaded in order") {
+                    auto events = journal.Load();
+                    REQUIRE(events.size() == 3);
+                    CHECK(events.at(2).seq == 3);
+                }
+
+                AND_WHEN("rotated part is dropped") {
+                    journal.DropRotated();
+
+                    THEN("only new events remain") {
+                        CHECK(journal.Load().size() == 1);
+                    }
+                }
+            }
+        }
+    }
+
+    std::filesystem::remove(path);
+}
+
+SCENARIO("Journal replay") {
+    boost::asio::io_context ioc;
+    model::Game game = MakeGame();
+    game_manager::GameManager manager{game, ioc, false, 0};
+
+    GIVEN("a join, a move and a tick") {
+        std::vector<JournalEvent> events;
+        events.push_back(MakeJoin(1, 5, "token"));
+        events.push_back(MakeMove(2, 5, move_manager::Direction::EAST));
+        events.push_back(MakeTick(3, 1000));
+
+        WHEN("events are replayed") {
+            CHECK(manager.Replay(std::move(events)) == 3);
+
+            THEN("the player is restored and moved") {
+                game_manager::GameRepr repr = manager.GetRepresentation();
+                REQUIRE(repr.sessions.size() == 1);
+                REQUIRE(repr.sessions.at(0).players.size() == 1);
+                const game_manager::Player& player = repr.sessions.at(0).players.at(0);
+                CHECK(player.id == 5);
+                CHECK(player.state.position.coor.x == 1.1);
+                CHECK(repr.sessions.at(0).journal_seq == 3);
+                CHECK(repr.players_number == 6);
+            }
+
+            AND_WHEN("the same events are replayed again") {
+                std::vector<JournalEvent> again;
+                again.push_back(MakeMove(2, 5, move_manager::Direction::WEST));
+
+                THEN("they are skipped") {
+                    CHECK(manager.Replay(std::move(again)) == 0);
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("Journal replay of retirement") {
+    boost::asio::io_context ioc;
+    model::Game game = MakeGame();
+    game_manager::GameManager manager{game, ioc, false, 0};
+    const std::string token = "0123456789abcdef0123456789abcdef";
+
+    auto run = [&ioc] {
+        ioc.restart();
+        ioc.run();
+    };
+
+    GIVEN("a player who stopped half the retirement time before the snapshot") {
+        std::vector<JournalEvent> events;
+        events.push_back(MakeJoin(1, 5, token));
+        REQUIRE(manager.Replay(std::move(events)) == 1);
+        manager.CallTick(30000, [](game_manager::Result) {});
+        run();
+        game_manager::GameRepr snapshot = manager.GetRepresentation();
+
+        WHEN("the player retires after the snapshot") {
+            auto journal = std::make_shared<JournalMock>();
+            manager.SetJournal(journal);
+            manager.CallTick(31000, [](game_manager::Result) {});
+            run();
+            REQUIRE(manager.GetRepresentation().sessions.at(0).players.empty());
+
+            AND_WHEN("the journal is replayed over the snapshot") {
+                game_manager::GameManager restored{game, ioc, false, 0};
+                restored.Restore(std::move(snapshot));
+                restored.Replay(std::move(journal->events));
+
+                THEN("the player and the token are gone") {
+                    game_manager::GameRepr repr = restored.GetRepresentation();
+                    REQUIRE(repr.sessions.size() == 1);
+                    CHECK(repr.sessions.at(0).players.empty());
+                    CHECK(repr.players.empty());
+
+                    std::optional<game_manager::Result> result;
+                    restored.GetPlayers(game_manager::Token{token},
+                        [&result](const std::optional<game_manager::PlayersAndObjects>&,
+                                  game_manager::Result res) {
+                            result = res;
+                        });
+                    run();
+                    CHECK(result == game_manager::Result::no_token);
+                }
+            }
+        }
+    }
+}
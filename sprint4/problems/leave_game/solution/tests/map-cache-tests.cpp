@@ -0,0 +1,142 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+
+#include "../src/map_cache.h"
+
+namespace {
+
+model::Map MakeMap(std::string id) {
+    model::MapConfig config;
+    config.interest_radius = 7.5;
+    model::Map map{model::Map::Id{id}, "Map " + id, config};
+    map.AddRoad({model::Road::HORIZONTAL, {0, 0}, 10});
+    map.AddRoad({model::Road::VERTICAL, {10, 0}, 5});
+    map.AddRoad({model::Road::HORIZONTAL, {10, 5}, 0, 2.5});
+    map.AddBuilding(model::Building{{{2, 2}, {5, 2}}});
+    map.AddOffice({model::Office::Id{"o0"}, {0, 5}, {5, 0}});
+
+    model::LootType key;
+    key.name = "key";
+    key.file = "assets/key.obj";
+    key.type = model::LootSort::obj;
+    key.rotation = 90;
+    key.color = "#338844";
+    key.scale = 0.03;
+    key.value = 10;
+    map.AddLootType(key);
+
+    return map;
+}
+
+} // namespace
+
+SCENARIO("Area graph") {
+    GIVEN("roads crossing each other") {
+        std::vector<model::Road> roads = {
+            {model::Road::HORIZONTAL, {0, 0}, 2},
+            {model::Road::VERTICAL, {1, 0}, 1}
+        };
+
+        WHEN("graph is built") {
+            move_manager::AreaGraph graph = move_manager::BuildAreaGraph(roads);
+
+            THEN("shared cells are added once and linked both ways") {
+                REQUIRE(graph.nodes.size() == 4);
+                CHECK(graph.nodes[0].base == model::Point{0, 0});
+                CHECK(graph.nodes[1].neighbours[1] == 2);
+                CHECK(graph.nodes[2].neighbours[3] == 1);
+                CHECK(graph.nodes[1].neighbours[2] == 3);
+                CHECK(graph.nodes[3].neighbours[0] == 1);
+                CHECK(graph.nodes[3].neighbours[1] == move_manager::AreaGraph::NO_NEIGHBOUR);
+            }
+        }
+    }
+
+    GIVEN("several maps") {
+        model::Game game{model::GameConfig{{5., 0.5}}};
+        game.AddMap(MakeMap("map1"));
+        game.AddMap(MakeMap("map2"));
+
+        WHEN("graphs are built in parallel") {
+            auto graphs = move_manager::BuildAreaGraphs(game.GetMaps());
+
+            THEN("they match serially built ones") {
+                REQUIRE(graphs.size() == 2);
+                CHECK(graphs[0] == move_manager::BuildAreaGraph(game.GetMaps()[0].GetRoads()));
+                CHECK(graphs[1] == move_manager::BuildAreaGraph(game.GetMaps()[1].GetRoads()));
+            }
+        }
+    }
+}
+
+SCENARIO("Map cache") {
+    const std::filesystem::path file = std::filesystem::temp_directory_path() / "map-cache-test.bin";
+    std::filesystem::remove(file);
+
+    GIVEN("a preprocessed game") {
+        model::GameConfig config{{5., 0.5}, 2., 4, 15.};
+        map_cache::PreprocessedGame source{model::Game{config}, {}};
+        source.game.AddMap(MakeMap("map1"));
+        source.game.AddMap(MakeMap("map2"));
+        source.graphs = move_manager::BuildAreaGraphs(source.game.GetMaps());
+
+        map_cache::Save(file, 42, source);
+
+        WHEN("it is loaded with the same config hash") {
+            auto loaded = map_cache::Load(file, 42);
+
+            THEN("maps and graphs are restored") {
+                REQUIRE(loaded.has_value());
+                CHECK(loaded->graphs == source.graphs);
+                CHECK(loaded->game.GetRetirementTime() == 15.);
+                CHECK(loaded->game.GetLootConfig().period == 5.);
+
+                const auto& maps = loaded->game.GetMaps();
+                REQUIRE(maps.size() == 2);
+                for (size_t i = 0; i < maps.size(); ++i) {
+                    const model::Map& expected = source.game.GetMaps()[i];
+                    CHECK(maps[i].GetId() == expected.GetId());
+                    CHECK(maps[i].GetName() == expected.GetName());
+                    CHECK(maps[i].GetDogSpeed() == 2.);
+                    CHECK(maps[i].GetBagCapacity() == 4);
+                    CHECK(maps[i].GetInterestRadius() == 7.5);
+                    REQUIRE(maps[i].GetRoads().size() == 3);
+                    CHECK(maps[i].GetRoads()[2].GetStart() == model::Point{10, 5});
+                    CHECK(maps[i].GetRoads()[2].GetEnd() == model::Point{0, 5});
+                    CHECK(maps[i].GetRoads()[2].GetSpawnWeight() == 2.5);
+                    CHECK(maps[i].GetRoads()[0].GetSpawnWeight() == 1.);
+                    CHECK(maps[i].GetBuildings().size() == 1);
+                    REQUIRE(maps[i].GetOffices().size() == 1);
+                    CHECK(maps[i].GetOffices()[0].GetOffset().dx == 5);
+                    REQUIRE(maps[i].GetLootTypes().size() == 1);
+                    CHECK(maps[i].GetLootTypes()[0].rotation == 90);
+                    CHECK(maps[i].GetLootTypes()[0].color == "#338844");
+                }
+            }
+        }
+
+        WHEN("config hash differs") {
+            THEN("cache is stale") {
+                CHECK_FALSE(map_cache::Load(file, 43).has_value());
+            }
+        }
+
+        WHEN("file is truncated") {
+            std::filesystem::resize_file(file, std::filesystem::file_size(file) - 1);
+
+            THEN("cache is ignored") {
+                CHECK_FALSE(map_cache::Load(file, 42).has_value());
+            }
+        }
+    }
+
+    GIVEN("no cache file") {
+        THEN("nothing is loaded") {
+            CHECK_FALSE(map_cache::Load(file, 42).has_value());
+        }
+    }
+
+    std::filesystem::remove(file);
+}
@@ -0,0 +1,70 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <thread>
+#include <vector>
+
+#include "../src/metrics.h"
+
+SCENARIO("Log-linear histogram") {
+    using metrics::Histogram;
+
+    GIVEN("bucket boundaries") {
+        THEN("small values get their own buckets") {
+            for (uint64_t v = 0; v < Histogram::SUB_BUCKETS; ++v) {
+                CHECK(Histogram::GetBucketIndex(v) == v);
+            }
+        }
+
+        THEN("every value falls into the bucket whose bounds contain it") {
+            for (uint64_t v = 1; v < 100000; v = v * 3 / 2 + 1) {
+                size_t index = Histogram::GetBucketIndex(v);
+                CHECK(v <= Histogram::GetBucketUpperBound(index));
+                CHECK((index == 0 || v > Histogram::GetBucketUpperBound(index - 1)));
+            }
+        }
+
+        THEN("huge values go to the last bucket") {
+            CHECK(Histogram::GetBucketIndex(UINT64_MAX) == Histogram::BUCKETS - 1);
+        }
+    }
+
+    GIVEN("a histogram") {
+        Histogram histogram;
+
+        WHEN("several threads record values") {
+            std::vector<std::thread> threads;
+            for (int t = 0; t < 4; ++t) {
+                threads.emplace_back([&histogram] {
+                    for (uint64_t i = 0; i < 1000; ++i) {
+                        histogram.Record(i);
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+
+            THEN("the snapshot contains all of them") {
+                Histogram::Snapshot snapshot = histogram.GetSnapshot();
+                uint64_t total = 0;
+                for (uint64_t count : snapshot.buckets) {
+                    total += count;
+                }
+                CHECK(snapshot.count == 4000);
+                CHECK(total == 4000);
+                CHECK(snapshot.sum == 4 * 999 * 1000 / 2);
+            }
+        }
+    }
+}
+
+SCENARIO("Request routes") {
+    using metrics::Route;
+
+    CHECK(metrics::GetRoute("/api/v1/game/state") == Route::state);
+    CHECK(metrics::GetRoute("/api/v1/game/batch") == Route::batch);
+    CHECK(metrics::GetRoute("/api/v1/game/records?start=0") == Route::records);
+    CHECK(metrics::GetRoute("/api/v1/maps/map1") == Route::maps);
+    CHECK(metrics::GetRoute("/api/v2/unknown") == Route::other);
+    CHECK(metrics::GetRoute("/index.html") == Route::static_files);
+}
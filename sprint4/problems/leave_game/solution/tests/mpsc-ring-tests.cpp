@@ -0,0 +1,83 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <thread>
+#include <vector>
+
+#include "../src/mpsc_ring.h"
+
+SCENARIO("Bounded MPSC ring") {
+    GIVEN("a ring of capacity 4") {
+        mpsc_ring::MpscRing<int> ring{4};
+
+        WHEN("it is filled") {
+            for (int i = 0; i < 4; ++i) {
+                REQUIRE(ring.TryPush(i));
+            }
+
+            THEN("next push fails") {
+                CHECK_FALSE(ring.TryPush(4));
+            }
+
+            THEN("values are popped in order and the ring becomes empty") {
+                int value = -1;
+                for (int i = 0; i < 4; ++i) {
+                    REQUIRE(ring.TryPop(value));
+                    CHECK(value == i);
+                }
+                CHECK_FALSE(ring.TryPop(value));
+            }
+
+            AND_WHEN("one value is popped") {
+                int value;
+                ring.TryPop(value);
+
+                THEN("one more value can be pushed") {
+                    CHECK(ring.TryPush(4));
+                    CHECK_FALSE(ring.TryPush(5));
+                }
+            }
+        }
+    }
+
+    GIVEN("several producers") {
+        const int producers = 4;
+        const int per_producer = 10000;
+        mpsc_ring::MpscRing<std::pair<int, int>> ring{64};
+
+        WHEN("they push concurrently") {
+            std::vector<std::thread> threads;
+            for (int p = 0; p < producers; ++p) {
+                threads.emplace_back([&ring, p] {
+                    for (int i = 0; i < per_producer; ++i) {
+                        while (!ring.TryPush(std::pair{p, i})) {
+                            std::this_thread::yield();
+                        }
+                    }
+                });
+            }
+
+            std::vector<int> next(producers, 0);
+            int received = 0;
+            bool ordered = true;
+            while (received < producers * per_producer) {
+                std::pair<int, int> value;
+                if (ring.TryPop(value)) {
+                    ordered = ordered && value.second == next[value.first];
+                    next[value.first] = value.second + 1;
+                    ++received;
+                }
+            }
+
+            for (auto& thread : threads) {
+                thread.join();
+            }
+
+            THEN("every value is received once, in per-producer order") {
+                CHECK(ordered);
+                for (int p = 0; p < producers; ++p) {
+                    CHECK(next[p] == per_producer);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,144 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/move_manager.h"
+
+#include <random>
+
+namespace {
+
+using move_manager::AliasTable;
+using move_manager::Area;
+using move_manager::Coords;
+using move_manager::PositionState;
+
+} // namespace
+
+SCENARIO("Alias table") {
+    std::mt19937 generator{1};
+
+    GIVEN("a table with uneven weights") {
+        AliasTable table{{1., 0., 3., 4.}};
+        const size_t samples = 80000;
+
+        WHEN("indices are sampled") {
+            std::vector<size_t> counts(4, 0);
+            for (size_t i = 0; i < samples; ++i) {
+                counts.at(table.Sample(generator))++;
+            }
+
+            THEN("each index is chosen in proportion to its weight") {
+                CHECK(counts[1] == 0);
+                CHECK(counts[0] > samples / 8 * 0.9);
+                CHECK(counts[0] < samples / 8 * 1.1);
+                CHECK(counts[2] > samples * 3 / 8 * 0.95);
+                CHECK(counts[2] < samples * 3 / 8 * 1.05);
+                CHECK(counts[3] > samples / 2 * 0.95);
+                CHECK(counts[3] < samples / 2 * 1.05);
+            }
+        }
+    }
+
+    GIVEN("a table with a single weight") {
+        AliasTable table{{0.5}};
+
+        THEN("it always returns that index") {
+            for (size_t i = 0; i < 100; ++i) {
+                CHECK(table.Sample(generator) == 0);
+            }
+        }
+    }
+}
+
+SCENARIO("Road placement") {
+    std::mt19937 generator{2};
+
+    GIVEN("a map of two crossing roads") {
+        std::vector<model::Road> roads{
+            {model::Road::HORIZONTAL, {0, 0}, 10},
+            {model::Road::VERTICAL, {5, -5}, 5}
+        };
+        move_manager::Map map{roads};
+
+        THEN("points are looked up in the grid") {
+            REQUIRE(map.GetAreasCount() == 21);
+            REQUIRE(map.FindArea({3.4, 0.3}));
+            CHECK(map.FindArea({3.4, 0.3})->GetBase() == model::Point{3, 0});
+            REQUIRE(map.FindArea({5., -4.6}));
+            CHECK(map.FindArea({5., -4.6})->GetBase() == model::Point{5, -5});
+            CHECK(map.FindArea({-0.4, 0.}) == map.GetStartPlace().area);
+            CHECK_FALSE(map.FindArea({3., 2.}));
+            CHECK_FALSE(map.FindArea({-1., 0.}));
+            CHECK_FALSE(map.FindArea({11., 0.}));
+        }
+
+        WHEN("positions are placed") {
+            PositionState on_road{{7.2, 0.1}, nullptr};
+            PositionState off_road{{7.2, 3.}, nullptr};
+            std::vector<PositionState*> positions{&on_road};
+            map.PlaceCoors(positions);
+
+            THEN("they get their areas, and positions off the roads are rejected") {
+                REQUIRE(on_road.area);
+                CHECK(on_road.area->GetBase() == model::Point{7, 0});
+                positions.push_back(&off_road);
+                CHECK_THROWS_AS(map.PlaceCoors(positions), std::out_of_range);
+            }
+        }
+
+        WHEN("random places are sampled") {
+            THEN("they lie on the roads inside their areas") {
+                for (size_t i = 0; i < 1000; ++i) {
+                    PositionState place = map.GetRandomPlace(generator);
+                    REQUIRE(place.area);
+                    CHECK(map.FindArea(place.coor) == place.area);
+                }
+            }
+        }
+
+        WHEN("occupied areas are excluded") {
+            auto is_free = [](const Area& area) {
+                return area.GetBase().y != 0;
+            };
+
+            THEN("places are mostly taken from free areas") {
+                size_t free = 0;
+                for (size_t i = 0; i < 1000; ++i) {
+                    free += is_free(*map.GetRandomPlace(generator, is_free).area);
+                }
+                // Свободна половина клеток, за 8 попыток промахиваются в 1/256 случаев
+                CHECK(free > 980);
+            }
+        }
+    }
+
+    GIVEN("a map where one road has zero spawn weight and another has triple weight") {
+        std::vector<model::Road> roads{
+            {model::Road::HORIZONTAL, {0, 0}, 9, 3.},
+            {model::Road::VERTICAL, {0, 1}, 10, 0.},
+            {model::Road::HORIZONTAL, {0, 11}, 9}
+        };
+        move_manager::Map map{roads};
+
+        WHEN("random places are sampled") {
+            size_t heavy = 0;
+            size_t light = 0;
+            size_t empty = 0;
+            for (size_t i = 0; i < 40000; ++i) {
+                int y = map.GetRandomPlace(generator).area->GetBase().y;
+                if (y == 0) {
+                    heavy++;
+                } else if (y == 11) {
+                    light++;
+                } else {
+                    empty++;
+                }
+            }
+
+            THEN("areas are chosen by road weight") {
+                CHECK(empty == 0);
+                CHECK(heavy > light * 2.7);
+                CHECK(heavy < light * 3.3);
+            }
+        }
+    }
+}
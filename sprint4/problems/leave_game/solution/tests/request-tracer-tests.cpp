@@ -0,0 +1,68 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/post.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "../src/request_tracer.h"
+
+namespace net = boost::asio;
+
+SCENARIO("Request tracing across strand hops") {
+    using request_tracer::Hop;
+    using request_tracer::Stage;
+
+    std::filesystem::path file = std::filesystem::temp_directory_path() / "request-tracer-test.json";
+    request_tracer::Tracer& tracer = request_tracer::Tracer::GetInstance();
+    tracer.Enable(file, 1);
+
+    GIVEN("two strands") {
+        net::io_context ioc;
+        auto first = net::make_strand(ioc);
+        auto second = net::make_strand(ioc);
+
+        WHEN("a traced request hops between them") {
+            request_tracer::TracePtr trace = tracer.StartTrace("state");
+            REQUIRE(trace);
+            uint32_t trace_id = trace->GetId();
+            uint32_t seen_id = 0;
+            bool untraced_outside = false;
+
+            {
+                request_tracer::CurrentScope scope{trace};
+                net::post(first, Hop(Stage::tokens, [&] {
+                    net::post(second, Hop(Stage::session, [&] {
+                        request_tracer::TracePtr current = request_tracer::GetCurrent();
+                        seen_id = current->GetId();
+                        current->Finish();
+                    }));
+                }));
+            }
+            untraced_outside = request_tracer::GetCurrent() == nullptr;
+            trace.reset();
+
+            ioc.run();
+
+            THEN("the trace is visible in every hop and written with queue and work spans") {
+                CHECK(untraced_outside);
+                CHECK(seen_id == trace_id);
+
+                std::ifstream in(file);
+                std::stringstream content;
+                content << in.rdbuf();
+                std::string trace_json = content.str();
+
+                CHECK(trace_json.starts_with("["));
+                CHECK(trace_json.find("\"name\":\"tokens_strand queue\"") != std::string::npos);
+                CHECK(trace_json.find("\"name\":\"session_strand\"") != std::string::npos);
+                CHECK(trace_json.find("\"name\":\"state\",\"cat\":\"request\"") != std::string::npos);
+            }
+        }
+    }
+
+    std::filesystem::remove(file);
+}
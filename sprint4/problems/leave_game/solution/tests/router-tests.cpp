@@ -0,0 +1,250 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+#include "../src/router.h"
+
+namespace {
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+using tcp = net::ip::tcp;
+
+// Воркер, который отвечает на count запросов в одном соединении, повторяя цель запроса.
+// Цели полученных запросов добавляются в received
+void ServeEcho(tcp::acceptor& acceptor, size_t count, std::vector<std::string>* received = nullptr) {
+    tcp::socket socket = acceptor.accept();
+    beast::flat_buffer buffer;
+
+    for (size_t i = 0; i < count; ++i) {
+        http::request<http::string_body> request;
+        http::read(socket, buffer, request);
+        if (received) {
+            received->emplace_back(request.target());
+        }
+
+        http::response<http::string_body> response{http::status::ok, request.version()};
+        response.body() = std::string{request.target()};
+        response.keep_alive(true);
+        response.prepare_payload();
+        http::write(socket, response);
+    }
+}
+
+// Воркер, который отвечает на первый запрос, а второй читает и закрывает соединение,
+// не ответив. Затем обслуживает ещё одно соединение с одним запросом
+std::vector<std::string> ServeAndDrop(tcp::acceptor& acceptor) {
+    std::vector<std::string> received;
+    {
+        tcp::socket socket = acceptor.accept();
+        beast::flat_buffer buffer;
+        for (size_t i = 0; i < 2; ++i) {
+            http::request<http::string_body> request;
+            http::read(socket, buffer, request);
+            received.emplace_back(request.target());
+            if (i == 1) {
+                break;
+            }
+
+            http::response<http::string_body> response{http::status::ok, request.version()};
+            response.keep_alive(true);
+            response.prepare_payload();
+            http::write(socket, response);
+        }
+    }
+    ServeEcho(acceptor, 1, &received);
+    return received;
+}
+
+} // namespace
+
+SCENARIO("Token shard prefix") {
+    GIVEN("a shard id") {
+        WHEN("it is put into a token") {
+            std::string token = router::MakeTokenPrefix(26) + "0123456789abcdef0123456789abcd";
+
+            THEN("the shard can be read back") {
+                CHECK(token.starts_with("1a"));
+                CHECK(router::GetTokenShard(token) == 26);
+            }
+        }
+
+        THEN("ids out of range are rejected") {
+            CHECK(router::MakeTokenPrefix(0) == "00");
+            CHECK(router::MakeTokenPrefix(255) == "ff");
+            CHECK_THROWS_AS(router::MakeTokenPrefix(256), std::invalid_argument);
+        }
+    }
+
+    GIVEN("malformed tokens") {
+        THEN("they have no shard") {
+            CHECK_FALSE(router::GetTokenShard("").has_value());
+            CHECK_FALSE(router::GetTokenShard("a").has_value());
+            CHECK_FALSE(router::GetTokenShard("zz0123").has_value());
+        }
+    }
+}
+
+SCENARIO("Router options parsing") {
+    GIVEN("map shards spec") {
+        THEN("maps are pinned to shards") {
+            auto shards = router::ParseMapShards("map1=0,town=2");
+            REQUIRE(shards.size() == 2);
+            CHECK(shards.at("map1") == 0);
+            CHECK(shards.at("town") == 2);
+        }
+
+        THEN("malformed specs are rejected") {
+            CHECK_THROWS_AS(router::ParseMapShards("map1"), std::invalid_argument);
+            CHECK_THROWS_AS(router::ParseMapShards("=1"), std::invalid_argument);
+            CHECK_THROWS_AS(router::ParseMapShards("map1=x"), std::invalid_argument);
+        }
+    }
+
+    GIVEN("ports spec") {
+        THEN("ports are parsed in order") {
+            CHECK(router::ParsePorts("8081,8082") == std::vector<uint16_t>{8081, 8082});
+            CHECK_THROWS_AS(router::ParsePorts("8081,70000"), std::invalid_argument);
+        }
+    }
+}
+
+SCENARIO("Map assignment") {
+    GIVEN("two shards and a pinned map") {
+        router::MapAssignment assignment{2, {{"pinned", 1}}};
+
+        WHEN("players join") {
+            size_t pinned = assignment.Join("pinned");
+            size_t first = assignment.Join("map1");
+            size_t again = assignment.Join("map1");
+            size_t second = assignment.Join("map2");
+
+            THEN("pinned map keeps its shard and others go to the shard with fewest joins") {
+                CHECK(pinned == 1);
+                CHECK(first == 0);
+                CHECK(again == 0);
+                CHECK(second == 1);
+            }
+        }
+
+        THEN("pinning to unknown shard is rejected") {
+            CHECK_THROWS_AS((router::MapAssignment{2, {{"map1", 2}}}), std::invalid_argument);
+        }
+    }
+}
+
+SCENARIO("Forwarding to a worker") {
+    GIVEN("a worker") {
+        net::io_context ioc;
+        tcp::acceptor acceptor{ioc, {net::ip::make_address("127.0.0.1"), 0}};
+        router::WorkerClient client{ioc, acceptor.local_endpoint()};
+
+        std::jthread worker{[&acceptor] {
+            ServeEcho(acceptor, 2);
+        }};
+
+        WHEN("two requests are forwarded one after another") {
+            std::vector<std::string> bodies;
+
+            auto forward = [&](std::string target, router::WorkerClient::Handler next) {
+                router::WorkerClient::Request request{http::verb::get, target, 11};
+                request.keep_alive(true);
+                client.Forward(std::move(request), std::move(next));
+            };
+
+            forward("/first", [&](boost::system::error_code ec, router::WorkerClient::Response&& response) {
+                REQUIRE_FALSE(ec);
+                bodies.push_back(response.body());
+
+                forward("/second", [&](boost::system::error_code ec, router::WorkerClient::Response&& response) {
+                    REQUIRE_FALSE(ec);
+                    bodies.push_back(response.body());
+                });
+            });
+            ioc.run();
+
+            THEN("both responses come back over the same connection") {
+                CHECK(bodies == std::vector<std::string>{"/first", "/second"});
+            }
+        }
+    }
+
+    GIVEN("a worker that drops the connection after receiving the second request") {
+        net::io_context ioc;
+        tcp::acceptor acceptor{ioc, {net::ip::make_address("127.0.0.1"), 0}};
+        router::WorkerClient client{ioc, acceptor.local_endpoint()};
+
+        auto forward_twice = [&](http::verb second_method) {
+            std::optional<boost::system::error_code> result;
+            router::WorkerClient::Request first{http::verb::get, "/first", 11};
+            first.keep_alive(true);
+            client.Forward(std::move(first), [&](boost::system::error_code ec, auto&&) {
+                REQUIRE_FALSE(ec);
+                router::WorkerClient::Request second{second_method, "/second", 11};
+                second.keep_alive(true);
+                client.Forward(std::move(second), [&](boost::system::error_code ec, auto&&) {
+                    result = ec;
+                });
+            });
+            ioc.run();
+            return result;
+        };
+
+        std::vector<std::string> received;
+        std::jthread worker{[&] {
+            received = ServeAndDrop(acceptor);
+        }};
+
+        WHEN("the second request is a GET") {
+            auto result = forward_twice(http::verb::get);
+            worker.join();
+
+            THEN("it is repeated on a new connection") {
+                REQUIRE(result);
+                CHECK_FALSE(*result);
+                CHECK(received == std::vector<std::string>{"/first", "/second", "/second"});
+            }
+        }
+
+        WHEN("the second request is a POST") {
+            auto result = forward_twice(http::verb::post);
+
+            // Воркер ждёт повтора, которого не будет
+            tcp::socket socket{ioc};
+            socket.connect(acceptor.local_endpoint());
+            http::write(socket, http::request<http::string_body>{http::verb::get, "/next", 11});
+            worker.join();
+
+            THEN("it is not repeated and the handler gets an error") {
+                REQUIRE(result);
+                CHECK(*result);
+                CHECK(received == std::vector<std::string>{"/first", "/second", "/next"});
+            }
+        }
+    }
+
+    GIVEN("no worker") {
+        net::io_context ioc;
+        tcp::endpoint endpoint;
+        {
+            tcp::acceptor acceptor{ioc, {net::ip::make_address("127.0.0.1"), 0}};
+            endpoint = acceptor.local_endpoint();
+        }
+        router::WorkerClient client{ioc, endpoint};
+
+        WHEN("a request is forwarded") {
+            boost::system::error_code result;
+            client.Forward({http::verb::get, "/", 11}, [&](boost::system::error_code ec, auto&&) {
+                result = ec;
+            });
+            ioc.run();
+
+            THEN("the handler gets an error") {
+                CHECK(result);
+            }
+        }
+    }
+}
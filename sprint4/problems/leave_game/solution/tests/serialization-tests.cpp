@@ -1,8 +1,10 @@
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/archive/text_oarchive.hpp>
+#include <boost/asio/io_context.hpp>
 #include <boost/serialization/vector.hpp>
 #include <catch2/catch_test_macros.hpp>
 
+#include <filesystem>
 #include <sstream>
 #include <vector>
 
@@ -189,3 +191,42 @@ SCENARIO_METHOD(Fixture, "Player serialization") {
         }
     }
 }
+
+SCENARIO("Stopping periodic saves") {
+    const std::filesystem::path state_path = std::filesystem::temp_directory_path() / "serialization-test.state";
+    std::filesystem::remove(state_path);
+
+    boost::asio::io_context ioc;
+    model::Game game{model::GameConfig{}};
+    game_manager::GameManager manager{game, ioc, false, 0};
+    game_serialization::Serializator serializator{manager, state_path.string(), 1000};
+
+    GIVEN("a save in progress") {
+        serializator.SaveAsync();
+
+        WHEN("saving is stopped") {
+            bool stopped = false;
+            serializator.Stop([&stopped] {
+                stopped = true;
+            });
+
+            THEN("the stop waits for the save") {
+                CHECK_FALSE(stopped);
+                ioc.run();
+                CHECK(stopped);
+                CHECK(std::filesystem::exists(state_path));
+            }
+
+            THEN("no new save starts") {
+                ioc.run();
+                std::filesystem::remove(state_path);
+                serializator.SaveAsync();
+                ioc.restart();
+                ioc.run();
+                CHECK_FALSE(std::filesystem::exists(state_path));
+            }
+        }
+    }
+
+    std::filesystem::remove(state_path);
+}
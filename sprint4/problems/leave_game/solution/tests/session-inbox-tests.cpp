@@ -0,0 +1,129 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include "../src/game_manager.h"
+#include "game-fixtures.h"
+
+namespace {
+
+using game_fixtures::MakeGame;
+using game_fixtures::MakeJoin;
+using game_manager::Result;
+using game_manager::Token;
+using move_manager::Direction;
+
+const std::string TOKEN = "0123456789abcdef0123456789abcdef";
+
+} // namespace
+
+SCENARIO("Session command inbox") {
+    boost::asio::io_context ioc;
+    model::Game game = MakeGame();
+    game_manager::GameManager manager{game, ioc, false, 0};
+
+    std::vector<game_manager::JournalEvent> events;
+    events.push_back(MakeJoin(1, 1, TOKEN));
+    REQUIRE(manager.Replay(std::move(events)) == 1);
+
+    auto move = [&manager](Direction dir) {
+        auto result = std::make_shared<Result>(Result::no_token);
+        manager.MovePlayer(Token{TOKEN}, dir, [result](Result res) {
+            *result = res;
+        });
+        return result;
+    };
+
+    auto get_state = [&manager, &ioc] {
+        std::optional<move_manager::State> state;
+        manager.GetPlayers(Token{TOKEN},
+            [&state](const std::optional<game_manager::PlayersAndObjects>& players, Result res) {
+                if (res == Result::ok) {
+                    state = players->players.front().state;
+                }
+            });
+        ioc.restart();
+        ioc.run();
+        return state;
+    };
+
+    GIVEN("several commands of one player before the state is read") {
+        auto first = move(Direction::WEST);
+        auto second = move(Direction::SOUTH);
+        ioc.run();
+
+        THEN("each command is answered") {
+            CHECK(*first == Result::ok);
+            CHECK(*second == Result::ok);
+        }
+
+        THEN("the last command wins") {
+            auto state = get_state();
+            REQUIRE(state);
+            CHECK(state->dir == Direction::SOUTH);
+            CHECK(state->speed.y_axis > 0.);
+        }
+    }
+
+    GIVEN("a turn followed by a stop") {
+        move(Direction::EAST);
+        move(Direction::NONE);
+        ioc.run();
+
+        THEN("the player stops facing the direction of the turn") {
+            auto state = get_state();
+            REQUIRE(state);
+            CHECK(state->dir == Direction::EAST);
+            CHECK(state->speed.x_axis == 0.);
+            CHECK(state->speed.y_axis == 0.);
+        }
+    }
+
+    GIVEN("more commands than the inbox holds") {
+        std::vector<std::shared_ptr<Result>> results;
+        for (size_t i = 0; i < 3000; ++i) {
+            results.push_back(move(i % 2 == 0 ? Direction::WEST : Direction::EAST));
+        }
+        ioc.run();
+
+        THEN("overflowing commands are applied through the strand in order") {
+            for (const auto& result : results) {
+                CHECK(*result == Result::ok);
+            }
+            auto state = get_state();
+            REQUIRE(state);
+            CHECK(state->dir == Direction::EAST);
+        }
+    }
+}
+
+SCENARIO("Commands of a retired player") {
+    boost::asio::io_context ioc;
+    model::Game game = MakeGame();
+    const model::Map& map = game.GetMaps().front();
+    move_manager::Map move_map{map};
+    game_manager::GameSession session{ioc, map, move_map, game.GetLootConfig(), false, 1., 0, 0};
+
+    std::vector<game_manager::Retiree> retirees;
+    REQUIRE(session.ApplyJournalEvent(MakeJoin(1, 1, TOKEN), retirees));
+
+    GIVEN("a player retired while its token is still known") {
+        game_manager::JournalEvent retire = game_manager::JournalEvent::Retire(1);
+        retire.seq = 2;
+        REQUIRE(session.ApplyJournalEvent(retire, retirees));
+        REQUIRE(retirees.size() == 1);
+
+        WHEN("it sends a move") {
+            std::optional<Result> result;
+            session.MovePlayer(1, Direction::EAST, [&result](Result res) {
+                result = res;
+            });
+            ioc.run();
+
+            THEN("the move is not acknowledged") {
+                REQUIRE(result);
+                CHECK(*result == Result::no_session);
+            }
+        }
+    }
+}
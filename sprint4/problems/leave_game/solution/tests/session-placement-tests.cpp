@@ -0,0 +1,55 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include "../src/game_manager.h"
+#include "game-fixtures.h"
+
+namespace {
+
+model::Game MakeGame(size_t max_players_per_session) {
+    model::MapConfig map_config;
+    map_config.max_players_per_session = max_players_per_session;
+    return game_fixtures::MakeGame(game_fixtures::MakeConfig(), game_fixtures::MakeMap(map_config));
+}
+
+std::vector<size_t> JoinAndCount(game_manager::GameManager& manager, boost::asio::io_context& ioc, size_t players) {
+    for (size_t i = 0; i < players; ++i) {
+        manager.Join("Rex", model::Map::Id{"map1"}, [](game_manager::PlayerInfo) {});
+    }
+    ioc.run();
+
+    std::vector<size_t> result;
+    for (const game_manager::GameSessionRepr& session : manager.GetRepresentation().sessions) {
+        result.push_back(session.players.size());
+    }
+    return result;
+}
+
+} // namespace
+
+SCENARIO("Session capacity") {
+    boost::asio::io_context ioc;
+
+    GIVEN("a map with at most two players per session") {
+        model::Game game = MakeGame(2);
+        game_manager::GameManager manager{game, ioc, false, 0};
+
+        WHEN("five players join") {
+            auto sessions = JoinAndCount(manager, ioc, 5);
+
+            THEN("new sessions are created when the cap is reached") {
+                CHECK(sessions == std::vector<size_t>{2, 2, 1});
+            }
+        }
+    }
+
+    GIVEN("a map without the limit") {
+        model::Game game = MakeGame(0);
+        game_manager::GameManager manager{game, ioc, false, 0};
+
+        THEN("all players share one session") {
+            CHECK(JoinAndCount(manager, ioc, 5) == std::vector<size_t>{5});
+        }
+    }
+}
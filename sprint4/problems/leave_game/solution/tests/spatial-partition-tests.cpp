@@ -0,0 +1,254 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include "../src/collision_detector.h"
+#include "../src/game_manager.h"
+#include "../src/parallel.h"
+#include "game-fixtures.h"
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+
+namespace {
+
+using namespace std::literals;
+
+using collision_detector::GatheringEvent;
+using game_manager::BatchCommand;
+using game_manager::BatchResult;
+using game_manager::JournalEvent;
+using game_manager::JournalEventType;
+using game_manager::Token;
+
+class TestProvider : public collision_detector::ItemGathererProvider {
+public:
+    void AddItem(collision_detector::Item item) { items_.push_back(item); }
+    size_t ItemsCount() const override { return items_.size(); }
+    collision_detector::Item GetItem(size_t idx) const override { return items_.at(idx); }
+
+    void AddGatherer(collision_detector::Gatherer gatherer) { gatherers_.push_back(gatherer); }
+    size_t GatherersCount() const override { return gatherers_.size(); }
+    collision_detector::Gatherer GetGatherer(size_t idx) const override { return gatherers_.at(idx); }
+private:
+    std::vector<collision_detector::Item> items_;
+    std::vector<collision_detector::Gatherer> gatherers_;
+};
+
+bool SameEvent(const GatheringEvent& a, const GatheringEvent& b) {
+    return a.item_id == b.item_id && a.gatherer_id == b.gatherer_id && a.sq_distance == b.sq_distance
+           && a.time == b.time && a.is_office == b.is_office;
+}
+
+void RunSequentially(size_t count, const std::function<void(size_t)>& task) {
+    for (size_t i = 0; i < count; ++i) {
+        task(i);
+    }
+}
+
+std::string MakeToken(size_t index) {
+    std::string result = std::to_string(index);
+    return std::string(32 - result.size(), '0') + result;
+}
+
+model::Game MakeGame() {
+    model::GameConfig config;
+    config.loot_config = {1000., 0.};
+
+    model::Map map = game_fixtures::MakeMap({2.}, 100);
+    map.AddRoad({model::Road::VERTICAL, {50, 0}, 20});
+    map.AddOffice({model::Office::Id{"o1"}, {50, 10}, {0, 0}});
+    return game_fixtures::MakeGame(config, std::move(map));
+}
+
+// Игроки вразброс по дороге, лут между ними, несколько тиков с поворотами
+std::vector<JournalEvent> MakeEvents() {
+    std::vector<JournalEvent> events;
+    uint64_t seq = 0;
+    std::mt19937 generator{42};
+    std::uniform_real_distribution<double> x_dist{0., 100.};
+    std::uniform_int_distribution<int> dir_dist{0, 3};
+    const move_manager::Direction dirs[] = {move_manager::Direction::EAST, move_manager::Direction::WEST,
+                                            move_manager::Direction::NORTH, move_manager::Direction::SOUTH};
+
+    for (size_t i = 0; i < 40; ++i) {
+        events.push_back(game_fixtures::MakeJoin(++seq, i, MakeToken(i), "Dog"s + std::to_string(i),
+                                                 {x_dist(generator), 0.}));
+    }
+    for (size_t i = 0; i < 60; ++i) {
+        JournalEvent loot{JournalEventType::loot};
+        loot.seq = ++seq;
+        loot.loot_id = i;
+        loot.position = {x_dist(generator), 0.};
+        events.push_back(std::move(loot));
+    }
+    for (size_t round = 0; round < 10; ++round) {
+        for (size_t i = 0; i < 40; ++i) {
+            JournalEvent move{JournalEventType::move};
+            move.seq = ++seq;
+            move.player_id = i;
+            move.dir = dirs[dir_dist(generator)];
+            events.push_back(std::move(move));
+        }
+        JournalEvent tick{JournalEventType::tick};
+        tick.seq = ++seq;
+        tick.duration = 1000;
+        events.push_back(std::move(tick));
+    }
+    return events;
+}
+
+std::shared_ptr<const game_manager::SessionState> PlayGame(game_manager::PartitionOptions options) {
+    boost::asio::io_context ioc;
+    model::Game game = MakeGame();
+    game_manager::GameManager manager{game, ioc, false, 0};
+    manager.SetPartitioning(options);
+    manager.Replay(MakeEvents());
+
+    std::vector<BatchCommand> commands{{Token{MakeToken(0)}, std::nullopt}};
+    std::vector<BatchResult> results;
+    manager.Batch(std::move(commands), [&results](std::vector<BatchResult>&& batch_results) {
+        results = std::move(batch_results);
+    });
+    ioc.run();
+    return results.at(0).state;
+}
+
+} // namespace
+
+SCENARIO("Parallel for") {
+    GIVEN("an io_context run by several threads") {
+        boost::asio::io_context ioc;
+        auto guard = boost::asio::make_work_guard(ioc);
+        std::vector<std::jthread> threads;
+        for (size_t i = 0; i < 3; ++i) {
+            threads.emplace_back([&ioc] {
+                ioc.run();
+            });
+        }
+
+        WHEN("tasks are run in parallel") {
+            std::vector<int> done(1000, 0);
+            parallel::For(ioc.get_executor(), done.size(), 3, [&done](size_t i) {
+                done[i]++;
+            });
+
+            THEN("every task is run exactly once before the call returns") {
+                CHECK(std::count(done.begin(), done.end(), 1) == 1000);
+            }
+        }
+
+        WHEN("a task throws") {
+            std::atomic<int> running = 0;
+            auto call = [&] {
+                parallel::For(ioc.get_executor(), 1000, 3, [&running](size_t i) {
+                    running++;
+                    std::this_thread::sleep_for(std::chrono::microseconds{10});
+                    running--;
+                    if (i == 10) {
+                        throw std::runtime_error("task failed");
+                    }
+                });
+            };
+
+            THEN("the exception reaches the caller after all taken tasks are finished") {
+                CHECK_THROWS_AS(call(), std::runtime_error);
+                CHECK(running == 0);
+            }
+        }
+        guard.reset();
+    }
+
+    GIVEN("an io_context without threads") {
+        boost::asio::io_context ioc;
+
+        WHEN("tasks are run in parallel") {
+            size_t count = 0;
+            parallel::For(ioc.get_executor(), 10, 4, [&count](size_t) {
+                count++;
+            });
+
+            THEN("the caller runs them all by itself") {
+                CHECK(count == 10);
+                CHECK(ioc.run() == 4);
+            }
+        }
+    }
+}
+
+SCENARIO("Partitioned gather events") {
+    GIVEN("random gatherers and items") {
+        TestProvider provider;
+        std::mt19937 generator{7};
+        std::uniform_real_distribution<double> coor{0., 100.};
+        std::uniform_real_distribution<double> shift{-3., 3.};
+
+        for (size_t i = 0; i < 300; ++i) {
+            provider.AddItem({{coor(generator), coor(generator)}, 0.3, i % 50 == 0});
+        }
+        for (size_t g = 0; g < 300; ++g) {
+            geom::Point2D start{coor(generator), coor(generator)};
+            geom::Point2D end = g % 2 == 0 ? geom::Point2D{start.x + shift(generator) * 5, start.y}
+                                           : geom::Point2D{start.x, start.y + shift(generator) * 5};
+            provider.AddGatherer({start, end, 0.6});
+        }
+        // Неподвижный сборщик ничего не собирает
+        provider.AddGatherer({{10., 10.}, {10., 10.}, 0.6});
+
+        auto expected = collision_detector::FindGatherEvents(provider);
+        REQUIRE(!expected.empty());
+
+        for (size_t regions : {1, 2, 3, 8, 64, 1000}) {
+            WHEN("the map is split into " + std::to_string(regions) + " regions") {
+                auto events = collision_detector::FindGatherEventsPartitioned(provider, regions, RunSequentially);
+
+                THEN("events are the same as without partitioning") {
+                    CHECK(std::equal(events.begin(), events.end(), expected.begin(), expected.end(), SameEvent));
+                }
+            }
+        }
+    }
+
+    GIVEN("all items at one x") {
+        TestProvider provider;
+        provider.AddItem({{5., 1.}, 0.3, false});
+        provider.AddItem({{5., 2.}, 0.3, false});
+        provider.AddGatherer({{5., 0.}, {5., 3.}, 0.6});
+
+        WHEN("the map is split into regions") {
+            auto events = collision_detector::FindGatherEventsPartitioned(provider, 4, RunSequentially);
+
+            THEN("both items are gathered in order") {
+                REQUIRE(events.size() == 2);
+                CHECK(events[0].item_id == 0);
+                CHECK(events[1].item_id == 1);
+            }
+        }
+    }
+}
+
+SCENARIO("Large session mode") {
+    GIVEN("the same game played with and without partitioning") {
+        auto expected = PlayGame({});
+        auto state = PlayGame({1, 4});
+
+        THEN("players end up in the same places with the same loot") {
+            REQUIRE(expected);
+            REQUIRE(state);
+            REQUIRE(state->players.size() == expected->players.size());
+            for (size_t i = 0; i < expected->players.size(); ++i) {
+                const auto& a = expected->players[i];
+                const auto& b = state->players[i];
+                CHECK(a.id == b.id);
+                CHECK(a.state.position.coor.x == b.state.position.coor.x);
+                CHECK(a.state.position.coor.y == b.state.position.coor.y);
+                CHECK(a.items_in_bag.size() == b.items_in_bag.size());
+                CHECK(a.score == b.score);
+            }
+            CHECK(state->objects.size() == expected->objects.size());
+            CHECK(state->objects.size() < 60);
+        }
+    }
+}
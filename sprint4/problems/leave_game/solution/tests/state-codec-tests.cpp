@@ -0,0 +1,170 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/binary_io.h"
+#include "../src/state_codec.h"
+
+#include <limits>
+
+namespace {
+
+using namespace std::literals;
+
+game_manager::Player MakePlayer(size_t id, geom::Scalar x, geom::Scalar y) {
+    game_manager::Player player;
+    player.id = id;
+    player.name = "Собака " + std::to_string(id);
+    player.state.position.coor = {x, y};
+    player.state.position.area = nullptr;
+    return player;
+}
+
+} // namespace
+
+SCENARIO("Varint encoding") {
+    GIVEN("numbers of different sizes") {
+        const std::vector<uint64_t> values{0, 1, 127, 128, 300, 1ull << 35, std::numeric_limits<uint64_t>::max()};
+        const std::vector<int64_t> signed_values{0, -1, 1, -64, 64, -1000000, std::numeric_limits<int64_t>::min(),
+                                                 std::numeric_limits<int64_t>::max()};
+
+        WHEN("they are written and read back") {
+            std::string out;
+            for (uint64_t value : values) {
+                binary_io::PutVarint(out, value);
+            }
+            for (int64_t value : signed_values) {
+                binary_io::PutZigzag(out, value);
+            }
+
+            THEN("the values are the same and small ones take one byte") {
+                binary_io::Reader reader{out};
+                for (uint64_t value : values) {
+                    CHECK(reader.GetVarint() == value);
+                }
+                for (int64_t value : signed_values) {
+                    CHECK(reader.GetZigzag() == value);
+                }
+                CHECK(reader.IsEnd());
+
+                std::string small;
+                binary_io::PutVarint(small, 127);
+                binary_io::PutZigzag(small, -64);
+                CHECK(small.size() == 2);
+                CHECK(out.substr(0, 5) == "\x00\x01\x7f\x80\x01"s);
+            }
+        }
+
+        WHEN("a varint is truncated") {
+            std::string out;
+            binary_io::PutVarint(out, 300);
+            out.pop_back();
+
+            THEN("reading throws") {
+                binary_io::Reader reader{out};
+                CHECK_THROWS_AS(reader.GetVarint(), std::runtime_error);
+            }
+        }
+    }
+}
+
+SCENARIO("Binary state") {
+    GIVEN("a session with two dogs and loot") {
+        std::deque<game_manager::Player> players;
+        players.push_back(MakePlayer(3, 10.5, 0.));
+        players.push_back(MakePlayer(300, 0., 2.25));
+        players[0].state.speed = {-1.5, 0.};
+        players[0].state.dir = move_manager::Direction::WEST;
+        players[0].score = 20;
+        players[0].items_in_bag = {{7, 1}, {8, 0}};
+
+        game_manager::LootObjectsContainer objects;
+        objects.push_back({1, {4., 0.}, 7});
+        objects.push_back({0, {0., 1.}, 9});
+
+        WHEN("the whole state is encoded") {
+            std::string data = state_codec::EncodeState({players, objects});
+
+            THEN("it is read back field by field") {
+                binary_io::Reader reader{data};
+                CHECK(reader.Get<uint8_t>() == state_codec::VERSION);
+                CHECK(reader.Get<uint8_t>() == static_cast<uint8_t>(state_codec::Kind::state));
+
+                REQUIRE(reader.GetVarint() == 2);
+                CHECK(reader.GetVarint() == 3);
+                CHECK(reader.GetZigzag() == 10752);
+                CHECK(reader.GetZigzag() == 0);
+                CHECK(reader.GetZigzag() == -1536);
+                CHECK(reader.GetZigzag() == 0);
+                CHECK(reader.Get<uint8_t>() == static_cast<uint8_t>(move_manager::Direction::WEST));
+                CHECK(reader.GetVarint() == 20);
+                REQUIRE(reader.GetVarint() == 2);
+                CHECK(reader.GetVarint() == 7);
+                CHECK(reader.GetVarint() == 1);
+                CHECK(reader.GetVarint() == 8);
+                CHECK(reader.GetVarint() == 0);
+
+                CHECK(reader.GetVarint() == 300);
+                CHECK(reader.GetZigzag() == 0);
+                CHECK(reader.GetZigzag() == 2304);
+                reader.GetZigzag();
+                reader.GetZigzag();
+                reader.Get<uint8_t>();
+                CHECK(reader.GetVarint() == 0);
+                CHECK(reader.GetVarint() == 0);
+
+                REQUIRE(reader.GetVarint() == 2);
+                CHECK(reader.GetVarint() == 7);
+                CHECK(reader.GetVarint() == 1);
+                CHECK(reader.GetZigzag() == 4096);
+                CHECK(reader.GetZigzag() == 0);
+                CHECK(reader.GetVarint() == 9);
+                reader.GetVarint();
+                reader.GetZigzag();
+                CHECK(reader.GetZigzag() == 1024);
+                CHECK(reader.IsEnd());
+            }
+        }
+
+        WHEN("only a part of the state is visible") {
+            std::vector<uint32_t> visible_players{1};
+            std::vector<uint32_t> visible_objects;
+            game_manager::PlayersAndObjects state{players, objects, &visible_players, &visible_objects};
+            std::string data = state_codec::EncodeState(state);
+
+            THEN("only visible entities are written") {
+                binary_io::Reader reader{data};
+                reader.GetBytes(2);
+                REQUIRE(reader.GetVarint() == 1);
+                CHECK(reader.GetVarint() == 300);
+                reader.GetBytes(data.size() - 1 - 2 - 2 - 1);
+                CHECK(reader.GetVarint() == 0);
+                CHECK(reader.IsEnd());
+            }
+        }
+
+        WHEN("the players list is encoded") {
+            std::string data = state_codec::EncodePlayersList(players);
+
+            THEN("ids and names are written") {
+                binary_io::Reader reader{data};
+                CHECK(reader.Get<uint8_t>() == state_codec::VERSION);
+                CHECK(reader.Get<uint8_t>() == static_cast<uint8_t>(state_codec::Kind::players));
+                REQUIRE(reader.GetVarint() == 2);
+                CHECK(reader.GetVarint() == 3);
+                CHECK(reader.GetBytes(reader.GetVarint()) == players[0].name);
+                CHECK(reader.GetVarint() == 300);
+                CHECK(reader.GetBytes(reader.GetVarint()) == players[1].name);
+                CHECK(reader.IsEnd());
+            }
+        }
+    }
+}
+
+SCENARIO("Binary state negotiation") {
+    CHECK(state_codec::IsAccepted("application/x-game-state"));
+    CHECK(state_codec::IsAccepted("text/html, Application/X-Game-State;q=0.9, */*;q=0.1"));
+    CHECK(state_codec::IsAccepted("application/x-game-state; q=1"));
+    CHECK_FALSE(state_codec::IsAccepted(""));
+    CHECK_FALSE(state_codec::IsAccepted("application/json, */*"));
+    CHECK_FALSE(state_codec::IsAccepted("application/x-game-state;q=0"));
+    CHECK_FALSE(state_codec::IsAccepted("application/x-game-state-v2"));
+}
@@ -0,0 +1,202 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <filesystem>
+#include <thread>
+
+#include "../src/takeover.h"
+#include "game-fixtures.h"
+
+namespace {
+
+using game_fixtures::MakeGame;
+using game_fixtures::MakeJoin;
+
+// Вместо слушающего TCP-сокета передаётся конец pipe
+class FakeListener : public http_server::ListenerBase {
+public:
+    explicit FakeListener(int fd) : fd_(fd) {}
+
+    int GetNativeHandle() override {
+        return fd_;
+    }
+
+    void Stop(std::function<void()> on_drained, std::chrono::milliseconds) override {
+        stopped = true;
+        if (hold_drain) {
+            drained = std::move(on_drained);
+            return;
+        }
+        on_drained();
+    }
+
+    std::atomic<bool> stopped = false;
+    // Начатые запросы "обрабатываются", пока тест не вызовет drained
+    bool hold_drain = false;
+    std::function<void()> drained;
+private:
+    int fd_;
+};
+
+} // namespace
+
+SCENARIO("Descriptor passing") {
+    GIVEN("a pair of connected unix sockets and a pipe") {
+        boost::asio::io_context ioc;
+        takeover::local::socket first(ioc);
+        takeover::local::socket second(ioc);
+        boost::asio::local::connect_pair(first, second);
+
+        int pipe_fds[2];
+        REQUIRE(::pipe(pipe_fds) == 0);
+
+        WHEN("write end of the pipe is sent") {
+            takeover::SendDescriptor(first, pipe_fds[1]);
+            int received = takeover::ReceiveDescriptor(second);
+
+            THEN("received descriptor writes to the same pipe") {
+                CHECK(received != pipe_fds[1]);
+                REQUIRE(::write(received, "x", 1) == 1);
+
+                char data = 0;
+                REQUIRE(::read(pipe_fds[0], &data, 1) == 1);
+                CHECK(data == 'x');
+            }
+            ::close(received);
+        }
+
+        ::close(pipe_fds[0]);
+        ::close(pipe_fds[1]);
+    }
+}
+
+SCENARIO("Server handoff") {
+    const std::filesystem::path socket_path = std::filesystem::temp_directory_path() / "takeover-test.sock";
+    const std::filesystem::path journal_path = std::filesystem::temp_directory_path() / "takeover-test.journal";
+    std::filesystem::remove(journal_path);
+
+    GIVEN("a running server with a player") {
+        model::Game game = MakeGame();
+        boost::asio::io_context ioc;
+        game_manager::GameManager manager{game, ioc, false, 0};
+
+        std::vector<game_manager::JournalEvent> events;
+        events.push_back(MakeJoin(1, 5, "0123456789abcdef0123456789abcdef"));
+        REQUIRE(manager.Replay(std::move(events)) == 1);
+
+        int pipe_fds[2];
+        REQUIRE(::pipe(pipe_fds) == 0);
+        auto listener = std::make_shared<FakeListener>(pipe_fds[1]);
+
+        auto journal = std::make_shared<game_journal::Journal>(journal_path);
+
+        std::make_shared<takeover::Donor>(ioc, socket_path, listener, manager, nullptr, journal,
+            [&ioc] {
+                ioc.stop();
+            },
+            [](boost::system::error_code, std::string_view) {}
+        )->Run();
+
+        std::jthread server{[&ioc] {
+            ioc.run();
+        }};
+
+        WHEN("a successor takes over") {
+            auto handoff = takeover::TakeOver(socket_path);
+            server.join();
+
+            THEN("it gets the listening socket and the game state") {
+                REQUIRE(handoff.has_value());
+                CHECK(handoff->listen_fd >= 0);
+                REQUIRE(handoff->state.has_value());
+                REQUIRE(handoff->state->players.size() == 1);
+                CHECK(handoff->state->players[0].id == 5);
+                CHECK(handoff->state->players[0].token == "0123456789abcdef0123456789abcdef");
+                REQUIRE(handoff->state->sessions.size() == 1);
+                CHECK(handoff->state->sessions[0].players.size() == 1);
+
+                CHECK(listener->stopped);
+            }
+
+            THEN("the old server no longer writes to the journal") {
+                journal->Append(MakeJoin(1, 6, "fedcba9876543210fedcba9876543210"));
+                journal->Commit();
+                CHECK(std::filesystem::file_size(journal_path) == 0);
+            }
+            ::close(handoff->listen_fd);
+        }
+
+        ::close(pipe_fds[0]);
+        ::close(pipe_fds[1]);
+    }
+
+    GIVEN("a successor that hangs up before the state is sent") {
+        const std::filesystem::path state_path = std::filesystem::temp_directory_path() / "takeover-test.state";
+        std::filesystem::remove(state_path);
+
+        model::Game game = MakeGame();
+        boost::asio::io_context ioc;
+        game_manager::GameManager manager{game, ioc, false, 0};
+
+        std::vector<game_manager::JournalEvent> events;
+        events.push_back(MakeJoin(1, 5, "0123456789abcdef0123456789abcdef"));
+        REQUIRE(manager.Replay(std::move(events)) == 1);
+
+        int pipe_fds[2];
+        REQUIRE(::pipe(pipe_fds) == 0);
+        auto listener = std::make_shared<FakeListener>(pipe_fds[1]);
+        listener->hold_drain = true;
+
+        auto serializator = std::make_shared<game_serialization::Serializator>(manager, state_path.string(), 0);
+
+        bool finished = false;
+        std::make_shared<takeover::Donor>(ioc, socket_path, listener, manager, serializator, nullptr,
+            [&finished] {
+                finished = true;
+            },
+            [](boost::system::error_code, std::string_view) {}
+        )->Run();
+
+        takeover::local::socket successor(ioc);
+        successor.connect(takeover::local::endpoint(socket_path.string()));
+        while (!listener->drained) {
+            ioc.run_one();
+        }
+        ::close(takeover::ReceiveDescriptor(successor));
+        successor.close();
+
+        WHEN("the old server finishes") {
+            listener->drained();
+            ioc.restart();
+            ioc.run();
+
+            THEN("the state is saved to the file before exit") {
+                CHECK(finished);
+
+                boost::asio::io_context restored_ioc;
+                game_manager::GameManager restored{game, restored_ioc, false, 0};
+                game_serialization::Serializator{restored, state_path.string(), 0}.Load();
+                game_manager::GameRepr repr = restored.GetRepresentation();
+                REQUIRE(repr.players.size() == 1);
+                CHECK(repr.players[0].id == 5);
+            }
+        }
+
+        ::close(pipe_fds[0]);
+        ::close(pipe_fds[1]);
+        std::filesystem::remove(state_path);
+    }
+
+    GIVEN("no running server") {
+        std::filesystem::remove(socket_path);
+
+        THEN("there is nothing to take over") {
+            CHECK_FALSE(takeover::TakeOver(socket_path).has_value());
+        }
+    }
+
+    std::filesystem::remove(socket_path);
+    std::filesystem::remove(journal_path);
+}
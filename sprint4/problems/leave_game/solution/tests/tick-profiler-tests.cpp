@@ -0,0 +1,58 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <sstream>
+
+#include "../src/tick_profiler.h"
+
+SCENARIO("Tick phase profiler") {
+    using tick_profiler::Phase;
+    using tick_profiler::Profiler;
+    using tick_profiler::Span;
+
+    Profiler& profiler = Profiler::GetInstance();
+
+    GIVEN("an enabled profiler") {
+        profiler.Enable();
+
+        WHEN("nested spans are measured") {
+            {
+                Span tick{Phase::tick, 42, 3};
+                Span move{Phase::move, 42, 3};
+            }
+
+            THEN("both spans are collected with their session and entity count") {
+                auto events = profiler.Collect();
+                auto is_session = [](const chrome_trace::TraceEvent& event) {
+                    return event.args[0].second == 42;
+                };
+                CHECK(std::count_if(events.begin(), events.end(), is_session) >= 2);
+
+                auto move = std::find_if(events.begin(), events.end(), [&](const auto& event) {
+                    return is_session(event) && event.name == "move";
+                });
+                REQUIRE(move != events.end());
+                CHECK(move->args[1].first == "entities");
+                CHECK(move->args[1].second == 3);
+                CHECK(move->dur >= 0);
+            }
+
+            THEN("they are written as Chrome trace events") {
+                std::ostringstream out;
+                chrome_trace::WriteEvents(out, profiler.Collect());
+                std::string trace = out.str();
+
+                CHECK(trace.starts_with("{\"traceEvents\":["));
+                CHECK(trace.find("\"name\":\"tick\"") != std::string::npos);
+                CHECK(trace.find("\"session\":42") != std::string::npos);
+            }
+
+            THEN("phase aggregates are exported as metrics") {
+                std::ostringstream out;
+                profiler.WriteMetrics(out);
+
+                CHECK(out.str().find("game_tick_phase_duration_seconds_count{phase=\"move\"}") != std::string::npos);
+            }
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+#include "../src/ticker.h"
+
+using namespace std::literals;
+
+namespace {
+
+std::vector<std::chrono::milliseconds> Advance(ticker::Stepper& stepper, std::chrono::milliseconds elapsed) {
+    std::vector<std::chrono::milliseconds> steps;
+    stepper.Advance(elapsed, [&steps](std::chrono::milliseconds step) {
+        steps.push_back(step);
+    });
+    return steps;
+}
+
+using Steps = std::vector<std::chrono::milliseconds>;
+
+} // namespace
+
+SCENARIO("Tick stepper") {
+    GIVEN("variable step without limits") {
+        ticker::Stepper stepper;
+
+        THEN("elapsed time is one step") {
+            CHECK(Advance(stepper, 1234ms) == Steps{1234ms});
+        }
+    }
+
+    GIVEN("variable step limited by max delta") {
+        ticker::TickOptions options;
+        options.max_delta = 100ms;
+
+        WHEN("the policy is to catch up") {
+            ticker::Stepper stepper{options};
+
+            THEN("a long delta is split into bounded sub-steps") {
+                CHECK(Advance(stepper, 50ms) == Steps{50ms});
+                CHECK(Advance(stepper, 250ms) == Steps{100ms, 100ms, 50ms});
+                CHECK(stepper.GetDropped() == 0ms);
+            }
+        }
+
+        WHEN("the policy is to drop") {
+            options.overrun = ticker::OverrunPolicy::drop;
+            ticker::Stepper stepper{options};
+
+            THEN("only one step is played and the rest is counted as dropped") {
+                CHECK(Advance(stepper, 250ms) == Steps{100ms});
+                CHECK(stepper.GetDropped() == 150ms);
+            }
+        }
+    }
+
+    GIVEN("fixed step") {
+        ticker::TickOptions options;
+        options.fixed_step = 50ms;
+
+        WHEN("the policy is to catch up") {
+            ticker::Stepper stepper{options};
+
+            THEN("time is played in equal steps and the remainder is carried over") {
+                CHECK(Advance(stepper, 30ms).empty());
+                CHECK(Advance(stepper, 30ms) == Steps{50ms});
+                CHECK(stepper.GetLag() == 10ms);
+                CHECK(Advance(stepper, 140ms) == Steps{50ms, 50ms, 50ms});
+                CHECK(stepper.GetLag() == 0ms);
+            }
+        }
+
+        WHEN("the policy is to drop") {
+            options.overrun = ticker::OverrunPolicy::drop;
+            ticker::Stepper stepper{options};
+
+            THEN("a stall is played as one step") {
+                CHECK(Advance(stepper, 220ms) == Steps{50ms});
+                CHECK(stepper.GetDropped() == 150ms);
+                CHECK(stepper.GetLag() == 20ms);
+            }
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "../src/timing_wheel.h"
+
+using timing_wheel::TimingWheel;
+
+namespace {
+
+using Fired = std::vector<std::pair<int, uint64_t>>;
+
+template <typename Wheel>
+Fired Advance(Wheel& wheel, uint64_t now) {
+    Fired fired;
+    wheel.Advance(now, [&fired](int id, uint64_t deadline) {
+        fired.emplace_back(id, deadline);
+    });
+    return fired;
+}
+
+} // namespace
+
+SCENARIO("Timing wheel") {
+    TimingWheel<int> wheel;
+
+    GIVEN("deadlines on different levels") {
+        wheel.Schedule(1, 10);
+        wheel.Schedule(2, 1000);
+        wheel.Schedule(3, 300000);
+        wheel.Schedule(4, 100000000);
+        REQUIRE(wheel.GetSize() == 4);
+
+        THEN("nothing fires before the first deadline") {
+            CHECK(Advance(wheel, 9).empty());
+            CHECK(wheel.GetNextEventTime() == 10);
+        }
+
+        THEN("each deadline fires once when time reaches it") {
+            CHECK(Advance(wheel, 10) == Fired{{1, 10}});
+            CHECK(Advance(wheel, 999).empty());
+            CHECK(Advance(wheel, 1000) == Fired{{2, 1000}});
+            CHECK(Advance(wheel, 299999).empty());
+            CHECK(Advance(wheel, 300050) == Fired{{3, 300000}});
+            CHECK(Advance(wheel, 100000000) == Fired{{4, 100000000}});
+            CHECK(wheel.GetSize() == 0);
+            CHECK(wheel.GetNextEventTime() == TimingWheel<int>::NEVER);
+        }
+
+        THEN("a long jump fires everything in order") {
+            CHECK(Advance(wheel, 200000000) == Fired{{1, 10}, {2, 1000}, {3, 300000}, {4, 100000000}});
+        }
+    }
+
+    GIVEN("a deadline in the past") {
+        Advance(wheel, 100);
+        wheel.Schedule(1, 50);
+
+        THEN("it fires on the next advance") {
+            CHECK(Advance(wheel, 101) == Fired{{1, 101}});
+        }
+    }
+
+    GIVEN("many random deadlines advanced by uneven steps") {
+        std::mt19937_64 random{42};
+        std::uniform_int_distribution<uint64_t> deadlines{0, 1000000};
+        std::vector<uint64_t> expected;
+        for (int i = 0; i < 2000; ++i) {
+            expected.push_back(deadlines(random));
+            wheel.Schedule(i, expected.back());
+        }
+
+        THEN("every deadline fires exactly at the first advance reaching it") {
+            std::uniform_int_distribution<uint64_t> steps{1, 5000};
+            uint64_t now = 0;
+            uint64_t previous = 0;
+            size_t fired = 0;
+            bool in_time = true;
+            while (now <= 1000000) {
+                for (auto [id, deadline] : Advance(wheel, now)) {
+                    in_time = in_time && deadline == expected[id] && deadline <= now
+                              && (deadline > previous || (previous == 0 && deadline == 0));
+                    ++fired;
+                }
+                previous = now;
+                now += steps(random);
+            }
+            CHECK(Advance(wheel, now).size() + fired == expected.size());
+            CHECK(in_time);
+        }
+    }
+}
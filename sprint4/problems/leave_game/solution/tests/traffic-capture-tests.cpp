@@ -0,0 +1,70 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <sstream>
+
+#include "../src/traffic_capture.h"
+
+SCENARIO("Traffic capture format") {
+    using traffic_capture::Record;
+
+    GIVEN("a few records") {
+        Record join;
+        join.timestamp_us = 10;
+        join.latency_us = 250;
+        join.method = 3;
+        join.status = 200;
+        join.target = "/api/v1/game/join";
+        join.headers = {{1, "application/json"}};
+        join.body = R"({"userName":"Rex","mapId":"map1"})";
+        join.issued_token = "00000000000000000000000000000001";
+
+        Record state;
+        state.timestamp_us = 1000;
+        state.latency_us = 40;
+        state.method = 2;
+        state.status = 200;
+        state.target = "/api/v1/game/state";
+        state.headers = {{2, "Bearer 00000000000000000000000000000001"}};
+
+        WHEN("they are written and read back") {
+            std::stringstream stream;
+            traffic_capture::WriteFileHeader(stream);
+            traffic_capture::WriteRecord(stream, join);
+            traffic_capture::WriteRecord(stream, state);
+
+            THEN("the same records are read") {
+                REQUIRE(traffic_capture::ReadFileHeader(stream));
+                CHECK(traffic_capture::ReadRecord(stream) == join);
+                CHECK(traffic_capture::ReadRecord(stream) == state);
+                CHECK_FALSE(traffic_capture::ReadRecord(stream).has_value());
+            }
+        }
+
+        WHEN("the last record is truncated") {
+            std::stringstream stream;
+            traffic_capture::WriteRecord(stream, join);
+            std::string data = stream.str();
+            std::stringstream truncated{data.substr(0, data.size() - 3)};
+
+            THEN("it is not read") {
+                CHECK_FALSE(traffic_capture::ReadRecord(truncated).has_value());
+            }
+        }
+    }
+}
+
+SCENARIO("Token pseudonymization") {
+    traffic_capture::Capture& capture = traffic_capture::Capture::GetInstance();
+
+    const std::string token = "0123456789abcdef0123456789abcdef";
+    std::string pseudonym = capture.Pseudonymize(token);
+
+    CHECK(pseudonym.size() == token.size());
+    CHECK(pseudonym != token);
+    CHECK(capture.Pseudonymize(token) == pseudonym);
+    CHECK(capture.Pseudonymize("fedcba9876543210fedcba9876543210") != pseudonym);
+    CHECK(capture.PseudonymizeAuthorization("Bearer " + token) == "Bearer " + pseudonym);
+
+    CHECK(traffic_capture::FindIssuedToken(R"({"authToken":")" + token + R"(","playerId":0})") == token);
+    CHECK_FALSE(traffic_capture::FindIssuedToken(R"({"code":"badRequest"})").has_value());
+}
@@ -0,0 +1,380 @@
+// Воспроизводит запись трафика, сделанную game_server --capture-traffic,
+// и сравнивает задержки с исходным запуском.
+// С --compare-port та же запись по очереди воспроизводится на двух серверах, например собранных
+// с GAME_IO_URING и без, и сравниваются их пропускная способность и задержки.
+// Токены, выданные /join во время записи, заменяются токенами, которые выдаёт сервер при повторе
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "../src/json_keys.h"
+#include "../src/metrics.h"
+#include "../src/traffic_capture.h"
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+using tcp = net::ip::tcp;
+using namespace std::literals;
+
+namespace {
+
+struct Args {
+    std::string capture;
+    std::string host = "127.0.0.1"s;
+    std::string port = "8080"s;
+    // 0 - без пауз между запросами
+    double speed = 1.;
+    unsigned threads = 4;
+    // Второй сервер для сравнения, пусто - сравнение с исходным запуском
+    std::string compare_port;
+};
+
+[[nodiscard]] std::optional<Args> ParseCommandLine(int argc, const char* const argv[]) {
+    namespace po = boost::program_options;
+    po::options_description desc{"Allowed options"s};
+
+    Args args;
+    desc.add_options()
+    ("help,h", "produce help message")
+    ("capture", po::value(&args.capture)->value_name("file"s), "traffic capture file")
+    ("host", po::value(&args.host)->value_name("host"s), "server host (default 127.0.0.1)")
+    ("port", po::value(&args.port)->value_name("port"s), "server port (default 8080)")
+    ("speed", po::value(&args.speed)->value_name("x"s), "replay speed multiplier, 0 - as fast as possible")
+    ("threads", po::value(&args.threads)->value_name("n"s), "number of client connections")
+    ("compare-port", po::value(&args.compare_port)->value_name("port"s), "replay also to the server on this port and compare req/s and latencies, e.g. io_uring and epoll builds");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.contains("help"s)) {
+        std::cout << desc;
+        return std::nullopt;
+    }
+
+    if (!vm.contains("capture"s)) {
+        throw std::runtime_error("Capture file have not been specified"s);
+    }
+
+    args.threads = std::max(1u, args.threads);
+    return args;
+}
+
+std::vector<traffic_capture::Record> LoadCapture(const std::string& file) {
+    std::ifstream in(file, std::ios::binary);
+    if (!traffic_capture::ReadFileHeader(in)) {
+        throw std::runtime_error("Not a traffic capture file: "s + file);
+    }
+
+    std::vector<traffic_capture::Record> records;
+    while (auto record = traffic_capture::ReadRecord(in)) {
+        records.push_back(std::move(*record));
+    }
+    return records;
+}
+
+// Соответствие псевдонимов из записи токенам, выданным при повторе
+class TokenMap {
+public:
+    explicit TokenMap(const std::vector<traffic_capture::Record>& records) {
+        for (const traffic_capture::Record& record : records) {
+            if (!record.issued_token.empty()) {
+                expected_.insert(record.issued_token);
+            }
+        }
+    }
+
+    // Ждёт, пока /join, выдавший токен, не будет повторён.
+    // nullopt, если повторный /join не выдал токен
+    std::optional<std::string> Resolve(const std::string& pseudonym) {
+        if (!expected_.contains(pseudonym)) {
+            return pseudonym;
+        }
+
+        std::unique_lock lock{mutex_};
+        cv_.wait(lock, [&] {
+            return tokens_.contains(pseudonym);
+        });
+        return tokens_.at(pseudonym);
+    }
+
+    void Set(const std::string& pseudonym, std::optional<std::string> token) {
+        {
+            std::lock_guard lock{mutex_};
+            tokens_[pseudonym] = std::move(token);
+        }
+        cv_.notify_all();
+    }
+private:
+    std::unordered_set<std::string> expected_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::unordered_map<std::string, std::optional<std::string>> tokens_;
+};
+
+struct Result {
+    metrics::Route route;
+    uint32_t original_us;
+    uint32_t replay_us;
+    bool status_changed;
+};
+
+class Client {
+public:
+    Client(const std::string& host, const std::string& port)
+        : host_(host)
+        , endpoints_(tcp::resolver{ioc_}.resolve(host, port)) {
+    }
+
+    http::response<http::string_body> Send(http::request<http::string_body>& req) {
+        req.set(http::field::host, host_);
+        req.keep_alive(true);
+        req.prepare_payload();
+
+        // Сервер мог закрыть соединение - одна повторная попытка
+        for (int attempt = 0;; ++attempt) {
+            try {
+                if (!connected_) {
+                    stream_.connect(endpoints_);
+                    connected_ = true;
+                }
+                http::write(stream_, req);
+                http::response<http::string_body> res;
+                http::read(stream_, buffer_, res);
+                if (!res.keep_alive()) {
+                    Close();
+                }
+                return res;
+            } catch (const std::exception&) {
+                Close();
+                if (attempt > 0) {
+                    throw;
+                }
+            }
+        }
+    }
+private:
+    void Close() {
+        beast::error_code ec;
+        stream_.socket().shutdown(tcp::socket::shutdown_both, ec);
+        stream_.close();
+        buffer_.clear();
+        connected_ = false;
+    }
+
+    net::io_context ioc_;
+    std::string host_;
+    tcp::resolver::results_type endpoints_;
+    beast::tcp_stream stream_{ioc_};
+    beast::flat_buffer buffer_;
+    bool connected_ = false;
+};
+
+// Возвращает false, если запрос пришлось пропустить
+bool PrepareRequest(const traffic_capture::Record& record, TokenMap& tokens,
+                    http::request<http::string_body>& req) {
+    req.method(static_cast<http::verb>(record.method));
+    req.target(record.target);
+    req.version(11);
+    req.body() = record.body;
+
+    for (const auto& [field, value] : record.headers) {
+        auto http_field = static_cast<http::field>(field);
+        if (http_field == http::field::authorization && value.starts_with(json_keys::token_prefix)) {
+            auto token = tokens.Resolve(value.substr(json_keys::token_prefix.size()));
+            if (!token) {
+                return false;
+            }
+            req.set(http_field, json_keys::token_prefix + *token);
+        } else {
+            req.set(http_field, value);
+        }
+    }
+    return true;
+}
+
+void Replay(const Args& args, const std::string& port, const std::vector<traffic_capture::Record>& records,
+            std::vector<std::optional<Result>>& results) {
+    TokenMap tokens{records};
+    std::atomic<size_t> next = 0;
+    const auto start = std::chrono::steady_clock::now();
+
+    auto worker = [&] {
+        Client client{args.host, port};
+
+        for (size_t i = next++; i < records.size(); i = next++) {
+            const traffic_capture::Record& record = records[i];
+
+            if (args.speed > 0) {
+                auto offset = std::chrono::microseconds{static_cast<int64_t>(record.timestamp_us / args.speed)};
+                std::this_thread::sleep_until(start + offset);
+            }
+
+            http::request<http::string_body> req;
+            if (!PrepareRequest(record, tokens, req)) {
+                continue;
+            }
+
+            auto sent = std::chrono::steady_clock::now();
+            http::response<http::string_body> res;
+            try {
+                res = client.Send(req);
+            } catch (const std::exception& ex) {
+                std::cerr << record.target << ": "sv << ex.what() << std::endl;
+                if (!record.issued_token.empty()) {
+                    tokens.Set(record.issued_token, std::nullopt);
+                }
+                continue;
+            }
+            auto latency = std::chrono::steady_clock::now() - sent;
+
+            if (!record.issued_token.empty()) {
+                auto token = traffic_capture::FindIssuedToken(res.body());
+                tokens.Set(record.issued_token, token ? std::optional{std::string{*token}} : std::nullopt);
+            }
+
+            results[i] = Result{
+                metrics::GetRoute(record.target),
+                record.latency_us,
+                static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(latency).count()),
+                res.result_int() != record.status
+            };
+        }
+    };
+
+    std::vector<std::jthread> threads;
+    for (unsigned i = 0; i < args.threads; ++i) {
+        threads.emplace_back(worker);
+    }
+}
+
+uint32_t GetPercentile(std::vector<uint32_t>& values, double percentile) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t index = std::min(values.size() - 1, static_cast<size_t>(percentile * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+void PrintReport(const std::vector<std::optional<Result>>& results) {
+    struct RouteStats {
+        std::vector<uint32_t> original;
+        std::vector<uint32_t> replay;
+        size_t status_changed = 0;
+    };
+    std::map<std::string_view, RouteStats> routes;
+    size_t skipped = 0;
+
+    for (const std::optional<Result>& result : results) {
+        if (!result) {
+            ++skipped;
+            continue;
+        }
+        RouteStats& stats = routes[metrics::GetRouteName(result->route)];
+        stats.original.push_back(result->original_us);
+        stats.replay.push_back(result->replay_us);
+        stats.status_changed += result->status_changed;
+    }
+
+    std::cout << std::left << std::setw(10) << "route"sv << std::right << std::setw(8) << "count"sv;
+    for (std::string_view p : {"p50"sv, "p90"sv, "p99"sv}) {
+        std::cout << std::setw(11) << p << " orig"sv << std::setw(11) << p << " new"sv;
+    }
+    std::cout << std::setw(10) << "status!="sv << '\n';
+
+    for (auto& [name, stats] : routes) {
+        std::cout << std::left << std::setw(10) << name << std::right << std::setw(8) << stats.original.size();
+        for (double p : {0.5, 0.9, 0.99}) {
+            std::cout << std::setw(13) << GetPercentile(stats.original, p) << "us"sv
+                      << std::setw(12) << GetPercentile(stats.replay, p) << "us"sv;
+        }
+        std::cout << std::setw(10) << stats.status_changed << '\n';
+    }
+    std::cout << "skipped: "sv << skipped << '\n';
+}
+
+struct Run {
+    std::string port;
+    std::vector<std::optional<Result>> results;
+    std::chrono::steady_clock::duration elapsed;
+};
+
+// Сводка по серверам в соседних столбцах
+void PrintComparison(const std::vector<Run>& runs) {
+    std::cout << std::left << std::setw(12) << "port"sv << std::right << std::setw(10) << "requests"sv
+              << std::setw(8) << "failed"sv << std::setw(12) << "req/s"sv << std::setw(12) << "p50"sv
+              << std::setw(12) << "p99"sv << std::setw(10) << "status!="sv << '\n';
+
+    for (const Run& run : runs) {
+        std::vector<uint32_t> latencies;
+        size_t status_changed = 0;
+        for (const std::optional<Result>& result : run.results) {
+            if (result) {
+                latencies.push_back(result->replay_us);
+                status_changed += result->status_changed;
+            }
+        }
+        double seconds = std::chrono::duration<double>(run.elapsed).count();
+        double rps = seconds > 0 ? latencies.size() / seconds : 0.;
+
+        std::cout << std::left << std::setw(12) << run.port << std::right << std::setw(10) << latencies.size()
+                  << std::setw(8) << run.results.size() - latencies.size()
+                  << std::setw(12) << std::fixed << std::setprecision(0) << rps
+                  << std::setw(10) << GetPercentile(latencies, 0.5) << "us"sv
+                  << std::setw(10) << GetPercentile(latencies, 0.99) << "us"sv
+                  << std::setw(10) << status_changed << '\n';
+    }
+}
+
+} // namespace
+
+int main(int argc, const char* argv[]) {
+    try {
+        auto args = ParseCommandLine(argc, argv);
+        if (!args) {
+            return EXIT_SUCCESS;
+        }
+
+        std::vector<traffic_capture::Record> records = LoadCapture(args->capture);
+
+        if (args->compare_port.empty()) {
+            std::vector<std::optional<Result>> results(records.size());
+            Replay(*args, args->port, records, results);
+            PrintReport(results);
+            return EXIT_SUCCESS;
+        }
+
+        // Серверы нагружаются по очереди, чтобы не делить между собой процессор
+        std::vector<Run> runs;
+        for (const std::string& port : {args->port, args->compare_port}) {
+            Run& run = runs.emplace_back(Run{port, std::vector<std::optional<Result>>(records.size()), {}});
+            auto start = std::chrono::steady_clock::now();
+            Replay(*args, port, records, run.results);
+            run.elapsed = std::chrono::steady_clock::now() - start;
+        }
+        PrintComparison(runs);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}